@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_BENCHMARKSCENE_INCLUDED
+#define BENCHMARK_BENCHMARKSCENE_INCLUDED
+
+
+#include <GLWidget.hpp>
+#include <scene/Scene.hpp>
+
+#include <QCoreApplication>
+
+
+/// Hidden OpenGL widget and scene for benchmarks which need to create objects or GPU resources
+/**
+ * A QApplication has to exist before this is created.
+ */
+class BenchmarkScene
+{
+public:
+	BenchmarkScene()
+	{
+		QCoreApplication::setOrganizationName( "Splatterlinge" );
+		QCoreApplication::setApplicationName( "Splatterlinge" );
+		mGLWidget = new GLWidget;
+		mScene = new Scene( mGLWidget );
+	}
+	~BenchmarkScene()
+	{
+		delete mScene;
+		delete mGLWidget;
+	}
+
+	GLWidget * glWidget() { return mGLWidget; }
+	Scene * scene() { return mScene; }
+
+private:
+	GLWidget * mGLWidget;
+	Scene * mScene;
+};
+
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BenchmarkScene.hpp"
+
+#include <scene/object/AObject.hpp>
+#include <scene/object/ACollisionVisitor.hpp>
+#include <utility/Sphere.hpp>
+
+#include <QApplication>
+#include <QDebug>
+
+#include <new>
+#include <stdlib.h>
+
+
+/// Number of allocations while sAllocationsCounted is set
+static int sAllocations = 0;
+static bool sAllocationsCounted = false;
+
+
+void * operator new( size_t size )
+{
+	if( sAllocationsCounted )
+		++sAllocations;
+	void * p = malloc( size ? size : 1 );
+	if( !p )
+		throw std::bad_alloc();
+	return p;
+}
+
+
+void * operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+
+void operator delete( void * p )
+{
+	free( p );
+}
+
+
+void operator delete[]( void * p )
+{
+	free( p );
+}
+
+
+/// Solid sphere
+class Ball : public AObject
+{
+public:
+	Ball( Scene * scene, const QVector3D & position, float radius ) : AObject( scene, radius )
+		{ setPosition( position ); }
+
+	virtual void visitSphereCollisions( const AObject * exclude, const float & radius,
+		QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
+	{
+		AObject::visitSphereCollisions( exclude, radius, center, normal, visitor );
+		float depth;
+		QVector3D tmpNormal;
+		if( Sphere::intersectSphere( position(), boundingSphereRadius(), center, radius, &tmpNormal, &depth ) )
+		{
+			visitor.visit( this );
+			center += tmpNormal * depth;
+			if( normal )
+				*normal = tmpNormal;
+		}
+	}
+};
+
+
+/// Field of balls kept in a spatial index
+class Field : public AObject
+{
+public:
+	Field( Scene * scene, int size ) : AObject( scene )
+	{
+		enableSpatialIndex( 8.0f );
+		for( int x = 0; x < size; ++x )
+		{
+			for( int z = 0; z < size; ++z )
+				add( QSharedPointer<AObject>( new Ball( scene, QVector3D( x*4.0f, 0.0f, z*4.0f ), 1.0f ) ) );
+		}
+	}
+};
+
+
+int main( int argc, char ** argv )
+{
+	QApplication app( argc, argv );
+	BenchmarkScene benchmark;
+	Field field( benchmark.scene(), 32 );
+
+	static const int queries = 10000;
+	int collisions = 0;
+	CollisionList<4> list;
+	QVector3D center;
+
+	// the first query may still set up lazily created state
+	field.visitSphereCollisions( NULL, 1.5f, center, NULL, list );
+
+	sAllocations = 0;
+	sAllocationsCounted = true;
+	for( int i = 0; i < queries; ++i )
+	{
+		list.clear();
+		center = QVector3D( (i*7) % 128, 0.5f, (i*13) % 128 );
+		field.visitSphereCollisions( NULL, 1.5f, center, NULL, list );
+		collisions += list.count();
+	}
+	sAllocationsCounted = false;
+	int visitorAllocations = sAllocations;
+
+	sAllocations = 0;
+	sAllocationsCounted = true;
+	for( int i = 0; i < queries; ++i )
+	{
+		center = QVector3D( (i*7) % 128, 0.5f, (i*13) % 128 );
+		collisions -= field.collideSphere( NULL, 1.5f, center ).size();
+	}
+	sAllocationsCounted = false;
+	int vectorAllocations = sAllocations;
+
+	qDebug() << queries << "queries - visitSphereCollisions():" << visitorAllocations << "allocations,"
+		<< "collideSphere():" << vectorAllocations << "allocations";
+
+	if( collisions != 0 )
+	{
+		qWarning() << "visitSphereCollisions() and collideSphere() found different collisions";
+		return 1;
+	}
+	if( visitorAllocations != 0 )
+	{
+		qWarning() << "visitSphereCollisions() allocated memory";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BenchmarkScene.hpp"
+
+#include <geometry/Terrain.hpp>
+#include <utility/Ray.hpp>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QDebug>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+static float random( float minimum, float maximum )
+{
+	return minimum + ( maximum - minimum ) * ( (float)rand() / RAND_MAX );
+}
+
+
+/// Bundles of rays leaving the same point within a narrow cone - like a shotgun blast
+static QVector<Ray> shotgunRays( const Terrain * terrain, int bundles, int raysPerBundle )
+{
+	QVector<Ray> rays;
+	rays.reserve( bundles * raysPerBundle );
+	for( int b = 0; b < bundles; ++b )
+	{
+		QVector3D origin( random( -450.0f, 450.0f ), 0.0f, random( -450.0f, 450.0f ) );
+		origin.setY( terrain->getHeight( origin ) + 2.0f );
+		const float angle = random( 0.0f, 2.0f * M_PI );
+		const QVector3D aim( cosf( angle ), random( -0.2f, 0.05f ), sinf( angle ) );
+		for( int r = 0; r < raysPerBundle; ++r )
+		{
+			const QVector3D spread( random( -0.05f, 0.05f ), random( -0.05f, 0.05f ), random( -0.05f, 0.05f ) );
+			rays.append( Ray( origin, ( aim + spread ).normalized(), 500.0f ) );
+		}
+	}
+	return rays;
+}
+
+
+/// Rays with independent origins and directions
+static QVector<Ray> scatteredRays( const Terrain * terrain, int count )
+{
+	QVector<Ray> rays;
+	rays.reserve( count );
+	for( int i = 0; i < count; ++i )
+	{
+		QVector3D origin( random( -450.0f, 450.0f ), 0.0f, random( -450.0f, 450.0f ) );
+		origin.setY( terrain->getHeight( origin ) + random( 1.0f, 20.0f ) );
+		const QVector3D direction( random( -1.0f, 1.0f ), random( -0.5f, 0.1f ), random( -1.0f, 1.0f ) );
+		rays.append( Ray( origin, direction.normalized(), 500.0f ) );
+	}
+	return rays;
+}
+
+
+static void benchmark( const char * name, const Terrain * terrain, const QVector<Ray> & rays )
+{
+	static const int repetitions = 20;
+
+	QVector<Ray> scalar;
+	QElapsedTimer timer;
+	timer.start();
+	for( int r = 0; r < repetitions; ++r )
+	{
+		scalar = rays;
+		for( int i = 0; i < scalar.size(); ++i )
+			terrain->intersectLine( scalar[i].origin, scalar[i].direction, scalar[i].length, &scalar[i].normal );
+	}
+	qint64 scalarNsecs = timer.nsecsElapsed();
+
+	QVector<Ray> packets;
+	timer.start();
+	for( int r = 0; r < repetitions; ++r )
+	{
+		packets = rays;
+		terrain->intersectLines( packets.data(), packets.size(), NULL );
+	}
+	qint64 packetNsecs = timer.nsecsElapsed();
+
+	int mismatches = 0;
+	for( int i = 0; i < rays.size(); ++i )
+	{
+		if( fabsf( scalar[i].length - packets[i].length ) > 1e-3f )
+			++mismatches;
+	}
+
+	const double scale = 1e6 * repetitions;
+	qDebug( "%-10s %6d rays: scalar %8.3f ms, packets %8.3f ms, speedup %.2fx, %d mismatches",
+		name, rays.size(), scalarNsecs / scale, packetNsecs / scale, (double)scalarNsecs / packetNsecs, mismatches );
+}
+
+
+int main( int argc, char ** argv )
+{
+	QApplication app( argc, argv );
+	BenchmarkScene scene;
+
+	Terrain terrain( "./data/landscape/earth/height.png",
+		QVector3D( 1000.0f, 50.0f, 1000.0f ), QVector3D( -500.0f, -9.5f, -500.0f ), 4, scene.scene()->jobs() );
+
+	srand( 1 );
+	benchmark( "shotgun", &terrain, shotgunRays( &terrain, 2500, 8 ) );
+	benchmark( "scattered", &terrain, scatteredRays( &terrain, 20000 ) );
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BenchmarkScene.hpp"
+
+#include <geometry/Terrain.hpp>
+#include <geometry/Vertex.hpp>
+
+#include <QApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QFile>
+#include <QDir>
+#include <QVector>
+#include <QDebug>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+static const QVector3D TerrainSize( 1000.0f, 50.0f, 1000.0f );
+static const QVector3D TerrainOffset( -500.0f, -9.5f, -500.0f );
+static const int SmoothingPasses = 4;
+
+
+/// Writes a heightmap of rolling hills with some noise
+static QString syntheticHeightMap( int side )
+{
+	QImage image( side, side, QImage::Format_RGB32 );
+	srand( side );
+	for( int y = 0; y < side; ++y )
+	{
+		QRgb * line = (QRgb*)image.scanLine( y );
+		for( int x = 0; x < side; ++x )
+		{
+			const float hills = 60.0f * sinf( x * 0.011f ) * cosf( y * 0.013f ) + 40.0f * sinf( x * 0.037f + y * 0.021f );
+			const int height = qBound( 0, (int)( 127.0f + hills ) + rand() % 9 - 4, 255 );
+			line[x] = qRgb( height, height, height );
+		}
+	}
+	const QString path = QDir::temp().filePath( QString( "splatterlingeTerrain%1.png" ).arg( side ) );
+	if( !image.save( path, "PNG" ) )
+		qFatal( "Could not write \"%s\"!", path.toLocal8Bit().constData() );
+	return path;
+}
+
+
+/// The terrain construction before it used a float height grid - the heightmap is decoded like before
+static float legacyBuild( const QString & heightMapPath )
+{
+	const QImage heightMap( heightMapPath );
+	const QSize mapSize = heightMap.size();
+	QVector<VertexP3fN3fT2f> vertices( mapSize.width() * mapSize.height() );
+
+	QVector<QVector3D> rawPositions;
+	for( int h=0; h<mapSize.height(); h++ )
+		for( int w=0; w<mapSize.width(); w++ )
+			rawPositions.push_back( TerrainOffset + QVector3D(
+				w*(TerrainSize.x()/mapSize.width()),
+				(float)qRed( heightMap.pixel( w, h ) )*(TerrainSize.y()/256.0),
+				h*(TerrainSize.z()/mapSize.height())
+			) );
+
+#define inPosition(x,y) (in[(x)+(y)*mapSize.width()])
+#define outPosition(x,y) (out[(x)+(y)*mapSize.width()])
+	for( int i=0; i<SmoothingPasses; i++ )
+	{
+		const QVector<QVector3D> in = rawPositions;
+		QVector<QVector3D> out( in.size() );
+		for( int w=0; w<mapSize.width(); w++ )
+			outPosition( w, 0 ) = inPosition( w, 0 );
+		for( int h=1; h<mapSize.height()-1; h++ )
+		{
+			outPosition( 0, h ) = inPosition( 0, h );
+			for( int w=1; w<mapSize.width()-1; w++ )
+			{
+				QVector3D smoothed = QVector3D(0,0,0);
+				smoothed += inPosition( w-1, h-1 );
+				smoothed += inPosition( w  , h-1 );
+				smoothed += inPosition( w+1, h-1 );
+				smoothed += inPosition( w-1, h   );
+				smoothed += inPosition( w  , h   )*4.0;
+				smoothed += inPosition( w+1, h   );
+				smoothed += inPosition( w-1, h+1 );
+				smoothed += inPosition( w  , h+1 );
+				smoothed += inPosition( w+1, h+1 );
+				smoothed /= 12.0f;
+				outPosition( w, h ) = smoothed;
+			}
+			outPosition( mapSize.width()-1, h ) = inPosition( mapSize.width()-1, h );
+		}
+		for( int w=0; w<mapSize.width(); w++ )
+			outPosition( w, mapSize.height()-1 ) = inPosition( w, mapSize.height()-1 );
+		rawPositions = out;
+	}
+#undef inPosition
+#undef outPosition
+
+	for( int i=0; i<vertices.size(); i++ )
+		vertices[i].position = rawPositions[i];
+	for( int h=0; h<mapSize.height()-1; h++ )
+	{
+		for( int w=0; w<mapSize.width()-1; w++ )
+			vertices[w+h*mapSize.width()].normal = QVector3D::normal(
+				vertices[w+h*mapSize.width()].position,
+				vertices[w+(h+1)*mapSize.width()].position,
+				vertices[w+1+h*mapSize.width()].position
+			);
+		vertices[mapSize.width()-1+h*mapSize.width()].normal = QVector3D(0,1,0);
+	}
+	for( int w=0; w<mapSize.width(); w++ )
+		vertices[w+(mapSize.height()-1)*mapSize.width()].normal = QVector3D(0,1,0);
+	for( int h=0; h<mapSize.height(); h++ )
+		for( int w=0; w<mapSize.width(); w++ )
+			vertices[w+h*mapSize.width()].texCoord = QVector2D( w, h );
+
+	return vertices[vertices.size()/2].position.y();
+}
+
+
+/// Builds a terrain without a cache file - the cache written is removed afterwards
+/**
+ * Besides the vertices this decodes and hashes the heightmap, builds the chunks, writes the cache and uploads to the graphics card.
+ */
+static qint64 build( const QString & heightMapPath, JobSystem * jobs )
+{
+	QFile::remove( heightMapPath + ".cache" );
+	QElapsedTimer timer;
+	timer.start();
+	{
+		Terrain terrain( heightMapPath, TerrainSize, TerrainOffset, SmoothingPasses, jobs );
+	}
+	const qint64 nsecs = timer.nsecsElapsed();
+	QFile::remove( heightMapPath + ".cache" );
+	return nsecs;
+}
+
+
+int main( int argc, char ** argv )
+{
+	QApplication app( argc, argv );
+	BenchmarkScene scene;
+
+	// the sides of the heightmaps can be given as arguments - the legacy build of 8192x8192 needs about 4 GB
+	QList<int> sides;
+	const QStringList arguments = app.arguments();
+	for( int i = 1; i < arguments.size(); ++i )
+		sides.append( arguments[i].toInt() );
+	if( sides.isEmpty() )
+		sides << 4096 << 8192;
+
+	foreach( int side, sides )
+	{
+		const QString path = syntheticHeightMap( side );
+
+		QElapsedTimer timer;
+		timer.start();
+		const float checksum = legacyBuild( path );
+		const qint64 legacyNsecs = timer.nsecsElapsed();
+		const qint64 serialNsecs = build( path, NULL );
+		const qint64 parallelNsecs = build( path, scene.scene()->jobs() );
+
+		qDebug( "%5dx%-5d %d passes: legacy %8.1f ms, grid %8.1f ms (%.2fx), grid on all cores %8.1f ms (%.2fx) [%g]",
+			side, side, SmoothingPasses, legacyNsecs / 1e6,
+			serialNsecs / 1e6, (double)legacyNsecs / serialNsecs,
+			parallelNsecs / 1e6, (double)legacyNsecs / parallelNsecs, checksum );
+
+		QFile::remove( path );
+	}
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <scene/TransformHierarchy.hpp>
+
+#include <QElapsedTimer>
+#include <QLinkedList>
+#include <QVector>
+#include <QDebug>
+
+
+/// Node of a pointer based scene graph as it was used before the TransformHierarchy
+struct LegacyNode
+{
+	LegacyNode * parent;
+	QVector3D position;
+	QQuaternion rotation;
+	QMatrix4x4 modelMatrix;
+	QLinkedList<LegacyNode*> children;
+
+	LegacyNode( LegacyNode * p ) : parent( p ) {}
+	~LegacyNode() { qDeleteAll( children ); }
+
+	void update()
+	{
+		if( parent )
+			modelMatrix = parent->modelMatrix;
+		else
+			modelMatrix.setToIdentity();
+		modelMatrix.translate( position );
+		modelMatrix.rotate( rotation );
+		foreach( LegacyNode * child, children )
+			child->update();
+	}
+};
+
+
+static const int FanOut = 8;
+static const int MovedEvery = 10;
+
+
+static float benchmarkLegacy( int nodes, int frames, qint64 * nsecs )
+{
+	QVector<LegacyNode*> all;
+	all.reserve( nodes );
+	LegacyNode * root = new LegacyNode( NULL );
+	all.append( root );
+	for( int i = 1; i < nodes; ++i )
+	{
+		LegacyNode * parent = all.at( (i-1) / FanOut );
+		LegacyNode * node = new LegacyNode( parent );
+		node->position = QVector3D( i % 7, i % 5, i % 3 );
+		parent->children.append( node );
+		all.append( node );
+	}
+
+	float checksum = 0.0f;
+	QElapsedTimer timer;
+	timer.start();
+	for( int frame = 0; frame < frames; ++frame )
+	{
+		for( int i = frame % MovedEvery; i < nodes; i += MovedEvery )
+			all[i]->position += QVector3D( 0.0f, 0.001f, 0.0f );
+		root->update();
+		for( int i = 0; i < nodes; ++i )
+			checksum += all.at(i)->modelMatrix(1,3);
+	}
+	*nsecs = timer.nsecsElapsed();
+
+	delete root;
+	return checksum;
+}
+
+
+static float benchmarkHierarchy( int nodes, int frames, qint64 * nsecs )
+{
+	// the hierarchy never dereferences the objects, it only checks them for NULL
+	AObject * dummy = reinterpret_cast<AObject*>( &nodes );
+	TransformHierarchy hierarchy;
+	QVector<int> handles;
+	handles.reserve( nodes );
+	handles.append( hierarchy.insert( dummy ) );
+	for( int i = 1; i < nodes; ++i )
+	{
+		int handle = hierarchy.insert( dummy );
+		hierarchy.setParent( handle, handles.at( (i-1) / FanOut ) );
+		hierarchy.setPosition( handle, QVector3D( i % 7, i % 5, i % 3 ) );
+		handles.append( handle );
+	}
+
+	float checksum = 0.0f;
+	QElapsedTimer timer;
+	timer.start();
+	for( int frame = 0; frame < frames; ++frame )
+	{
+		for( int i = frame % MovedEvery; i < nodes; i += MovedEvery )
+			hierarchy.setPosition( handles.at(i), hierarchy.position( handles.at(i) ) + QVector3D( 0.0f, 0.001f, 0.0f ) );
+		hierarchy.propagate();
+		for( int i = 0; i < nodes; ++i )
+			checksum += hierarchy.worldMatrix( handles.at(i) )(1,3);
+	}
+	*nsecs = timer.nsecsElapsed();
+
+	return checksum;
+}
+
+
+int main( int argc, char ** argv )
+{
+	Q_UNUSED( argc );
+	Q_UNUSED( argv );
+
+	static const int sizes[] = { 1000, 10000, 100000 };
+	for( unsigned int s = 0; s < sizeof(sizes)/sizeof(sizes[0]); ++s )
+	{
+		int nodes = sizes[s];
+		int frames = qMax( 10, 10000000 / nodes );
+		qint64 legacyNsecs, hierarchyNsecs;
+		float legacySum = benchmarkLegacy( nodes, frames, &legacyNsecs );
+		float hierarchySum = benchmarkHierarchy( nodes, frames, &hierarchyNsecs );
+		if( qAbs( legacySum - hierarchySum ) > qAbs( legacySum ) * 1e-3f )
+			qWarning() << "Results differ for" << nodes << "nodes:" << legacySum << hierarchySum;
+		qDebug( "%6d nodes: legacy %8.3f ms/frame, hierarchy %8.3f ms/frame, speedup %.2fx",
+			nodes,
+			legacyNsecs / 1e6 / frames,
+			hierarchyNsecs / 1e6 / frames,
+			(double)legacyNsecs / hierarchyNsecs );
+	}
+
+	return 0;
+}
@@ -4,15 +4,46 @@
 varying vec3 vNormal, vVertex;
 varying vec3 vLightPos[MAX_LIGHTS];
 
+#ifdef INSTANCED
+// model matrix of the instance - the model view matrix only holds the view matrix then
+attribute mat4 instanceMatrix;
+#endif
+
+#ifdef TERRAIN
+// provided by terrainGrid.vert
+vec4 terrainVertex();
+vec3 terrainNormal();
+#endif
+
 
 void main()
 {
+#if defined( INSTANCED )
+	vec4 vertex = gl_ModelViewMatrix * instanceMatrix * gl_Vertex;
+#elif defined( TERRAIN )
+	vec4 gridVertex = terrainVertex();
+	vec4 vertex = gl_ModelViewMatrix * gridVertex;
+#else
 	vec4 vertex = gl_ModelViewMatrix * gl_Vertex;
+#endif
 	vVertex = vec3( vertex );
 	gl_ClipVertex = vertex;
+#if defined( INSTANCED )
+	gl_Position = gl_ProjectionMatrix * vertex;
+	vNormal = gl_NormalMatrix * ( mat3( instanceMatrix ) * gl_Normal );
+#elif defined( TERRAIN )
+	gl_Position = gl_ProjectionMatrix * vertex;
+	vNormal = gl_NormalMatrix * terrainNormal();
+#else
 	gl_Position = ftransform();
-	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
 	vNormal = gl_NormalMatrix * gl_Normal;
+#endif
+#ifdef TERRAIN
+	// heightmap coordinates
+	gl_TexCoord[0] = gl_TextureMatrix[0] * vec4( gridVertex.xy, 0.0, 1.0 );
+#else
+	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+#endif
 	gl_FrontColor = gl_Color;
 
 	for( int i=0; i<MAX_LIGHTS; ++i )
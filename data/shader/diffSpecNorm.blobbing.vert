@@ -4,16 +4,23 @@
 varying vec3 vNormal, vVertex;
 varying vec3 vLightPos[MAX_LIGHTS];
 
+// provided by terrainGrid.vert
+vec4 terrainVertex();
+vec3 terrainNormal();
+
 
 void main()
 {
-	vec4 vertex = gl_ModelViewMatrix * gl_Vertex;
+	vec4 gridVertex = terrainVertex();
+	vec4 vertex = gl_ModelViewMatrix * gridVertex;
 	vVertex = vec3( vertex );
 	gl_ClipVertex = vertex;
-	gl_Position = ftransform();
-	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
-	gl_TexCoord[1] = gl_TextureMatrix[1] * gl_MultiTexCoord0;
-	vNormal = gl_NormalMatrix * gl_Normal;
+	gl_Position = gl_ProjectionMatrix * vertex;
+	// heightmap coordinates
+	vec4 texCoord = vec4( gridVertex.xy, 0.0, 1.0 );
+	gl_TexCoord[0] = gl_TextureMatrix[0] * texCoord;
+	gl_TexCoord[1] = gl_TextureMatrix[1] * texCoord;
+	vNormal = gl_NormalMatrix * terrainNormal();
 	gl_FrontColor = gl_Color;
 
 	for( int i=0; i<MAX_LIGHTS; ++i )
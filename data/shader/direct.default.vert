@@ -2,13 +2,26 @@
 
 varying vec3 vVertex;
 
+#ifdef INSTANCED
+// model matrix of the instance - the model view matrix only holds the view matrix then
+attribute mat4 instanceMatrix;
+#endif
+
 
 void main()
 {
+#ifdef INSTANCED
+	vec4 vertex = gl_ModelViewMatrix * instanceMatrix * gl_Vertex;
+#else
 	vec4 vertex = gl_ModelViewMatrix * gl_Vertex;
+#endif
 	vVertex = vec3( vertex );
 	gl_ClipVertex = vertex;
+#ifdef INSTANCED
+	gl_Position = gl_ProjectionMatrix * vertex;
+#else
 	gl_Position = ftransform();
+#endif
 	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
 	gl_FrontColor = gl_Color;
 }
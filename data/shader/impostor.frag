@@ -0,0 +1,42 @@
+#version 120
+#define MAX_LIGHTS 2
+
+varying vec3 vNormal, vVertex;
+varying vec3 vLightPos[MAX_LIGHTS];
+varying float vFade;
+
+uniform sampler2D atlas;	// the model's colors lit by ambient light only
+
+
+void main()
+{
+	vec4 colorFromMap = texture2D( atlas, gl_TexCoord[0].st );
+
+	// fades in by discarding less and less fragments - needs neither sorting nor blending
+	float threshold = fract( sin( dot( gl_FragCoord.xy, vec2( 12.9898, 78.233 ) ) ) * 43758.5453 );
+	if( colorFromMap.a < 0.5 || vFade <= threshold )
+		discard;
+
+	vec3 finalColor = vec3( 0.0 );
+	vec3 normal = normalize( vNormal );
+
+	for( int i=0; i<MAX_LIGHTS; ++i )
+	{
+		vec3 lightDir = normalize( vLightPos[i] );
+		float lambert = max( 0.0, dot( normal, lightDir ) );
+
+		float d = length( vLightPos[i] );
+		float attenuation = 1.0 / (
+			gl_LightSource[i].constantAttenuation +
+			gl_LightSource[i].linearAttenuation * d +
+			gl_LightSource[i].quadraticAttenuation * d*d );
+
+		finalColor +=
+			( gl_LightSource[i].ambient.rgb + gl_LightSource[i].diffuse.rgb * lambert * attenuation ) *
+			colorFromMap.rgb;
+	}
+
+	float fogFactor = clamp( -(length( vVertex )-gl_Fog.start) * gl_Fog.scale, 0.0, 1.0 );
+	vec3 finalFragment = mix( gl_Fog.color.rgb, finalColor, fogFactor );
+	gl_FragColor = vec4( finalFragment, 1.0 );
+}
@@ -0,0 +1,49 @@
+#version 120
+#define MAX_LIGHTS 2
+
+varying vec3 vNormal, vVertex;
+varying vec3 vLightPos[MAX_LIGHTS];
+varying float vFade;
+
+// model matrix of the instance - the model view matrix only holds the view matrix
+attribute mat4 instanceMatrix;
+
+uniform vec3 eyePosition;
+uniform vec3 extent;	// radius around the vertical axis, bottom and top of the model
+uniform float views;	// number of views in the atlas
+uniform vec2 fade;	// distance the billboard starts fading in and is fully opaque
+
+
+void main()
+{
+	vec3 center = instanceMatrix[3].xyz;
+	float scale = length( instanceMatrix[0].xyz );
+	vec3 toEye = eyePosition - center;
+
+	// turn around the vertical axis only - the quad stays upright like the model
+	vec3 horizontal = vec3( toEye.x, 0.0, toEye.z );
+	vec3 facing = length( horizontal ) > 0.0001 ? normalize( horizontal ) : vec3( 0.0, 0.0, 1.0 );
+	vec3 right = vec3( facing.z, 0.0, -facing.x );
+	vec3 position = center
+		+ right * ( gl_Vertex.x * extent.x * scale )
+		+ vec3( 0.0, mix( extent.y, extent.z, gl_Vertex.y ) * scale, 0.0 );
+
+	// the view rendered from the direction nearest to the eye's direction in model space
+	vec3 modelEye = transpose( mat3( instanceMatrix ) ) * toEye;
+	float view = mod( floor( atan( modelEye.x, modelEye.z ) / 6.2831853 * views + 0.5 ), views );
+	gl_TexCoord[0] = vec4( ( view + gl_Vertex.x * 0.5 + 0.5 ) / views, gl_Vertex.y, 0.0, 1.0 );
+
+	vec4 vertex = gl_ModelViewMatrix * vec4( position, 1.0 );
+	vVertex = vec3( vertex );
+	gl_ClipVertex = vertex;
+	gl_Position = gl_ProjectionMatrix * vertex;
+
+	// lit like a surface facing the eye and the sky
+	vNormal = gl_NormalMatrix * normalize( facing + vec3( 0.0, 1.0, 0.0 ) );
+	vFade = clamp( ( length( toEye ) - fade.x ) / ( fade.y - fade.x ), 0.0, 1.0 );
+
+	for( int i=0; i<MAX_LIGHTS; ++i )
+	{
+		vLightPos[i] = gl_LightSource[i].position.xyz - gl_LightSource[i].position.w * vVertex;
+	}
+}
@@ -0,0 +1,145 @@
+#version 120
+#define MAX_LIGHTS 2
+// Defined by TerrainMaterial:
+// LAYERS - number of blended materials from 1 to 5
+// NORMAL_MAPPING - use the normal and specular maps of the materials
+
+varying vec3 vNormal, vVertex;
+varying vec3 vLightPos[MAX_LIGHTS];
+
+uniform sampler2D splatMap;
+uniform vec2 splatScale;
+uniform vec2 splatOffset;
+
+uniform vec2 layerScale[LAYERS];
+uniform vec4 layerAmbient[LAYERS];
+uniform vec4 layerDiffuse[LAYERS];
+uniform vec4 layerSpecular[LAYERS];
+uniform vec4 layerEmission[LAYERS];
+uniform float layerShininess[LAYERS];
+
+uniform sampler2D diffuseMap0;
+uniform sampler2D diffuseMap1;
+uniform sampler2D diffuseMap2;
+uniform sampler2D diffuseMap3;
+uniform sampler2D diffuseMap4;
+#ifdef NORMAL_MAPPING
+uniform sampler2D normalMap0;
+uniform sampler2D normalMap1;
+uniform sampler2D normalMap2;
+uniform sampler2D normalMap3;
+uniform sampler2D normalMap4;
+uniform sampler2D specularMap0;
+uniform sampler2D specularMap1;
+uniform sampler2D specularMap2;
+uniform sampler2D specularMap3;
+uniform sampler2D specularMap4;
+#define LAYER( i, diffuseMap, normalMap, specularMap ) layer( i, diffuseMap, normalMap, specularMap )
+#else
+#define LAYER( i, diffuseMap, normalMap, specularMap ) layer( i, diffuseMap )
+#endif
+
+vec3 viewDir;
+vec3 normal;
+mat3 TBN;
+
+
+vec3 light( int i, vec3 color, vec3 surfaceNormal, vec4 specularFromMap )
+{
+	vec3 finalColor = layerEmission[i].rgb;
+	for( int l=0; l<MAX_LIGHTS; ++l )
+	{
+		finalColor += gl_LightSource[l].ambient.rgb * layerAmbient[i].rgb * color;
+
+		vec3 lightDir = normalize( vLightPos[l] );
+		float lambert = max( 0.0, dot( surfaceNormal, lightDir ) );
+
+		float d = length( vLightPos[l] );
+		float attenuation = 1.0 / (
+			gl_LightSource[l].constantAttenuation +
+			gl_LightSource[l].linearAttenuation * d +
+			gl_LightSource[l].quadraticAttenuation * d*d );
+
+		finalColor +=
+			gl_LightSource[l].diffuse.rgb *
+			layerDiffuse[i].rgb *
+			lambert * attenuation * color;
+
+		vec3 R = reflect( -lightDir, surfaceNormal );
+#ifdef NORMAL_MAPPING
+		float specular = pow( max(dot(R, viewDir), 0.0), layerShininess[i] * specularFromMap.a + 1 );
+#else
+		float specular = pow( max(dot(R, viewDir), 0.0), layerShininess[i] );
+#endif
+
+		finalColor +=
+			gl_LightSource[l].specular.rgb *
+			layerSpecular[i].rgb *
+			specular * attenuation * specularFromMap.rgb;
+	}
+	return finalColor;
+}
+
+
+#ifdef NORMAL_MAPPING
+vec4 layer( int i, sampler2D diffuseMap, sampler2D normalMap, sampler2D specularMap )
+{
+	vec2 coord = gl_TexCoord[0].st * layerScale[i];
+	vec4 colorFromMap = texture2D( diffuseMap, coord ) * gl_Color;
+	vec4 specularFromMap = texture2D( specularMap, coord );
+	vec3 normalFromMap = normalize( texture2D( normalMap, coord ).rgb * 2.0 - 1.0 );
+	vec3 color = light( i, colorFromMap.rgb, normalize( TBN * normalFromMap ), specularFromMap );
+	return vec4( color, colorFromMap.a * layerDiffuse[i].a );
+}
+#else
+vec4 layer( int i, sampler2D diffuseMap )
+{
+	vec4 colorFromMap = texture2D( diffuseMap, gl_TexCoord[0].st * layerScale[i] ) * gl_Color;
+	vec3 color = light( i, colorFromMap.rgb, normal, vec4( 1.0 ) );
+	return vec4( color, colorFromMap.a * layerDiffuse[i].a );
+}
+#endif
+
+
+void main()
+{
+	normal = normalize( vNormal );
+	viewDir = normalize( -vVertex );
+
+#ifdef NORMAL_MAPPING
+	// calculate tangent space matrix - all layers share the orientation of the base layer's texture coordinates
+	vec2 coord = gl_TexCoord[0].st * layerScale[0];
+	vec3 dpx = dFdx( vVertex );
+	vec3 dpy = dFdy( vVertex );
+	vec2 dtx = dFdx( coord );
+	vec2 dty = dFdy( coord );
+	vec3 tangent = normalize( dpx * dty.t - dpy * dtx.t );
+	vec3 binormal = normalize( -dpx * dty.s + dpy * dtx.s );
+	TBN = mat3( tangent, binormal, normal );	// the transpose of texture-to-eye space matrix
+#endif
+
+	// every layer is blended over the ones below like drawn in its own pass
+	vec4 weights = texture2D( splatMap, gl_TexCoord[0].st * splatScale + splatOffset );
+	vec4 base = LAYER( 0, diffuseMap0, normalMap0, specularMap0 );
+	vec3 finalColor = base.rgb;
+#if LAYERS > 1
+	vec4 layer1 = LAYER( 1, diffuseMap1, normalMap1, specularMap1 );
+	finalColor = mix( finalColor, layer1.rgb, layer1.a * weights.r );
+#endif
+#if LAYERS > 2
+	vec4 layer2 = LAYER( 2, diffuseMap2, normalMap2, specularMap2 );
+	finalColor = mix( finalColor, layer2.rgb, layer2.a * weights.g );
+#endif
+#if LAYERS > 3
+	vec4 layer3 = LAYER( 3, diffuseMap3, normalMap3, specularMap3 );
+	finalColor = mix( finalColor, layer3.rgb, layer3.a * weights.b );
+#endif
+#if LAYERS > 4
+	vec4 layer4 = LAYER( 4, diffuseMap4, normalMap4, specularMap4 );
+	finalColor = mix( finalColor, layer4.rgb, layer4.a * weights.a );
+#endif
+
+	float fogFactor = clamp( -(length( vVertex )-gl_Fog.start) * gl_Fog.scale, 0.0, 1.0 );
+	vec3 finalFragment = mix( gl_Fog.color.rgb, finalColor, fogFactor );
+	gl_FragColor = vec4( finalFragment, base.a );
+}
@@ -0,0 +1,28 @@
+#version 120
+#define MAX_LIGHTS 2
+
+varying vec3 vNormal, vVertex;
+varying vec3 vLightPos[MAX_LIGHTS];
+
+// provided by terrainGrid.vert
+vec4 terrainVertex();
+vec3 terrainNormal();
+
+
+void main()
+{
+	vec4 gridVertex = terrainVertex();
+	vec4 vertex = gl_ModelViewMatrix * gridVertex;
+	vVertex = vec3( vertex );
+	gl_ClipVertex = vertex;
+	gl_Position = gl_ProjectionMatrix * vertex;
+	// heightmap coordinates - each layer applies its own scale
+	gl_TexCoord[0] = vec4( gridVertex.xy, 0.0, 1.0 );
+	vNormal = gl_NormalMatrix * terrainNormal();
+	gl_FrontColor = gl_Color;
+
+	for( int i=0; i<MAX_LIGHTS; ++i )
+	{
+		vLightPos[i] = gl_LightSource[i].position.xyz - gl_LightSource[i].position.w * vVertex;
+	}
+}
@@ -0,0 +1,55 @@
+#version 120
+#extension GL_EXT_gpu_shader4 : enable
+// Linked with shaders compiled with the TERRAIN define - see TerrainGrid.
+// Terrain vertices only hold a height and a normal, the grid position is rebuilt from the vertex index.
+
+// vertices per row of the drawn block, its origin and the last vertex of the heightmap
+uniform int terrainGridWidth;
+uniform vec2 terrainGridOrigin;
+uniform vec2 terrainGridMaximum;
+// quads along the side of a tile followed by skirts - 0 if there are no skirts
+uniform float terrainTileQuads;
+
+#ifndef GL_EXT_gpu_shader4
+// column and row within the block if the vertex index is not available
+attribute vec2 terrainGridIndex;
+#endif
+
+
+vec2 terrainGridPosition()
+{
+#ifdef GL_EXT_gpu_shader4
+	int row = gl_VertexID / terrainGridWidth;
+	vec2 index = vec2( float( gl_VertexID - row*terrainGridWidth ), float( row ) );
+#else
+	vec2 index = terrainGridIndex;
+#endif
+	if( terrainTileQuads > 0.0 && index.y > terrainTileQuads )
+	{
+		// a row of skirt vertices for each border of the tile: top, right, bottom, left
+		float border = index.y - terrainTileQuads - 1.0;
+		if( border < 0.5 )
+			index = vec2( index.x, 0.0 );
+		else if( border < 1.5 )
+			index = vec2( terrainTileQuads, index.x );
+		else if( border < 2.5 )
+			index = vec2( index.x, terrainTileQuads );
+		else
+			index = vec2( 0.0, index.x );
+	}
+	return min( terrainGridOrigin + index, terrainGridMaximum );
+}
+
+
+// column, row and quantized height - the grid matrix on the modelview stack scales them to the terrain
+vec4 terrainVertex()
+{
+	return vec4( terrainGridPosition(), gl_Vertex.x, 1.0 );
+}
+
+
+// in grid coordinates like the vertex - still has to be normalized
+vec3 terrainNormal()
+{
+	return gl_Vertex.yzw;
+}
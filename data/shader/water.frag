@@ -2,12 +2,23 @@
 
 varying vec3 vVertex;
 varying vec3 vNormal;
-varying vec4 vTexCoord;
+varying vec4 vReflectionCoord;
+varying vec4 vRefractionCoord;
 
 uniform sampler2D reflectionMap;
 uniform sampler2D refractionMap;
 uniform sampler2D waterMap;
 uniform float time;
+// part of the maps covered by the viewport they were rendered with
+uniform vec2 reflectionScale;
+uniform vec2 refractionScale;
+uniform vec2 mapTexel;
+
+// keeps linear filtering from reading outside of the viewport
+vec2 viewportCoord( vec2 coord, vec2 scale )
+{
+	return clamp( coord * scale, mapTexel * 0.5, scale - mapTexel * 0.5 );
+}
 
 void main()
 {
@@ -17,14 +28,15 @@ void main()
 	fangle = pow( fangle, 2 );
 	float fresnelTerm = 1/fangle;
 
-	vec2 texCoord = vec2( vTexCoord.x / vTexCoord.w, vTexCoord.y / vTexCoord.w );
+	vec2 reflCoord = vec2( vReflectionCoord.x / vReflectionCoord.w, vReflectionCoord.y / vReflectionCoord.w );
+	vec2 refrCoord = vec2( vRefractionCoord.x / vRefractionCoord.w, vRefractionCoord.y / vRefractionCoord.w );
 	vec2 samplePos = vec2(256, 255) / 4 + time * 8 * vec2(0,1);
 	vec3 bump = vec3( texture2D( waterMap, gl_TexCoord[0].st/32 + samplePos ) );
-	vec2 perturbation = texCoord + 2 * (bump.rg - 0.5f);
-	vec2 refrPerturbation = texCoord + 0.5 * (bump.rg - 0.5f);
+	vec2 perturbation = reflCoord + 2 * (bump.rg - 0.5f);
+	vec2 refrPerturbation = refrCoord + 0.5 * (bump.rg - 0.5f);
 
-	vec3 reflection = vec3( texture2D( reflectionMap, perturbation ) );
-	vec3 refraction = vec3( texture2D( refractionMap, refrPerturbation ) );
+	vec3 reflection = vec3( texture2D( reflectionMap, viewportCoord( perturbation, reflectionScale ) ) );
+	vec3 refraction = vec3( texture2D( refractionMap, viewportCoord( refrPerturbation, refractionScale ) ) );
 
 	vec3 finalColor = mix( reflection, refraction, (1-fresnelTerm) );
 	float fogFactor = clamp( -(length( vVertex )-gl_Fog.start) * gl_Fog.scale, 0.0, 1.0 );
@@ -2,7 +2,12 @@
 
 varying vec3 vVertex;
 varying vec3 vNormal;
-varying vec4 vTexCoord;
+varying vec4 vReflectionCoord;
+varying vec4 vRefractionCoord;
+
+// the projections the maps were rendered with - they lag behind the eye between two updates
+uniform mat4 reflectionMatrix;
+uniform mat4 refractionMatrix;
 
 void main()
 {
@@ -14,7 +19,8 @@ void main()
 	);
 	vVertex = vec3( gl_ModelViewMatrix * gl_Vertex );
 	vNormal = gl_NormalMatrix * gl_Normal;
-	vTexCoord = (gl_ModelViewProjectionMatrix * gl_Vertex) * proj2Tex;
+	vReflectionCoord = (reflectionMatrix * gl_Vertex) * proj2Tex;
+	vRefractionCoord = (refractionMatrix * gl_Vertex) * proj2Tex;
 	gl_TexCoord[0].xy   = gl_MultiTexCoord0.xy;
 	gl_Position = ftransform();
 }
@@ -25,6 +25,7 @@
 
 #include <scene/Scene.hpp>
 #include <scene/object/Landscape.hpp>
+#include <utility/DrawStatistics.hpp>
 
 #include <QBoxLayout>
 #include <QCheckBox>
@@ -50,6 +51,11 @@ DebugWindow::DebugWindow( Scene * scene, QWidget * parent ) :
 	QObject::connect( mObjectBoundingSpheres, SIGNAL(stateChanged(int)), this, SLOT(setObjectBoundingSpheres(int)) );
 	mLayout->addWidget( mObjectBoundingSpheres );
 
+	mDrawStatistics = new QCheckBox( "Draw statistics" );
+	mDrawStatistics->setChecked( DrawStatistics::visible() );
+	QObject::connect( mDrawStatistics, SIGNAL(stateChanged(int)), this, SLOT(setDrawStatistics(int)) );
+	mLayout->addWidget( mDrawStatistics );
+
 	mLayout->addSpacerItem( new QSpacerItem( 50, 1, QSizePolicy::Expanding, QSizePolicy::Expanding ) );
 
 	setLayout( mLayout );
@@ -61,6 +67,7 @@ DebugWindow::~DebugWindow()
 	delete mLayout;
 	delete mWireFrame;
 	delete mObjectBoundingSpheres;
+	delete mDrawStatistics;
 }
 
 
@@ -74,3 +81,9 @@ void DebugWindow::setObjectBoundingSpheres( int enable )
 {
 	AObject::setGlobalDebugBoundingSpheres( enable );
 }
+
+
+void DebugWindow::setDrawStatistics( int enable )
+{
+	DrawStatistics::setVisible( enable );
+}
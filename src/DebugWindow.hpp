@@ -48,10 +48,12 @@ private:
 	QBoxLayout * mLayout;
 	QCheckBox * mWireFrame;
 	QCheckBox * mObjectBoundingSpheres;
+	QCheckBox * mDrawStatistics;
 
 public slots:
 	void setWireFrame( int enable );
 	void setObjectBoundingSpheres( int enable );
+	void setDrawStatistics( int enable );
 };
 
 
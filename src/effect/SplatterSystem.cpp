@@ -27,6 +27,7 @@
 #include <geometry/Terrain.hpp>
 #include <utility/Interpolation.hpp>
 #include <utility/RandomNumber.hpp>
+#include <utility/CommandBuffer.hpp>
 #include <resource/Material.hpp>
 #include <resource/AudioSample.hpp>
 
@@ -34,15 +35,30 @@
 #include <float.h>
 
 
+/// Deferred call to SplatterSystem::spray
+class SprayCommand : public CommandBuffer::ACommand
+{
+public:
+	SprayCommand( SplatterSystem * system, const QVector3D & source, float size ) :
+		mSystem( system ), mSource( source ), mSize( size ) {}
+	virtual void execute() { mSystem->spray( mSource, mSize ); }
+private:
+	SplatterSystem * mSystem;
+	QVector3D mSource;
+	float mSize;
+};
+
+
 SplatterSystem::SplatterSystem( GLWidget * glWidget, Terrain * terrain,
 		const QString & splatterMaterialName, const QString & particleMaterialName,
 		const QString & burstAudioSampleName,
 		int maxSplatters, int maxParticles ) :
 	mGLWidget( glWidget ),
 	mTerrain( terrain ),
+	mCommands( NULL ),
 	mSplatters( maxSplatters )
 {
-	mSplatterMaterial = new Material( glWidget, splatterMaterialName );
+	mSplatterMaterial = new Material( glWidget, splatterMaterialName, MaterialShaderVariant::TERRAIN );
 	mParticleMaterial = new Material( glWidget, particleMaterialName );
 
 	mParticleSystem = new ParticleSystem( maxParticles );
@@ -104,11 +120,22 @@ void SplatterSystem::draw( const QMatrix4x4 & modelView )
 		if( mSplatters[i].fade <= 0.0f )
 			continue;
 
+		QRectF mapRect = mTerrain->toMapF( mSplatters[i].rect );
+		float fX( mapRect.x()-(int)mapRect.x() );
+		float fY( mapRect.y()-(int)mapRect.y() );
+		QRect drawRect
+		(
+			floorf(mapRect.x()), floorf(mapRect.y()),
+			ceilf(mapRect.width()+fX), ceilf(mapRect.height()+fY)
+		);
+		// skip splatters on chunks the landscape found outside the frustum
+		if( !mTerrain->isVisibleMap( drawRect ) )
+			continue;
+
 		QVector4D c = Interpolation::linear( QVector4D(1.0f,1.0f,1.0f,1.0f), mSplatterMaterial->constData()->emission(), sqrtf(mSplatters[i].fade) );
 		mSplatterMaterial->overrideEmission( c );
 
 		glPushMatrix();
-		QRectF mapRect = mTerrain->toMapF( mSplatters[i].rect );
 
 		// rotate around center of texture in 90 deg. steps
 		glTranslate( 0.5f, 0.5f, 0.0f );
@@ -121,13 +148,6 @@ void SplatterSystem::draw( const QMatrix4x4 & modelView )
 		glScale( 1.0/(mapRect.size().width()*(1.0f-sizeFactor)), 1.0/(mapRect.size().height()*(1.0f-sizeFactor)), 1.0 );
 		glTranslate( -mapRect.x()-border.width(), -mapRect.y()-border.height(), 0.0 );
 
-		float fX( mapRect.x()-(int)mapRect.x() );
-		float fY( mapRect.y()-(int)mapRect.y() );
-		QRect drawRect
-		(
-			floorf(mapRect.x()), floorf(mapRect.y()),
-			ceilf(mapRect.width()+fX), ceilf(mapRect.height()+fY)
-		);
 		mTerrain->drawPatchMap( drawRect );
 		glPopMatrix();
 	}
@@ -139,6 +159,12 @@ void SplatterSystem::draw( const QMatrix4x4 & modelView )
 
 void SplatterSystem::spray( const QVector3D & source, float size )
 {
+	if( mCommands && mCommands->recording() )
+	{
+		mCommands->push( new SprayCommand( this, source, size ) );
+		return;
+	}
+
 	if( size < 10.0f ) size = 10.0f;
 	if( size > 100.0f ) size = 100.0f;
 	int numToEmit = 0.5f * size;
@@ -194,3 +220,23 @@ void SplatterSystem::particleInteraction( const double & delta, ParticleSystem::
 		return;
 	particle.setLife( 0.0f );
 }
+
+
+void SplatterSystem::particleInteractions( const double & delta, ParticleSystem::Particle ** particles, int count )
+{
+	mParticleX.resize( count );
+	mParticleZ.resize( count );
+	mGroundHeights.resize( count );
+	for( int i = 0; i < count; ++i )
+	{
+		mParticleX[i] = particles[i]->position().x();
+		mParticleZ[i] = particles[i]->position().z();
+	}
+	mTerrain->getHeights( mParticleX.constData(), mParticleZ.constData(), mGroundHeights.data(), count );
+
+	for( int i = 0; i < count; ++i )
+	{
+		if( particles[i]->position().y() - mGroundHeights[i] <= -particleSystem()->size()/2.0f )
+			particles[i]->setLife( 0.0f );
+	}
+}
@@ -35,6 +35,7 @@
 class AudioSample;
 class Material;
 class Terrain;
+class CommandBuffer;
 
 
 /// Simulates splatter on a terrain
@@ -52,6 +53,7 @@ public:
 	void splat( const QVector3D & source, float size );
 
 	Material * splatterMaterial() { return mSplatterMaterial; }
+	/// Splatters are drawn on the terrain - the material has to use MaterialShaderVariant::TERRAIN
 	void setSplatterMaterial( Material * splatterMaterial ) { mSplatterMaterial = splatterMaterial; }
 
 	Material * particleMaterial() { return mParticleMaterial; }
@@ -71,8 +73,12 @@ public:
 
 	ParticleSystem * particleSystem() const { return mParticleSystem; }
 
+	/// Sets the buffer spray() is deferred to while it is recording - NULL to always spray immediately
+	void setCommandBuffer( CommandBuffer * commands ) { mCommands = commands; }
+
 	// Overrides:
 	virtual void particleInteraction( const double & delta, ParticleSystem::Particle & particle );
+	virtual void particleInteractions( const double & delta, ParticleSystem::Particle ** particles, int count );
 
 protected:
 
@@ -87,10 +93,15 @@ private:
 	};
 	GLWidget * mGLWidget;
 	Terrain * mTerrain;
+	CommandBuffer * mCommands;
 	QVector< Splatter > mSplatters;
 	ParticleSystem * mParticleSystem;
 	Material * mSplatterMaterial;
 	Material * mParticleMaterial;
+	/// Positions and ground heights of the particles handled by particleInteractions()
+	QVector<float> mParticleX;
+	QVector<float> mParticleZ;
+	QVector<float> mGroundHeights;
 	float mSplatterFadeSpeed;
 	float mSplatterDriftFactor;
 	float mBurstPitchRange;
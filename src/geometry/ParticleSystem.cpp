@@ -25,6 +25,7 @@
 
 #include <GLWidget.hpp>
 #include <utility/RandomNumber.hpp>
+#include <utility/DrawStatistics.hpp>
 
 #include <math.h>
 
@@ -49,6 +50,7 @@ void ParticleSystem::update( const double & delta )
 {
 	QVector3D deltaVelocity = mGravity * delta;
 	double powDragDelta = pow( mDrag, delta );
+	mMovedParticles.clear();
 	for( int i=0; i<mParticles.size(); ++i )
 	{
 		if( mParticles[i].life() <= 0.0f )
@@ -57,9 +59,10 @@ void ParticleSystem::update( const double & delta )
 		mParticles[i].rVelocity() *= powDragDelta;
 		mParticles[i].rVelocity() += deltaVelocity;
 		mParticles[i].rLife() -= delta;
-		if( mInteractionCallback )
-			mInteractionCallback->particleInteraction( delta, mParticles[i] );
+		mMovedParticles.append( &mParticles[i] );
 	}
+	if( mInteractionCallback && !mMovedParticles.isEmpty() )
+		mInteractionCallback->particleInteractions( delta, mMovedParticles.data(), mMovedParticles.size() );
 }
 
 
@@ -135,6 +138,7 @@ void ParticleSystem::draw( const QMatrix4x4 & modelView )
 		glTexCoordPointer( 2, GL_FLOAT, sizeof(VertexP3fN3fT2f), &(mParticleVertices.constData()->texCoord) );
 
 		glDrawArrays( GL_QUADS, 0, activeVertices );
+		DrawStatistics::countDrawCall( activeVertices/2 );
 
 		VertexP3fN3fT2f::glDisableClientState();
 	}
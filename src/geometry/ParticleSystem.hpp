@@ -64,6 +64,12 @@ public:
 	{
 	public:
 		virtual void particleInteraction( const double & delta, Particle & particle ) = 0;
+		/// Called once per update with all particles moved - override to handle them in a batch
+		virtual void particleInteractions( const double & delta, Particle ** particles, int count )
+		{
+			for( int i = 0; i < count; ++i )
+				particleInteraction( delta, *particles[i] );
+		}
 	};
 
 	ParticleSystem( int capacity=1000 );
@@ -96,6 +102,8 @@ private:
 	QVector<Particle> mParticles;
 	QVector<VertexP3fN3fT2f> mParticleVertices;
 	Interactable * mInteractionCallback;
+	/// Particles moved by the last update
+	QVector<Particle*> mMovedParticles;
 };
 
 
@@ -22,223 +22,1374 @@
  */
 
 #include "Terrain.hpp"
+#include "TerrainTileCache.hpp"
+#include "TerrainGrid.hpp"
 
 #include <utility/Triangle.hpp>
+#include <utility/TrianglePacket.hpp>
+#include <utility/RayPacket.hpp>
 #include <utility/Quaternion.hpp>
+#include <utility/DrawStatistics.hpp>
+#include <utility/JobSystem.hpp>
 
 #include <QImage>
+#include <QVarLengthArray>
+#include <QFile>
+#include <QCryptographicHash>
 #include <QDebug>
 
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <stddef.h>
+#include <string.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-Terrain::Terrain( const QString & heightMapPath, const QVector3D & size, const QVector3D & offset, const int & smoothingPasses )
+
+Terrain::Terrain( const QString & heightMapPath, const QVector3D & size, const QVector3D & offset, const int & smoothingPasses, JobSystem * jobs, const int & tileRadius ) :
+	mTileFile( NULL ),
+	mTileCache( NULL )
+{
+	mSize = size;
+	mOffset = offset;
+
+	// decoding and smoothing the heightmap is slow - reuse the results of the last run if nothing changed
+	if( tileRadius > 0 )
+	{
+		openTiles( heightMapPath, smoothingPasses, jobs );
+	} else {
+		setHeightQuantization();
+		const QByteArray key = cacheKey( heightMapPath, smoothingPasses );
+		const QString cachePath = heightMapPath + ".cache";
+		if( !loadCache( cachePath, key ) )
+		{
+			// only the heights are kept - the vertices live on the graphics card
+			QVector<VertexH1sN3s> vertices;
+			buildVertices( heightMapPath, smoothingPasses, jobs, vertices );
+			buildChunks();
+			saveCache( cachePath, key, vertices );
+			createVertexBuffer( vertices.constData(), vertices.size()*VertexH1sN3s::size() );
+		}
+	}
+	if( mMapSize.width() > SHRT_MAX+1 || mMapSize.height() > SHRT_MAX+1 )
+	{
+		qFatal( "Heightmaps are limited to %dx%d pixels!", SHRT_MAX+1, SHRT_MAX+1 );
+	}
+	mToMapFactor = QSizeF( (float)mMapSize.width()/(float)mSize.x(), (float)mMapSize.height()/(float)mSize.z() );
+
+	buildHeightPyramid();
+
+	if( mTileFile )
+	{
+		setGridMatrix( mTileFile->heightBase(), mTileFile->heightStep() );
+		mTileCache = new TerrainTileCache( mTileFile, tileRadius, QSizeF( mSize.x()/mMapSize.width(), mSize.z()/mMapSize.height() ) );
+		buildCullTree();
+		return;
+	}
+
+	setGridMatrix( mOffset.y(), mHeightStep );
+	if( !TerrainGrid::vertexIndexSupported() )
+		mGridIndexStream = TerrainGrid::createIndexStream( mMapSize.width(), mMapSize.width() * mMapSize.height() );
+
+	// indices - followed by room for clipped triangles
+	mStreamCapacity = ChunkQuads * ChunkQuads * 6 * 4;
+	mStreamPosition = 0;
+	mIndexBuffer = QGLBuffer( QGLBuffer::IndexBuffer );
+	mIndexBuffer.create();
+	mIndexBuffer.bind();
+	mIndexBuffer.setUsagePattern( QGLBuffer::DynamicDraw );
+	mIndexBuffer.allocate( ( mIndices.size() + mStreamCapacity ) * sizeof(unsigned int) );
+	mIndexBuffer.write( 0, mIndices.constData(), mIndices.size()*sizeof(unsigned int) );
+	mIndexBuffer.release();
+	buildCullTree();
+}
+
+
+Terrain::~Terrain()
+{
+	delete mTileCache;
+	delete mTileFile;
+	mVertexBuffer.destroy();
+	mGridIndexStream.destroy();
+	mIndexBuffer.destroy();
+}
+
+
+/// Number of heightmap rows processed by a single job while building the vertices
+static const int sBuildRows = 32;
+/// Number of heightmap rows decoded and smoothed at once
+static const int sBandRows = 256;
+
+
+/// Runs a batch of jobs - on the calling thread if no job system is given
+template< class Job >
+static void runJobs( JobSystem * jobs, QVector<Job> & batch )
+{
+	QVector<JobSystem::AJob*> pointers( batch.size() );
+	for( int i = 0; i < batch.size(); ++i )
+		pointers[i] = &batch[i];
+	if( jobs )
+		jobs->run( pointers );
+	else
+		for( int i = 0; i < pointers.size(); ++i )
+			pointers[i]->run();
+}
+
+
+/// Base for jobs working on a block of heightmap rows
+class RowsJob : public JobSystem::AJob
+{
+public:
+	RowsJob() : first( 0 ), last( 0 ) {}
+	int first;
+	int last;
+};
+
+
+/// Reads the heights of a block of rows from the red channel of a heightmap
+class DecodeRowsJob : public RowsJob
+{
+public:
+	virtual void run()
+	{
+		for( int h = first; h < last; ++h )
+		{
+			const uchar * line = image->scanLine( h );
+			float * height = heights + (size_t)( h - top ) * image->width();
+			switch( image->format() )
+			{
+			case QImage::Format_Indexed8:
+				for( int w = 0; w < image->width(); ++w )
+					height[w] = (float)qRed( colors[line[w]] ) * scale;
+				break;
+#if QT_VERSION >= 0x050500
+			case QImage::Format_Grayscale8:
+				for( int w = 0; w < image->width(); ++w )
+					height[w] = (float)line[w] * scale;
+				break;
+#endif
+			default:
+				for( int w = 0; w < image->width(); ++w )
+					height[w] = (float)qRed( ((const QRgb*)line)[w] ) * scale;
+				break;
+			}
+		}
+	}
+	const QImage * image;
+	const QRgb * colors;
+	float * heights;	///< The rows from top on
+	int top;
+	float scale;
+};
+
+
+/// Applies a 3x3 smoothing kernel to a block of rows - the outermost vertices are kept
+class SmoothRowsJob : public RowsJob
+{
+public:
+	virtual void run()
+	{
+		for( int h = first; h < last; ++h )
+		{
+			const float * row = in + (size_t)( h - top ) * size.width();
+			float * result = out + (size_t)( h - top ) * size.width();
+			if( h == 0 || h == size.height()-1 )
+			{
+				memcpy( result, row, size.width()*sizeof(float) );
+				continue;
+			}
+			const float * above = row - size.width();
+			const float * below = row + size.width();
+			result[0] = row[0];
+			result[size.width()-1] = row[size.width()-1];
+
+			int w = 1;
+#ifdef __SSE__
+			const __m128 three = _mm_set1_ps( 3.0f );
+			const __m128 twelve = _mm_set1_ps( 12.0f );
+			for( ; w+4 <= size.width()-1; w += 4 )
+			{
+				// sums of the three columns around each of four vertices - the center is weighted 4 times
+				const __m128 left = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( above+w-1 ), _mm_loadu_ps( row+w-1 ) ), _mm_loadu_ps( below+w-1 ) );
+				const __m128 center = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( above+w ), _mm_loadu_ps( row+w ) ), _mm_loadu_ps( below+w ) );
+				const __m128 right = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( above+w+1 ), _mm_loadu_ps( row+w+1 ) ), _mm_loadu_ps( below+w+1 ) );
+				const __m128 sum = _mm_add_ps( _mm_add_ps( left, center ), _mm_add_ps( right, _mm_mul_ps( _mm_loadu_ps( row+w ), three ) ) );
+				_mm_storeu_ps( result+w, _mm_div_ps( sum, twelve ) );
+			}
+#endif
+			for( ; w < size.width()-1; ++w )
+			{
+				const float left = above[w-1] + row[w-1] + below[w-1];
+				const float center = above[w] + row[w] + below[w];
+				const float right = above[w+1] + row[w+1] + below[w+1];
+				result[w] = ( left + center + right + row[w]*3.0f ) / 12.0f;
+			}
+		}
+	}
+	const float * in;	///< The rows from top on
+	float * out;
+	int top;
+	QSize size;
+};
+
+
+/// Quantizes a vertex of a height grid to the compact format drawn from - see Terrain::setGridMatrix()
+/**
+ * The grid position is implied by the vertex index - see TerrainGrid.
+ */
+static void encodeGridVertex( const float * heights, const QSize & size, int x, int y, float heightBase, float heightStep, VertexH1sN3s & out )
+{
+	const float * height = heights + x + y*size.width();
+	out.height = (GLshort)qBound( (float)SHRT_MIN, floorf( ( height[0] - heightBase ) / heightStep + 0.5f ), (float)SHRT_MAX );
+
+	// the normal of the triangle spanned with the right and lower neighbour in grid units, which equals the
+	// terrain's normal transformed by the transpose of the grid matrix - the last row and column point up
+	float dx = 0.0f;
+	float dy = 0.0f;
+	if( x < size.width()-1 && y < size.height()-1 )
+	{
+		dx = ( height[1] - height[0] ) / heightStep;
+		dy = ( height[size.width()] - height[0] ) / heightStep;
+	}
+	const float length = sqrtf( dx*dx + dy*dy + 1.0f );
+	out.normal[0] = (GLshort)floorf( -dx / length * SHRT_MAX + 0.5f );
+	out.normal[1] = (GLshort)floorf( -dy / length * SHRT_MAX + 0.5f );
+	out.normal[2] = (GLshort)floorf( 1.0f / length * SHRT_MAX + 0.5f );
+}
+
+
+/// Encodes the vertices of a block of rows as uploaded to the graphics card
+class EncodeRowsJob : public RowsJob
+{
+public:
+	virtual void run()
+	{
+		for( int h = first; h < last; ++h )
+			for( int w = 0; w < size.width(); ++w )
+				encodeGridVertex( heights, size, w, h, heightBase, heightStep, vertices[w + h*size.width()] );
+	}
+	const float * heights;
+	VertexH1sN3s * vertices;
+	QSize size;
+	float heightBase;
+	float heightStep;
+};
+
+
+/// Splits a range of heightmap rows into a batch of jobs
+template< class Job >
+static QVector<Job> rowJobs( const Job & prototype, int first, int last )
+{
+	QVector<Job> batch;
+	for( int row = first; row < last; row += sBuildRows )
+	{
+		Job job( prototype );
+		job.first = row;
+		job.last = qMin( row + sBuildRows, last );
+		batch.append( job );
+	}
+	return batch;
+}
+
+
+/// Decodes and smoothes a heightmap in bands of rows
+/**
+ * Each smoothing pass depends on the rows next to a band, so a band is decoded with as many rows
+ * above and below as there are passes and shrinks by one row on both sides with every pass.\n
+ * Only the decoded image and the rows of the band being read are kept in memory.
+ */
+class HeightMapRows : public TerrainTileFile::AHeightSource
+{
+public:
+	HeightMapRows( const QString & heightMapPath, float scale, float offset, int smoothingPasses, JobSystem * jobs );
+
+	bool isNull() const { return mImage.isNull(); }
+	virtual QSize mapSize() const { return mImage.size(); }
+	virtual void range( float & minimum, float & maximum );
+	virtual void read( int first, int last, float * heights );
+
+private:
+	QImage mImage;
+	QVector<QRgb> mColors;
+	float mScale;
+	float mOffset;
+	int mSmoothingPasses;
+	JobSystem * mJobs;
+	QVector<float> mBand;
+	QVector<float> mSmoothed;
+};
+
+
+HeightMapRows::HeightMapRows( const QString & heightMapPath, float scale, float offset, int smoothingPasses, JobSystem * jobs ) :
+	mImage( heightMapPath ),
+	mScale( scale ),
+	mOffset( offset ),
+	mSmoothingPasses( smoothingPasses ),
+	mJobs( jobs )
+{
+	// 8 bit images are read as they are - everything else is expanded to 32 bits
+	switch( mImage.format() )
+	{
+	case QImage::Format_Invalid:
+	case QImage::Format_Indexed8:
+#if QT_VERSION >= 0x050500
+	case QImage::Format_Grayscale8:
+#endif
+	case QImage::Format_RGB32:
+	case QImage::Format_ARGB32:
+		break;
+	default:
+		mImage = mImage.convertToFormat( QImage::Format_RGB32 );
+		break;
+	}
+	mColors = mImage.colorTable();
+	mColors.resize( 256 );
+}
+
+
+void HeightMapRows::range( float & minimum, float & maximum )
+{
+	// smoothing averages the decoded heights, so it never leaves their range
+	minimum = FLT_MAX;
+	maximum = -FLT_MAX;
+	QVector<float> line( mImage.width() );
+	DecodeRowsJob decode;
+	decode.image = &mImage;
+	decode.colors = mColors.constData();
+	decode.heights = line.data();
+	decode.scale = mScale;
+	for( decode.first = 0; decode.first < mImage.height(); ++decode.first )
+	{
+		decode.top = decode.first;
+		decode.last = decode.first+1;
+		decode.run();
+		for( int w = 0; w < line.size(); ++w )
+		{
+			minimum = qMin( minimum, line[w] );
+			maximum = qMax( maximum, line[w] );
+		}
+	}
+	minimum += mOffset;
+	maximum += mOffset;
+}
+
+
+void HeightMapRows::read( int first, int last, float * heights )
+{
+	const int width = mImage.width();
+	const int height = mImage.height();
+	int top = qMax( first - mSmoothingPasses, 0 );
+	int bottom = qMin( last + mSmoothingPasses, height );
+	mBand.resize( ( bottom - top ) * width );
+	mSmoothed.resize( mBand.size() );
+
+	DecodeRowsJob decode;
+	decode.image = &mImage;
+	decode.colors = mColors.constData();
+	decode.heights = mBand.data();
+	decode.top = top;
+	decode.scale = mScale;
+	QVector<DecodeRowsJob> decodeJobs = rowJobs( decode, top, bottom );
+	runJobs( mJobs, decodeJobs );
+
+	for( int i = 0; i < mSmoothingPasses; ++i )
+	{
+		// the rows at the border of the map are kept, the others need both neighbours from the last pass
+		const int from = top > 0 ? top + i+1 : 0;
+		const int to = bottom < height ? bottom - (i+1) : height;
+		SmoothRowsJob smooth;
+		smooth.in = mBand.constData();
+		smooth.out = mSmoothed.data();
+		smooth.top = top;
+		smooth.size = mImage.size();
+		QVector<SmoothRowsJob> smoothJobs = rowJobs( smooth, from, to );
+		runJobs( mJobs, smoothJobs );
+		mBand.swap( mSmoothed );
+	}
+
+	const float * band = mBand.constData() + (size_t)( first - top ) * width;
+	for( qint64 i = 0; i < (qint64)( last - first ) * width; ++i )
+		heights[i] = band[i] + mOffset;
+}
+
+
+void Terrain::buildHeights( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs, QVector<float> & heights )
+{
+	HeightMapRows source( heightMapPath, mSize.y()/256.0, mOffset.y(), smoothingPasses, jobs );
+	if( source.isNull() )
+	{
+		qFatal( "\"%s\" not found!", heightMapPath.toLocal8Bit().constData() );
+	}
+	mMapSize = source.mapSize();
+
+	// read in bands to avoid holding more than one copy of the heights
+	heights.resize( mMapSize.width() * mMapSize.height() );
+	for( int first = 0; first < mMapSize.height(); first += sBandRows )
+	{
+		const int last = qMin( first + sBandRows, mMapSize.height() );
+		source.read( first, last, heights.data() + (size_t)first * mMapSize.width() );
+	}
+}
+
+
+void Terrain::buildVertices( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs, QVector<VertexH1sN3s> & vertices )
+{
+	buildHeights( heightMapPath, smoothingPasses, jobs, mHeights );
+
+	vertices.resize( mMapSize.width() * mMapSize.height() );
+	EncodeRowsJob encode;
+	encode.heights = mHeights.constData();
+	encode.vertices = vertices.data();
+	encode.size = mMapSize;
+	encode.heightBase = mHeightBase;
+	encode.heightStep = mHeightStep;
+	QVector<EncodeRowsJob> encodeJobs = rowJobs( encode, 0, mMapSize.height() );
+	runJobs( jobs, encodeJobs );
+}
+
+
+/// Offsets of the vertices used along a side of a chunk - the last one is clamped to the chunk's border
+static QVector<int> chunkSamples( int quads, int step )
+{
+	QVector<int> samples;
+	for( int i = 0; i < quads; i += step )
+		samples.append( i );
+	samples.append( quads );
+	return samples;
+}
+
+
+void Terrain::setGridMatrix( float heightBase, float heightStep )
+{
+	// grid position (column, row, quantized height) to terrain position - heightBase is the height of SHRT_MIN
+	const float dx = mSize.x() / mMapSize.width();
+	const float dz = mSize.z() / mMapSize.height();
+	mGridMatrix = QMatrix4x4(
+		dx,   0.0f, 0.0f,       mOffset.x(),
+		0.0f, 0.0f, heightStep, heightBase - SHRT_MIN * heightStep,
+		0.0f, dz,   0.0f,       mOffset.z(),
+		0.0f, 0.0f, 0.0f,       1.0f
+	);
+}
+
+
+void Terrain::setHeightQuantization()
+{
+	// heights are quantized to 16 bit over the terrain's volume - deformed heights are kept within it
+	mHeightStep = qMax( mSize.y() / USHRT_MAX, FLT_EPSILON );
+	mHeightBase = mOffset.y() - SHRT_MIN * mHeightStep;
+}
+
+
+void Terrain::createVertexBuffer( const void * vertices, int bytes )
+{
+	// patched by applyBrush()
+	mVertexBuffer = QGLBuffer( QGLBuffer::VertexBuffer );
+	mVertexBuffer.create();
+	mVertexBuffer.bind();
+	mVertexBuffer.setUsagePattern( QGLBuffer::DynamicDraw );
+	mVertexBuffer.allocate( vertices, bytes );
+	mVertexBuffer.release();
+}
+
+
+void Terrain::encodeVertex( int x, int y, VertexH1sN3s & out ) const
+{
+	encodeGridVertex( mHeights.constData(), mMapSize, x, y, mHeightBase, mHeightStep, out );
+}
+
+
+void Terrain::openTiles( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs )
+{
+	const QString tilesPath = heightMapPath + ".tiles";
+	const QByteArray key = tileKey( heightMapPath, smoothingPasses );
+	mTileFile = new TerrainTileFile;
+	if( !mTileFile->open( tilesPath, key ) )
+	{
+		// the heightmap has to be decoded once - afterwards only the tiles in use are read
+		HeightMapRows source( heightMapPath, mSize.y()/256.0, mOffset.y(), smoothingPasses, jobs );
+		if( source.isNull() )
+		{
+			qFatal( "\"%s\" not found!", heightMapPath.toLocal8Bit().constData() );
+		}
+		if( !TerrainTileFile::write( tilesPath, key, source, jobs ) || !mTileFile->open( tilesPath, key ) )
+		{
+			qFatal( "Could not create terrain tiles \"%s\"!", tilesPath.toLocal8Bit().constData() );
+		}
+	}
+	mMapSize = mTileFile->mapSize();
+}
+
+
+QVector3D Terrain::getVertexNormal( const int & x, const int & y ) const
+{
+	// the normal of the triangle spanned with the right and lower neighbour - like the normals drawn
+	if( x >= mMapSize.width()-1 || y >= mMapSize.height()-1 )
+		return QVector3D( 0, 1, 0 );
+	const float dx = mSize.x() / mMapSize.width();
+	const float dz = mSize.z() / mMapSize.height();
+	const float height = gridHeight( x, y );
+	return QVector3D( -dz*( gridHeight( x+1, y ) - height ), dz*dx, -dx*( gridHeight( x, y+1 ) - height ) ).normalized();
+}
+
+
+/// Layout of the terrain cache file
+/**
+ * The header is followed by the vertices in the format drawn from, the heights of the vertices,
+ * the chunks and the chunk indices.
+ */
+struct TerrainCacheHeader
+{
+	char magic[4];
+	quint32 version;
+	char key[20];
+	qint32 mapWidth;
+	qint32 mapHeight;
+	qint32 chunkColumns;
+	qint32 chunkRows;
+	qint32 vertexCount;
+	qint32 chunkCount;
+	qint32 indexCount;
+};
+
+static const char sCacheMagic[4] = { 'S', 'T', 'R', 'N' };
+static const quint32 sCacheVersion = 4;
+
+/// Size of the blocks the heightmap is hashed in
+static const qint64 sHashBlockSize = 64 * 1024;
+
+
+/// Streams a heightmap through a hash instead of reading it at once
+static void hashHeightMap( QCryptographicHash & hash, const QString & heightMapPath )
+{
+	QFile heightMapFile( heightMapPath );
+	if( heightMapFile.open( QIODevice::ReadOnly ) )
+	{
+		QByteArray block( sHashBlockSize, 0 );
+		qint64 read;
+		while( ( read = heightMapFile.read( block.data(), block.size() ) ) > 0 )
+			hash.addData( block.constData(), read );
+	}
+}
+
+
+QByteArray Terrain::cacheKey( const QString & heightMapPath, const int & smoothingPasses ) const
+{
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hashHeightMap( hash, heightMapPath );
+
+	// everything else the cached data depends on
+	const float parameters[6] = { mSize.x(), mSize.y(), mSize.z(), mOffset.x(), mOffset.y(), mOffset.z() };
+	const qint32 layout[6] = { smoothingPasses, ChunkQuads, ChunkLevels, (qint32)VertexH1sN3s::size(), (qint32)sizeof(Chunk), (qint32)sizeof(unsigned int) };
+	hash.addData( (const char*)parameters, sizeof(parameters) );
+	hash.addData( (const char*)layout, sizeof(layout) );
+
+	return hash.result();
+}
+
+
+QByteArray Terrain::tileKey( const QString & heightMapPath, const int & smoothingPasses ) const
+{
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hashHeightMap( hash, heightMapPath );
+
+	// the tiles only hold heights - the tile layout is checked by the tile file itself
+	const float parameters[2] = { mSize.y(), mOffset.y() };
+	const qint32 passes = smoothingPasses;
+	hash.addData( (const char*)parameters, sizeof(parameters) );
+	hash.addData( (const char*)&passes, sizeof(passes) );
+
+	return hash.result();
+}
+
+
+bool Terrain::loadCache( const QString & path, const QByteArray & key )
+{
+	QFile file( path );
+	if( !file.open( QIODevice::ReadOnly ) || file.size() < (qint64)sizeof(TerrainCacheHeader) )
+		return false;
+	const uchar * data = file.map( 0, file.size() );
+	if( !data )
+		return false;
+
+	TerrainCacheHeader header;
+	memcpy( &header, data, sizeof(header) );
+	const qint64 vertexBytes = (qint64)header.vertexCount * VertexH1sN3s::size();
+	const qint64 heightBytes = (qint64)header.vertexCount * sizeof(float);
+	const qint64 chunkBytes = (qint64)header.chunkCount * sizeof(Chunk);
+	const qint64 indexBytes = (qint64)header.indexCount * sizeof(unsigned int);
+	bool valid =
+		!memcmp( header.magic, sCacheMagic, sizeof(header.magic) ) &&
+		header.version == sCacheVersion &&
+		key.size() == sizeof(header.key) && !memcmp( header.key, key.constData(), sizeof(header.key) ) &&
+		header.vertexCount == header.mapWidth * header.mapHeight &&
+		header.chunkCount == header.chunkColumns * header.chunkRows &&
+		(qint64)sizeof(header) + vertexBytes + heightBytes + chunkBytes + indexBytes == file.size();
+
+	if( valid )
+	{
+		mMapSize = QSize( header.mapWidth, header.mapHeight );
+		mChunkCount = QSize( header.chunkColumns, header.chunkRows );
+		const uchar * position = data + sizeof(header);
+		// the vertices are stored as drawn - the mapped range is uploaded without an intermediate copy
+		createVertexBuffer( position, vertexBytes );
+		position += vertexBytes;
+		mHeights.resize( header.vertexCount );
+		memcpy( mHeights.data(), position, heightBytes );
+		position += heightBytes;
+		mChunks.resize( header.chunkCount );
+		memcpy( (void*)mChunks.data(), position, chunkBytes );
+		position += chunkBytes;
+		mIndices.resize( header.indexCount );
+		memcpy( mIndices.data(), position, indexBytes );
+	}
+
+	file.unmap( (uchar*)data );
+	return valid;
+}
+
+
+void Terrain::saveCache( const QString & path, const QByteArray & key, const QVector<VertexH1sN3s> & vertices ) const
+{
+	TerrainCacheHeader header;
+	memcpy( header.magic, sCacheMagic, sizeof(header.magic) );
+	header.version = sCacheVersion;
+	memcpy( header.key, key.constData(), qMin( key.size(), (int)sizeof(header.key) ) );
+	header.mapWidth = mMapSize.width();
+	header.mapHeight = mMapSize.height();
+	header.chunkColumns = mChunkCount.width();
+	header.chunkRows = mChunkCount.height();
+	header.vertexCount = vertices.size();
+	header.chunkCount = mChunks.size();
+	header.indexCount = mIndices.size();
+
+	QFile file( path );
+	bool written =
+		file.open( QIODevice::WriteOnly | QIODevice::Truncate ) &&
+		file.write( (const char*)&header, sizeof(header) ) == sizeof(header) &&
+		file.write( (const char*)vertices.constData(), vertices.size() * VertexH1sN3s::size() ) == (qint64)( vertices.size() * VertexH1sN3s::size() ) &&
+		file.write( (const char*)mHeights.constData(), mHeights.size() * sizeof(float) ) == (qint64)( mHeights.size() * sizeof(float) ) &&
+		file.write( (const char*)mChunks.constData(), mChunks.size() * sizeof(Chunk) ) == (qint64)( mChunks.size() * sizeof(Chunk) ) &&
+		file.write( (const char*)mIndices.constData(), mIndices.size() * sizeof(unsigned int) ) == (qint64)( mIndices.size() * sizeof(unsigned int) );
+	file.close();
+
+	if( !written )
+	{
+		qWarning() << "Could not write terrain cache" << path;
+		file.remove();
+	}
+}
+
+
+void Terrain::buildChunks()
+{
+	// the last chunk of a row or column absorbs a remainder smaller than half a chunk
+	const QSize quads( mMapSize.width()-1, mMapSize.height()-1 );
+	mChunkCount = QSize(
+		qMax( 1, ( quads.width() + ChunkQuads/2 ) / ChunkQuads ),
+		qMax( 1, ( quads.height() + ChunkQuads/2 ) / ChunkQuads )
+	);
+
+	mIndices.clear();
+	mChunks.resize( mChunkCount.width() * mChunkCount.height() );
+	for( int row = 0; row < mChunkCount.height(); ++row )
+	{
+		for( int column = 0; column < mChunkCount.width(); ++column )
+		{
+			Chunk & chunk = mChunks[column + row*mChunkCount.width()];
+			int x = column * ChunkQuads;
+			int y = row * ChunkQuads;
+			int width = ( column == mChunkCount.width()-1 ) ? quads.width() - x : ChunkQuads;
+			int height = ( row == mChunkCount.height()-1 ) ? quads.height() - y : ChunkQuads;
+			chunk.quads = QRect( x, y, width, height );
+
+			// a level needs at least two samples per side to have a border ring
+			chunk.maximumLevel = 0;
+			while( chunk.maximumLevel+1 < ChunkLevels && ( 2 << chunk.maximumLevel ) * 2 <= qMin( width, height ) )
+				++chunk.maximumLevel;
+			chunk.level = 0;
+
+			for( int level = 0; level <= chunk.maximumLevel; ++level )
+				buildChunkLevel( chunk, level, mIndices );
+			measureChunk( chunk );
+		}
+	}
+}
+
+
+void Terrain::measureChunk( Chunk & chunk ) const
+{
+	chunk.minimumHeight = FLT_MAX;
+	chunk.maximumHeight = -FLT_MAX;
+	for( int v = chunk.quads.top(); v <= chunk.quads.top()+chunk.quads.height(); ++v )
+	{
+		for( int u = chunk.quads.left(); u <= chunk.quads.left()+chunk.quads.width(); ++u )
+		{
+			chunk.minimumHeight = qMin( chunk.minimumHeight, getVertexPosition( u, v ).y() );
+			chunk.maximumHeight = qMax( chunk.maximumHeight, getVertexPosition( u, v ).y() );
+		}
+	}
+
+	for( int level = 0; level <= chunk.maximumLevel; ++level )
+	{
+		chunk.errors[level] = chunkLevelError( chunk, level );
+		if( level > 0 )
+			chunk.errors[level] = qMax( chunk.errors[level], chunk.errors[level-1] );
+	}
+}
+
+
+void Terrain::addTriangle( QVector<unsigned int> & indices, const QPoint & a, const QPoint & b, const QPoint & c ) const
+{
+	// keep the winding of the original mesh - (x,y), (x,y+1), (x+1,y) is front facing
+	int cross = ( b.x()-a.x() ) * ( c.y()-a.y() ) - ( b.y()-a.y() ) * ( c.x()-a.x() );
+	if( cross == 0 )
+		return;
+	const QPoint & second = cross < 0 ? b : c;
+	const QPoint & third = cross < 0 ? c : b;
+	indices.append( a.x() + a.y()*(unsigned int)mMapSize.width() );
+	indices.append( second.x() + second.y()*(unsigned int)mMapSize.width() );
+	indices.append( third.x() + third.y()*(unsigned int)mMapSize.width() );
+}
+
+
+void Terrain::buildChunkLevel( Chunk & chunk, int level, QVector<unsigned int> & indices )
+{
+	const int step = 1 << level;
+	const QPoint origin = chunk.quads.topLeft();
+	const QVector<int> xs = chunkSamples( chunk.quads.width(), step );
+	const QVector<int> ys = chunkSamples( chunk.quads.height(), step );
+	const int nx = xs.size()-1;
+	const int ny = ys.size()-1;
+
+	// interior cells - split like the original mesh
+	chunk.interior[level].offset = indices.size();
+	for( int j = 1; j < ny-1; ++j )
+	{
+		for( int i = 1; i < nx-1; ++i )
+		{
+			QPoint p00 = origin + QPoint( xs[i], ys[j] );
+			QPoint p01 = origin + QPoint( xs[i], ys[j+1] );
+			QPoint p10 = origin + QPoint( xs[i+1], ys[j] );
+			QPoint p11 = origin + QPoint( xs[i+1], ys[j+1] );
+			addTriangle( indices, p00, p01, p10 );
+			addTriangle( indices, p11, p10, p01 );
+		}
+	}
+	chunk.interior[level].count = indices.size() - chunk.interior[level].offset;
+
+	// border rings - the outer vertices either match this level or the next coarser one
+	for( int border = 0; border < 4; ++border )
+	{
+		const bool horizontal = border == 0 || border == 2;
+		const QVector<int> & along = horizontal ? xs : ys;
+		const QVector<int> & across = horizontal ? ys : xs;
+		const int length = horizontal ? chunk.quads.width() : chunk.quads.height();
+		const int outer = ( border == 0 || border == 3 ) ? 0 : across.last();
+		const int inner = ( border == 0 || border == 3 ) ? across[1] : across[across.size()-2];
+
+		for( int variant = 0; variant < 2; ++variant )
+		{
+			const QVector<int> outerSamples = chunkSamples( length, step << variant );
+			QVector<QPoint> o;
+			QVector<QPoint> in;
+			for( int i = 0; i < outerSamples.size(); ++i )
+				o.append( origin + ( horizontal ? QPoint( outerSamples[i], outer ) : QPoint( outer, outerSamples[i] ) ) );
+			for( int i = 1; i < along.size()-1; ++i )
+				in.append( origin + ( horizontal ? QPoint( along[i], inner ) : QPoint( inner, along[i] ) ) );
+
+			// zip the outer and inner vertices together
+			IndexRange & range = chunk.borders[level][border][variant];
+			range.offset = indices.size();
+			int i = 0;
+			int j = 0;
+			while( i < o.size()-1 || j < in.size()-1 )
+			{
+				int nextOuter = i < o.size()-1 ? ( horizontal ? o[i+1].x() : o[i+1].y() ) : INT_MAX;
+				int nextInner = j < in.size()-1 ? ( horizontal ? in[j+1].x() : in[j+1].y() ) : INT_MAX;
+				if( nextOuter <= nextInner )
+				{
+					addTriangle( indices, o[i], o[i+1], in[j] );
+					++i;
+				} else {
+					addTriangle( indices, o[i], in[j+1], in[j] );
+					++j;
+				}
+			}
+			range.count = indices.size() - range.offset;
+		}
+	}
+}
+
+
+float Terrain::chunkLevelError( const Chunk & chunk, int level ) const
+{
+	// compare each vertex with the triangle of the coarser level covering it
+	const int step = 1 << level;
+	const QPoint origin = chunk.quads.topLeft();
+	const QVector<int> xs = chunkSamples( chunk.quads.width(), step );
+	const QVector<int> ys = chunkSamples( chunk.quads.height(), step );
+
+	float error = 0.0f;
+	for( int j = 0; j < ys.size()-1; ++j )
+	{
+		for( int i = 0; i < xs.size()-1; ++i )
+		{
+			const float h00 = getVertexPosition( origin.x()+xs[i],   origin.y()+ys[j]   ).y();
+			const float h01 = getVertexPosition( origin.x()+xs[i],   origin.y()+ys[j+1] ).y();
+			const float h10 = getVertexPosition( origin.x()+xs[i+1], origin.y()+ys[j]   ).y();
+			const float h11 = getVertexPosition( origin.x()+xs[i+1], origin.y()+ys[j+1] ).y();
+			for( int y = ys[j]; y <= ys[j+1]; ++y )
+			{
+				for( int x = xs[i]; x <= xs[i+1]; ++x )
+				{
+					float fx = (float)( x - xs[i] ) / (float)( xs[i+1] - xs[i] );
+					float fy = (float)( y - ys[j] ) / (float)( ys[j+1] - ys[j] );
+					float interpolated;
+					if( fx + fy < 1.0f )
+						interpolated = h00 + fx*( h10-h00 ) + fy*( h01-h00 );
+					else
+						interpolated = h11 + (1.0f-fx)*( h01-h11 ) + (1.0f-fy)*( h10-h11 );
+					error = qMax( error, fabsf( getVertexPosition( origin.x()+x, origin.y()+y ).y() - interpolated ) );
+				}
+			}
+		}
+	}
+	return error;
+}
+
+
+void Terrain::updateLevelOfDetail( const QVector3D & eyePosition, float errorScale )
+{
+	if( mTileCache )
+	{
+		mTileCache->update( toMapF( eyePosition ), eyePosition.y(), errorScale );
+		return;
+	}
+
+	// coarsest level within the error bound
+	for( int i = 0; i < mChunks.size(); ++i )
+	{
+		Chunk & chunk = mChunks[i];
+		QPointF from = fromMap( chunk.quads.topLeft() );
+		QPointF to = fromMap( chunk.quads.topLeft() + QPoint( chunk.quads.width(), chunk.quads.height() ) );
+		QVector3D nearest(
+			qBound( (float)from.x(), eyePosition.x(), (float)to.x() ),
+			qBound( chunk.minimumHeight, eyePosition.y(), chunk.maximumHeight ),
+			qBound( (float)from.y(), eyePosition.z(), (float)to.y() )
+		);
+		float distance = ( nearest - eyePosition ).length();
+
+		chunk.level = 0;
+		while( chunk.level < chunk.maximumLevel && chunk.errors[chunk.level+1] * errorScale <= distance )
+			++chunk.level;
+	}
+
+	// refine chunks until no neighbours differ by more than one level
+	bool changed = true;
+	while( changed )
+	{
+		changed = false;
+		for( int row = 0; row < mChunkCount.height(); ++row )
+		{
+			for( int column = 0; column < mChunkCount.width(); ++column )
+			{
+				Chunk & chunk = mChunks[column + row*mChunkCount.width()];
+				const Chunk * neighbours[4] = {
+					this->chunk( column, row-1 ), this->chunk( column+1, row ),
+					this->chunk( column, row+1 ), this->chunk( column-1, row )
+				};
+				for( int n = 0; n < 4; ++n )
+				{
+					if( neighbours[n] && chunk.level > neighbours[n]->level + 1 )
+					{
+						chunk.level = neighbours[n]->level + 1;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+
+const Terrain::Chunk * Terrain::chunk( int column, int row ) const
+{
+	if( column < 0 || row < 0 || column >= mChunkCount.width() || row >= mChunkCount.height() )
+		return NULL;
+	return &mChunks[column + row*mChunkCount.width()];
+}
+
+
+void Terrain::appendChunk( const Chunk & chunk )
+{
+	const int column = chunk.quads.x() / ChunkQuads;
+	const int row = chunk.quads.y() / ChunkQuads;
+	const Chunk * neighbours[4] = {
+		this->chunk( column, row-1 ), this->chunk( column+1, row ),
+		this->chunk( column, row+1 ), this->chunk( column-1, row )
+	};
+
+	const IndexRange * ranges[5];
+	ranges[0] = &chunk.interior[chunk.level];
+	for( int border = 0; border < 4; ++border )
+	{
+		bool coarser = neighbours[border] && neighbours[border]->level > chunk.level;
+		ranges[border+1] = &chunk.borders[chunk.level][border][coarser ? 1 : 0];
+	}
+
+	for( int i = 0; i < 5; ++i )
+	{
+		if( ranges[i]->count == 0 )
+			continue;
+		mDrawCounts.append( ranges[i]->count );
+		mDrawOffsets.append( (const GLvoid*)( (size_t)ranges[i]->offset * sizeof(unsigned int) ) );
+	}
+}
+
+
+void Terrain::appendClippedChunk( const Chunk & chunk, const QRect & rect )
 {
-	QImage heightMap( heightMapPath );
-	if( heightMap.isNull() )
+	// collect the ranges like appendChunk() and keep the triangles touching the rectangle
+	const int counts = mDrawCounts.size();
+	appendChunk( chunk );
+	for( int i = counts; i < mDrawCounts.size(); ++i )
 	{
-		qFatal( "\"%s\" not found!", heightMapPath.toLocal8Bit().constData() );
+		IndexRange range;
+		range.offset = (int)( (size_t)mDrawOffsets[i] / sizeof(unsigned int) );
+		range.count = mDrawCounts[i];
+		appendClippedRange( range, rect );
 	}
-	mMapSize = heightMap.size();
-	mSize = size;
-	mOffset = offset;
-	mToMapFactor = QSizeF( (float)mMapSize.width()/(float)mSize.x(), (float)mMapSize.height()/(float)mSize.z() );
+	mDrawCounts.resize( counts );
+	mDrawOffsets.resize( counts );
+}
 
-	mVertices.resize( mMapSize.width() * mMapSize.height() );
 
-	// prepare positions
-	QVector<QVector3D> rawPositions;
-	for( int h=0; h<mMapSize.height(); h++ )
+void Terrain::appendClippedRange( const IndexRange & range, const QRect & rect )
+{
+	const unsigned int width = mMapSize.width();
+	for( int i = range.offset; i < range.offset + range.count; i += 3 )
 	{
-		for( int w=0; w<mMapSize.width(); w++ )
+		int minimumX = INT_MAX, maximumX = INT_MIN, minimumY = INT_MAX, maximumY = INT_MIN;
+		for( int v = 0; v < 3; ++v )
 		{
-			rawPositions.push_back( offset + QVector3D(
-				w*(mSize.x()/mMapSize.width()),
-				(float)qRed( heightMap.pixel( w, h ) )*(mSize.y()/256.0),
-				h*(mSize.z()/mMapSize.height())
-			) );
+			int x = mIndices[i+v] % width;
+			int y = mIndices[i+v] / width;
+			minimumX = qMin( minimumX, x );	maximumX = qMax( maximumX, x );
+			minimumY = qMin( minimumY, y );	maximumY = qMax( maximumY, y );
 		}
+		// the quads of the rectangle span the vertices from left/top to right+1/bottom+1
+		if( minimumX > rect.right() || maximumX <= rect.left() || minimumY > rect.bottom() || maximumY <= rect.top() )
+			continue;
+		mClippedIndices.append( mIndices[i] );
+		mClippedIndices.append( mIndices[i+1] );
+		mClippedIndices.append( mIndices[i+2] );
+	}
+}
+
+
+void Terrain::streamClippedIndices()
+{
+	// the index buffer has to be bound
+	if( mClippedIndices.size() > mStreamCapacity )
+	{
+		// grow the tail - this reuploads the chunk indices, but happens rarely
+		mStreamCapacity = qMax( mClippedIndices.size(), mStreamCapacity * 2 );
+		mIndexBuffer.allocate( ( mIndices.size() + mStreamCapacity ) * sizeof(unsigned int) );
+		mIndexBuffer.write( 0, mIndices.constData(), mIndices.size()*sizeof(unsigned int) );
+		mStreamPosition = 0;
+	}
+	if( mStreamPosition + mClippedIndices.size() > mStreamCapacity )
+		mStreamPosition = 0;	// wrap around
+
+	int offset = mIndices.size() + mStreamPosition;
+	mIndexBuffer.write( offset*sizeof(unsigned int), mClippedIndices.constData(), mClippedIndices.size()*sizeof(unsigned int) );
+	mDrawCounts.append( mClippedIndices.size() );
+	mDrawOffsets.append( (const GLvoid*)( (size_t)offset * sizeof(unsigned int) ) );
+	mStreamPosition += mClippedIndices.size();
+}
+
+
+void Terrain::drawAppended()
+{
+	uploadDirtyRects();
+	mIndexBuffer.bind();
+	if( !mClippedIndices.isEmpty() )
+		streamClippedIndices();
+
+	if( !mDrawCounts.isEmpty() )
+	{
+		glPushMatrix();
+		glMultMatrix( mGridMatrix );
+
+		// the shader rebuilds grid position and texture coordinates from the vertex index
+		mVertexBuffer.bind();
+		glEnableClientState( GL_INDEX_ARRAY );
+		VertexH1sN3s::glEnableClientState();
+		VertexH1sN3s::glPointerVBO();
+		TerrainGrid::bind( mMapSize.width(), QPoint( 0, 0 ), mMapSize, 0, mGridIndexStream.isCreated() ? &mGridIndexStream : NULL );
+
+		glMultiDrawElements( GL_TRIANGLES, mDrawCounts.constData(), GL_UNSIGNED_INT, (const GLvoid**)mDrawOffsets.constData(), mDrawCounts.size() );
+		int indices = 0;
+		for( int i = 0; i < mDrawCounts.size(); ++i )
+			indices += mDrawCounts[i];
+		DrawStatistics::countDrawCall( indices / 3 );
+
+		TerrainGrid::release();
+		glDisableClientState( GL_INDEX_ARRAY );
+		VertexH1sN3s::glDisableClientState();
+		mVertexBuffer.release();
+
+		glPopMatrix();
 	}
+	mIndexBuffer.release();
+
+	mDrawCounts.clear();
+	mDrawOffsets.clear();
+	mClippedIndices.clear();
+}
+
+
+void Terrain::drawTiles( const QRect & rect )
+{
+	glPushMatrix();
+	glMultMatrix( mGridMatrix );
+	glEnableClientState( GL_INDEX_ARRAY );
+	VertexH1sN3s::glEnableClientState();
+
+	mTileCache->draw( rect, mCellVisible );
+
+	glDisableClientState( GL_INDEX_ARRAY );
+	VertexH1sN3s::glDisableClientState();
+	glPopMatrix();
+}
+
 
-	// smoothed positions
-	for( int i=0; i<smoothingPasses; i++ )
-		rawPositions = smoothedPositions( rawPositions, mMapSize );
+void Terrain::drawPatchMap( const QRect & rect )
+{
+	QRect rectToDraw = rect.intersected( QRect( QPoint(0,0), QSize(mMapSize.width()-1,mMapSize.height()-1) ) );
+	if( rectToDraw.width() < 1 || rectToDraw.height() < 1 )
+		return;	// nothing to draw
 
-	// copy smoothed positions to vertex array
-	for( int i=0; i<mVertices.size(); i++ )
+	if( mTileCache )
 	{
-		mVertices[i].position = rawPositions[i];
+		drawTiles( rectToDraw );
+		return;
 	}
 
-	// normals
-	for( int h=0; h<mMapSize.height()-1; h++ )
+	for( int row = chunkRow( rectToDraw.top() ); row <= chunkRow( rectToDraw.bottom() ); ++row )
 	{
-		for( int w=0; w<mMapSize.width()-1; w++ )
+		for( int column = chunkColumn( rectToDraw.left() ); column <= chunkColumn( rectToDraw.right() ); ++column )
 		{
-			vertex( w, h ).normal = QVector3D::normal(
-				getVertexPosition( w,   h ),
-				getVertexPosition( w,   h+1 ),
-				getVertexPosition( w+1, h )
-			);
+			const int index = column + row*mChunkCount.width();
+			if( !mCellVisible[index] )
+				continue;
+			const Chunk & chunk = mChunks[index];
+			if( rectToDraw.contains( chunk.quads ) )
+				appendChunk( chunk );
+			else
+				appendClippedChunk( chunk, rectToDraw );
 		}
-		vertex( mMapSize.width()-1, h ).normal = QVector3D(0,1,0);	// last vertex in row
 	}
-	for( int w=0; w<mMapSize.width(); w++ )
+	drawAppended();
+}
+
+
+void Terrain::draw()
+{
+	if( mTileCache )
+	{
+		drawTiles( QRect( QPoint(0,0), QSize(mMapSize.width()-1,mMapSize.height()-1) ) );
+		return;
+	}
+
+	for( int i = 0; i < mVisibleCells.size(); ++i )
+		appendChunk( mChunks[mVisibleCells[i]] );
+	drawAppended();
+}
+
+
+void Terrain::buildCullTree()
+{
+	if( mTileFile )
 	{
-		vertex( w, mMapSize.height()-1 ).normal = QVector3D(0,1,0);	// last row
+		mCellCount = mTileFile->tileCount();
+		mCellQuads = TerrainTileFile::TileQuads;
+	} else {
+		mCellCount = mChunkCount;
+		mCellQuads = ChunkQuads;
 	}
 
-	// texture coordinates
-	for( int h=0; h<mMapSize.height(); h++ )
+	// split breadth first, so the children of a node end up next to each other
+	mCullNodes.clear();
+	mCullLeaves.resize( mCellCount.width() * mCellCount.height() );
+	CullNode root;
+	root.cells = QRect( QPoint(0,0), mCellCount );
+	root.parent = -1;
+	mCullNodes.append( root );
+	for( int i = 0; i < mCullNodes.size(); ++i )
 	{
-		for( int w=0; w<mMapSize.width(); w++ )
+		const QRect cells = mCullNodes[i].cells;
+		if( cells.width() == 1 && cells.height() == 1 )
+		{
+			mCullNodes[i].firstChild = -1;
+			mCullNodes[i].childCount = 0;
+			mCullLeaves[cells.left() + cells.top()*mCellCount.width()] = i;
+			continue;
+		}
+		const int splitX = cells.width() > 1 ? cells.left() + cells.width()/2 : cells.left() + cells.width();
+		const int splitY = cells.height() > 1 ? cells.top() + cells.height()/2 : cells.top() + cells.height();
+		mCullNodes[i].firstChild = mCullNodes.size();
+		const QRect children[4] = {
+			QRect( QPoint( cells.left(), cells.top() ), QPoint( splitX-1, splitY-1 ) ),
+			QRect( QPoint( splitX, cells.top() ), QPoint( cells.right(), splitY-1 ) ),
+			QRect( QPoint( cells.left(), splitY ), QPoint( splitX-1, cells.bottom() ) ),
+			QRect( QPoint( splitX, splitY ), QPoint( cells.right(), cells.bottom() ) )
+		};
+		for( int c = 0; c < 4; ++c )
 		{
-			vertex( w, h ).texCoord = QVector2D( w, h );
+			if( children[c].isEmpty() )
+				continue;
+			CullNode child;
+			child.cells = children[c];
+			child.parent = i;
+			mCullNodes.append( child );
 		}
+		mCullNodes[i].childCount = mCullNodes.size() - mCullNodes[i].firstChild;
 	}
-	mVertexBuffer = QGLBuffer( QGLBuffer::VertexBuffer );
-	mVertexBuffer.create();
-	mVertexBuffer.bind();
-	mVertexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-	mVertexBuffer.allocate( mVertices.data(), mVertices.size()*VertexP3fN3fT2f::size() );
-	mVertexBuffer.release();
 
-	// indices
-	QVector<unsigned int> indices;
-	for( int h=0; h<mMapSize.height()-1; ++h )
+	// children are measured before their parents
+	for( int i = mCullNodes.size()-1; i >= 0; --i )
+		measureCullNode( i );
+
+	mCellVisible.fill( true, mCullLeaves.size() );
+	mVisibleCells.resize( mCullLeaves.size() );
+	for( int i = 0; i < mVisibleCells.size(); ++i )
+		mVisibleCells[i] = i;
+}
+
+
+QRect Terrain::cellQuads( int index ) const
+{
+	if( !mTileFile )
+		return mChunks[index].quads;
+	const int T = TerrainTileFile::TileQuads;
+	const int column = index % mCellCount.width();
+	const int row = index / mCellCount.width();
+	return QRect( column*T, row*T, T, T ).intersected( QRect( 0, 0, mMapSize.width()-1, mMapSize.height()-1 ) );
+}
+
+
+void Terrain::cellHeightRange( int index, float & minimum, float & maximum ) const
+{
+	if( !mTileFile )
+	{
+		minimum = mChunks[index].minimumHeight;
+		maximum = mChunks[index].maximumHeight;
+		return;
+	}
+	// the skirts hanging below a tile have to be drawn with it
+	const TerrainTileFile::TileInfo & tile = mTileFile->tile( index % mCellCount.width(), index / mCellCount.width() );
+	minimum = tile.minimum - mTileCache->skirtSamples( index ) * mTileFile->heightStep();
+	maximum = tile.maximum;
+}
+
+
+void Terrain::measureCullNode( int index )
+{
+	CullNode & node = mCullNodes[index];
+	float minimum, maximum;
+	if( node.firstChild < 0 )
 	{
-		for( int w=0; w<mMapSize.width(); ++w )
+		cellHeightRange( node.cells.left() + node.cells.top()*mCellCount.width(), minimum, maximum );
+	} else {
+		minimum = FLT_MAX;
+		maximum = -FLT_MAX;
+		for( int c = 0; c < node.childCount; ++c )
 		{
-			indices.push_back( w + h*(unsigned int)mMapSize.width() );
-			indices.push_back( w + (h+1)*(unsigned int)mMapSize.width() );
+			const CullNode & child = mCullNodes[node.firstChild + c];
+			minimum = qMin( minimum, child.minimum.y() );
+			maximum = qMax( maximum, child.maximum.y() );
 		}
 	}
-	mIndexBuffer = QGLBuffer( QGLBuffer::IndexBuffer );
-	mIndexBuffer.create();
-	mIndexBuffer.bind();
-	mIndexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-	mIndexBuffer.allocate( indices.data(), indices.size()*sizeof(unsigned int) );
-	mIndexBuffer.release();
+	const QRect first = cellQuads( node.cells.left() + node.cells.top()*mCellCount.width() );
+	const QRect last = cellQuads( node.cells.right() + node.cells.bottom()*mCellCount.width() );
+	const QPointF from = fromMap( first.topLeft() );
+	const QPointF to = fromMap( last.bottomRight() + QPoint( 1, 1 ) );
+	node.minimum = QVector3D( from.x(), minimum, from.y() );
+	node.maximum = QVector3D( to.x(), maximum, to.y() );
 }
 
 
-Terrain::~Terrain()
+void Terrain::cull( const FrustumTest & frustum )
 {
-	mVertices.clear();
-	mVertexBuffer.destroy();
-	mIndexBuffer.destroy();
+	for( int i = 0; i < mVisibleCells.size(); ++i )
+		mCellVisible[mVisibleCells[i]] = false;
+	mVisibleCells.clear();
+	cullNode( frustum, 0, FrustumTest::AllPlanes );
 }
 
 
-QVector< QVector3D > Terrain::smoothedPositions( const QVector< QVector3D > & in, const QSize & size )
+void Terrain::cullNode( const FrustumTest & frustum, int index, unsigned int planes )
 {
-	QVector< QVector3D > out( in.size() );
+	const CullNode & node = mCullNodes[index];
+	if( frustum.testBox( node.minimum, node.maximum, planes ) == FrustumTest::OUTSIDE )
+		return;
 
-#define inPosition(x,y) (in[(x)+(y)*size.width()])
-#define outPosition(x,y) (out[(x)+(y)*size.width()])
-	for( int w=0; w<mMapSize.width(); w++ )
-		outPosition( w, 0 ) = inPosition( w, 0 );
-	for( int h=1; h<mMapSize.height()-1; h++ )
+	if( planes && node.firstChild >= 0 )
 	{
-		outPosition( 0, h ) = inPosition( 0, h );
-		for( int w=1; w<mMapSize.width()-1; w++ )
+		for( int c = 0; c < node.childCount; ++c )
+			cullNode( frustum, node.firstChild + c, planes );
+		return;
+	}
+
+	// a leaf or completely inside
+	for( int row = node.cells.top(); row <= node.cells.bottom(); ++row )
+	{
+		for( int column = node.cells.left(); column <= node.cells.right(); ++column )
 		{
-			QVector3D smoothed = QVector3D(0,0,0);
-			smoothed += inPosition( w-1, h-1 );
-			smoothed += inPosition( w  , h-1 );
-			smoothed += inPosition( w+1, h-1 );
-			smoothed += inPosition( w-1, h   );
-			smoothed += inPosition( w  , h   )*4.0;
-			smoothed += inPosition( w+1, h   );
-			smoothed += inPosition( w-1, h+1 );
-			smoothed += inPosition( w  , h+1 );
-			smoothed += inPosition( w+1, h+1 );
-			smoothed /= 12.0f;
-			outPosition( w, h ) = smoothed;
+			const int cell = column + row*mCellCount.width();
+			mCellVisible[cell] = true;
+			mVisibleCells.append( cell );
 		}
-		outPosition( mMapSize.width()-1, h ) = inPosition( mMapSize.width()-1, h );
 	}
-	for( int w=0; w<mMapSize.width(); w++ )
-		outPosition( w, mMapSize.height()-1 ) = inPosition( w,  mMapSize.height()-1 );
-#undef inPosition
-#undef outPosition
-	return out;
 }
 
 
-void Terrain::drawPatchMap( const QRect & rect )
+bool Terrain::isVisibleMap( const QRect & rect ) const
 {
-	QRect rectToDraw = rect.intersected( QRect( QPoint(0,0), QSize(mMapSize.width()-1,mMapSize.height()-1) ) );
-	if( rectToDraw.width() < 1 || rectToDraw.height() < 1 )
-		return;	// need at least 4 vertices to build triangle strip
-	if( rectToDraw.y() >= mMapSize.height()-1 )
-		return;	// reached the bottom row - there is no next row to build triangle strips with
+	const QRect quads = rect.intersected( QRect( QPoint(0,0), QSize(mMapSize.width()-1,mMapSize.height()-1) ) );
+	if( quads.isEmpty() )
+		return false;
+	for( int row = cellRow( quads.top() ); row <= cellRow( quads.bottom() ); ++row )
+		for( int column = cellColumn( quads.left() ); column <= cellColumn( quads.right() ); ++column )
+			if( mCellVisible[column + row*mCellCount.width()] )
+				return true;
+	return false;
+}
 
-	mVertexBuffer.bind();
-	mIndexBuffer.bind();
-	glEnableClientState( GL_INDEX_ARRAY );
-	VertexP3fN3fT2f::glEnableClientState();
-	VertexP3fN3fT2f::glPointerVBO();
-
-	for( int slice=rectToDraw.y(); slice<rectToDraw.y()+rectToDraw.height(); slice++ )
-	{
-		glDrawElements(
-			GL_TRIANGLE_STRIP,
-			rectToDraw.width()*2+2,
-			GL_UNSIGNED_INT,
-			(const GLvoid*)((size_t)(2*sizeof(unsigned int)*(	// convert index to pointer
-				rectToDraw.x() + mMapSize.width()*slice		// index to start
-			) ) )
-		);
-		/*
-		//TODO: something like this should be faster
-		glDrawRangeElements(
-			GL_TRIANGLE_STRIP,
-			slice*(unsigned int)mMapSize.width()+rectToDraw.x(),
-			(slice+1)*(unsigned int)mMapSize.width()+rectToDraw.x()+rectToDraw.width()+2,
-			rectToDraw.width()*2+2,
-			GL_UNSIGNED_INT,
-			(const GLvoid*)((size_t)(2*sizeof(unsigned int)*(	// convert index to pointer
-				rectToDraw.x() + mMapSize.width()*slice		// index to start
-			) ) )
-		);
-		*/
+
+QRect Terrain::applyBrush( const QVector3D & center, float radius, float depth, BrushProfile profile )
+{
+	if( mTileFile )
+	{
+		qWarning() << "Paged terrains can't be deformed";
+		return QRect();
 	}
+	const QRect map( QPoint(0,0), mMapSize );
+	const QRect vertices = QRect(
+		toMap( QPointF( center.x()-radius, center.z()-radius ) ),
+		toMap( QPointF( center.x()+radius, center.z()+radius ) ) + QPoint( 1, 1 )
+	).intersected( map );
+	if( radius <= 0.0f || vertices.isEmpty() )
+		return QRect();
 
-	glDisableClientState( GL_INDEX_ARRAY );
-	VertexP3fN3fT2f::glDisableClientState();
+	const float minimumHeight = mOffset.y();
+	const float maximumHeight = mOffset.y() + mSize.y();
+	for( int y = vertices.top(); y <= vertices.bottom(); ++y )
+	{
+		for( int x = vertices.left(); x <= vertices.right(); ++x )
+		{
+			const QVector3D position = getVertexPosition( x, y );
+			const float dx = position.x() - center.x();
+			const float dz = position.z() - center.z();
+			const float distance = sqrtf( dx*dx + dz*dz ) / radius;
+			if( distance >= 1.0f )
+				continue;
+			float weight;
+			switch( profile )
+			{
+			case BRUSH_SPHERE:	weight = sqrtf( 1.0f - distance*distance );		break;
+			case BRUSH_FLAT:	weight = 1.0f;						break;
+			default:		weight = 0.5f + 0.5f * cosf( distance * (float)M_PI );	break;
+			}
+			mHeights[x + y*mMapSize.width()] = qBound( minimumHeight, position.y() - depth*weight, maximumHeight );
+		}
+	}
 
-	mVertexBuffer.release();
-	mIndexBuffer.release();
+	// the normal of a vertex depends on its right and lower neighbour - both are encoded when uploading
+	const QRect normals = vertices.adjusted( -1, -1, 0, 0 ).intersected( map );
+	addDirtyRect( normals );
+
+	// chunks sharing a changed vertex
+	for( int row = chunkRow( qMax( vertices.top()-1, 0 ) ); row <= chunkRow( vertices.bottom() ); ++row )
+	{
+		for( int column = chunkColumn( qMax( vertices.left()-1, 0 ) ); column <= chunkColumn( vertices.right() ); ++column )
+		{
+			Chunk & chunk = mChunks[column + row*mChunkCount.width()];
+			if( chunk.quads.adjusted( 0, 0, 1, 1 ).intersects( vertices ) )
+			{
+				measureChunk( chunk );
+				for( int node = mCullLeaves[column + row*mChunkCount.width()]; node >= 0; node = mCullNodes[node].parent )
+					measureCullNode( node );
+			}
+		}
+	}
+
+	// quads sharing a changed vertex and the blocks above them
+	QRect blocks = normals.intersected( QRect( QPoint(0,0), mHeightPyramidSizes[0] ) );
+	for( int level = 0; level < mHeightPyramid.size(); ++level )
+	{
+		for( int y = blocks.top(); y <= blocks.bottom(); ++y )
+			for( int x = blocks.left(); x <= blocks.right(); ++x )
+				updateHeightRange( level, x, y );
+		blocks = QRect( QPoint( blocks.left()/2, blocks.top()/2 ), QPoint( blocks.right()/2, blocks.bottom()/2 ) );
+	}
+
+	return vertices;
 }
 
 
-void Terrain::draw()
+void Terrain::addDirtyRect( const QRect & rect )
 {
-	mVertexBuffer.bind();
-	mIndexBuffer.bind();
-	glEnableClientState( GL_INDEX_ARRAY );
-	VertexP3fN3fT2f::glEnableClientState();
-	VertexP3fN3fT2f::glPointerVBO();
-
-	for( int slice=0; slice<mMapSize.height()-1; slice++ )
-	{
-		glDrawElements(
-			GL_TRIANGLE_STRIP,
-			mMapSize.width()*2,
-			GL_UNSIGNED_INT,
-			(const GLvoid*)((size_t)(2*sizeof(unsigned int)*(	// convert index to pointer
-				mMapSize.width()*slice			// index to start
-			) ) )
-		);
+	// merge overlapping and adjacent rectangles, so no vertex is uploaded twice
+	QRect merged = rect;
+	for( int i = mDirtyRects.size()-1; i >= 0; --i )
+	{
+		if( mDirtyRects[i].adjusted( -1, -1, 1, 1 ).intersects( merged ) )
+		{
+			merged = merged.united( mDirtyRects[i] );
+			mDirtyRects.remove( i );
+			i = mDirtyRects.size();	// the grown rectangle may touch rectangles already passed
+		}
 	}
+	mDirtyRects.append( merged );
+}
 
-	glDisableClientState( GL_INDEX_ARRAY );
-	VertexP3fN3fT2f::glDisableClientState();
+
+void Terrain::uploadDirtyRects()
+{
+	if( mDirtyRects.isEmpty() )
+		return;
+
+	QVector<VertexH1sN3s> vertices;
+	mVertexBuffer.bind();
+	for( int i = 0; i < mDirtyRects.size(); ++i )
+	{
+		// the span from the first to the last vertex of the rectangle is contiguous in the buffer - the vertices
+		// in between are encoded from the unchanged heights again, so the whole span is written at once
+		const QRect & rect = mDirtyRects[i];
+		const int first = rect.left() + rect.top()*mMapSize.width();
+		const int last = rect.right() + rect.bottom()*mMapSize.width();
+		vertices.resize( last - first + 1 );
+		VertexH1sN3s * vertex = vertices.data();
+		for( int y = rect.top(); y <= rect.bottom(); ++y )
+		{
+			const int from = y == rect.top() ? rect.left() : 0;
+			const int to = y == rect.bottom() ? rect.right() : mMapSize.width()-1;
+			for( int x = from; x <= to; ++x )
+				encodeVertex( x, y, *vertex++ );
+		}
+		mVertexBuffer.write( first * VertexH1sN3s::size(), vertices.constData(), vertices.size() * VertexH1sN3s::size() );
+	}
 	mVertexBuffer.release();
-	mIndexBuffer.release();
+	mDirtyRects.clear();
 }
 
 
@@ -298,20 +1449,94 @@ Triangle Terrain::getTriangle( const QPointF & position ) const
 
 bool Terrain::getHeight( const QPointF & position, float & height ) const
 {
-	Triangle t;
-	if( !getTriangle( toMapF(position), t ) )
+	const QPointF map = toMapF( position );
+	if( map.x() < 0.0f || map.y() < 0.0f || map.x() >= mMapSize.width()-1 || map.y() >= mMapSize.height()-1 )
 		return false;
-	QVector3D normal = t.normal();
-	height = ( (normal.x()*(position.x()-t.p().x())) + (normal.z()*(position.y()-t.p().z())) ) / ( -normal.y() ) + t.p().y();
+	const float x = position.x();
+	const float z = position.y();
+	getHeights( &x, &z, &height, 1 );
 	return true;
 }
 
 
 float Terrain::getHeight( const QPointF & position ) const
 {
-	Triangle t = getTriangle( toMapF(position) );
-	QVector3D normal = t.normal();
-	return ( (normal.x()*(position.x()-t.p().x())) + (normal.z()*(position.y()-t.p().z())) ) / ( -normal.y() ) + t.p().y();
+	const float x = position.x();
+	const float z = position.y();
+	float height;
+	getHeights( &x, &z, &height, 1 );
+	return height;
+}
+
+
+void Terrain::getHeights( const float * x, const float * z, float * heights, int count ) const
+{
+	// the quads are split like the mesh - (x,y), (x,y+1), (x+1,y) is the first triangle
+	const float scaleX = mToMapFactor.width();
+	const float scaleZ = mToMapFactor.height();
+	const float offsetX = mOffset.x();
+	const float offsetZ = mOffset.z();
+	const int lastX = qMax( mMapSize.width()-2, 0 );
+	const int lastY = qMax( mMapSize.height()-2, 0 );
+	const int width = mMapSize.width();
+	int i = 0;
+
+#ifdef __SSE2__
+	if( !mTileFile )
+	{
+		const __m128 one = _mm_set1_ps( 1.0f );
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maximumX = _mm_set1_ps( (float)lastX );
+		const __m128 maximumY = _mm_set1_ps( (float)lastY );
+		for( ; i+4 <= count; i += 4 )
+		{
+			const __m128 u = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( x+i ), _mm_set1_ps( offsetX ) ), _mm_set1_ps( scaleX ) );
+			const __m128 v = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( z+i ), _mm_set1_ps( offsetZ ) ), _mm_set1_ps( scaleZ ) );
+			// truncation equals flooring once negative coordinates are clamped to the first quad
+			const __m128 cellX = _mm_min_ps( _mm_max_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( u ) ), zero ), maximumX );
+			const __m128 cellY = _mm_min_ps( _mm_max_ps( _mm_cvtepi32_ps( _mm_cvttps_epi32( v ) ), zero ), maximumY );
+			const __m128 fx = _mm_sub_ps( u, cellX );
+			const __m128 fy = _mm_sub_ps( v, cellY );
+
+			int column[4];
+			int row[4];
+			_mm_storeu_si128( (__m128i*)column, _mm_cvttps_epi32( cellX ) );
+			_mm_storeu_si128( (__m128i*)row, _mm_cvttps_epi32( cellY ) );
+			const float * h[4];
+			for( int j = 0; j < 4; ++j )
+				h[j] = mHeights.constData() + column[j] + row[j]*width;
+			const __m128 h00 = _mm_setr_ps( h[0][0], h[1][0], h[2][0], h[3][0] );
+			const __m128 h10 = _mm_setr_ps( h[0][1], h[1][1], h[2][1], h[3][1] );
+			const __m128 h01 = _mm_setr_ps( h[0][width], h[1][width], h[2][width], h[3][width] );
+			const __m128 h11 = _mm_setr_ps( h[0][width+1], h[1][width+1], h[2][width+1], h[3][width+1] );
+
+			const __m128 first = _mm_add_ps( h00, _mm_add_ps( _mm_mul_ps( fx, _mm_sub_ps( h10, h00 ) ), _mm_mul_ps( fy, _mm_sub_ps( h01, h00 ) ) ) );
+			const __m128 second = _mm_add_ps( h11, _mm_add_ps(
+				_mm_mul_ps( _mm_sub_ps( one, fx ), _mm_sub_ps( h01, h11 ) ),
+				_mm_mul_ps( _mm_sub_ps( one, fy ), _mm_sub_ps( h10, h11 ) ) ) );
+			const __m128 inFirst = _mm_cmplt_ps( _mm_add_ps( fx, fy ), one );
+			_mm_storeu_ps( heights+i, _mm_or_ps( _mm_and_ps( inFirst, first ), _mm_andnot_ps( inFirst, second ) ) );
+		}
+	}
+#endif
+
+	for( ; i < count; ++i )
+	{
+		const float u = ( x[i] - offsetX ) * scaleX;
+		const float v = ( z[i] - offsetZ ) * scaleZ;
+		const int cellX = qBound( 0, (int)floorf( u ), lastX );
+		const int cellY = qBound( 0, (int)floorf( v ), lastY );
+		const float fx = u - cellX;
+		const float fy = v - cellY;
+		const float h00 = gridHeight( cellX, cellY );
+		const float h10 = gridHeight( cellX+1, cellY );
+		const float h01 = gridHeight( cellX, cellY+1 );
+		const float h11 = gridHeight( cellX+1, cellY+1 );
+		if( fx + fy < 1.0f )
+			heights[i] = h00 + fx*( h10-h00 ) + fy*( h01-h00 );
+		else
+			heights[i] = h11 + (1.0f-fx)*( h01-h11 ) + (1.0f-fy)*( h10-h11 );
+	}
 }
 
 
@@ -339,101 +1564,399 @@ QQuaternion Terrain::getNormalRotation( const QPointF & position, const QVector3
 }
 
 
-bool Terrain::getLineQuadIntersection( const QVector3D & origin, const QVector3D & direction, const QPoint & quadMapCoord, float & length ) const
+bool Terrain::getLineQuadsIntersection( const QVector3D & origin, const QVector3D & direction, const QPoint * quadMapCoords, int count, float & length ) const
 {
-	QPoint pos = quadMapCoord;
-	if( pos.x() >= mMapSize.width()-1 )
-		pos.setX( mMapSize.width()-2 );
-	if( pos.y() >= mMapSize.height()-1 )
-		pos.setY( mMapSize.height()-2 );
-	if( pos.x() < 0 )
-		pos.setX( 0 );
-	if( pos.y() < 0 )
-		pos.setY( 0 );
+	// two triangles per quad, tested four at a time
+	TrianglePacket packet;
+	int slot = 0;
+	bool intersects = false;
+	for( int i = 0; i < count; ++i )
+	{
+		QPoint pos = quadMapCoords[i];
+		if( pos.x() >= mMapSize.width()-1 )
+			pos.setX( mMapSize.width()-2 );
+		if( pos.y() >= mMapSize.height()-1 )
+			pos.setY( mMapSize.height()-2 );
+		if( pos.x() < 0 )
+			pos.setX( 0 );
+		if( pos.y() < 0 )
+			pos.setY( 0 );
 
-	float intersectionDistance;
+		packet.set( slot++,
+			getVertexPosition( pos.x(), pos.y() ),
+			getVertexPosition( pos.x(), pos.y()+1 ),
+			getVertexPosition( pos.x()+1, pos.y() )
+		);
+		packet.set( slot++,
+			getVertexPosition( pos.x()+1, pos.y()+1 ),
+			getVertexPosition( pos.x()+1, pos.y() ),
+			getVertexPosition( pos.x(), pos.y()+1 )
+		);
 
-	Triangle t1(
-		getVertexPosition( pos.x(), pos.y() ),
-		getVertexPosition( pos.x(), pos.y()+1 ),
-		getVertexPosition( pos.x()+1, pos.y() )
-	);
+		if( slot == TrianglePacket::size || i == count-1 )
+		{
+			intersects |= packet.intersectRay( origin, direction, length ) >= 0;
+			packet.clear();
+			slot = 0;
+		}
+	}
+	return intersects;
+}
 
-	if( t1.intersectRay( origin, direction, &intersectionDistance ) )
+
+void Terrain::buildHeightPyramid()
+{
+	mHeightPyramid.clear();
+	mHeightPyramidSizes.clear();
+
+	// level 0 - one entry per quad, or per block of the tile file if the terrain is paged
+	QSize levelSize;
+	QVector<HeightRange> level;
+	mHeightPyramidShift = 0;
+	if( mTileFile )
 	{
-		if( intersectionDistance < length && intersectionDistance > 0.0f )
+		while( ( 1 << mHeightPyramidShift ) < TerrainTileFile::BlockQuads )
+			++mHeightPyramidShift;
+		levelSize = mTileFile->blockCount();
+		level.resize( levelSize.width() * levelSize.height() );
+		for( int y = 0; y < levelSize.height(); ++y )
 		{
-			length = intersectionDistance;
-			return true;
+			for( int x = 0; x < levelSize.width(); ++x )
+			{
+				level[x + y*levelSize.width()].minimum = mTileFile->block( x, y ).minimum;
+				level[x + y*levelSize.width()].maximum = mTileFile->block( x, y ).maximum;
+			}
 		}
+	} else {
+		levelSize = QSize( qMax( mMapSize.width()-1, 1 ), qMax( mMapSize.height()-1, 1 ) );
+		level.resize( levelSize.width() * levelSize.height() );
 	}
+	mHeightPyramid.append( level );
+	mHeightPyramidSizes.append( levelSize );
 
-	Triangle t2(
-		getVertexPosition( pos.x()+1, pos.y()+1 ),
-		getVertexPosition( pos.x()+1, pos.y() ),
-		getVertexPosition( pos.x(), pos.y()+1 )
-	);
+	// merge 2x2 blocks until a single block covers the whole terrain
+	while( levelSize.width() > 1 || levelSize.height() > 1 )
+	{
+		levelSize = QSize( (levelSize.width()+1) / 2, (levelSize.height()+1) / 2 );
+		mHeightPyramid.append( QVector<HeightRange>( levelSize.width() * levelSize.height() ) );
+		mHeightPyramidSizes.append( levelSize );
+	}
+
+	const int firstLevel = mTileFile ? 1 : 0;
+	for( int i = firstLevel; i < mHeightPyramid.size(); ++i )
+		for( int y = 0; y < mHeightPyramidSizes[i].height(); ++y )
+			for( int x = 0; x < mHeightPyramidSizes[i].width(); ++x )
+				updateHeightRange( i, x, y );
+}
+
+
+void Terrain::updateHeightRange( int level, int x, int y )
+{
+	HeightRange & range = mHeightPyramid[level][x + y*mHeightPyramidSizes[level].width()];
+	range.minimum = FLT_MAX;
+	range.maximum = -FLT_MAX;
 
-	if( t2.intersectRay( origin, direction, &intersectionDistance ) )
+	if( level == 0 )
 	{
-		if( intersectionDistance < length && intersectionDistance > 0.0f )
+		// the four vertices of a quad
+		for( int v = 0; v < 4; ++v )
 		{
-			length = intersectionDistance;
-			return true;
+			float height = getVertexPosition( qMin( x+(v&1), mMapSize.width()-1 ), qMin( y+(v>>1), mMapSize.height()-1 ) ).y();
+			range.minimum = qMin( range.minimum, height );
+			range.maximum = qMax( range.maximum, height );
+		}
+		return;
+	}
+
+	const QVector<HeightRange> & below = mHeightPyramid[level-1];
+	const QSize & belowSize = mHeightPyramidSizes[level-1];
+	for( int child = 0; child < 4; ++child )
+	{
+		int cx = x*2 + (child&1);
+		int cy = y*2 + (child>>1);
+		if( cx >= belowSize.width() || cy >= belowSize.height() )
+			continue;
+		const HeightRange & childRange = below[cx + cy*belowSize.width()];
+		range.minimum = qMin( range.minimum, childRange.minimum );
+		range.maximum = qMax( range.maximum, childRange.maximum );
+	}
+}
+
+
+bool Terrain::clipLineToQuads( int level, int x, int y, const QVector3D & origin, const QVector3D & direction, float & tEnter, float & tExit ) const
+{
+	// world space rectangle covered by the block
+	const float quadWidth = mSize.x() / mMapSize.width();
+	const float quadDepth = mSize.z() / mMapSize.height();
+	level += mHeightPyramidShift;
+	const float minimum[2] = {
+		mOffset.x() + (float)( x << level ) * quadWidth,
+		mOffset.z() + (float)( y << level ) * quadDepth
+	};
+	const float maximum[2] = {
+		mOffset.x() + (float)qMin( (x+1) << level, mMapSize.width()-1 ) * quadWidth,
+		mOffset.z() + (float)qMin( (y+1) << level, mMapSize.height()-1 ) * quadDepth
+	};
+	const float o[2] = { origin.x(), origin.z() };
+	const float d[2] = { direction.x(), direction.z() };
+
+	for( int axis = 0; axis < 2; ++axis )
+	{
+		if( fabsf( d[axis] ) < FLT_EPSILON )
+		{
+			if( o[axis] < minimum[axis] || o[axis] > maximum[axis] )
+				return false;
+			continue;
+		}
+		float t0 = ( minimum[axis] - o[axis] ) / d[axis];
+		float t1 = ( maximum[axis] - o[axis] ) / d[axis];
+		if( t0 > t1 )
+			qSwap( t0, t1 );
+		tEnter = qMax( tEnter, t0 );
+		tExit = qMin( tExit, t1 );
+	}
+	return tEnter <= tExit;
+}
+
+
+bool Terrain::intersectLinePyramid( int level, int x, int y, const QVector3D & origin, const QVector3D & direction, float & length ) const
+{
+	// skip the block if the line passes completely above or below it
+	float tEnter = 0.0f;
+	float tExit = length;
+	if( !clipLineToQuads( level, x, y, origin, direction, tEnter, tExit ) )
+		return false;
+	const HeightRange & range = mHeightPyramid[level][x + y*mHeightPyramidSizes[level].width()];
+	float heightEnter = origin.y() + direction.y() * tEnter;
+	float heightExit = origin.y() + direction.y() * tExit;
+	if( qMin( heightEnter, heightExit ) > range.maximum || qMax( heightEnter, heightExit ) < range.minimum )
+		return false;
+
+	if( level == 0 )
+	{
+		if( mHeightPyramidShift > 0 )
+			return intersectLineBlock( x, y, origin, direction, tEnter, tExit, length );
+		const QPoint quad( x, y );
+		return getLineQuadsIntersection( origin, direction, &quad, 1, length );
+	}
+
+	// visit the children in the order the line passes them, so the first hit is the nearest
+	const QSize & childSize = mHeightPyramidSizes[level-1];
+	int children[4];
+	float childEnter[4];
+	int childCount = 0;
+	for( int child = 0; child < 4; ++child )
+	{
+		int cx = x*2 + (child&1);
+		int cy = y*2 + (child>>1);
+		if( cx >= childSize.width() || cy >= childSize.height() )
+			continue;
+		float t0 = 0.0f;
+		float t1 = length;
+		if( !clipLineToQuads( level-1, cx, cy, origin, direction, t0, t1 ) )
+			continue;
+		int i = childCount++;
+		for( ; i > 0 && childEnter[i-1] > t0; --i )
+		{
+			children[i] = children[i-1];
+			childEnter[i] = childEnter[i-1];
 		}
+		children[i] = child;
+		childEnter[i] = t0;
 	}
 
+	for( int i = 0; i < childCount; ++i )
+	{
+		if( intersectLinePyramid( level-1, x*2 + (children[i]&1), y*2 + (children[i]>>1), origin, direction, length ) )
+			return true;
+	}
 	return false;
 }
 
 
+bool Terrain::intersectLineBlock( int x, int y, const QVector3D & origin, const QVector3D & direction, float tEnter, float tExit, float & length ) const
+{
+	// test the quads of the block below the part of the line passing it
+	const QPointF enter = toMapF( origin + direction*tEnter );
+	const QPointF exit = toMapF( origin + direction*tExit );
+	const int size = 1 << mHeightPyramidShift;
+	const QRect block( x*size, y*size, size, size );
+	const QRect quads = QRect(
+		QPoint( (int)floorf( qMin( enter.x(), exit.x() ) ), (int)floorf( qMin( enter.y(), exit.y() ) ) ),
+		QPoint( (int)floorf( qMax( enter.x(), exit.x() ) ), (int)floorf( qMax( enter.y(), exit.y() ) ) )
+	).intersected( block ).intersected( QRect( 0, 0, mMapSize.width()-1, mMapSize.height()-1 ) );
+	if( quads.isEmpty() )
+		return false;
+
+	QVarLengthArray<QPoint, TerrainTileFile::BlockQuads*TerrainTileFile::BlockQuads> quadMapCoords;
+	for( int v = quads.top(); v <= quads.bottom(); ++v )
+		for( int u = quads.left(); u <= quads.right(); ++u )
+			quadMapCoords.append( QPoint( u, v ) );
+	return getLineQuadsIntersection( origin, direction, quadMapCoords.constData(), quadMapCoords.size(), length );
+}
+
+
 bool Terrain::intersectLine( const QVector3D & origin, const QVector3D & direction, float & length, QVector3D * normal ) const
 {
-	QPoint mapFrom = toMap( origin );
-	QPoint mapTo = toMap( origin + direction * length );
-
-	int x = mapFrom.x();
-	int y = mapFrom.y();
-	int dx = abs( mapTo.x() - x );
-	int dy = abs( mapTo.y() - y );
-	int sx = ( x < mapTo.x() ) ? 1 : -1;
-	int sy = ( y < mapTo.y() ) ? 1 : -1;
-	int error = dx - dy;
-
-	int ox = 1;
-	int oy = 1;
-	if( dx < dy )
-		oy = 0;
-	else
-		ox = 0;
+	if( mHeightPyramid.isEmpty() )
+		return false;
+
+	if( intersectLinePyramid( mHeightPyramid.size()-1, 0, 0, origin, direction, length ) )
+	{
+		if( normal )
+			*normal = getNormal( origin + direction*length );
+		return true;
+	}
+	return false;
+}
+
 
-	while( true )
+void Terrain::getBlockBox( int level, int x, int y, QVector3D & minimum, QVector3D & maximum ) const
+{
+	// the same rectangle clipLineToQuads() uses
+	const float quadWidth = mSize.x() / mMapSize.width();
+	const float quadDepth = mSize.z() / mMapSize.height();
+	const HeightRange & range = mHeightPyramid[level][x + y*mHeightPyramidSizes[level].width()];
+	const int shift = level + mHeightPyramidShift;
+	minimum = QVector3D(
+		mOffset.x() + (float)( x << shift ) * quadWidth,
+		range.minimum,
+		mOffset.z() + (float)( y << shift ) * quadDepth );
+	maximum = QVector3D(
+		mOffset.x() + (float)qMin( (x+1) << shift, mMapSize.width()-1 ) * quadWidth,
+		range.maximum,
+		mOffset.z() + (float)qMin( (y+1) << shift, mMapSize.height()-1 ) * quadDepth );
+}
+
+
+int Terrain::intersectPacketPyramid( int level, int x, int y, RayPacket & packet, int rays ) const
+{
+	if( level == 0 )
 	{
-		bool intersects = false;
-		intersects |= getLineQuadIntersection( origin, direction, QPoint(x, y), length );
-		intersects |= getLineQuadIntersection( origin, direction, QPoint(x+ox, y+oy), length );
-		intersects |= getLineQuadIntersection( origin, direction, QPoint(x-ox, y-oy), length );
-		if( intersects )
+		int hits = 0;
+		if( mHeightPyramidShift > 0 )
 		{
-			if( normal )
-				*normal = getNormal( origin + direction*length );
-			return true;
+			// the quads of paged terrains are only read block by block - test the rays one by one
+			for( int i = 0; i < RayPacket::size; ++i )
+			{
+				if( !( rays & (1<<i) ) )
+					continue;
+				const QVector3D origin = packet.origin( i );
+				const QVector3D direction = packet.direction( i );
+				float length = packet.length( i );
+				float tEnter = 0.0f;
+				float tExit = length;
+				if( clipLineToQuads( 0, x, y, origin, direction, tEnter, tExit )
+					&& intersectLineBlock( x, y, origin, direction, tEnter, tExit, length ) )
+				{
+					packet.setLength( i, length );
+					hits |= 1 << i;
+				}
+			}
+			return hits;
 		}
+		hits |= packet.intersectTriangle(
+			getVertexPosition( x, y ),
+			getVertexPosition( x, y+1 ),
+			getVertexPosition( x+1, y ) );
+		hits |= packet.intersectTriangle(
+			getVertexPosition( x+1, y+1 ),
+			getVertexPosition( x+1, y ),
+			getVertexPosition( x, y+1 ) );
+		return hits;
+	}
 
-		if( x == mapTo.x() && y == mapTo.y() )
-			break;
+	// visit the children in the order the packet passes them, so hits shorten the rays early
+	const QSize & childSize = mHeightPyramidSizes[level-1];
+	int children[4];
+	int childRays[4];
+	float childEnter[4];
+	int childCount = 0;
+	for( int child = 0; child < 4; ++child )
+	{
+		int cx = x*2 + (child&1);
+		int cy = y*2 + (child>>1);
+		if( cx >= childSize.width() || cy >= childSize.height() )
+			continue;
+		QVector3D minimum, maximum;
+		getBlockBox( level-1, cx, cy, minimum, maximum );
+		float enter[RayPacket::size];
+		const int passing = rays & packet.clipBox( minimum, maximum, enter );
+		if( !passing )
+			continue;
+		float nearest = FLT_MAX;
+		for( int i = 0; i < RayPacket::size; ++i )
+		{
+			if( passing & (1<<i) )
+				nearest = qMin( nearest, enter[i] );
+		}
+		int i = childCount++;
+		for( ; i > 0 && childEnter[i-1] > nearest; --i )
+		{
+			children[i] = children[i-1];
+			childRays[i] = childRays[i-1];
+			childEnter[i] = childEnter[i-1];
+		}
+		children[i] = child;
+		childRays[i] = passing;
+		childEnter[i] = nearest;
+	}
 
-		int error2 = 2 * error;
-		if( error2 > -dy )
+	int hits = 0;
+	for( int i = 0; i < childCount; ++i )
+	{
+		const int cx = x*2 + (children[i]&1);
+		const int cy = y*2 + (children[i]>>1);
+		int passing = childRays[i];
+		if( hits )
 		{
-			error -= dy;
-			x += sx;
+			// rays shortened by previous hits may not reach this child anymore
+			QVector3D minimum, maximum;
+			float enter[RayPacket::size];
+			getBlockBox( level-1, cx, cy, minimum, maximum );
+			passing &= packet.clipBox( minimum, maximum, enter );
+			if( !passing )
+				continue;
 		}
-		if( error2 < dx )
+		hits |= intersectPacketPyramid( level-1, cx, cy, packet, passing );
+	}
+	return hits;
+}
+
+
+int Terrain::intersectLines( Ray * rays, int count, const AObject * target ) const
+{
+	if( mHeightPyramid.isEmpty() )
+		return 0;
+
+	const int top = mHeightPyramid.size()-1;
+	QVector3D minimum, maximum;
+	getBlockBox( top, 0, 0, minimum, maximum );
+
+	int intersections = 0;
+	RayPacket packet;
+	for( int first = 0; first < count; first += RayPacket::size )
+	{
+		const int packetSize = qMin( (int)RayPacket::size, count-first );
+		packet.clear();
+		for( int i = 0; i < packetSize; ++i )
+			packet.set( i, rays[first+i].origin, rays[first+i].direction, rays[first+i].length );
+
+		float enter[RayPacket::size];
+		const int passing = packet.clipBox( minimum, maximum, enter );
+		if( !passing )
+			continue;
+		const int hits = intersectPacketPyramid( top, 0, 0, packet, passing );
+		for( int i = 0; i < packetSize; ++i )
 		{
-			error += dx;
-			y += sy;
+			if( !( hits & (1<<i) ) )
+				continue;
+			Ray & ray = rays[first+i];
+			ray.length = packet.length( i );
+			ray.normal = getNormal( ray.origin + ray.direction*ray.length );
+			ray.target = target;
+			++intersections;
 		}
 	}
-	return false;
+	return intersections;
 }
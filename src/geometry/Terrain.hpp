@@ -25,11 +25,15 @@
 #define GEOMETRY_TERRAIN_INCLUDED
 
 #include "Vertex.hpp"
+#include "TerrainTileFile.hpp"
 
 #include <GLWidget.hpp>
 #include <utility/Triangle.hpp>
+#include <utility/Ray.hpp>
+#include <utility/FrustumTest.hpp>
 
 #include <QString>
+#include <QByteArray>
 #include <QPoint>
 #include <QPointF>
 #include <QRect>
@@ -38,16 +42,27 @@
 #include <QSizeF>
 #include <QVector>
 #include <QVector3D>
+#include <QMatrix4x4>
 #include <QGLBuffer>
 
 #include <math.h>
 
 
+class JobSystem;
+class TerrainTileCache;
+class RayPacket;
+
+
 /// Generates and draws a mesh based on a heightmap.
 /**
  * A terrain is a grid of vertices that lies within the X/Z plane.\n
  * The vertice's height is read from a heightmap.\n
  * The heightmap's resolution also defines the grid's resolution and can be of any size.\n
+ * For drawing, the grid is split into chunks, each drawn with its own level of detail - see updateLevelOfDetail().\n
+ * The graphics card only receives a 16 bit height and a normal of each vertex, the vertex shader rebuilds
+ * the grid position from the vertex index - see TerrainGrid. Terrains have to be drawn with such shaders.\n
+ * Large heightmaps can be paged - the heights are then read from a memory mapped TerrainTileFile
+ * and only the tiles around the viewer are kept on the graphics card by a TerrainTileCache.\n
  */
 class Terrain
 {
@@ -57,8 +72,14 @@ public:
 	 * @param heightMapPath The path to an image file used as heightmap. This should be a monochrome image.
 	 * @param size The volume occupied by this terrain.
 	 * @param offset Where to put the origin of the terrain.
+	 * @param jobs Used to build the mesh on all cores if given.
+	 * @param tileRadius Pages the terrain if positive - only the tiles within this many tiles around the viewer are drawn.
+	 *
+	 * The generated mesh is stored next to the heightmap (with ".cache" appended to its name)
+	 * and reused as long as neither the heightmap nor the parameters change.
+	 * Paged terrains store their tiles with ".tiles" appended instead.
 	 */
-	Terrain( const QString & heightMapPath, const QVector3D & size = QVector3D(1,1,1), const QVector3D & offset = QVector3D(0,0,0), const int & smoothingPasses = 1 );
+	Terrain( const QString & heightMapPath, const QVector3D & size = QVector3D(1,1,1), const QVector3D & offset = QVector3D(0,0,0), const int & smoothingPasses = 1, JobSystem * jobs = 0, const int & tileRadius = 0 );
 
 	/// Frees terrain data
 	~Terrain();
@@ -69,6 +90,55 @@ public:
 	 */
 	void draw();
 
+	/// Chooses the level of detail of every chunk.
+	/**
+	 * Each chunk uses the coarsest level whose height error stays below the accepted screen space error.
+	 * Neighbouring chunks differ by at most one level, so their borders can be stitched without cracks.
+	 * Until this is called, the terrain is drawn at full resolution.
+	 * Paged terrains also load the tiles around the viewer and choose the level of each tile instead.
+	 * @param eyePosition The position of the viewer in world coordinates.
+	 * @param errorScale Converts a height error at distance 1 to a multiple of the accepted screen space error,
+	 *  e.g. viewportHeight / ( 2 * tan(fov/2) * pixelError ).
+	 */
+	void updateLevelOfDetail( const QVector3D & eyePosition, float errorScale );
+
+	/// Finds the chunks within the viewing frustum.
+	/**
+	 * Walks a quadtree of boxes fitting the heights of the chunks - paged terrains use their tiles instead of chunks.
+	 * Children are only tested against the planes of the frustum their parent intersects,
+	 * nodes completely inside the frustum are accepted without testing their children.\n
+	 * draw() and drawPatchMap() only draw the chunks found by the last call, initially all chunks are visible.
+	 * @param frustum The viewing frustum in terrain coordinates.
+	 */
+	void cull( const FrustumTest & frustum );
+
+	/// Indices of the chunks - or tiles of a paged terrain - found visible by the last cull()
+	const QVector<int> & visibleCells() const { return mVisibleCells; }
+
+	/// Whether a rectangle in heightmap coordinates overlaps a chunk found visible by the last cull()
+	bool isVisibleMap( const QRect & rect ) const;
+
+	/// Shape of the dent made by applyBrush()
+	enum BrushProfile
+	{
+		BRUSH_SMOOTH,	///< Falls off like a cosine towards the radius
+		BRUSH_SPHERE,	///< A spherical crater
+		BRUSH_FLAT	///< The same depth within the whole radius
+	};
+
+	/// Lowers the terrain around a position - a negative depth raises it.
+	/**
+	 * Only the vertices, normals, level of detail errors and height ranges within the affected rectangle are updated.
+	 * Changed vertices are collected and uploaded once before the terrain is drawn the next time.
+	 * Heights are kept within the terrain's volume. Paged terrains can't be deformed.
+	 * @param center Center of the brush in world coordinates - the height is ignored.
+	 * @param radius Radius of the brush in world coordinates.
+	 * @param depth Height change at the center of the brush.
+	 * @param profile Shape of the dent.
+	 * @return The changed vertices in heightmap coordinates - empty if nothing changed.
+	 */
+	QRect applyBrush( const QVector3D & center, float radius, float depth, BrushProfile profile = BRUSH_SMOOTH );
+
 	/// Draws the terrain within a rectangle in world coordinates.
 	/**
 	 * The terrain is rendered using VBOs.
@@ -102,6 +172,9 @@ public:
 	/// Draws the terrain within a rectangle in heightmap coordinates.
 	/**
 	 * The terrain is rendered using VBOs.
+	 * Chunks completely inside the rectangle are drawn from their precomputed indices,
+	 * the triangles of partially covered chunks are clipped against the rectangle.
+	 * Everything is submitted with a single draw call.
 	 * @param rect The rectangle to draw in heightmap coordinates.
 	 */
 	void drawPatchMap( const QRect & rect );
@@ -126,10 +199,12 @@ public:
 	const QVector3D & size() const { return mSize; }	///< The size of the terrain.
 	const QVector3D & offset() const { return mOffset; }	///< The offset of the terrain.
 
-	const QVector3D & getVertexPosition( const int & x, const int & y ) const;	///< The vertex at heightmap coordinates.
-	const QVector3D & getVertexPosition( const QPoint & p ) const;			///< The vertex at heightmap coordinates.
-	const QVector3D & getVertexNormal( const int & x, const int & y ) const;	///< The normal at heightmap coordinates.
-	const QVector3D & getVertexNormal( const QPoint & p ) const;			///< The normal at heightmap coordinates.
+	bool isPaged() const { return mTileFile != NULL; }	///< Whether the terrain is read from a tile file.
+
+	QVector3D getVertexPosition( const int & x, const int & y ) const;	///< The vertex at heightmap coordinates.
+	QVector3D getVertexPosition( const QPoint & p ) const;			///< The vertex at heightmap coordinates.
+	QVector3D getVertexNormal( const int & x, const int & y ) const;	///< The normal at heightmap coordinates.
+	QVector3D getVertexNormal( const QPoint & p ) const;			///< The normal at heightmap coordinates.
 
 	/// Returns the rotation needed to match the terrains surface normal
 	QQuaternion getNormalRotation( const QVector3D & position, const QVector3D & from = QVector3D(0,1,0) ) const;
@@ -148,29 +223,206 @@ public:
 	bool getHeight( const QPointF & position, float & height ) const;	///< Returns the height of the terrain below a position if existing
 	float getHeight( const QVector3D & position ) const;			///< Returns the height of the terrain below a position
 	float getHeight( const QPointF & position ) const;			///< Returns the height of the terrain below a position
+	/// Returns the heights of the terrain below multiple positions
+	/**
+	 * Like getHeight(), positions outside of the terrain use the plane of the nearest triangle.
+	 * The heights are interpolated from a plain height grid, four positions at a time if possible.
+	 * @param x X-coordinates of the positions in world coordinates.
+	 * @param z Z-coordinates of the positions in world coordinates.
+	 * @param heights Receives a height for every position.
+	 * @param count Number of positions.
+	 */
+	void getHeights( const float * x, const float * z, float * heights, int count ) const;
 	bool getHeightAboveGround( const QVector3D & position, float & heightAboveGround ) const;	///< Returns the height above terrain if existing
 	float getHeightAboveGround( const QVector3D & position ) const;					///< Returns the height above terrain
 
 	/// Calculates the intersection distance to the terrain. length is used as input and output.
+	/**
+	 * Regions the line passes above or below are skipped using a min/max height pyramid,
+	 * only the quads near the line are tested exactly.
+	 */
 	bool intersectLine( const QVector3D & origin, const QVector3D & direction, float & length, QVector3D * normal ) const;
 
+	/// Intersects multiple lines with the terrain.
+	/**
+	 * The rays traverse the height pyramid in packets of four, so each block and triangle is tested
+	 * against all rays of a packet at once.
+	 * Each ray's length and normal are updated on intersection and its target is set to the given object.
+	 * @return The number of rays intersecting the terrain.
+	 */
+	int intersectLines( Ray * rays, int count, const AObject * target ) const;
+
 protected:
 
 private:
-	VertexP3fN3fT2f & vertex( const int & x, const int & y );
-	VertexP3fN3fT2f & vertex( const QPoint & p );
-
-	QVector<QVector3D> smoothedPositions( const QVector< QVector3D > & in, const QSize & size );
-
-	bool getLineQuadIntersection( const QVector3D & origin, const QVector3D & direction, const QPoint & quadMapCoord, float & length ) const;
+	/// Decodes and smoothes the heightmap and adds the offset - also sets the map size
+	void buildHeights( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs, QVector<float> & heights );
+	/// Builds mHeights and the vertices drawn from
+	void buildVertices( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs, QVector<VertexH1sN3s> & vertices );
+	void setHeightQuantization();
+	void createVertexBuffer( const void * vertices, int bytes );
+	void encodeVertex( int x, int y, VertexH1sN3s & out ) const;
+	void setGridMatrix( float heightBase, float heightStep );
+	void addDirtyRect( const QRect & rect );
+	/// Encodes and uploads the vertices of each dirty rectangle with a single write
+	void uploadDirtyRects();
+
+	/// Maps the tile file of a paged terrain - it is written first if missing or outdated
+	/**
+	 * The tiles are written while the heightmap is decoded and smoothed in bands of rows,
+	 * so the heights of the whole map are never held in memory.
+	 */
+	void openTiles( const QString & heightMapPath, const int & smoothingPasses, JobSystem * jobs );
+	/// The height of a vertex from the height grid or the tile file
+	float gridHeight( int x, int y ) const
+		{ return mTileFile ? mTileFile->height( x, y ) : mHeights[x + y*mMapSize.width()]; }
+	void drawTiles( const QRect & rect );
+
+	/// Hashes the heightmap and all parameters the generated vertices and chunks depend on
+	QByteArray cacheKey( const QString & heightMapPath, const int & smoothingPasses ) const;
+	/// Hashes the heightmap and the parameters the heights in the tile file depend on
+	QByteArray tileKey( const QString & heightMapPath, const int & smoothingPasses ) const;
+	/// Restores heights and chunks and uploads the vertices from a cache file written by saveCache() if its key matches
+	bool loadCache( const QString & path, const QByteArray & key );
+	void saveCache( const QString & path, const QByteArray & key, const QVector<VertexH1sN3s> & vertices ) const;
+
+	bool getLineQuadsIntersection( const QVector3D & origin, const QVector3D & direction, const QPoint * quadMapCoords, int count, float & length ) const;
+
+	/// Number of quads along the side of a chunk
+	static const int ChunkQuads = 32;
+	/// Number of detail levels - level n uses every 2^n-th vertex
+	static const int ChunkLevels = 5;
+
+	/// A range within the index buffer
+	struct IndexRange
+	{
+		int offset;
+		int count;
+	};
+
+	/// A block of quads drawn with a common level of detail
+	/**
+	 * Each level is split into the interior and the four borders (top, right, bottom, left),
+	 * every border can be stitched to a neighbour with the same or the next coarser level.
+	 */
+	struct Chunk
+	{
+		QRect quads;
+		float minimumHeight;
+		float maximumHeight;
+		int maximumLevel;
+		int level;
+		float errors[ChunkLevels];
+		IndexRange interior[ChunkLevels];
+		IndexRange borders[ChunkLevels][4][2];
+	};
+
+	void buildChunks();
+	void buildChunkLevel( Chunk & chunk, int level, QVector<unsigned int> & indices );
+	float chunkLevelError( const Chunk & chunk, int level ) const;
+	/// Updates the height range and errors of a chunk
+	void measureChunk( Chunk & chunk ) const;
+	void addTriangle( QVector<unsigned int> & indices, const QPoint & a, const QPoint & b, const QPoint & c ) const;
+	int chunkColumn( int x ) const { return qMin( x / ChunkQuads, mChunkCount.width()-1 ); }
+	int chunkRow( int y ) const { return qMin( y / ChunkQuads, mChunkCount.height()-1 ); }
+	const Chunk * chunk( int column, int row ) const;
+	void appendChunk( const Chunk & chunk );
+	void appendClippedChunk( const Chunk & chunk, const QRect & rect );
+	void appendClippedRange( const IndexRange & range, const QRect & rect );
+	void streamClippedIndices();
+	void drawAppended();
+
+	/// A node of the culling quadtree
+	/**
+	 * Leaves hold a single cell - a chunk, or a tile of a paged terrain.
+	 * Inner nodes split their cells in halves along each side longer than one cell.
+	 */
+	struct CullNode
+	{
+		QRect cells;
+		QVector3D minimum;
+		QVector3D maximum;
+		int parent;
+		int firstChild;	///< Children are stored consecutively - -1 for leaves
+		int childCount;
+	};
+
+	void buildCullTree();
+	QRect cellQuads( int index ) const;
+	void cellHeightRange( int index, float & minimum, float & maximum ) const;
+	int cellColumn( int x ) const { return qMin( x / mCellQuads, mCellCount.width()-1 ); }
+	int cellRow( int y ) const { return qMin( y / mCellQuads, mCellCount.height()-1 ); }
+	/// Updates the height range of a node from its cell or children
+	void measureCullNode( int index );
+	void cullNode( const FrustumTest & frustum, int index, unsigned int planes );
+
+	/// Height range of a block of quads
+	struct HeightRange
+	{
+		float minimum;
+		float maximum;
+	};
+
+	void buildHeightPyramid();
+	/// Recomputes a single entry of mHeightPyramid from the vertices or the level below
+	void updateHeightRange( int level, int x, int y );
+	bool intersectLinePyramid( int level, int x, int y, const QVector3D & origin, const QVector3D & direction, float & length ) const;
+	bool intersectLineBlock( int x, int y, const QVector3D & origin, const QVector3D & direction, float tEnter, float tExit, float & length ) const;
+	bool clipLineToQuads( int level, int x, int y, const QVector3D & origin, const QVector3D & direction, float & tEnter, float & tExit ) const;
+	/// Returns the bounding box of a block of the height pyramid
+	void getBlockBox( int level, int x, int y, QVector3D & minimum, QVector3D & maximum ) const;
+	/// Intersects a packet of rays with a block they pass - returns the rays which hit the terrain
+	int intersectPacketPyramid( int level, int x, int y, RayPacket & packet, int rays ) const;
 
 	QSize mMapSize;
 	QVector3D mOffset;
 	QVector3D mSize;
-	QVector<VertexP3fN3fT2f> mVertices;
+	/// The heights of the vertices - the only copy of the terrain kept in memory
+	QVector<float> mHeights;
 	QGLBuffer mIndexBuffer;
+	/// Height and normal of each vertex in grid coordinates - see encodeVertex()
 	QGLBuffer mVertexBuffer;
+	/// Column and row of each vertex for shaders without vertex index - see TerrainGrid
+	QGLBuffer mGridIndexStream;
+	/// Height of a quantized height of 0 and the height difference between two successive quantized heights
+	float mHeightBase;
+	float mHeightStep;
+	/// Vertices changed since the last upload
+	QVector<QRect> mDirtyRects;
+	/// Transforms grid coordinates to terrain coordinates
+	QMatrix4x4 mGridMatrix;
 	QSizeF mToMapFactor;
+	QSize mChunkCount;
+	QVector<Chunk> mChunks;
+	/// All chunk indices - kept to clip chunks against patches
+	QVector<unsigned int> mIndices;
+	/// Index ranges collected for the current draw call
+	QVector<GLsizei> mDrawCounts;
+	QVector<const GLvoid*> mDrawOffsets;
+	/// Clipped triangles collected for the current draw call
+	QVector<unsigned int> mClippedIndices;
+	/// Size of the index buffer's tail used as ring buffer for clipped triangles
+	int mStreamCapacity;
+	/// Next free index within the tail
+	int mStreamPosition;
+	/// Min/max heights of the quads - level 0 holds single quads, each further level halves the resolution
+	QVector< QVector<HeightRange> > mHeightPyramid;
+	/// Number of blocks in each level of mHeightPyramid
+	QVector<QSize> mHeightPyramidSizes;
+	/// log2 of the number of quads along the side of a block in level 0 of mHeightPyramid
+	int mHeightPyramidShift;
+	/// Number of cells and quads along the side of a cell - the last cell of a row or column may be larger or smaller
+	QSize mCellCount;
+	int mCellQuads;
+	/// Culling quadtree - the root comes first, children follow their parents
+	QVector<CullNode> mCullNodes;
+	/// The leaf of each cell
+	QVector<int> mCullLeaves;
+	QVector<int> mVisibleCells;
+	QVector<bool> mCellVisible;
+	/// Heights of a paged terrain - NULL if the terrain is kept in memory
+	TerrainTileFile * mTileFile;
+	TerrainTileCache * mTileCache;
 };
 
 
@@ -338,40 +590,26 @@ inline float Terrain::getHeightAboveGround( const QVector3D & position ) const
 }
 
 
-inline const QVector3D & Terrain::getVertexPosition( const int & x, const int & y ) const
+inline QVector3D Terrain::getVertexPosition( const int & x, const int & y ) const
 {
-	return mVertices[x+y*mMapSize.width()].position;
+	return QVector3D(
+		mOffset.x() + x * mSize.x() / mMapSize.width(),
+		gridHeight( x, y ),
+		mOffset.z() + y * mSize.z() / mMapSize.height()
+	);
 }
 
 
-inline const QVector3D & Terrain::getVertexPosition( const QPoint & p ) const
+inline QVector3D Terrain::getVertexPosition( const QPoint & p ) const
 {
 	return getVertexPosition( p.x(), p.y() );
 }
 
 
-inline const QVector3D & Terrain::getVertexNormal( const int & x, const int & y ) const
-{
-	return mVertices[x+y*mMapSize.width()].normal;
-}
-
-
-inline const QVector3D & Terrain::getVertexNormal( const QPoint & p ) const
+inline QVector3D Terrain::getVertexNormal( const QPoint & p ) const
 {
 	return getVertexNormal( p.x(), p.y() );
 }
 
 
-inline VertexP3fN3fT2f & Terrain::vertex( const int & x, const int & y )
-{
-	return mVertices[x+y*mMapSize.width()];
-}
-
-
-inline VertexP3fN3fT2f & Terrain::vertex( const QPoint & p )
-{
-	return vertex( p.x(), p.y() );
-}
-
-
 #endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TerrainGrid.hpp"
+
+#include <QVector>
+
+
+int TerrainGrid::sIndexAttribute = -1;
+
+
+QGLBuffer TerrainGrid::createIndexStream( int width, int count )
+{
+	QVector<GLshort> indices( count * 2 );
+	for( int i = 0; i < count; ++i )
+	{
+		indices[i*2] = i % width;
+		indices[i*2+1] = i / width;
+	}
+
+	QGLBuffer stream( QGLBuffer::VertexBuffer );
+	stream.create();
+	stream.bind();
+	stream.setUsagePattern( QGLBuffer::StaticDraw );
+	stream.allocate( indices.constData(), indices.size() * sizeof(GLshort) );
+	stream.release();
+	return stream;
+}
+
+
+void TerrainGrid::bind( int width, const QPoint & origin, const QSize & mapSize, int tileQuads, QGLBuffer * indexStream )
+{
+	GLint program = 0;
+	glGetIntegerv( GL_CURRENT_PROGRAM, &program );
+	if( !program )
+		return;
+
+	glUniform1i( glGetUniformLocation( program, "terrainGridWidth" ), width );
+	glUniform2f( glGetUniformLocation( program, "terrainGridOrigin" ), origin.x(), origin.y() );
+	glUniform2f( glGetUniformLocation( program, "terrainGridMaximum" ), mapSize.width()-1, mapSize.height()-1 );
+	glUniform1f( glGetUniformLocation( program, "terrainTileQuads" ), tileQuads );
+
+	if( !indexStream )
+		return;
+	sIndexAttribute = glGetAttribLocation( program, "terrainGridIndex" );
+	if( sIndexAttribute < 0 )
+		return;
+	// the pointer keeps referring to the stream after it is released
+	indexStream->bind();
+	glEnableVertexAttribArray( sIndexAttribute );
+	glVertexAttribPointer( sIndexAttribute, 2, GL_SHORT, GL_FALSE, 0, 0 );
+	indexStream->release();
+}
+
+
+void TerrainGrid::release()
+{
+	if( sIndexAttribute < 0 )
+		return;
+	glDisableVertexAttribArray( sIndexAttribute );
+	sIndexAttribute = -1;
+}
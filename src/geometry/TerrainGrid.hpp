@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GEOMETRY_TERRAINGRID_INCLUDED
+#define GEOMETRY_TERRAINGRID_INCLUDED
+
+#include <GLWidget.hpp>
+
+#include <QPoint>
+#include <QSize>
+#include <QGLBuffer>
+
+
+/// Passes the layout of terrain vertices to the bound shader
+/**
+ * Terrain vertices only hold a height and a normal - see VertexH1sN3s.\n
+ * Shaders compiled with the TERRAIN define are linked with terrainGrid.vert, which rebuilds the grid position
+ * from the vertex index: the index is split into column and row within a block of vertices,
+ * offset by the block's origin in the heightmap and clamped to the heightmap.
+ * The vertices of a tile are followed by a row of skirt vertices for each border - see TerrainTileCache.\n
+ * Without EXT_gpu_shader4 the vertex index is not available to shaders,
+ * column and row are then read from an additional stream created by createIndexStream().
+ */
+class TerrainGrid
+{
+public:
+	/// Whether vertex shaders can read the vertex index - no index stream is needed then
+	static bool vertexIndexSupported() { return GLEW_EXT_gpu_shader4; }
+
+	/// Creates a stream with the column and row of each vertex of a block - for drawing without vertex index
+	static QGLBuffer createIndexStream( int width, int count );
+
+	/// Passes a block of vertices to the current shader program.
+	/**
+	 * @param width Number of vertices in each row of the block.
+	 * @param origin Position of the block's first vertex in heightmap coordinates.
+	 * @param mapSize The size of the heightmap.
+	 * @param tileQuads Number of quads along the side of a tile followed by skirts - 0 if there are no skirts.
+	 * @param indexStream The stream created by createIndexStream() - NULL if the vertex index is supported.
+	 */
+	static void bind( int width, const QPoint & origin, const QSize & mapSize, int tileQuads, QGLBuffer * indexStream );
+	static void release();
+
+private:
+	/// Location of the index stream's attribute in the current program - -1 if not bound
+	static int sIndexAttribute;
+};
+
+
+#endif
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TerrainTileCache.hpp"
+#include "TerrainTileFile.hpp"
+#include "TerrainGrid.hpp"
+
+#include <utility/DrawStatistics.hpp>
+
+#include <QMutexLocker>
+
+#include <math.h>
+#include <limits.h>
+
+
+TerrainTileCache::TerrainTileCache( const TerrainTileFile * file, int radius, const QSizeF & spacing ) :
+	mFile( file ),
+	mRadius( qMax( radius, 1 ) ),
+	mSpacing( spacing ),
+	mQuit( false )
+{
+	mTiles.resize( mFile->tileCount().width() * mFile->tileCount().height() );
+	for( int i = 0; i < mTiles.size(); ++i )
+	{
+		mTiles[i].state = Absent;
+		mTiles[i].level = 0;
+	}
+	buildIndices();
+	if( !TerrainGrid::vertexIndexSupported() )
+		mGridIndexStream = TerrainGrid::createIndexStream( TerrainTileFile::TileQuads + 1, vertexCount() );
+
+	mLoader = new Loader( this );
+	mLoader->start();
+}
+
+
+TerrainTileCache::~TerrainTileCache()
+{
+	mMutex.lock();
+	mQuit = true;
+	mRequestsAvailable.wakeAll();
+	mMutex.unlock();
+	mLoader->wait();
+	delete mLoader;
+
+	while( !mResident.isEmpty() )
+		evict( mResident.last() );
+	for( int i = 0; i < mBufferPool.size(); ++i )
+		mBufferPool[i].destroy();
+	for( int i = 0; i < mIndexBuffers.size(); ++i )
+		mIndexBuffers[i].destroy();
+	mGridIndexStream.destroy();
+}
+
+
+void TerrainTileCache::Loader::run()
+{
+	while( true )
+	{
+		LoadedTile loaded;
+		{
+			QMutexLocker locker( &mCache->mMutex );
+			while( !mCache->mQuit && mCache->mRequests.isEmpty() )
+				mCache->mRequestsAvailable.wait( &mCache->mMutex );
+			if( mCache->mQuit )
+				return;
+			loaded.index = mCache->mRequests.takeFirst();
+		}
+
+		// the tile file is only read - no need to hold the lock
+		mCache->buildTile( loaded.index, loaded.vertices );
+
+		QMutexLocker locker( &mCache->mMutex );
+		mCache->mLoaded.append( loaded );
+	}
+}
+
+
+int TerrainTileCache::vertexCount() const
+{
+	// the grid followed by the skirts of the four sides - each continuing the grid with another row, see TerrainGrid
+	const int side = TerrainTileFile::TileQuads + 1;
+	return side * side + 4 * side;
+}
+
+
+QRect TerrainTileCache::tileQuads( int index ) const
+{
+	const int T = TerrainTileFile::TileQuads;
+	const QSize & mapSize = mFile->mapSize();
+	const int column = index % mFile->tileCount().width();
+	const int row = index / mFile->tileCount().width();
+	return QRect( column*T, row*T, T, T ).intersected( QRect( 0, 0, mapSize.width()-1, mapSize.height()-1 ) );
+}
+
+
+void TerrainTileCache::buildIndices()
+{
+	// every level first holds the cells row by row, then the skirt quads of the top, right, bottom and left side
+	const int T = TerrainTileFile::TileQuads;
+	const unsigned int side = T + 1;
+	const unsigned int skirts = side * side;
+	mIndexBuffers.resize( TerrainTileFile::Levels );
+	for( int level = 0; level < TerrainTileFile::Levels; ++level )
+	{
+		const unsigned int step = 1 << level;
+		const unsigned int cells = T >> level;
+		QVector<unsigned int> indices;
+		indices.reserve( ( cells*cells + 4*cells ) * 6 );
+
+		// split like the cells of Terrain's chunks - (x,y), (x,y+1), (x+1,y) is front facing
+		for( unsigned int j = 0; j < cells; ++j )
+		{
+			for( unsigned int i = 0; i < cells; ++i )
+			{
+				const unsigned int v00 = i*step + j*step*side;
+				const unsigned int v01 = v00 + step*side;
+				const unsigned int v10 = v00 + step;
+				const unsigned int v11 = v01 + step;
+				indices << v00 << v01 << v10;
+				indices << v11 << v10 << v01;
+			}
+		}
+
+		for( int border = 0; border < 4; ++border )
+		{
+			// the bottom and left side run in the opposite direction around the tile
+			const bool flip = border >= 2;
+			for( unsigned int k = 0; k < cells; ++k )
+			{
+				unsigned int a, b;
+				switch( border )
+				{
+				case 0:	a = k*step;			b = a + step;		break;
+				case 1:	a = T + k*step*side;		b = a + step*side;	break;
+				case 2:	a = k*step + T*side;		b = a + step;		break;
+				default:	a = k*step*side;		b = a + step*side;	break;
+				}
+				const unsigned int skirtA = skirts + border*side + k*step;
+				const unsigned int skirtB = skirtA + step;
+				if( flip )
+				{
+					indices << b << a << skirtA;
+					indices << skirtA << skirtB << b;
+				} else {
+					indices << a << b << skirtA;
+					indices << skirtB << skirtA << b;
+				}
+			}
+		}
+
+		QGLBuffer & buffer = mIndexBuffers[level];
+		buffer = QGLBuffer( QGLBuffer::IndexBuffer );
+		buffer.create();
+		buffer.bind();
+		buffer.setUsagePattern( QGLBuffer::StaticDraw );
+		buffer.allocate( indices.constData(), indices.size()*sizeof(unsigned int) );
+		buffer.release();
+	}
+}
+
+
+int TerrainTileCache::skirtSamples( int index ) const
+{
+	const QSize & count = mFile->tileCount();
+	const int column = index % count.width();
+	const int row = index / count.width();
+
+	// skirts reach down far enough to cover the gap to a neighbour at any level
+	float gap = mFile->tile( column, row ).errors[TerrainTileFile::Levels-1];
+	float neighbourGap = 0.0f;
+	if( column > 0 )		neighbourGap = qMax( neighbourGap, mFile->tile( column-1, row ).errors[TerrainTileFile::Levels-1] );
+	if( column < count.width()-1 )	neighbourGap = qMax( neighbourGap, mFile->tile( column+1, row ).errors[TerrainTileFile::Levels-1] );
+	if( row > 0 )			neighbourGap = qMax( neighbourGap, mFile->tile( column, row-1 ).errors[TerrainTileFile::Levels-1] );
+	if( row < count.height()-1 )	neighbourGap = qMax( neighbourGap, mFile->tile( column, row+1 ).errors[TerrainTileFile::Levels-1] );
+	return (int)ceilf( ( gap + neighbourGap ) / mFile->heightStep() ) + 1;
+}
+
+
+void TerrainTileCache::buildTile( int index, QVector<VertexH1sN3s> & vertices ) const
+{
+	const int T = TerrainTileFile::TileQuads;
+	const int side = T + 1;
+	const QSize & count = mFile->tileCount();
+	const QSize & mapSize = mFile->mapSize();
+	const int column = index % count.width();
+	const int row = index / count.width();
+	const int depth = skirtSamples( index );
+
+	vertices.resize( vertexCount() );
+	for( int v = 0; v < side; ++v )
+	{
+		const int y = qMin( row*T + v, mapSize.height()-1 );
+		for( int u = 0; u < side; ++u )
+		{
+			const int x = qMin( column*T + u, mapSize.width()-1 );
+			const int sample = mFile->sample( x, y );
+			VertexH1sN3s & vertex = vertices[u + v*side];
+			vertex.height = sample + SHRT_MIN;
+
+			// the normal of Terrain's vertices in grid units, like Terrain::encodeVertex()
+			const float dx = (float)( mFile->sample( x+1, y ) - sample );
+			const float dy = (float)( mFile->sample( x, y+1 ) - sample );
+			const float length = sqrtf( dx*dx + dy*dy + 1.0f );
+			vertex.normal[0] = (GLshort)floorf( -dx / length * SHRT_MAX + 0.5f );
+			vertex.normal[1] = (GLshort)floorf( -dy / length * SHRT_MAX + 0.5f );
+			vertex.normal[2] = (GLshort)floorf( 1.0f / length * SHRT_MAX + 0.5f );
+		}
+	}
+
+	for( int border = 0; border < 4; ++border )
+	{
+		for( int k = 0; k < side; ++k )
+		{
+			int source;
+			switch( border )
+			{
+			case 0:		source = k;		break;
+			case 1:		source = T + k*side;	break;
+			case 2:		source = k + T*side;	break;
+			default:	source = k*side;	break;
+			}
+			VertexH1sN3s & skirt = vertices[side*side + border*side + k];
+			skirt = vertices[source];
+			skirt.height = (GLshort)qMax( (int)skirt.height - depth, SHRT_MIN );
+		}
+	}
+}
+
+
+void TerrainTileCache::upload( int index, const QVector<VertexH1sN3s> & vertices )
+{
+	Tile & tile = mTiles[index];
+	const int bytes = vertices.size() * VertexH1sN3s::size();
+	if( mBufferPool.isEmpty() )
+	{
+		tile.vertexBuffer = QGLBuffer( QGLBuffer::VertexBuffer );
+		tile.vertexBuffer.create();
+		tile.vertexBuffer.bind();
+		tile.vertexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+		tile.vertexBuffer.allocate( vertices.constData(), bytes );
+	} else {
+		// all tiles have the same size - reuse the storage of an evicted tile
+		tile.vertexBuffer = mBufferPool.takeLast();
+		tile.vertexBuffer.bind();
+		tile.vertexBuffer.write( 0, vertices.constData(), bytes );
+	}
+	tile.vertexBuffer.release();
+	tile.state = Resident;
+	tile.level = 0;
+	mResident.append( index );
+}
+
+
+void TerrainTileCache::evict( int index )
+{
+	Tile & tile = mTiles[index];
+	mBufferPool.append( tile.vertexBuffer );
+	tile.vertexBuffer = QGLBuffer();
+	tile.state = Absent;
+	mResident.removeOne( index );
+}
+
+
+void TerrainTileCache::sortRequests( const QPointF & eye )
+{
+	// insertion sort by distance to the viewer - there are only a few requests
+	const float T = TerrainTileFile::TileQuads;
+	QVector<float> distances( mRequests.size() );
+	for( int i = 0; i < mRequests.size(); ++i )
+	{
+		const QRect quads = tileQuads( mRequests[i] );
+		const float x = ( quads.left() + quads.right() + 1 ) * 0.5f - eye.x();
+		const float y = ( quads.top() + quads.bottom() + 1 ) * 0.5f - eye.y();
+		const float distance = ( x*x + y*y ) / ( T*T );
+		const int index = mRequests[i];
+		int j = i;
+		for( ; j > 0 && distances[j-1] > distance; --j )
+		{
+			mRequests[j] = mRequests[j-1];
+			distances[j] = distances[j-1];
+		}
+		mRequests[j] = index;
+		distances[j] = distance;
+	}
+}
+
+
+void TerrainTileCache::update( const QPointF & eye, float eyeHeight, float errorScale )
+{
+	const int T = TerrainTileFile::TileQuads;
+	const QSize & count = mFile->tileCount();
+	const QPoint center(
+		qBound( 0, (int)floorf( eye.x() / T ), count.width()-1 ),
+		qBound( 0, (int)floorf( eye.y() / T ), count.height()-1 )
+	);
+	const QRect bounds( 0, 0, count.width(), count.height() );
+	const QRect wanted = QRect( center - QPoint( mRadius, mRadius ), QSize( 2*mRadius+1, 2*mRadius+1 ) ).intersected( bounds );
+	// tiles are kept a little longer than they are wanted, so moving back and forth doesn't reload them
+	const QRect kept = QRect( center - QPoint( mRadius+1, mRadius+1 ), QSize( 2*mRadius+3, 2*mRadius+3 ) ).intersected( bounds );
+	const QRect immediate = QRect( center - QPoint( 1, 1 ), QSize( 3, 3 ) ).intersected( bounds );
+
+	for( int i = mResident.size()-1; i >= 0; --i )
+	{
+		const int index = mResident[i];
+		if( !kept.contains( index % count.width(), index / count.width() ) )
+			evict( index );
+	}
+
+	QList<LoadedTile> loaded;
+	{
+		QMutexLocker locker( &mMutex );
+
+		// drop requests which are no longer needed
+		for( int i = mRequests.size()-1; i >= 0; --i )
+		{
+			const int index = mRequests[i];
+			if( !kept.contains( index % count.width(), index / count.width() ) ||
+				immediate.contains( index % count.width(), index / count.width() ) )
+			{
+				mTiles[index].state = Absent;
+				mRequests.removeAt( i );
+			}
+		}
+
+		for( int row = wanted.top(); row <= wanted.bottom(); ++row )
+		{
+			for( int column = wanted.left(); column <= wanted.right(); ++column )
+			{
+				const int index = column + row*count.width();
+				if( mTiles[index].state == Absent && !immediate.contains( column, row ) )
+				{
+					mTiles[index].state = Queued;
+					mRequests.append( index );
+				}
+			}
+		}
+		sortRequests( eye );
+		if( !mRequests.isEmpty() )
+			mRequestsAvailable.wakeOne();
+
+		for( int i = 0; i < sUploadsPerFrame && !mLoaded.isEmpty(); ++i )
+			loaded.append( mLoaded.takeFirst() );
+	}
+
+	for( int i = 0; i < loaded.size(); ++i )
+	{
+		const int index = loaded[i].index;
+		// the tile may have been loaded immediately or left the area in the meantime
+		if( mTiles[index].state == Resident )
+			continue;
+		if( kept.contains( index % count.width(), index / count.width() ) )
+			upload( index, loaded[i].vertices );
+		else
+			mTiles[index].state = Absent;
+	}
+
+	// the tiles around the viewer can't wait
+	QVector<VertexH1sN3s> vertices;
+	for( int row = immediate.top(); row <= immediate.bottom(); ++row )
+	{
+		for( int column = immediate.left(); column <= immediate.right(); ++column )
+		{
+			const int index = column + row*count.width();
+			if( mTiles[index].state == Resident )
+				continue;
+			buildTile( index, vertices );
+			upload( index, vertices );
+		}
+	}
+
+	// coarsest level within the error bound - like Terrain::updateLevelOfDetail()
+	for( int i = 0; i < mResident.size(); ++i )
+	{
+		Tile & tile = mTiles[mResident[i]];
+		const QRect quads = tileQuads( mResident[i] );
+		const TerrainTileFile::TileInfo & info = mFile->tile( mResident[i] % count.width(), mResident[i] / count.width() );
+		const float x = ( qBound( (float)quads.left(), (float)eye.x(), (float)quads.right()+1 ) - eye.x() ) * mSpacing.width();
+		const float z = ( qBound( (float)quads.top(), (float)eye.y(), (float)quads.bottom()+1 ) - eye.y() ) * mSpacing.height();
+		const float y = qBound( info.minimum, eyeHeight, info.maximum ) - eyeHeight;
+		const float distance = sqrtf( x*x + y*y + z*z );
+
+		tile.level = 0;
+		while( tile.level+1 < TerrainTileFile::Levels && info.errors[tile.level+1] * errorScale <= distance )
+			++tile.level;
+	}
+}
+
+
+void TerrainTileCache::appendRange( int offset, int count )
+{
+	// merge with the previous range if they are adjacent
+	const GLvoid * start = (const GLvoid*)( (size_t)offset * sizeof(unsigned int) );
+	if( !mDrawCounts.isEmpty() &&
+		(size_t)mDrawOffsets.last() + mDrawCounts.last() * sizeof(unsigned int) == (size_t)start )
+	{
+		mDrawCounts.last() += count;
+		return;
+	}
+	mDrawCounts.append( count );
+	mDrawOffsets.append( start );
+}
+
+
+void TerrainTileCache::draw( const QRect & quads, const QVector<bool> & visible )
+{
+	for( int r = 0; r < mResident.size(); ++r )
+	{
+		const int index = mResident[r];
+		if( !visible[index] )
+			continue;
+		const Tile & tile = mTiles[index];
+		const QRect tileRect = tileQuads( index );
+		const QRect rect = quads.intersected( tileRect );
+		if( rect.isEmpty() )
+			continue;
+
+		// cells of the tile's level covering the rectangle
+		const int step = 1 << tile.level;
+		const int cells = TerrainTileFile::TileQuads >> tile.level;
+		const int i0 = ( rect.left() - tileRect.left() ) / step;
+		const int i1 = ( rect.right() - tileRect.left() ) / step;
+		const int j0 = ( rect.top() - tileRect.top() ) / step;
+		const int j1 = ( rect.bottom() - tileRect.top() ) / step;
+		for( int j = j0; j <= j1; ++j )
+			appendRange( ( j*cells + i0 ) * 6, ( i1-i0+1 ) * 6 );
+
+		const int skirts = cells * cells * 6;
+		if( rect.top() == tileRect.top() )
+			appendRange( skirts + ( 0*cells + i0 ) * 6, ( i1-i0+1 ) * 6 );
+		if( rect.right() == tileRect.right() )
+			appendRange( skirts + ( 1*cells + j0 ) * 6, ( j1-j0+1 ) * 6 );
+		if( rect.bottom() == tileRect.bottom() )
+			appendRange( skirts + ( 2*cells + i0 ) * 6, ( i1-i0+1 ) * 6 );
+		if( rect.left() == tileRect.left() )
+			appendRange( skirts + ( 3*cells + j0 ) * 6, ( j1-j0+1 ) * 6 );
+
+		QGLBuffer vertexBuffer = tile.vertexBuffer;
+		QGLBuffer indexBuffer = mIndexBuffers[tile.level];
+		vertexBuffer.bind();
+		indexBuffer.bind();
+		VertexH1sN3s::glPointerVBO();
+		TerrainGrid::bind( TerrainTileFile::TileQuads + 1, tileRect.topLeft(), mFile->mapSize(), TerrainTileFile::TileQuads, mGridIndexStream.isCreated() ? &mGridIndexStream : NULL );
+
+		glMultiDrawElements( GL_TRIANGLES, mDrawCounts.constData(), GL_UNSIGNED_INT, (const GLvoid**)mDrawOffsets.constData(), mDrawCounts.size() );
+		int indices = 0;
+		for( int i = 0; i < mDrawCounts.size(); ++i )
+			indices += mDrawCounts[i];
+		DrawStatistics::countDrawCall( indices / 3 );
+
+		TerrainGrid::release();
+		indexBuffer.release();
+		vertexBuffer.release();
+		mDrawCounts.clear();
+		mDrawOffsets.clear();
+	}
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GEOMETRY_TERRAINTILECACHE_INCLUDED
+#define GEOMETRY_TERRAINTILECACHE_INCLUDED
+
+#include "Vertex.hpp"
+
+#include <GLWidget.hpp>
+
+#include <QList>
+#include <QVector>
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QSizeF>
+#include <QGLBuffer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+
+class TerrainTileFile;
+
+
+/// Keeps the tiles of a TerrainTileFile around the viewer on the graphics card
+/**
+ * Tiles are turned into vertices on a background thread, nearest first,
+ * and uploaded into vertex buffers taken from a pool - a few of them each frame.\n
+ * Tiles leaving the area around the viewer return their buffers to the pool.\n
+ * Each tile is drawn with its own level of detail, the gaps between tiles of different levels
+ * are hidden by skirts hanging down from the tile borders.\n
+ * Vertices use grid coordinates like Terrain's vertex buffer and have to be drawn with its grid matrix.\n
+ * Like Terrain's vertices they only hold a height and a normal, their grid position is rebuilt by the shader - see TerrainGrid.
+ */
+class TerrainTileCache
+{
+public:
+	/**
+	 * @param file The tiles to draw - has to stay open while the cache exists.
+	 * @param radius Number of tiles kept around the tile containing the viewer in each direction.
+	 * @param spacing World size of a single quad.
+	 */
+	TerrainTileCache( const TerrainTileFile * file, int radius, const QSizeF & spacing );
+	~TerrainTileCache();
+
+	/// Requests the tiles around the viewer, uploads finished tiles and chooses the level of detail of each tile.
+	/**
+	 * The tiles next to the viewer are loaded immediately if they are missing.
+	 * @param eye Position of the viewer in heightmap coordinates.
+	 * @param eyeHeight Height of the viewer.
+	 * @param errorScale See Terrain::updateLevelOfDetail().
+	 */
+	void update( const QPointF & eye, float eyeHeight, float errorScale );
+
+	/// Draws the resident tiles within a rectangle of quads in heightmap coordinates.
+	/**
+	 * The grid matrix and the client states besides the vertex arrays have to be set up by the caller.
+	 * @param visible Whether each tile of the file may be drawn - see Terrain::cull().
+	 */
+	void draw( const QRect & quads, const QVector<bool> & visible );
+
+	/// How far the skirts of a tile reach below its lowest vertex in samples
+	int skirtSamples( int index ) const;
+
+	int residentTiles() const { return mResident.size(); }	///< Number of tiles on the graphics card
+
+private:
+	/// Number of finished tiles uploaded per frame
+	static const int sUploadsPerFrame = 2;
+
+	enum TileState
+	{
+		Absent,
+		Queued,	///< Waiting for the loader, being loaded or waiting for upload
+		Resident
+	};
+
+	struct Tile
+	{
+		TileState state;
+		int level;
+		QGLBuffer vertexBuffer;
+	};
+
+	/// Vertices built by the loader, waiting for upload
+	struct LoadedTile
+	{
+		int index;
+		QVector<VertexH1sN3s> vertices;
+	};
+
+	/// Builds the vertices of requested tiles
+	class Loader : public QThread
+	{
+	public:
+		Loader( TerrainTileCache * cache ) : mCache( cache ) {}
+	protected:
+		virtual void run();
+	private:
+		TerrainTileCache * mCache;
+	};
+
+	const TerrainTileFile * mFile;
+	int mRadius;
+	QSizeF mSpacing;
+	QVector<Tile> mTiles;
+	/// Indices of all resident tiles
+	QList<int> mResident;
+	/// Vertex buffers of evicted tiles
+	QList<QGLBuffer> mBufferPool;
+	/// One index buffer per level, shared by all tiles
+	QVector<QGLBuffer> mIndexBuffers;
+	/// Column and row of each vertex of a tile for shaders without vertex index - see TerrainGrid
+	QGLBuffer mGridIndexStream;
+	QVector<GLsizei> mDrawCounts;
+	QVector<const GLvoid*> mDrawOffsets;
+
+	Loader * mLoader;
+	QMutex mMutex;
+	QWaitCondition mRequestsAvailable;
+	/// Tiles waiting for the loader, nearest first - guarded by mMutex
+	QList<int> mRequests;
+	/// Tiles finished by the loader - guarded by mMutex
+	QList<LoadedTile> mLoaded;
+	/// Tells the loader to stop - guarded by mMutex
+	bool mQuit;
+
+	int vertexCount() const;
+	QRect tileQuads( int index ) const;
+	void buildIndices();
+	void buildTile( int index, QVector<VertexH1sN3s> & vertices ) const;
+	void upload( int index, const QVector<VertexH1sN3s> & vertices );
+	void evict( int index );
+	void appendRange( int offset, int count );
+	void sortRequests( const QPointF & eye );
+};
+
+
+#endif
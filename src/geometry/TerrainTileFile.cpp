@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TerrainTileFile.hpp"
+
+#include <utility/JobSystem.hpp>
+
+#include <QVector>
+#include <QDebug>
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+
+/// Layout of a tile file - followed by the tile infos, the block ranges and the samples of all tiles
+struct TerrainTileFileHeader
+{
+	char magic[4];
+	quint32 version;
+	char key[20];
+	qint32 mapWidth;
+	qint32 mapHeight;
+	qint32 tileQuads;
+	qint32 levels;
+	qint32 blockQuads;
+	float heightBase;
+	float heightStep;
+};
+
+static const char sTileFileMagic[4] = { 'S', 'T', 'T', 'L' };
+static const quint32 sTileFileVersion = 2;
+
+
+/// Quantizes the tiles of one row and computes their height ranges and errors
+class EncodeTileRowJob : public JobSystem::AJob
+{
+public:
+	virtual void run();
+
+	const float * heights;	///< The rows from top on
+	int top;
+	QSize mapSize;
+	QSize tileCount;
+	QSize blockCount;
+	int row;
+	float heightBase;
+	float heightStep;
+
+	QVector<quint16> samples;
+	QVector<TerrainTileFile::TileInfo> tiles;
+	QVector<TerrainTileFile::BlockRange> blocks;
+	int firstBlockRow;
+
+private:
+	float height( int x, int y ) const
+	{
+		return heights[ qBound( 0, x, mapSize.width()-1 ) + (size_t)( qBound( 0, y, mapSize.height()-1 ) - top ) * mapSize.width() ];
+	}
+	float levelError( int x, int y, int level ) const;
+};
+
+
+void EncodeTileRowJob::run()
+{
+	const int T = TerrainTileFile::TileQuads;
+	const int tileVertices = ( T+1 ) * ( T+1 );
+	samples.resize( tileCount.width() * tileVertices );
+	tiles.resize( tileCount.width() );
+
+	for( int column = 0; column < tileCount.width(); ++column )
+	{
+		const int x = column * T;
+		const int y = row * T;
+		quint16 * tileSamples = samples.data() + column * tileVertices;
+		TerrainTileFile::TileInfo & info = tiles[column];
+		info.minimum = FLT_MAX;
+		info.maximum = -FLT_MAX;
+		for( int v = 0; v <= T; ++v )
+		{
+			for( int u = 0; u <= T; ++u )
+			{
+				const float h = height( x+u, y+v );
+				tileSamples[u + v*(T+1)] = (quint16)qBound( 0.0f, floorf( ( h - heightBase ) / heightStep + 0.5f ), 65535.0f );
+				info.minimum = qMin( info.minimum, h );
+				info.maximum = qMax( info.maximum, h );
+			}
+		}
+		info.errors[0] = 0.0f;
+		for( int level = 1; level < TerrainTileFile::Levels; ++level )
+			info.errors[level] = qMax( info.errors[level-1], levelError( x, y, level ) );
+	}
+
+	// the blocks covered by this row of tiles
+	const int B = TerrainTileFile::BlockQuads;
+	firstBlockRow = row * T / B;
+	const int lastBlockRow = qMin( ( row+1 ) * T / B, blockCount.height() );
+	blocks.resize( qMax( lastBlockRow - firstBlockRow, 0 ) * blockCount.width() );
+	for( int by = firstBlockRow; by < lastBlockRow; ++by )
+	{
+		for( int bx = 0; bx < blockCount.width(); ++bx )
+		{
+			TerrainTileFile::BlockRange & range = blocks[bx + ( by - firstBlockRow ) * blockCount.width()];
+			range.minimum = FLT_MAX;
+			range.maximum = -FLT_MAX;
+			for( int v = by*B; v <= qMin( ( by+1 )*B, mapSize.height()-1 ); ++v )
+			{
+				for( int u = bx*B; u <= qMin( ( bx+1 )*B, mapSize.width()-1 ); ++u )
+				{
+					range.minimum = qMin( range.minimum, height( u, v ) );
+					range.maximum = qMax( range.maximum, height( u, v ) );
+				}
+			}
+		}
+	}
+}
+
+
+float EncodeTileRowJob::levelError( int x, int y, int level ) const
+{
+	// compare each vertex with the triangle of the coarser level covering it
+	const int step = 1 << level;
+	const int cells = TerrainTileFile::TileQuads / step;
+	float error = 0.0f;
+	for( int j = 0; j < cells; ++j )
+	{
+		for( int i = 0; i < cells; ++i )
+		{
+			const int cx = x + i*step;
+			const int cy = y + j*step;
+			const float h00 = height( cx,      cy );
+			const float h01 = height( cx,      cy+step );
+			const float h10 = height( cx+step, cy );
+			const float h11 = height( cx+step, cy+step );
+			for( int v = 0; v <= step; ++v )
+			{
+				for( int u = 0; u <= step; ++u )
+				{
+					const float fx = (float)u / (float)step;
+					const float fy = (float)v / (float)step;
+					float interpolated;
+					if( fx + fy < 1.0f )
+						interpolated = h00 + fx*( h10-h00 ) + fy*( h01-h00 );
+					else
+						interpolated = h11 + (1.0f-fx)*( h01-h11 ) + (1.0f-fy)*( h10-h11 );
+					error = qMax( error, fabsf( height( cx+u, cy+v ) - interpolated ) );
+				}
+			}
+		}
+	}
+	return error;
+}
+
+
+TerrainTileFile::TerrainTileFile() :
+	mData( 0 ),
+	mHeightBase( 0.0f ),
+	mHeightStep( 1.0f ),
+	mTiles( 0 ),
+	mBlocks( 0 ),
+	mSamples( 0 )
+{
+}
+
+
+TerrainTileFile::~TerrainTileFile()
+{
+	close();
+}
+
+
+QSize TerrainTileFile::tileCount( const QSize & mapSize )
+{
+	return QSize(
+		qMax( 1, ( mapSize.width()-1 + TileQuads-1 ) / TileQuads ),
+		qMax( 1, ( mapSize.height()-1 + TileQuads-1 ) / TileQuads )
+	);
+}
+
+
+QSize TerrainTileFile::blockCount( const QSize & mapSize )
+{
+	return QSize(
+		qMax( 1, ( mapSize.width()-1 + BlockQuads-1 ) / BlockQuads ),
+		qMax( 1, ( mapSize.height()-1 + BlockQuads-1 ) / BlockQuads )
+	);
+}
+
+
+bool TerrainTileFile::write( const QString & path, const QByteArray & key, AHeightSource & source, JobSystem * jobs )
+{
+	const QSize mapSize = source.mapSize();
+	const QSize tiles = tileCount( mapSize );
+	const QSize blocks = blockCount( mapSize );
+	const qint64 tileVertices = ( TileQuads+1 ) * ( TileQuads+1 );
+
+	float minimum;
+	float maximum;
+	source.range( minimum, maximum );
+
+	TerrainTileFileHeader header;
+	memcpy( header.magic, sTileFileMagic, sizeof(header.magic) );
+	header.version = sTileFileVersion;
+	memset( header.key, 0, sizeof(header.key) );
+	memcpy( header.key, key.constData(), qMin( key.size(), (int)sizeof(header.key) ) );
+	header.mapWidth = mapSize.width();
+	header.mapHeight = mapSize.height();
+	header.tileQuads = TileQuads;
+	header.levels = Levels;
+	header.blockQuads = BlockQuads;
+	header.heightBase = minimum;
+	header.heightStep = qMax( ( maximum - minimum ) / 65535.0f, FLT_EPSILON );
+
+	const qint64 tilesOffset = sizeof(header);
+	const qint64 blocksOffset = tilesOffset + (qint64)tiles.width() * tiles.height() * sizeof(TileInfo);
+	const qint64 samplesOffset = blocksOffset + (qint64)blocks.width() * blocks.height() * sizeof(BlockRange);
+
+	QFile file( path );
+	bool written = file.open( QIODevice::WriteOnly | QIODevice::Truncate ) &&
+		file.write( (const char*)&header, sizeof(header) ) == sizeof(header);
+
+	// encode a few rows of tiles at once - only the heights they cover are read
+	const int rowsPerBatch = jobs ? jobs->numThreads() : 1;
+	QVector<float> heights;
+	for( int first = 0; written && first < tiles.height(); first += rowsPerBatch )
+	{
+		QVector<EncodeTileRowJob> batch( qMin( rowsPerBatch, tiles.height() - first ) );
+
+		// neighbouring rows of tiles share their border vertices
+		const int top = qMin( first * TileQuads, mapSize.height()-1 );
+		const int bottom = qMin( ( first + batch.size() ) * TileQuads, mapSize.height()-1 );
+		heights.resize( ( bottom - top + 1 ) * mapSize.width() );
+		source.read( top, bottom+1, heights.data() );
+
+		QVector<JobSystem::AJob*> pointers( batch.size() );
+		for( int i = 0; i < batch.size(); ++i )
+		{
+			EncodeTileRowJob & job = batch[i];
+			job.heights = heights.constData();
+			job.top = top;
+			job.mapSize = mapSize;
+			job.tileCount = tiles;
+			job.blockCount = blocks;
+			job.row = first + i;
+			job.heightBase = header.heightBase;
+			job.heightStep = header.heightStep;
+			pointers[i] = &job;
+		}
+		if( jobs )
+			jobs->run( pointers );
+		else
+			for( int i = 0; i < pointers.size(); ++i )
+				pointers[i]->run();
+
+		for( int i = 0; written && i < batch.size(); ++i )
+		{
+			const EncodeTileRowJob & job = batch[i];
+			const qint64 tileBytes = job.tiles.size() * sizeof(TileInfo);
+			const qint64 blockBytes = job.blocks.size() * sizeof(BlockRange);
+			const qint64 sampleBytes = job.samples.size() * sizeof(quint16);
+			written =
+				file.seek( tilesOffset + (qint64)job.row * tiles.width() * sizeof(TileInfo) ) &&
+				file.write( (const char*)job.tiles.constData(), tileBytes ) == tileBytes &&
+				file.seek( blocksOffset + (qint64)job.firstBlockRow * blocks.width() * sizeof(BlockRange) ) &&
+				file.write( (const char*)job.blocks.constData(), blockBytes ) == blockBytes &&
+				file.seek( samplesOffset + (qint64)job.row * tiles.width() * tileVertices * sizeof(quint16) ) &&
+				file.write( (const char*)job.samples.constData(), sampleBytes ) == sampleBytes;
+		}
+	}
+	file.close();
+
+	if( !written )
+	{
+		qWarning() << "Could not write terrain tiles" << path;
+		file.remove();
+	}
+	return written;
+}
+
+
+bool TerrainTileFile::open( const QString & path, const QByteArray & key )
+{
+	close();
+
+	mFile.setFileName( path );
+	if( !mFile.open( QIODevice::ReadOnly ) || mFile.size() < (qint64)sizeof(TerrainTileFileHeader) )
+	{
+		mFile.close();
+		return false;
+	}
+	mData = mFile.map( 0, mFile.size() );
+	if( !mData )
+	{
+		qWarning() << "Could not map terrain tiles" << path;
+		mFile.close();
+		return false;
+	}
+
+	TerrainTileFileHeader header;
+	memcpy( &header, mData, sizeof(header) );
+	const QSize mapSize( header.mapWidth, header.mapHeight );
+	const QSize tiles = tileCount( mapSize );
+	const QSize blocks = blockCount( mapSize );
+	const qint64 tileVertices = ( TileQuads+1 ) * ( TileQuads+1 );
+	const qint64 expectedSize = sizeof(header)
+		+ (qint64)tiles.width() * tiles.height() * sizeof(TileInfo)
+		+ (qint64)blocks.width() * blocks.height() * sizeof(BlockRange)
+		+ (qint64)tiles.width() * tiles.height() * tileVertices * sizeof(quint16);
+	if( memcmp( header.magic, sTileFileMagic, sizeof(header.magic) ) ||
+		header.version != sTileFileVersion ||
+		key.size() != sizeof(header.key) || memcmp( header.key, key.constData(), sizeof(header.key) ) ||
+		header.tileQuads != TileQuads || header.levels != Levels || header.blockQuads != BlockQuads ||
+		mFile.size() != expectedSize )
+	{
+		close();
+		return false;
+	}
+
+	mMapSize = mapSize;
+	mTileCount = tiles;
+	mBlockCount = blocks;
+	mHeightBase = header.heightBase;
+	mHeightStep = header.heightStep;
+	mTiles = (const TileInfo*)( mData + sizeof(header) );
+	mBlocks = (const BlockRange*)( mTiles + tiles.width() * tiles.height() );
+	mSamples = (const quint16*)( mBlocks + blocks.width() * blocks.height() );
+	return true;
+}
+
+
+void TerrainTileFile::close()
+{
+	if( mData )
+		mFile.unmap( mData );
+	mFile.close();
+	mData = 0;
+	mTiles = 0;
+	mBlocks = 0;
+	mSamples = 0;
+}
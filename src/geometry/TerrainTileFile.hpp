@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GEOMETRY_TERRAINTILEFILE_INCLUDED
+#define GEOMETRY_TERRAINTILEFILE_INCLUDED
+
+#include <QString>
+#include <QByteArray>
+#include <QSize>
+#include <QFile>
+
+
+class JobSystem;
+
+
+/// A heightfield split into fixed-size tiles, stored in a memory mapped file
+/**
+ * Each tile holds the 16 bit heights of (TileQuads+1)x(TileQuads+1) vertices,
+ * so it can be turned into a mesh without touching its neighbours.\n
+ * Besides the heights the file keeps the height range and the error of every detail level of each tile,
+ * and the height range of small blocks of quads used to skip empty regions when intersecting lines.\n
+ * Only the parts of the file which are actually read are loaded into memory by the operating system.
+ */
+class TerrainTileFile
+{
+public:
+	/// Number of quads along the side of a tile
+	static const int TileQuads = 256;
+	/// Number of detail levels - level n uses every 2^n-th vertex
+	static const int Levels = 6;
+	/// Number of quads along the side of a block
+	static const int BlockQuads = 16;
+
+	/// Height range and error of each detail level of a tile
+	struct TileInfo
+	{
+		float minimum;
+		float maximum;
+		float errors[Levels];
+	};
+
+	/// Height range of a block of quads
+	struct BlockRange
+	{
+		float minimum;
+		float maximum;
+	};
+
+	/// Supplies the heights written to a tile file in bands of rows
+	/**
+	 * The rows are requested from top to bottom, so a source never has to hold the whole heightfield.
+	 */
+	class AHeightSource
+	{
+	public:
+		virtual ~AHeightSource() {}
+		/// Number of vertices
+		virtual QSize mapSize() const = 0;
+		/// Bounds of all heights - used to quantize the heights before any of them is read
+		virtual void range( float & minimum, float & maximum ) = 0;
+		/// Reads the rows first to last-1 into heights, row by row
+		virtual void read( int first, int last, float * heights ) = 0;
+	};
+
+	TerrainTileFile();
+	~TerrainTileFile();
+
+	/// Writes a heightfield to a tile file.
+	/**
+	 * Only the rows of the tiles encoded at once are kept in memory.
+	 * @param path The file to write.
+	 * @param key Identifies the source of the heights - see open().
+	 * @param source Supplies the heights.
+	 * @param jobs Used to encode the tiles on all cores if given.
+	 */
+	static bool write( const QString & path, const QByteArray & key, AHeightSource & source, JobSystem * jobs = 0 );
+
+	/// Maps a tile file written with the same key into memory.
+	bool open( const QString & path, const QByteArray & key );
+	void close();
+	bool isOpen() const { return mData != 0; }
+
+	const QSize & mapSize() const { return mMapSize; }	///< Number of vertices
+	const QSize & tileCount() const { return mTileCount; }	///< Number of tiles
+	const QSize & blockCount() const { return mBlockCount; }	///< Number of blocks
+
+	const TileInfo & tile( int column, int row ) const { return mTiles[column + row*mTileCount.width()]; }
+	const BlockRange & block( int column, int row ) const { return mBlocks[column + row*mBlockCount.width()]; }
+
+	/// The quantized height of a vertex - coordinates are clamped to the map
+	quint16 sample( int x, int y ) const;
+	/// The height of a vertex - coordinates are clamped to the map
+	float height( int x, int y ) const { return mHeightBase + (float)sample( x, y ) * mHeightStep; }
+
+	float heightBase() const { return mHeightBase; }	///< Height of sample 0
+	float heightStep() const { return mHeightStep; }	///< Height difference between two successive samples
+
+private:
+	QFile mFile;
+	uchar * mData;
+	QSize mMapSize;
+	QSize mTileCount;
+	QSize mBlockCount;
+	float mHeightBase;
+	float mHeightStep;
+	const TileInfo * mTiles;
+	const BlockRange * mBlocks;
+	const quint16 * mSamples;
+
+	static QSize tileCount( const QSize & mapSize );
+	static QSize blockCount( const QSize & mapSize );
+};
+
+
+inline quint16 TerrainTileFile::sample( int x, int y ) const
+{
+	x = qBound( 0, x, mMapSize.width()-1 );
+	y = qBound( 0, y, mMapSize.height()-1 );
+	const int column = qMin( x / TileQuads, mTileCount.width()-1 );
+	const int row = qMin( y / TileQuads, mTileCount.height()-1 );
+	const int tileVertices = ( TileQuads+1 ) * ( TileQuads+1 );
+	const quint16 * tile = mSamples + (size_t)( column + row*mTileCount.width() ) * tileVertices;
+	return tile[ ( x - column*TileQuads ) + ( y - row*TileQuads ) * ( TileQuads+1 ) ];
+}
+
+
+#endif
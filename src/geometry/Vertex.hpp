@@ -23,6 +23,9 @@
 #include <QVector2D>
 #include <utility/glWrappers.hpp>
 
+#include <string.h>
+#include <limits.h>
+
 
 class VertexP3f
 {
@@ -165,4 +168,54 @@ public:
 };
 
 
+/// Compact terrain vertex holding only a height and a normal
+/**
+ * The grid position of a terrain vertex is implied by its index and rebuilt by the vertex shader - see TerrainGrid.\n
+ * Height and normal are passed as a single vertex with four components, the height coming first.
+ * The normal is not normalized to [-1,1] then, which the shaders do anyway.
+ */
+class VertexH1sN3s
+{
+public:
+	GLshort height;
+	GLshort normal[3];
+
+	VertexH1sN3s()
+	{
+		height = 0;
+		normal[0] = normal[2] = 0;
+		normal[1] = SHRT_MAX;
+	}
+
+	~VertexH1sN3s() {}
+
+	bool operator==( const VertexH1sN3s & other )
+	{
+		return height == other.height
+			&& !memcmp( normal, other.normal, sizeof(normal) );
+	}
+
+	bool operator!=( const VertexH1sN3s & other )
+	{
+		return !(*this==other);
+	}
+
+	static size_t size() { return sizeof( VertexH1sN3s ); }
+	static size_t heightOffset() { return offsetof( VertexH1sN3s, height ); }
+	static void * heightOffsetPTR() { return (void*)heightOffset(); }
+	static void glEnableClientState()
+	{
+		::glEnableClientState( GL_VERTEX_ARRAY );
+	}
+	static void glDisableClientState()
+	{
+		::glDisableClientState( GL_VERTEX_ARRAY );
+	}
+	static void glPointerVBO()
+	{
+		glVertexPointer( 4, GL_SHORT, size(), heightOffsetPTR() );
+	}
+};
+
+
 #endif
@@ -25,6 +25,7 @@
 #include "audioLoader/audioLoader.h"
 
 #include <scene/object/AObject.hpp>
+#include <utility/CommandBuffer.hpp>
 
 #include <QDebug>
 #include <QDir>
@@ -36,6 +37,40 @@
 RESOURCE_CACHE( AudioSampleData );
 
 
+/// Deferred playback change of an AudioSample
+class AudioSampleCommand : public CommandBuffer::ACommand
+{
+public:
+	enum Action
+	{
+		PLAY,
+		STOP,
+		REWIND,
+		MOVE
+	};
+	AudioSampleCommand( AudioSample * sample, Action action, const QVector3D & position = QVector3D(), double delta = 0.0 ) :
+		mSample( sample ), mAction( action ), mPosition( position ), mDelta( delta ) {}
+	virtual void execute()
+	{
+		switch( mAction )
+		{
+		case PLAY: mSample->play(); break;
+		case STOP: mSample->stop(); break;
+		case REWIND: mSample->rewind(); break;
+		case MOVE: mSample->setPositionAutoVelocity( mPosition, mDelta ); break;
+		}
+	}
+private:
+	AudioSample * mSample;
+	Action mAction;
+	QVector3D mPosition;
+	double mDelta;
+};
+
+
+CommandBuffer * AudioSample::sCommands = NULL;
+
+
 AudioSampleData::AudioSampleData( QString name ) :
 	AResourceData( name ),
 	mName( name ),
@@ -128,8 +163,46 @@ AudioSample::~AudioSample()
 }
 
 
+void AudioSample::rewind()
+{
+	if( sCommands && sCommands->recording() )
+	{
+		sCommands->push( new AudioSampleCommand( this, AudioSampleCommand::REWIND ) );
+		return;
+	}
+	alSourceRewind( mSource );
+}
+
+
+void AudioSample::play()
+{
+	if( sCommands && sCommands->recording() )
+	{
+		sCommands->push( new AudioSampleCommand( this, AudioSampleCommand::PLAY ) );
+		return;
+	}
+	alSourcePlay( mSource );
+}
+
+
+void AudioSample::stop()
+{
+	if( sCommands && sCommands->recording() )
+	{
+		sCommands->push( new AudioSampleCommand( this, AudioSampleCommand::STOP ) );
+		return;
+	}
+	alSourceStop( mSource );
+}
+
+
 void AudioSample::setPositionAutoVelocity( const QVector3D & position, const double & delta )
 {
+	if( sCommands && sCommands->recording() )
+	{
+		sCommands->push( new AudioSampleCommand( this, AudioSampleCommand::MOVE, position, delta ) );
+		return;
+	}
 	setPosition( position );
 	QVector3D velocity = ( position - mLastPosition ) / delta;
 	setVelocity( velocity );
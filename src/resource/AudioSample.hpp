@@ -34,6 +34,7 @@
 
 
 class AObject;
+class CommandBuffer;
 
 
 /// Audio sample data
@@ -64,6 +65,12 @@ private:
 
 
 /// Audio sample source
+/**
+ * Objects updated concurrently by the JobSystem must not talk to OpenAL directly.
+ * While the command buffer set with setCommandBuffer() is recording,
+ * play(), stop(), rewind() and setPositionAutoVelocity() are deferred to it
+ * and applied on the thread executing the buffer.
+ */
 class AudioSample : public AResource<AudioSampleData>
 {
 public:
@@ -94,11 +101,15 @@ public:
 
 	void setPositionAutoVelocity( const QVector3D & position, const double & delta );
 
-	void rewind() { alSourceRewind( mSource ); }
-	void play() { alSourcePlay( mSource ); }
-	void stop() { alSourceStop( mSource ); }
+	void rewind();
+	void play();
+	void stop();
+
+	/// Sets the buffer playback changes are deferred to while it is recording - NULL to never defer
+	static void setCommandBuffer( CommandBuffer * commands ) { sCommands = commands; }
 
 private:
+	static CommandBuffer * sCommands;
 	ALuint mSource;
 	QVector3D mLastPosition;
 };
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Impostor.hpp"
+#include "Shader.hpp"
+#include "StaticModel.hpp"
+
+#include <scene/TextureRenderer.hpp>
+#include <utility/DrawStatistics.hpp>
+
+#include <QGLShaderProgram>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QDebug>
+
+#include <math.h>
+
+
+/// Changes whenever the contents of the atlas change for the same model
+static const qint32 sAtlasVersion = 1;
+
+
+Impostor::Impostor( GLWidget * glWidget, StaticModel * model ) :
+	mGLWidget( glWidget ),
+	mAtlas( 0 )
+{
+	// the billboards turn around the vertical axis - every view has to fit the widest part of the model
+	const QVector3D & minimum = model->boundingBoxMinimum();
+	const QVector3D & maximum = model->boundingBoxMaximum();
+	mExtent = QVector3D(
+		sqrtf( qMax( minimum.x()*minimum.x(), maximum.x()*maximum.x() ) + qMax( minimum.z()*minimum.z(), maximum.z()*maximum.z() ) ),
+		minimum.y(),
+		maximum.y()
+	);
+
+	const QString & name = model->constData()->name();
+	const QString modelPath = StaticModelData::baseDirectory()+name+'/'+name+".obj";
+	const QString atlasPath = StaticModelData::baseDirectory()+name+'/'+name+".impostor.png";
+	const QString key = QString::fromLatin1( cacheKey( modelPath ).toHex() );
+
+	QImage atlas( atlasPath );
+	if( atlas.isNull() || atlas.size() != QSize( Views*Resolution, Resolution ) || atlas.text( "key" ) != key )
+	{
+		qDebug() << "+" << this << "Impostor rendering" << atlasPath;
+		atlas = renderAtlas( model );
+		bleedColors( atlas );
+		atlas.setText( "key", key );
+		if( !atlas.save( atlasPath, "PNG" ) )
+			qWarning() << "Could not write impostor atlas" << atlasPath;
+	}
+	mAtlas = mGLWidget->bindTexture( atlas, GL_TEXTURE_2D, GL_RGBA,
+		QGLContext::LinearFilteringBindOption | QGLContext::InvertedYBindOption | QGLContext::MipmapBindOption );
+	glBindTexture( GL_TEXTURE_2D, mAtlas );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	// a quad standing on the ground - x runs from left to right, y from the model's bottom to it's top
+	const GLfloat corners[8] = { -1.0f, 0.0f,  1.0f, 0.0f,  1.0f, 1.0f,  -1.0f, 1.0f };
+	mQuad = QGLBuffer( QGLBuffer::VertexBuffer );
+	mQuad.create();
+	mQuad.bind();
+	mQuad.setUsagePattern( QGLBuffer::StaticDraw );
+	mQuad.allocate( corners, sizeof(corners) );
+	mQuad.release();
+
+	mShader = new Shader( mGLWidget, "impostor" );
+}
+
+
+Impostor::~Impostor()
+{
+	delete mShader;
+	mQuad.destroy();
+	if( mAtlas )
+		mGLWidget->deleteTexture( mAtlas );
+}
+
+
+void Impostor::draw( const QMatrix4x4 & viewMatrix, const QVector3D & eye, const QVector<QMatrix4x4> & instances,
+	QGLBuffer & instanceBuffer, float fadeStart, float fadeEnd )
+{
+	if( instances.isEmpty() )
+		return;
+
+	mShader->bind();
+	QGLShaderProgram * program = mShader->program();
+	const int instanceMatrixAttribute = program->attributeLocation( "instanceMatrix" );
+	if( instanceMatrixAttribute < 0 )
+	{
+		mShader->release();
+		return;
+	}
+	program->setUniformValue( "atlas", 0 );
+	program->setUniformValue( "eyePosition", eye );
+	program->setUniformValue( "extent", mExtent );
+	program->setUniformValue( "views", (GLfloat)Views );
+	program->setUniformValue( "fade", QVector2D( fadeStart, qMax( fadeEnd, fadeStart + 0.001f ) ) );
+
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( GL_TEXTURE_2D, mAtlas );
+
+	glPushMatrix();
+	glLoadMatrix( viewMatrix );	// the shader places the quads
+
+	mQuad.bind();
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 2, GL_FLOAT, 0, NULL );
+	mQuad.release();
+
+	if( StaticModel::instancingSupported() )
+	{
+		if( !instanceBuffer.isCreated() )
+			StaticModel::uploadInstances( instanceBuffer, instances );
+
+		// a matrix attribute takes four consecutive locations - one per column
+		instanceBuffer.bind();
+		for( int column = 0; column < 4; column++ )
+		{
+			glEnableVertexAttribArray( instanceMatrixAttribute + column );
+			glVertexAttribPointer( instanceMatrixAttribute + column, 4, GL_FLOAT, GL_FALSE, 16*sizeof(GLfloat), (void*)(column*4*sizeof(GLfloat)) );
+			glVertexAttribDivisorARB( instanceMatrixAttribute + column, 1 );
+		}
+		instanceBuffer.release();
+
+		glDrawArraysInstancedARB( GL_QUADS, 0, 4, instances.size() );
+		DrawStatistics::countDrawCall( 2 * instances.size() );
+
+		for( int column = 0; column < 4; column++ )
+		{
+			glVertexAttribDivisorARB( instanceMatrixAttribute + column, 0 );
+			glDisableVertexAttribArray( instanceMatrixAttribute + column );
+		}
+	} else {
+		// without instanced arrays the matrix is passed as a constant attribute per quad
+		foreach( const QMatrix4x4 & instance, instances )
+		{
+			for( int column = 0; column < 4; column++ )
+			{
+				const QVector4D c = instance.column( column );
+				glVertexAttrib4f( instanceMatrixAttribute + column, c.x(), c.y(), c.z(), c.w() );
+			}
+			glDrawArrays( GL_QUADS, 0, 4 );
+			DrawStatistics::countDrawCall( 2 );
+		}
+	}
+
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glPopMatrix();
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	mShader->release();
+}
+
+
+QImage Impostor::renderAtlas( StaticModel * model )
+{
+	const QSize size( Views * Resolution, Resolution );
+	const float depth = model->boundingSphereRadius();
+
+	TextureRenderer renderer( mGLWidget, size, true, true );
+	renderer.bind();
+
+	glPushAttrib( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_FOG_BIT | GL_LIGHTING_BIT );
+	glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	glEnable( GL_DEPTH_TEST );
+	glDepthMask( GL_TRUE );
+	glDisable( GL_BLEND );
+
+	// ambient light only - the billboards are lit when they are drawn
+	const GLfloat white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	glLightfv( GL_LIGHT0, GL_AMBIENT, white );
+	glLightfv( GL_LIGHT0, GL_DIFFUSE, black );
+	glLightfv( GL_LIGHT0, GL_SPECULAR, black );
+	glLightfv( GL_LIGHT1, GL_AMBIENT, black );
+	glLightfv( GL_LIGHT1, GL_DIFFUSE, black );
+	glLightfv( GL_LIGHT1, GL_SPECULAR, black );
+	// and no fog within reach of the model
+	glFogf( GL_FOG_START, 1000000.0f );
+	glFogf( GL_FOG_END, 2000000.0f );
+
+	QMatrix4x4 projection;
+	projection.ortho( -mExtent.x(), mExtent.x(), mExtent.y(), mExtent.z(), 0.0f, 2.0f * depth );
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix();
+	glLoadMatrix( projection );
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+
+	// view n looks at the model from the azimuth n/Views of a full turn - the shader picks them the same way
+	const QVector<QMatrix4x4> origin( 1, QMatrix4x4() );
+	for( int view = 0; view < Views; view++ )
+	{
+		const float azimuth = 2.0f * M_PI * view / Views;
+		QMatrix4x4 viewMatrix;
+		viewMatrix.lookAt( QVector3D( sinf( azimuth ), 0.0f, cosf( azimuth ) ) * depth, QVector3D( 0.0f, 0.0f, 0.0f ), QVector3D( 0.0f, 1.0f, 0.0f ) );
+		glViewport( view * Resolution, 0, Resolution, Resolution );
+		model->draw( viewMatrix, origin );
+	}
+
+	QImage atlas( size, QImage::Format_ARGB32 );
+	glReadPixels( 0, 0, size.width(), size.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, atlas.bits() );
+
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix();
+	glMatrixMode( GL_MODELVIEW );
+	glPopMatrix();
+	glPopAttrib();
+	renderer.release();
+
+	return atlas.mirrored();	// OpenGL stores the rows bottom up
+}
+
+
+QByteArray Impostor::cacheKey( const QString & modelPath )
+{
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+
+	QFile modelFile( modelPath );
+	if( modelFile.open( QIODevice::ReadOnly ) )
+		hash.addData( modelFile.readAll() );
+
+	const qint32 layout[3] = { sAtlasVersion, Views, Resolution };
+	hash.addData( (const char*)layout, sizeof(layout) );
+
+	return hash.result();
+}
+
+
+void Impostor::bleedColors( QImage & atlas )
+{
+	// transparent texels take the color of their opaque neighbours, so filtering does not darken the outlines
+	const int width = atlas.width();
+	const int height = atlas.height();
+	QVector<char> filled( width * height );
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++ )
+			filled[y*width+x] = qAlpha( atlas.pixel( x, y ) ) >= 128;
+	}
+
+	static const int neighbours[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for( int pass = 0; pass < 4; pass++ )
+	{
+		QVector<char> next = filled;
+		for( int y = 0; y < height; y++ )
+		{
+			for( int x = 0; x < width; x++ )
+			{
+				if( filled[y*width+x] )
+					continue;
+
+				int red = 0, green = 0, blue = 0, count = 0;
+				for( int n = 0; n < 4; n++ )
+				{
+					const int nx = x + neighbours[n][0];
+					const int ny = y + neighbours[n][1];
+					if( nx < 0 || ny < 0 || nx >= width || ny >= height || !filled[ny*width+nx] )
+						continue;
+					const QRgb color = atlas.pixel( nx, ny );
+					red += qRed( color );
+					green += qGreen( color );
+					blue += qBlue( color );
+					count++;
+				}
+				if( count )
+				{
+					atlas.setPixel( x, y, qRgba( red/count, green/count, blue/count, qAlpha( atlas.pixel( x, y ) ) ) );
+					next[y*width+x] = true;
+				}
+			}
+		}
+		filled = next;
+	}
+}
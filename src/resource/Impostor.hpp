@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOURCE_IMPOSTOR_INCLUDED
+#define RESOURCE_IMPOSTOR_INCLUDED
+
+#include <GLWidget.hpp>
+
+#include <QGLBuffer>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+
+class Shader;
+class StaticModel;
+
+
+/// Billboards standing in for a static model in the distance
+/**
+ * The model is rendered from several directions around it's vertical axis into an atlas,
+ * each instance is then drawn as a single quad turned towards the eye showing the nearest view.\n
+ * Rendering the atlas takes a while, so it is stored next to the model and reused as long as
+ * the model's geometry and the atlas layout stay the same.\n
+ * The atlas holds the model's colors lit by ambient light only,
+ * the quads are lit as if they were a surface facing the eye and the sky.
+ */
+class Impostor
+{
+public:
+	/// Number of directions the model is rendered from
+	static const int Views = 8;
+	/// Width and height of a single view in the atlas
+	static const int Resolution = 128;
+
+	/// Loads the atlas of the model or renders it if there is none yet
+	Impostor( GLWidget * glWidget, StaticModel * model );
+	~Impostor();
+
+	/// Draws a billboard for each instance
+	/**
+	 * @param eye Position of the eye in world space - the billboards are turned towards it.
+	 * @param fadeStart Distance to the eye the billboards start fading in.
+	 * @param fadeEnd Distance to the eye the billboards are fully opaque.
+	 * @param instanceBuffer Keeps the model matrices of the instances - uploaded with StaticModel::uploadInstances().
+	 */
+	void draw( const QMatrix4x4 & viewMatrix, const QVector3D & eye, const QVector<QMatrix4x4> & instances,
+		QGLBuffer & instanceBuffer, float fadeStart, float fadeEnd );
+
+private:
+	GLWidget * mGLWidget;
+	Shader * mShader;
+	GLuint mAtlas;
+	QGLBuffer mQuad;
+	/// Radius of the cylinder around the model's vertical axis containing it, its bottom and top
+	QVector3D mExtent;
+
+	QImage renderAtlas( StaticModel * model );
+	static QByteArray cacheKey( const QString & modelPath );
+	static void bleedColors( QImage & atlas );
+};
+
+
+#endif
@@ -249,14 +249,17 @@ Material::Material( GLWidget * glWidget, QString name, MaterialShaderVariant::Ty
 	mShaderSet[MaterialQuality::LOW].shader = 0;
 	mShaderSet[MaterialQuality::LOW].blobMapUniform = -1;
 	mShaderSet[MaterialQuality::LOW].cubeMapUniform = -1;
+	mShaderSet[MaterialQuality::LOW].instanceMatrixAttribute = -1;
 	mShaderSet[MaterialQuality::MEDIUM].textureUnits.clear();
 	mShaderSet[MaterialQuality::MEDIUM].shader = 0;
 	mShaderSet[MaterialQuality::MEDIUM].blobMapUniform = -1;
 	mShaderSet[MaterialQuality::MEDIUM].cubeMapUniform = -1;
+	mShaderSet[MaterialQuality::MEDIUM].instanceMatrixAttribute = -1;
 	mShaderSet[MaterialQuality::HIGH].textureUnits.clear();
 	mShaderSet[MaterialQuality::HIGH].shader = 0;
 	mShaderSet[MaterialQuality::HIGH].blobMapUniform = -1;
 	mShaderSet[MaterialQuality::HIGH].cubeMapUniform = -1;
+	mShaderSet[MaterialQuality::HIGH].instanceMatrixAttribute = -1;
 	mBlobMap = mCubeMap = -1;
 
 	QSharedPointer<MaterialData> n( new MaterialData( glWidget, name ) );
@@ -359,7 +362,7 @@ void Material::release()
 }
 
 
-void Material::setShader( MaterialQuality::Type quality, QString shaderFullName )
+void Material::setShader( MaterialQuality::Type quality, QString shaderFullName, QStringList defines )
 {
 	delete mShaderSet[quality].shader;
 	mShaderSet[quality].shader = 0;
@@ -367,7 +370,7 @@ void Material::setShader( MaterialQuality::Type quality, QString shaderFullName
 	if( access( QString(ShaderData::baseDirectory()+shaderFullName+".vert").toLocal8Bit().constData(), R_OK ) != 0 )
 		return;
 
-	mShaderSet[quality].shader = new Shader( mGLWidget, shaderFullName );
+	mShaderSet[quality].shader = new Shader( mGLWidget, shaderFullName, defines );
 
 	mShaderSet[quality].textureUnits.clear();
 	{
@@ -403,6 +406,7 @@ void Material::setShader( MaterialQuality::Type quality, QString shaderFullName
 
 	mShaderSet[quality].blobMapUniform = mShaderSet[quality].shader->program()->uniformLocation( "blobMap" );
 	mShaderSet[quality].cubeMapUniform = mShaderSet[quality].shader->program()->uniformLocation( "cubeMap" );
+	mShaderSet[quality].instanceMatrixAttribute = mShaderSet[quality].shader->program()->attributeLocation( "instanceMatrix" );
 }
 
 
@@ -411,9 +415,19 @@ void Material::setShader( MaterialShaderVariant::Type variant )
 	switch( variant )
 	{
 		case MaterialShaderVariant::BLOBBING:
-			setShader( MaterialQuality::LOW, data()->shaderName(MaterialQuality::LOW)+".blobbing" );
-			setShader( MaterialQuality::MEDIUM, data()->shaderName(MaterialQuality::MEDIUM)+".blobbing" );
-			setShader( MaterialQuality::HIGH, data()->shaderName(MaterialQuality::HIGH)+".blobbing" );
+			setShader( MaterialQuality::LOW, data()->shaderName(MaterialQuality::LOW)+".blobbing", QStringList() << "TERRAIN" );
+			setShader( MaterialQuality::MEDIUM, data()->shaderName(MaterialQuality::MEDIUM)+".blobbing", QStringList() << "TERRAIN" );
+			setShader( MaterialQuality::HIGH, data()->shaderName(MaterialQuality::HIGH)+".blobbing", QStringList() << "TERRAIN" );
+			break;
+		case MaterialShaderVariant::INSTANCED:
+			setShader( MaterialQuality::LOW, data()->shaderName(MaterialQuality::LOW)+".default", QStringList() << "INSTANCED" );
+			setShader( MaterialQuality::MEDIUM, data()->shaderName(MaterialQuality::MEDIUM)+".default", QStringList() << "INSTANCED" );
+			setShader( MaterialQuality::HIGH, data()->shaderName(MaterialQuality::HIGH)+".default", QStringList() << "INSTANCED" );
+			break;
+		case MaterialShaderVariant::TERRAIN:
+			setShader( MaterialQuality::LOW, data()->shaderName(MaterialQuality::LOW)+".default", QStringList() << "TERRAIN" );
+			setShader( MaterialQuality::MEDIUM, data()->shaderName(MaterialQuality::MEDIUM)+".default", QStringList() << "TERRAIN" );
+			setShader( MaterialQuality::HIGH, data()->shaderName(MaterialQuality::HIGH)+".default", QStringList() << "TERRAIN" );
 			break;
 		default:
 		case MaterialShaderVariant::DEFAULT:
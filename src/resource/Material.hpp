@@ -29,6 +29,7 @@
 #include <GLWidget.hpp>
 
 #include <QVector4D>
+#include <QStringList>
 
 
 class GLWidget;
@@ -65,9 +66,11 @@ namespace MaterialShaderVariant
 	enum Type
 	{
 		DEFAULT		= 0,
-		BLOBBING	= 1
+		BLOBBING	= 1,	///< The blobbing shaders drawing terrain vertices - see Landscape::Blob
+		INSTANCED	= 2,	///< The default shaders taking the model matrix from the instanceMatrix attribute
+		TERRAIN		= 3	///< The default shaders drawing terrain vertices - see TerrainGrid
 	};
-	const static int num = 2;
+	const static int num = 4;
 };
 
 
@@ -138,6 +141,9 @@ public:
 	void bind();
 	void release();
 
+	/// Location of the bound shader's instanceMatrix attribute - -1 if it can't draw instances
+	int instanceMatrixAttribute() const { return mShaderSet[mBoundQuality].shader ? mShaderSet[mBoundQuality].instanceMatrixAttribute : -1; }
+
 	void setDefaultQuality( MaterialQuality::Type q ) { mDefaultQuality = q; }
 
 	static float filterAnisotropyMaximum() { GLfloat maxAnisotropy; glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy ); return maxAnisotropy; }
@@ -152,6 +158,7 @@ private:
 		QVector< QPair<int,GLfloat> > constants;
 		int blobMapUniform;
 		int cubeMapUniform;
+		int instanceMatrixAttribute;
 	} ShaderSet;
 
 	GLWidget * mGLWidget;
@@ -168,7 +175,7 @@ private:
 	MaterialQuality::Type mBoundQuality;
 
 	MaterialQuality::Type getBindingQuality();
-	void setShader( MaterialQuality::Type quality, QString shaderFullName );
+	void setShader( MaterialQuality::Type quality, QString shaderFullName, QStringList defines = QStringList() );
 
 	static float sFilterAnisotropy;
 };
@@ -26,16 +26,18 @@
 #include <GLWidget.hpp>
 
 #include <QGLShaderProgram>
+#include <QFile>
 #include <QDebug>
 
 
 RESOURCE_CACHE(ShaderData);
 
 
-ShaderData::ShaderData( GLWidget * glWidget, QString name ) :
-	AResourceData( name ),
+ShaderData::ShaderData( GLWidget * glWidget, QString name, QStringList defines ) :
+	AResourceData( defines.isEmpty() ? name : name+'#'+defines.join("#") ),
 	mGLWidget(glWidget),
 	mName(name),
+	mDefines(defines),
 	mProgram(0)
 {
 }
@@ -66,8 +68,10 @@ bool ShaderData::load()
 	qDebug() << "+" << this << "ShaderData" << uid();
 
 	mProgram = new QGLShaderProgram( mGLWidget );
-	mProgram->addShaderFromSourceFile( QGLShader::Vertex, baseDirectory()+mName+".vert" );
-	mProgram->addShaderFromSourceFile( QGLShader::Fragment, baseDirectory()+mName+".frag" );
+	addShader( QGLShader::Vertex, baseDirectory()+mName+".vert" );
+	addShader( QGLShader::Fragment, baseDirectory()+mName+".frag" );
+	if( mDefines.contains( "TERRAIN" ) )
+		addShader( QGLShader::Vertex, baseDirectory()+"terrainGrid.vert" );
 	if( !mProgram->link() )
 	{
 		qWarning() << mProgram->log();
@@ -78,9 +82,35 @@ bool ShaderData::load()
 }
 
 
-Shader::Shader( GLWidget * glWidget, QString name ) : AResource()
+bool ShaderData::addShader( QGLShader::ShaderType type, const QString & path )
 {
-	QSharedPointer<ShaderData> n( new ShaderData( glWidget, name ) );
+	if( mDefines.isEmpty() )
+		return mProgram->addShaderFromSourceFile( type, path );
+
+	QFile file( path );
+	if( !file.open( QIODevice::ReadOnly ) )
+	{
+		qWarning() << "Could not open shader" << path;
+		return false;
+	}
+	QByteArray source = file.readAll();
+
+	// the defines have to follow the #version line
+	QByteArray defines;
+	for( int i = 0; i < mDefines.size(); ++i )
+		defines += "#define " + mDefines[i].toLatin1() + '\n';
+	int position = 0;
+	if( source.startsWith( "#version" ) )
+		position = source.indexOf( '\n' ) + 1;
+	source.insert( position, defines );
+
+	return mProgram->addShaderFromSourceCode( type, source );
+}
+
+
+Shader::Shader( GLWidget * glWidget, QString name, QStringList defines ) : AResource()
+{
+	QSharedPointer<ShaderData> n( new ShaderData( glWidget, name, defines ) );
 	cache( n );
 }
 
@@ -29,6 +29,8 @@
 
 #include <GLWidget.hpp>
 
+#include <QGLShader>
+#include <QStringList>
 #include <QDebug>
 
 
@@ -39,13 +41,14 @@ class QGLShaderProgram;
 class ShaderData : public AResourceData
 {
 public:
-	ShaderData( GLWidget * glWidget, QString name );
+	ShaderData( GLWidget * glWidget, QString name, QStringList defines = QStringList() );
 	virtual ~ShaderData();
 
 	QGLShaderProgram * program() { return mProgram; }
 	const QGLShaderProgram * program() const { return mProgram; }
 
 	const QString & name() const { return mName; }
+	const QStringList & defines() const { return mDefines; }
 
 	// Overrides:
 	virtual bool load();
@@ -56,16 +59,25 @@ public:
 private:
 	GLWidget * mGLWidget;
 	QString mName;
+	QStringList mDefines;
 
 	QGLShaderProgram * mProgram;
+
+	bool addShader( QGLShader::ShaderType type, const QString & path );
 };
 
 
 /// Shader program
+/**
+ * Permutations of a shader are compiled from the same source files by passing defines -
+ * each of them, like "LAYERS 3", is turned into a #define line following the #version line.\n
+ * Permutations drawing terrains are compiled with the TERRAIN define and linked with terrainGrid.vert,
+ * which provides the functions terrainVertex() and terrainNormal() - see TerrainGrid.
+ */
 class Shader : public AResource<ShaderData>
 {
 public:
-	Shader( GLWidget * glWidget, QString name );
+	Shader( GLWidget * glWidget, QString name, QStringList defines = QStringList() );
 	virtual ~Shader();
 
 	QGLShaderProgram * program() { return data()->program(); }
@@ -22,8 +22,10 @@
  */
 
 #include "StaticModel.hpp"
+#include "Impostor.hpp"
 
 #include <scene/object/AObject.hpp>
+#include <utility/DrawStatistics.hpp>
 
 #include <QDebug>
 #include <QVector3D>
@@ -68,10 +70,16 @@ Part::Part( unsigned int current, unsigned int count, GLWidget * widget, QString
 {
 	this->start = current - count;
 	this->count = count;
+	this->materialName = material;
 	if( !material.isEmpty() )
+	{
 		this->material = new Material( widget, material );
+	}
 	else
+	{
 		this->material = NULL;
+	}
+	this->instancedMaterial = NULL;
 }
 
 
@@ -84,6 +92,8 @@ StaticModelData::StaticModelData( GLWidget * glWidget, QString name ) :
 	mName( name )
 {
 	mMode = 0;
+	mBoundingSphereRadius = 0.0f;
+	mImpostor = NULL;
 }
 
 
@@ -105,8 +115,15 @@ void StaticModelData::unload()
 		{
 			delete part.material;
 		}
+		if( part.instancedMaterial )
+		{
+			delete part.instancedMaterial;
+		}
 	}
 
+	delete mImpostor;
+	mImpostor = NULL;
+
 	mParts.clear();
 	mVertices.clear();
 	mIndices.clear();
@@ -221,6 +238,20 @@ bool StaticModelData::parse()
 
 void StaticModelData::generateBuffers()
 {
+	mBoundingSphereRadius = 0.0f;
+	mBoundingBoxMinimum = mVertices.isEmpty() ? QVector3D() : mVertices[0].position;
+	mBoundingBoxMaximum = mBoundingBoxMinimum;
+	foreach( const VertexP3fN3fT2f & vertex, mVertices )
+	{
+		mBoundingSphereRadius = qMax( mBoundingSphereRadius, (float)vertex.position.length() );
+		mBoundingBoxMinimum.setX( qMin( mBoundingBoxMinimum.x(), vertex.position.x() ) );
+		mBoundingBoxMinimum.setY( qMin( mBoundingBoxMinimum.y(), vertex.position.y() ) );
+		mBoundingBoxMinimum.setZ( qMin( mBoundingBoxMinimum.z(), vertex.position.z() ) );
+		mBoundingBoxMaximum.setX( qMax( mBoundingBoxMaximum.x(), vertex.position.x() ) );
+		mBoundingBoxMaximum.setY( qMax( mBoundingBoxMaximum.y(), vertex.position.y() ) );
+		mBoundingBoxMaximum.setZ( qMax( mBoundingBoxMaximum.z(), vertex.position.z() ) );
+	}
+
 	mVertexBuffer = QGLBuffer( QGLBuffer::VertexBuffer );
 	mVertexBuffer.create();
 	mVertexBuffer.bind();
@@ -323,6 +354,14 @@ StaticModel::~StaticModel()
 {
 }
 
+
+Impostor * StaticModel::impostor()
+{
+	if( !data()->impostor() )
+		data()->setImpostor( new Impostor( data()->glWidget(), this ) );
+	return data()->impostor();
+}
+
 void StaticModel::draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances )
 {
 	data()->vertexBuffer().bind();
@@ -336,29 +375,56 @@ void StaticModel::draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4>
 
 	foreach( const Part & part, data()->parts() )
 	{
-		if( part.material )
-		{
-			part.material->bind();
-		}
+		drawPart( part, viewMatrix, instances );
+	}
 
-		foreach( const QMatrix4x4 & instance, instances )
-		{
-			glLoadMatrix( viewMatrix * instance );
-
-			glDrawElements(
-				data()->mode(),
-				part.count,
-				GL_UNSIGNED_INT,
-				(void*)((size_t)(sizeof(unsigned int)*(	// convert index to pointer
-					part.start		// index to start
-				) ) )
-			);
-		}
+	glPopMatrix();
 
-		if( part.material )
+	glDisableClientState( GL_INDEX_ARRAY );
+	VertexP3fN3fT2f::glDisableClientState();
+
+	data()->vertexBuffer().release();
+	data()->indexBuffer().release();
+}
+
+
+void StaticModel::draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances, QGLBuffer & instanceBuffer )
+{
+	if( instances.isEmpty() )
+		return;
+
+	const bool instancing = instancingSupported();
+	if( instancing && !instanceBuffer.isCreated() )
+		uploadInstances( instanceBuffer, instances );
+
+	data()->vertexBuffer().bind();
+	data()->indexBuffer().bind();
+
+	glEnableClientState( GL_INDEX_ARRAY );
+	VertexP3fN3fT2f::glEnableClientState();
+	VertexP3fN3fT2f::glPointerVBO();
+
+	glPushMatrix();
+	glLoadMatrix( viewMatrix );	// the shaders apply the instance's model matrix
+
+	QVector<Part> & parts = data()->parts();
+	for( int i = 0; i < parts.size(); ++i )
+	{
+		Part & part = parts[i];
+		// most models are never instanced - their instanced shaders are only compiled once needed
+		if( instancing && part.material && !part.instancedMaterial )
+			part.instancedMaterial = new Material( data()->glWidget(), part.materialName, MaterialShaderVariant::INSTANCED );
+		if( instancing && part.instancedMaterial )
 		{
-			part.material->release();
+			part.instancedMaterial->bind();
+			int instanceMatrixAttribute = part.instancedMaterial->instanceMatrixAttribute();
+			if( instanceMatrixAttribute >= 0 )
+				drawPartInstanced( part, instanceMatrixAttribute, instanceBuffer, instances.size() );
+			part.instancedMaterial->release();
+			if( instanceMatrixAttribute >= 0 )
+				continue;
 		}
+		drawPart( part, viewMatrix, instances );
 	}
 
 	glPopMatrix();
@@ -371,6 +437,88 @@ void StaticModel::draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4>
 }
 
 
+void StaticModel::drawPart( const Part & part, const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances )
+{
+	if( part.material )
+	{
+		part.material->bind();
+	}
+
+	foreach( const QMatrix4x4 & instance, instances )
+	{
+		glLoadMatrix( viewMatrix * instance );
+
+		glDrawElements(
+			data()->mode(),
+			part.count,
+			GL_UNSIGNED_INT,
+			(void*)((size_t)(sizeof(unsigned int)*(	// convert index to pointer
+				part.start		// index to start
+			) ) )
+		);
+		DrawStatistics::countDrawCall( data()->mode() == GL_QUADS ? part.count/2 : part.count/3 );
+	}
+
+	if( part.material )
+	{
+		part.material->release();
+	}
+}
+
+
+void StaticModel::drawPartInstanced( const Part & part, int instanceMatrixAttribute, QGLBuffer & instanceBuffer, int instanceCount )
+{
+	// a matrix attribute takes four consecutive locations - one per column
+	instanceBuffer.bind();
+	for( int column = 0; column < 4; column++ )
+	{
+		glEnableVertexAttribArray( instanceMatrixAttribute + column );
+		glVertexAttribPointer( instanceMatrixAttribute + column, 4, GL_FLOAT, GL_FALSE, 16*sizeof(GLfloat), (void*)(column*4*sizeof(GLfloat)) );
+		glVertexAttribDivisorARB( instanceMatrixAttribute + column, 1 );
+	}
+	instanceBuffer.release();
+
+	glDrawElementsInstancedARB(
+		data()->mode(),
+		part.count,
+		GL_UNSIGNED_INT,
+		(void*)((size_t)(sizeof(unsigned int)*(	// convert index to pointer
+			part.start		// index to start
+		) ) ),
+		instanceCount
+	);
+	DrawStatistics::countDrawCall( (data()->mode() == GL_QUADS ? part.count/2 : part.count/3) * instanceCount );
+
+	for( int column = 0; column < 4; column++ )
+	{
+		glVertexAttribDivisorARB( instanceMatrixAttribute + column, 0 );
+		glDisableVertexAttribArray( instanceMatrixAttribute + column );
+	}
+}
+
+
+void StaticModel::uploadInstances( QGLBuffer & instanceBuffer, const QVector<QMatrix4x4> & instances, QGLBuffer::UsagePattern usage )
+{
+	// QMatrix4x4 carries more than its elements and qreal may be double - copy the columns as floats
+	QVector<GLfloat> matrices( instances.size() * 16 );
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		for( int element = 0; element < 16; element++ )
+			matrices[i*16+element] = instances[i].constData()[element];
+	}
+
+	if( !instanceBuffer.isCreated() )
+	{
+		instanceBuffer = QGLBuffer( QGLBuffer::VertexBuffer );
+		instanceBuffer.create();
+	}
+	instanceBuffer.bind();
+	instanceBuffer.setUsagePattern( usage );
+	instanceBuffer.allocate( matrices.constData(), matrices.size() * sizeof(GLfloat) );
+	instanceBuffer.release();
+}
+
+
 void StaticModel::draw()
 {
 	data()->vertexBuffer().bind();
@@ -397,6 +545,7 @@ void StaticModel::draw()
 				part.start		// index to start
 			) ) )
 		);
+		DrawStatistics::countDrawCall( part.count/3 );
 
 		if( part.material )
 		{
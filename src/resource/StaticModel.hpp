@@ -37,6 +37,8 @@
 #include <QFileInfo>
 #include <QMatrix4x4>
 
+class Impostor;
+
 static QChar   OBJ_COMMENT         = '#';
 static QString OBJ_FACE            = "f";
 static QString OBJ_GROUP           = "g";
@@ -73,7 +75,10 @@ public:
 
 	unsigned int start;
 	unsigned int count;
+	QString materialName;
 	Material * material;
+	/// The same material with shaders drawing many instances at once - created on the first instanced draw
+	Material * instancedMaterial;
 };
 
 /// The model's data
@@ -88,6 +93,15 @@ public:
 	QVector<Part> & parts() { return mParts; }
 	QGLBuffer & vertexBuffer() { return mVertexBuffer; }
 	QGLBuffer & indexBuffer() { return mIndexBuffer; }
+	/// Radius of a sphere around the model's origin containing all vertices
+	float boundingSphereRadius() const { return mBoundingSphereRadius; }
+	/// Corners of the axis aligned box containing all vertices
+	const QVector3D & boundingBoxMinimum() const { return mBoundingBoxMinimum; }
+	const QVector3D & boundingBoxMaximum() const { return mBoundingBoxMaximum; }
+	GLWidget * glWidget() { return mGLWidget; }
+	/// The billboards drawn instead of the model in the distance - NULL until StaticModel::impostor() first creates them
+	Impostor * impostor() { return mImpostor; }
+	void setImpostor( Impostor * impostor ) { mImpostor = impostor; }
 
 	bool parse();
 
@@ -106,6 +120,10 @@ protected:
 	QVector<unsigned int> mIndices;
 	QGLBuffer mVertexBuffer;
 	QGLBuffer mIndexBuffer;
+	float mBoundingSphereRadius;
+	QVector3D mBoundingBoxMinimum;
+	QVector3D mBoundingBoxMaximum;
+	Impostor * mImpostor;
 
 	void generateParts( QVector<Face> * faces );
 	void generateBuffers();
@@ -121,7 +139,35 @@ public:
 	virtual ~StaticModel();
 
 	void draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances );
+	/// Draws all instances with a single draw call per part
+	/**
+	 * Falls back to drawing each instance separately if instanced arrays are unsupported
+	 * or a part's material has no shader taking the instance's matrix.
+	 * @param instanceBuffer Keeps the model matrices of the instances - they are uploaded on first use,
+	 *  use uploadInstances() after changing the instances.
+	 */
+	void draw( const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances, QGLBuffer & instanceBuffer );
 	void draw();
+
+	float boundingSphereRadius() { return data()->boundingSphereRadius(); }
+	const QVector3D & boundingBoxMinimum() { return data()->boundingBoxMinimum(); }
+	const QVector3D & boundingBoxMaximum() { return data()->boundingBoxMaximum(); }
+
+	/// Returns the billboards standing in for the model in the distance
+	/**
+	 * They are rendered on first use and shared by all users of the model.
+	 */
+	Impostor * impostor();
+
+	/// Returns true if instances can be drawn with a single draw call
+	static bool instancingSupported() { return GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced; }
+	/// Stores the model matrices of the instances in the buffer - creates it if necessary
+	static void uploadInstances( QGLBuffer & instanceBuffer, const QVector<QMatrix4x4> & instances,
+		QGLBuffer::UsagePattern usage = QGLBuffer::StaticDraw );
+
+private:
+	void drawPart( const Part & part, const QMatrix4x4 & viewMatrix, const QVector<QMatrix4x4> & instances );
+	void drawPartInstanced( const Part & part, int instanceMatrixAttribute, QGLBuffer & instanceBuffer, int instanceCount );
 };
 
 
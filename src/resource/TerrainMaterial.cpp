@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TerrainMaterial.hpp"
+
+#include "Shader.hpp"
+#include <utility/glWrappers.hpp>
+
+#include <QGLShaderProgram>
+#include <QStringList>
+#include <QVector4D>
+#include <QByteArray>
+#include <QDebug>
+
+#include <math.h>
+
+
+TerrainMaterial::TerrainMaterial( GLWidget * glWidget, const QString & material, const QVector2D & scale, const QSize & mapSize ) :
+	mGLWidget( glWidget ),
+	mMapSize( mapSize ),
+	mSplatMapChanged( false ),
+	mBoundShader( NULL )
+{
+	for( int i = 0; i < MaxLayers; ++i )
+		mShaders[i][0] = mShaders[i][1] = NULL;
+
+	glGetIntegerv( GL_MAX_TEXTURE_IMAGE_UNITS, &mTextureUnits );
+
+	const uchar flatNormal[4] = { 128, 128, 255, 255 };
+	const uchar white[4] = { 255, 255, 255, 255 };
+	mFlatNormalMap = createTexture( 1, 1, flatNormal, GL_REPEAT );
+	mWhiteMap = createTexture( 1, 1, white, GL_REPEAT );
+
+	// the texels at the borders lie on the outermost vertices
+	mSplatMapSize = mMapSize.boundedTo( QSize( MaxSplatMapSize, MaxSplatMapSize ) );
+	mSplatMapScale = QSizeF(
+		(float)( mSplatMapSize.width()-1 ) / (float)qMax( mMapSize.width()-1, 1 ),
+		(float)( mSplatMapSize.height()-1 ) / (float)qMax( mMapSize.height()-1, 1 )
+	);
+	mSplatMap = createTexture( mSplatMapSize.width(), mSplatMapSize.height(), NULL, GL_CLAMP_TO_EDGE );
+	mWeights.fill( 0, mSplatMapSize.width() * mSplatMapSize.height() * 4 );
+	mSplatMapChanged = true;
+
+	addLayer( material, scale );
+}
+
+
+TerrainMaterial::~TerrainMaterial()
+{
+	for( int i = 0; i < MaxLayers; ++i )
+	{
+		delete mShaders[i][0];
+		delete mShaders[i][1];
+	}
+	for( int i = 0; i < mLayers.size(); ++i )
+		delete mLayers[i].material;
+	glDeleteTextures( 1, &mSplatMap );
+	glDeleteTextures( 1, &mFlatNormalMap );
+	glDeleteTextures( 1, &mWhiteMap );
+}
+
+
+GLuint TerrainMaterial::createTexture( int width, int height, const uchar * rgba, GLint wrap )
+{
+	GLuint texture;
+	glGenTextures( 1, &texture );
+	glBindTexture( GL_TEXTURE_2D, texture );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	return texture;
+}
+
+
+void TerrainMaterial::downloadWeights()
+{
+	mWeights.resize( mSplatMapSize.width() * mSplatMapSize.height() * 4 );
+	glBindTexture( GL_TEXTURE_2D, mSplatMap );
+	glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, mWeights.data() );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+
+bool TerrainMaterial::canAddLayer() const
+{
+	// the splat map and the textures of every layer
+	return mLayers.size() < MaxLayers && 1 + ( mLayers.size()+1 ) * texturesPerLayer( true ) <= mTextureUnits;
+}
+
+
+void TerrainMaterial::addLayer( const QString & material, const QVector2D & scale )
+{
+	if( mLayers.size() >= MaxLayers )
+	{
+		qWarning() << "A terrain material is limited to" << MaxLayers << "layers, skipping" << material;
+		return;
+	}
+
+	Layer layer;
+	layer.material = new Material( mGLWidget, material );
+	layer.scale = scale;
+	const QMap<QString,GLuint> & textures = layer.material->constData()->textures();
+	layer.diffuseMap = textures.value( "diffuseMap", mWhiteMap );
+	layer.normalMap = textures.value( "normalMap", mFlatNormalMap );
+	layer.specularMap = textures.value( "specularMap", mWhiteMap );
+	mLayers.append( layer );
+}
+
+
+void TerrainMaterial::addMask( const QImage & mask, const QRect & rect )
+{
+	if( mLayers.size() < 2 )
+	{
+		qWarning() << "The base layer of a terrain material can't be masked";
+		return;
+	}
+	if( mask.isNull() || rect.isEmpty() )
+		return;
+
+	const int channel = mLayers.size() - 2;
+	if( mWeights.isEmpty() )
+		downloadWeights();
+	const QImage image = mask.convertToFormat( QImage::Format_ARGB32 );
+	const float scaleX = (float)image.width() / (float)rect.width();
+	const float scaleY = (float)image.height() / (float)rect.height();
+
+	// every texel on the quads within the rectangle - sampled like a mask texture stretched over them
+	const QRect texels = QRect(
+		QPoint( (int)ceilf( rect.left() * mSplatMapScale.width() ), (int)ceilf( rect.top() * mSplatMapScale.height() ) ),
+		QPoint( (int)floorf( ( rect.right()+1 ) * mSplatMapScale.width() ), (int)floorf( ( rect.bottom()+1 ) * mSplatMapScale.height() ) )
+	).intersected( QRect( QPoint(0,0), mSplatMapSize ) );
+	for( int ty = texels.top(); ty <= texels.bottom(); ++ty )
+	{
+		const float y = ty / mSplatMapScale.height();
+		const float v = qBound( 0.0f, ( y - rect.y() ) * scaleY - 0.5f, (float)( image.height()-1 ) );
+		const int v0 = (int)v;
+		const float fv = v - v0;
+		const QRgb * row0 = (const QRgb*)image.scanLine( v0 );
+		const QRgb * row1 = (const QRgb*)image.scanLine( qMin( v0+1, image.height()-1 ) );
+		for( int tx = texels.left(); tx <= texels.right(); ++tx )
+		{
+			const float x = tx / mSplatMapScale.width();
+			const float u = qBound( 0.0f, ( x - rect.x() ) * scaleX - 0.5f, (float)( image.width()-1 ) );
+			const int u0 = (int)u;
+			const int u1 = qMin( u0+1, image.width()-1 );
+			const float fu = u - u0;
+			const float top = qRed( row0[u0] ) + ( qRed( row0[u1] ) - qRed( row0[u0] ) ) * fu;
+			const float bottom = qRed( row1[u0] ) + ( qRed( row1[u1] ) - qRed( row1[u0] ) ) * fu;
+			const float weight = ( top + ( bottom - top ) * fv ) / 255.0f;
+
+			// blending over an earlier mask of the same layer
+			uchar & target = mWeights[ ( tx + ty*mSplatMapSize.width() ) * 4 + channel ];
+			target = (uchar)( target + weight * ( 255 - target ) + 0.5f );
+		}
+	}
+	mSplatMapChanged = true;
+}
+
+
+Shader * TerrainMaterial::shader( int layers, bool normalMapping )
+{
+	Shader * & shader = mShaders[layers-1][normalMapping ? 1 : 0];
+	if( !shader )
+	{
+		QStringList defines;
+		defines << QString( "LAYERS %1" ).arg( layers );
+		if( normalMapping )
+			defines << "NORMAL_MAPPING";
+		defines << "TERRAIN";
+		shader = new Shader( mGLWidget, "terrain", defines );
+	}
+	return shader;
+}
+
+
+void TerrainMaterial::bind( int layers )
+{
+	layers = qBound( 1, layers, mLayers.size() );
+	const bool normalMapping = MaterialQuality::maximum() > MaterialQuality::LOW;
+
+	if( mSplatMapChanged )
+	{
+		glBindTexture( GL_TEXTURE_2D, mSplatMap );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, mSplatMapSize.width(), mSplatMapSize.height(), GL_RGBA, GL_UNSIGNED_BYTE, mWeights.constData() );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		mSplatMapChanged = false;
+		// the texture keeps the only copy - it is read back if another mask is added
+		mWeights = QVector<uchar>();
+	}
+
+	mBoundShader = shader( layers, normalMapping );
+	mBoundShader->bind();
+	QGLShaderProgram * program = mBoundShader->program();
+
+	QVector2D scales[MaxLayers];
+	QVector4D ambient[MaxLayers];
+	QVector4D diffuse[MaxLayers];
+	QVector4D specular[MaxLayers];
+	QVector4D emission[MaxLayers];
+	GLfloat shininess[MaxLayers];
+	for( int i = 0; i < layers; ++i )
+	{
+		const MaterialData & data = *mLayers[i].material->constData();
+		scales[i] = mLayers[i].scale;
+		ambient[i] = data.ambient();
+		diffuse[i] = data.diffuse();
+		specular[i] = data.specular();
+		emission[i] = data.emission();
+		shininess[i] = data.shininess();
+	}
+	program->setUniformValueArray( "layerScale", scales, layers );
+	program->setUniformValueArray( "layerAmbient", ambient, layers );
+	program->setUniformValueArray( "layerDiffuse", diffuse, layers );
+	program->setUniformValueArray( "layerSpecular", specular, layers );
+	program->setUniformValueArray( "layerEmission", emission, layers );
+	program->setUniformValueArray( "layerShininess", shininess, layers, 1 );
+	// heightmap coordinates to the texture coordinates of the splat map's texel centers
+	program->setUniformValue( "splatScale", QVector2D( mSplatMapScale.width()/(float)mSplatMapSize.width(), mSplatMapScale.height()/(float)mSplatMapSize.height() ) );
+	program->setUniformValue( "splatOffset", QVector2D( 0.5f/(float)mSplatMapSize.width(), 0.5f/(float)mSplatMapSize.height() ) );
+
+	int texUnit = 0;
+	glActiveTexture( GL_TEXTURE0 + texUnit );
+	glBindTexture( GL_TEXTURE_2D, mSplatMap );
+	program->setUniformValue( "splatMap", texUnit++ );
+	for( int i = 0; i < layers; ++i )
+	{
+		const QByteArray index = QByteArray::number( i );
+		glActiveTexture( GL_TEXTURE0 + texUnit );
+		glBindTexture( GL_TEXTURE_2D, mLayers[i].diffuseMap );
+		program->setUniformValue( ( "diffuseMap" + index ).constData(), texUnit++ );
+		if( !normalMapping )
+			continue;
+		glActiveTexture( GL_TEXTURE0 + texUnit );
+		glBindTexture( GL_TEXTURE_2D, mLayers[i].normalMap );
+		program->setUniformValue( ( "normalMap" + index ).constData(), texUnit++ );
+		glActiveTexture( GL_TEXTURE0 + texUnit );
+		glBindTexture( GL_TEXTURE_2D, mLayers[i].specularMap );
+		program->setUniformValue( ( "specularMap" + index ).constData(), texUnit++ );
+	}
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+
+void TerrainMaterial::release()
+{
+	if( !mBoundShader )
+		return;
+	mBoundShader->release();
+	mBoundShader = NULL;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESOURCE_TERRAINMATERIAL_INCLUDED
+#define RESOURCE_TERRAINMATERIAL_INCLUDED
+
+#include "Material.hpp"
+
+#include <GLWidget.hpp>
+
+#include <QString>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QSizeF>
+#include <QVector>
+#include <QVector2D>
+
+
+class Shader;
+
+
+/// Blends several materials on a terrain within a single pass
+/**
+ * The first layer covers the whole terrain, every further layer is blended over the layers below
+ * using its weights from one channel of an RGBA splat map.\n
+ * The splat map has the resolution of the heightmap up to MaxSplatMapSize texels per side - larger maps are covered
+ * by a stretched splat map. Its weights are only kept in memory until they are uploaded.\n
+ * Each layer is lit on its own before blending, so the result matches drawing every layer
+ * in a pass of its own with alpha blending - like Landscape::Blob does.\n
+ * A shader is compiled for each number of layers and for low and higher material qualities when first used.
+ * Its shaders are compiled for Terrain's vertices - the texture coordinates are the heightmap coordinates rebuilt by TerrainGrid.
+ */
+class TerrainMaterial
+{
+public:
+	/// The base layer and the layers of the four channels of the splat map
+	static const int MaxLayers = 5;
+	/// Largest number of splat map texels along each side
+	static const int MaxSplatMapSize = 2048;
+
+	/**
+	 * @param material Name of the base layer's material.
+	 * @param scale Scales heightmap coordinates to texture coordinates of the base layer's material.
+	 * @param mapSize The size of the heightmap.
+	 */
+	TerrainMaterial( GLWidget * glWidget, const QString & material, const QVector2D & scale, const QSize & mapSize );
+	~TerrainMaterial();
+
+	int layers() const { return mLayers.size(); }	///< Number of layers including the base layer
+
+	/// Whether another layer fits into the splat map and the texture units of the graphics card
+	bool canAddLayer() const;
+
+	/// Adds a layer above all existing layers - its weights are zero until masks are added.
+	void addLayer( const QString & material, const QVector2D & scale );
+
+	/// Adds a mask to the weights of the topmost layer.
+	/**
+	 * Overlapping masks are combined like drawing them one after another.
+	 * @param mask The red channel is used as weight.
+	 * @param rect The mask is stretched over this rectangle in heightmap coordinates.
+	 */
+	void addMask( const QImage & mask, const QRect & rect );
+
+	/// Binds the shader blending the given number of layers - the remaining layers are skipped.
+	void bind( int layers );
+	void release();
+
+private:
+	struct Layer
+	{
+		Material * material;
+		QVector2D scale;
+		GLuint diffuseMap;
+		GLuint normalMap;
+		GLuint specularMap;
+	};
+
+	GLWidget * mGLWidget;
+	QSize mMapSize;
+	QSize mSplatMapSize;
+	/// Splat map texels per heightmap quad
+	QSizeF mSplatMapScale;
+	QVector<Layer> mLayers;
+	/// RGBA weights of the layers above the base layer row by row - empty after they were uploaded
+	QVector<uchar> mWeights;
+	GLuint mSplatMap;
+	bool mSplatMapChanged;
+	/// Used for layers without normal or specular map
+	GLuint mFlatNormalMap;
+	GLuint mWhiteMap;
+	int mTextureUnits;
+	/// Shaders for each number of layers - with and without normal mapping
+	Shader * mShaders[MaxLayers][2];
+	Shader * mBoundShader;
+
+	static int texturesPerLayer( bool normalMapping ) { return normalMapping ? 3 : 1; }
+	GLuint createTexture( int width, int height, const uchar * rgba, GLint wrap );
+	/// Restores the weights freed after the last upload
+	void downloadWeights();
+	Shader * shader( int layers, bool normalMapping );
+};
+
+
+#endif
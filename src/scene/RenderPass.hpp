@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_RENDERPASS_INCLUDED
+#define SCENE_RENDERPASS_INCLUDED
+
+#include <QString>
+
+
+/// The passes the scene graph is drawn in
+/**
+ * Objects only take part in the passes selected by their mask (see AObject::setRenderPasses()),
+ * DrawStatistics counts the draw calls of each pass separately.
+ */
+class RenderPass
+{
+	RenderPass() {}
+	~RenderPass() {}
+public:
+	enum Type
+	{
+		MAIN		= 0,
+		REFLECTION	= 1,
+		REFRACTION	= 2,
+		SHADOW		= 3	///< Reserved for shadow maps, not drawn yet
+	};
+	const static int num = 4;
+
+	/// Mask bits selecting passes
+	enum Mask
+	{
+		MAIN_BIT	= 1 << MAIN,
+		REFLECTION_BIT	= 1 << REFLECTION,
+		REFRACTION_BIT	= 1 << REFRACTION,
+		SHADOW_BIT	= 1 << SHADOW,
+		ALL		= MAIN_BIT | REFLECTION_BIT | REFRACTION_BIT | SHADOW_BIT
+	};
+
+	static QString toString( const Type & pass );
+	/// The pass currently drawn
+	static const Type & current() { return sCurrent; }
+	static void setCurrent( const Type & pass ) { sCurrent = pass; }
+
+private:
+	static Type sCurrent;
+};
+
+
+#endif
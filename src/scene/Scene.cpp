@@ -30,15 +30,22 @@
 #include "object/World.hpp"
 #include "object/Eye.hpp"
 #include "TextureRenderer.hpp"
+#include "TransformHierarchy.hpp"
 #include "AMouseListener.hpp"
 #include "AKeyListener.hpp"
+#include "RenderPass.hpp"
 #include <GLWidget.hpp>
 #include <resource/Material.hpp>
 #include <resource/Shader.hpp>
+#include <resource/AudioSample.hpp>
 #include <utility/glWrappers.hpp>
 #include <utility/alWrappers.hpp>
+#include <utility/JobSystem.hpp>
+#include <utility/CommandBuffer.hpp>
+#include <utility/DrawStatistics.hpp>
 
 #include <QSettings>
+#include <QStringList>
 #include <QPainter>
 #include <QTimer>
 #include <QGraphicsItem>
@@ -79,11 +86,16 @@ Scene::Scene( GLWidget * glWidget, QObject * parent ) :
 	QGraphicsScene( parent ),
 	mGLWidget( glWidget ),
 	mEye( NULL ),
+	mTransforms( new TransformHierarchy ),
+	mJobs( new JobSystem ),
+	mCommands( new CommandBuffer ),
 	mLeftTextureRenderer( NULL ),
 	mRightTextureRenderer( NULL )
 {
 	QSettings settings;
 
+	AudioSample::setCommandBuffer( mCommands );
+
 	mRoot = 0;
 	mFrameCountSecond = 0;
 	mFramesPerSecond = 0;
@@ -183,6 +195,10 @@ Scene::~Scene()
 	delete mOVRShader;
 #endif
 	delete mEye;
+	delete mTransforms;
+	delete mJobs;
+	AudioSample::setCommandBuffer( NULL );
+	delete mCommands;
 	delete mLeftTextureRenderer;
 	delete mRightTextureRenderer;
 }
@@ -265,6 +281,7 @@ void Scene::updateObjects( const double & delta )
 {
 	mRoot->update( delta );
 	mRoot->update2( delta );
+	mTransforms->propagate();
 	mEye->update( delta );
 	mEye->applyAL();
 }
@@ -272,6 +289,7 @@ void Scene::updateObjects( const double & delta )
 
 void Scene::drawObjects()
 {
+	RenderPass::setCurrent( RenderPass::MAIN );
 	mEye->applyGL();
 	mRoot->draw();
 	mRoot->draw2();
@@ -315,6 +333,7 @@ void Scene::drawStereoFrameBuffers()
 
 	glBindTexture( GL_TEXTURE_2D, mLeftTextureRenderer->texID() );
 	glDrawArrays( GL_QUADS, 4, 4 );
+	DrawStatistics::countDrawCall( 2 );
 
 #ifdef OVR_ENABLED
 	if( mStereoUseOVR )
@@ -326,6 +345,7 @@ void Scene::drawStereoFrameBuffers()
 
 	glBindTexture( GL_TEXTURE_2D, mRightTextureRenderer->texID() );
 	glDrawArrays( GL_QUADS, 8, 4 );
+	DrawStatistics::countDrawCall( 2 );
 
 #ifdef OVR_ENABLED
 	if( mStereoUseOVR )
@@ -440,6 +460,7 @@ void Scene::drawBackground( QPainter * painter, const QRectF & rect )
 	}
 
 	mFrameCountSecond++;
+	DrawStatistics::finishFrame();
 	drawFPS( painter, rect );
 	drawHUD( painter, rect );
 
@@ -460,6 +481,20 @@ void Scene::drawFPS( QPainter * painter, const QRectF & rect )
 	painter->setPen( QColor(255,255,255) );
 	painter->setFont( mFont );
 	painter->drawText( rect, Qt::AlignTop | Qt::AlignRight, QString( tr("(%2s) %1 FPS") ).arg(mFramesPerSecond).arg(mDelta) );
+	if( DrawStatistics::visible() )
+	{
+		QRectF statisticsRect( rect );
+		statisticsRect.setTop( rect.top() + painter->fontMetrics().lineSpacing() );
+		painter->drawText( statisticsRect, Qt::AlignTop | Qt::AlignRight, QString( tr("%1 draw calls, %2 triangles") ).arg(DrawStatistics::drawCalls()).arg(DrawStatistics::triangles()) );
+		QStringList passes;
+		for( int pass = 0; pass < RenderPass::num; pass++ )
+		{
+			if( DrawStatistics::drawCalls( (RenderPass::Type)pass ) )
+				passes << QString( tr("%1: %2") ).arg(RenderPass::toString( (RenderPass::Type)pass )).arg(DrawStatistics::drawCalls( (RenderPass::Type)pass ));
+		}
+		statisticsRect.setTop( statisticsRect.top() + painter->fontMetrics().lineSpacing() );
+		painter->drawText( statisticsRect, Qt::AlignTop | Qt::AlignRight, passes.join( ", " ) );
+	}
 }
 
 
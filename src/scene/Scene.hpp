@@ -54,6 +54,9 @@ class TextureRenderer;
 class Shader;
 class Eye;
 class AObject;
+class TransformHierarchy;
+class JobSystem;
+class CommandBuffer;
 
 
 /// Scene manager and interface to Qt
@@ -78,6 +81,10 @@ public:
 	AObject * root() const { return mRoot; }
 	void setRoot( AObject * root ) { mRoot = root; }
 
+	TransformHierarchy * transforms() const { return mTransforms; }
+	JobSystem * jobs() const { return mJobs; }
+	CommandBuffer * commands() const { return mCommands; }
+
 	Eye * eye() const { return mEye; }
 	void setEye( Eye * eye ) { mEye = eye; }
 
@@ -178,6 +185,9 @@ private:
 	QList<AKeyListener*> mKeyListeners;
 	Eye * mEye;
 	AObject * mRoot;
+	TransformHierarchy * mTransforms;
+	JobSystem * mJobs;
+	CommandBuffer * mCommands;
 
 	TextureRenderer * mLeftTextureRenderer;
 	TextureRenderer * mRightTextureRenderer;
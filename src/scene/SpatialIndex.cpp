@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SpatialIndex.hpp"
+
+#include <scene/object/AObject.hpp>
+
+#include <QVarLengthArray>
+
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+
+
+SpatialIndex::SpatialIndex( float cellSize ) :
+	mCellSize( cellSize ),
+	mMinX( 0 ), mMaxX( -1 ), mMinZ( 0 ), mMaxZ( -1 )
+{
+}
+
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+
+void SpatialIndex::insert( AObject * object )
+{
+	Entry entry;
+	entry.object = object;
+	entry.bounded = false;
+	entry.x = 0;
+	entry.z = 0;
+	mEntries.append( entry );
+	link( mEntries.size()-1 );
+}
+
+
+void SpatialIndex::erase( AObject * object )
+{
+	for( int i = 0; i < mEntries.size(); ++i )
+	{
+		if( mEntries[i].object != object )
+			continue;
+		unlink( i );
+		int last = mEntries.size()-1;
+		if( i != last )
+		{
+			unlink( last );
+			mEntries[i] = mEntries[last];
+			link( i );
+		}
+		mEntries.pop_back();
+		return;
+	}
+}
+
+
+void SpatialIndex::refresh()
+{
+	for( int i = 0; i < mEntries.size(); ++i )
+	{
+		const Entry & entry = mEntries[i];
+		float radius = entry.object->boundingSphereRadius();
+		bool bounded = radius > FLT_EPSILON && radius <= mCellSize;
+		QVector3D position = entry.object->worldPosition();
+		if( bounded != entry.bounded || ( bounded && ( cell( position.x() ) != entry.x || cell( position.z() ) != entry.z ) ) )
+		{
+			unlink( i );
+			link( i );
+		}
+	}
+
+	// shrink the occupied area again
+	mMinX = mMinZ = INT_MAX;
+	mMaxX = mMaxZ = INT_MIN;
+	for( int i = 0; i < mEntries.size(); ++i )
+	{
+		const Entry & entry = mEntries[i];
+		if( entry.bounded )
+		{
+			mMinX = qMin( mMinX, entry.x );
+			mMaxX = qMax( mMaxX, entry.x );
+			mMinZ = qMin( mMinZ, entry.z );
+			mMaxZ = qMax( mMaxZ, entry.z );
+		}
+	}
+}
+
+
+void SpatialIndex::link( int i )
+{
+	Entry & entry = mEntries[i];
+	float radius = entry.object->boundingSphereRadius();
+	entry.bounded = radius > FLT_EPSILON && radius <= mCellSize;
+	if( !entry.bounded )
+	{
+		mUnbounded.append( i );
+		return;
+	}
+	QVector3D position = entry.object->worldPosition();
+	entry.x = cell( position.x() );
+	entry.z = cell( position.z() );
+	mCells[key( entry.x, entry.z )].append( i );
+	if( mMinX > mMaxX )
+	{
+		mMinX = mMaxX = entry.x;
+		mMinZ = mMaxZ = entry.z;
+	} else {
+		mMinX = qMin( mMinX, entry.x );
+		mMaxX = qMax( mMaxX, entry.x );
+		mMinZ = qMin( mMinZ, entry.z );
+		mMaxZ = qMax( mMaxZ, entry.z );
+	}
+}
+
+
+void SpatialIndex::unlink( int i )
+{
+	const Entry & entry = mEntries[i];
+	if( !entry.bounded )
+	{
+		mUnbounded.remove( mUnbounded.indexOf( i ) );
+		return;
+	}
+	QHash< quint64, QVector<int> >::iterator c = mCells.find( key( entry.x, entry.z ) );
+	c->remove( c->indexOf( i ) );
+	if( c->isEmpty() )
+		mCells.erase( c );
+}
+
+
+/// Intersects a line with every visited object
+class LineIntersector : public ACollisionVisitor
+{
+public:
+	LineIntersector( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
+		float & length, QVector3D * normal ) :
+		mExclude( exclude ), mOrigin( origin ), mDirection( direction ), mLength( length ), mNormal( normal ),
+		mNearestTarget( NULL ) {}
+	virtual void visit( const AObject * object )
+	{
+		if( object == mExclude )
+			return;
+		const AObject * target = object->intersectLine( mExclude, mOrigin, mDirection, mLength, mNormal );
+		if( target )
+			mNearestTarget = target;
+	}
+	const AObject * nearestTarget() const { return mNearestTarget; }
+private:
+	const AObject * mExclude;
+	const QVector3D & mOrigin;
+	const QVector3D & mDirection;
+	float & mLength;
+	QVector3D * mNormal;
+	const AObject * mNearestTarget;
+};
+
+
+/// Collects every visited object once
+class CandidateCollector : public ACollisionVisitor
+{
+public:
+	CandidateCollector( const AObject * exclude ) : mExclude( exclude ) {}
+	virtual void visit( const AObject * object )
+	{
+		if( object == mExclude )
+			return;
+		for( int i = 0; i < mCandidates.size(); ++i )
+		{
+			if( mCandidates[i] == object )
+				return;
+		}
+		mCandidates.append( object );
+	}
+	const QVarLengthArray<const AObject*,64> & candidates() const { return mCandidates; }
+private:
+	const AObject * mExclude;
+	QVarLengthArray<const AObject*,64> mCandidates;
+};
+
+
+const AObject * SpatialIndex::intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
+	float & length, QVector3D * normal ) const
+{
+	LineIntersector intersector( exclude, origin, direction, length, normal );
+	for( int i = 0; i < mUnbounded.size(); ++i )
+		intersector.visit( mEntries[mUnbounded[i]].object );
+	walkLine( origin, direction, length, intersector );
+	return intersector.nearestTarget();
+}
+
+
+void SpatialIndex::intersectLines( const AObject * exclude, Ray * rays, int count ) const
+{
+	// gather the candidates of all rays first, so each object is asked only once
+	CandidateCollector collector( exclude );
+	for( int i = 0; i < mUnbounded.size(); ++i )
+		collector.visit( mEntries[mUnbounded[i]].object );
+	for( int i = 0; i < count; ++i )
+		walkLine( rays[i].origin, rays[i].direction, rays[i].length, collector );
+
+	const QVarLengthArray<const AObject*,64> & candidates = collector.candidates();
+	for( int i = 0; i < candidates.size(); ++i )
+		candidates[i]->intersectLines( exclude, rays, count );
+}
+
+
+void SpatialIndex::walkLine( const QVector3D & origin, const QVector3D & direction, const float & length,
+	ACollisionVisitor & visitor ) const
+{
+	if( mCells.isEmpty() )
+		return;
+
+	// clip the line against the occupied cells and their neighbours
+	float tEnter = 0.0f;
+	float tExit = length + mCellSize;
+	const float boundsMin[2] = { (mMinX-1) * mCellSize, (mMinZ-1) * mCellSize };
+	const float boundsMax[2] = { (mMaxX+2) * mCellSize, (mMaxZ+2) * mCellSize };
+	const float o[2] = { origin.x(), origin.z() };
+	const float d[2] = { direction.x(), direction.z() };
+	for( int axis = 0; axis < 2; ++axis )
+	{
+		if( fabsf( d[axis] ) < FLT_EPSILON )
+		{
+			if( o[axis] < boundsMin[axis] || o[axis] > boundsMax[axis] )
+				return;
+			continue;
+		}
+		float t0 = ( boundsMin[axis] - o[axis] ) / d[axis];
+		float t1 = ( boundsMax[axis] - o[axis] ) / d[axis];
+		if( t0 > t1 )
+			qSwap( t0, t1 );
+		tEnter = qMax( tEnter, t0 );
+		tExit = qMin( tExit, t1 );
+	}
+	if( tEnter > tExit )
+		return;
+
+	// walk the cells along the line (2D DDA)
+	int c[2] = { cell( o[0] + d[0]*tEnter ), cell( o[1] + d[1]*tEnter ) };
+	int step[2];
+	float tMax[2];
+	float tDelta[2];
+	for( int axis = 0; axis < 2; ++axis )
+	{
+		if( fabsf( d[axis] ) < FLT_EPSILON )
+		{
+			step[axis] = 0;
+			tMax[axis] = FLT_MAX;
+			tDelta[axis] = FLT_MAX;
+		} else {
+			step[axis] = d[axis] > 0.0f ? 1 : -1;
+			tMax[axis] = ( ( c[axis] + ( step[axis] > 0 ? 1 : 0 ) ) * mCellSize - o[axis] ) / d[axis];
+			tDelta[axis] = mCellSize / fabsf( d[axis] );
+		}
+	}
+
+	// the walk is monotone, so a neighbour of the previous cell has already been visited
+	bool first = true;
+	int previous[2] = { 0, 0 };
+	while( true )
+	{
+		for( int x = c[0]-1; x <= c[0]+1; ++x )
+		{
+			for( int z = c[1]-1; z <= c[1]+1; ++z )
+			{
+				if( !first && abs( x-previous[0] ) <= 1 && abs( z-previous[1] ) <= 1 )
+					continue;
+				QHash< quint64, QVector<int> >::const_iterator i = mCells.constFind( key( x, z ) );
+				if( i == mCells.constEnd() )
+					continue;
+				for( int j = 0; j < i->size(); ++j )
+					visitor.visit( mEntries[i->at(j)].object );
+			}
+		}
+		first = false;
+		previous[0] = c[0];
+		previous[1] = c[1];
+
+		// the visitor may have shortened the line - hits beyond length can be ignored
+		int axis = tMax[0] < tMax[1] ? 0 : 1;
+		if( tMax[axis] > qMin( tExit, length + mCellSize ) )
+			break;
+		c[axis] += step[axis];
+		tMax[axis] += tDelta[axis];
+	}
+}
+
+
+void SpatialIndex::visitSphereCollisions( const AObject * exclude, const float & radius,
+	QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
+{
+	for( int i = 0; i < mUnbounded.size(); ++i )
+	{
+		const AObject * object = mEntries[mUnbounded[i]].object;
+		if( object != exclude )
+			object->visitSphereCollisions( exclude, radius, center, normal, visitor );
+	}
+
+	int minX = qMax( cell( center.x() - radius ) - 1, mMinX );
+	int maxX = qMin( cell( center.x() + radius ) + 1, mMaxX );
+	int minZ = qMax( cell( center.z() - radius ) - 1, mMinZ );
+	int maxZ = qMin( cell( center.z() + radius ) + 1, mMaxZ );
+	for( int x = minX; x <= maxX; ++x )
+	{
+		for( int z = minZ; z <= maxZ; ++z )
+		{
+			QHash< quint64, QVector<int> >::const_iterator i = mCells.constFind( key( x, z ) );
+			if( i == mCells.constEnd() )
+				continue;
+			for( int j = 0; j < i->size(); ++j )
+			{
+				const AObject * object = mEntries[i->at(j)].object;
+				if( object != exclude )
+					object->visitSphereCollisions( exclude, radius, center, normal, visitor );
+			}
+		}
+	}
+}
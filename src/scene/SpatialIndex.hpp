@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_SPATIALINDEX_INCLUDED
+#define SCENE_SPATIALINDEX_INCLUDED
+
+
+#include <QVector>
+#include <QVector3D>
+#include <QHash>
+
+#include <utility/Ray.hpp>
+
+#include <math.h>
+
+
+class AObject;
+class ACollisionVisitor;
+
+
+/// Loose uniform grid over the subordinated objects of an AObject
+/**
+ * Every object is stored in the cell containing its center on the XZ plane.
+ * Objects whose bounding sphere is larger than a cell or that have no bounding sphere at all
+ * are kept in a separate list and visited by every query.\n
+ * Because a bounding sphere never exceeds the cell size, a query only has to visit the cells touched
+ * by the query volume and their direct neighbours.\n
+ * Positions are synchronized by refresh(), which is called after all objects were updated.
+ */
+class SpatialIndex
+{
+public:
+	/// Creates an empty index
+	explicit SpatialIndex( float cellSize );
+	~SpatialIndex();
+
+	/// Adds an object to the index
+	void insert( AObject * object );
+	/// Removes an object from the index
+	void erase( AObject * object );
+	/// Moves all objects to the cells matching their current position and bounding sphere
+	void refresh();
+
+	/// Intersects a line with all candidate objects - see AObject::intersectLine
+	const AObject * intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
+		float & length, QVector3D * normal ) const;
+	/// Intersects multiple lines with all candidate objects - see AObject::intersectLines
+	void intersectLines( const AObject * exclude, Ray * rays, int count ) const;
+	/// Collision-tests a sphere with all candidate objects - see AObject::visitSphereCollisions
+	void visitSphereCollisions( const AObject * exclude, const float & radius,
+		QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const;
+
+	const float & cellSize() const { return mCellSize; }
+
+private:
+	class Entry
+	{
+	public:
+		AObject * object;
+		bool bounded;
+		int x;
+		int z;
+	};
+
+	float mCellSize;
+	QVector<Entry> mEntries;
+	QVector<int> mUnbounded;
+	QHash< quint64, QVector<int> > mCells;
+	int mMinX, mMaxX, mMinZ, mMaxZ;
+
+	static quint64 key( int x, int z ) { return ((quint64)(quint32)x << 32) | (quint32)z; }
+	int cell( float coordinate ) const { return (int)floorf( coordinate / mCellSize ); }
+	/// Visits the objects in all cells near a line until the line ends
+	void walkLine( const QVector3D & origin, const QVector3D & direction, const float & length,
+		ACollisionVisitor & visitor ) const;
+	void link( int entry );
+	void unlink( int entry );
+};
+
+
+#endif
@@ -27,7 +27,7 @@
 #include <QDebug>
 
 
-TextureRenderer::TextureRenderer( GLWidget * glWidget, const QSize & size, bool depthBuffer ) :
+TextureRenderer::TextureRenderer( GLWidget * glWidget, const QSize & size, bool depthBuffer, bool alpha ) :
 	mLastFrameBuffer( 0 ),
 	mLastRenderBuffer( 0 ),
 	mFrameBuffer( 0 ),
@@ -44,7 +44,7 @@ TextureRenderer::TextureRenderer( GLWidget * glWidget, const QSize & size, bool
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glTexImage2D( GL_TEXTURE_2D, 0, 3, mSize.width(), mSize.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL );
+	glTexImage2D( GL_TEXTURE_2D, 0, (alpha?4:3), mSize.width(), mSize.height(), 0, (alpha?GL_RGBA:GL_RGB), GL_UNSIGNED_BYTE, NULL );
 
 	glGenFramebuffers( 1, &mFrameBuffer );
 	glBindFramebuffer( GL_FRAMEBUFFER, mFrameBuffer );
@@ -93,13 +93,19 @@ TextureRenderer::~TextureRenderer()
 
 
 void TextureRenderer::bind()
+{
+	bind( size() );
+}
+
+
+void TextureRenderer::bind( const QSize & viewport )
 {
 	glGetIntegerv( GL_FRAMEBUFFER_BINDING, (GLint*)&mLastFrameBuffer );
 	glGetIntegerv( GL_RENDERBUFFER_BINDING, (GLint*)&mLastRenderBuffer );
 	glBindFramebuffer( GL_FRAMEBUFFER, mFrameBuffer );
 	glBindRenderbuffer( GL_RENDERBUFFER, mDepthBuffer );
 	glPushAttrib( GL_VIEWPORT_BIT );
-	glViewport( 0, 0, size().width(), size().height() );
+	glViewport( 0, 0, viewport.width(), viewport.height() );
 }
 
 
@@ -43,10 +43,15 @@ class TextureRenderer
 		QSize mSize;
 
 	public:
-		TextureRenderer( GLWidget * glWidget, const QSize & size, bool depthBuffer );
+		/**
+		 * @param alpha Keeps the alpha channel of the rendered image in the texture.
+		 */
+		TextureRenderer( GLWidget * glWidget, const QSize & size, bool depthBuffer, bool alpha = false );
 		~TextureRenderer();
 
 		void bind();
+		/// Renders into the lower left part of the texture only
+		void bind( const QSize & viewport );
 		void release();
 
 		GLuint texID() const { return mTex; }
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TransformHierarchy.hpp"
+
+
+TransformHierarchy::TransformHierarchy() :
+	mFreeSlots( 0 ),
+	mOrderDirty( false ),
+	mAllValid( true ),
+	mConcurrent( false )
+{
+}
+
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+
+int TransformHierarchy::insert( AObject * object )
+{
+	int handle;
+	if( mFreeHandles.size() )
+	{
+		handle = mFreeHandles.last();
+		mFreeHandles.pop_back();
+	} else {
+		handle = mSlots.size();
+		mSlots.append( -1 );
+	}
+
+	// a new node has no parent yet, so appending it keeps the depth order intact
+	int slot = mObjects.size();
+	mSlots[handle] = slot;
+	mObjects.append( object );
+	mHandles.append( handle );
+	mParents.append( -1 );
+	mPositions.append( QVector3D( 0, 0, 0 ) );
+	mRotations.append( QQuaternion() );
+	mWorldMatrices.append( QMatrix4x4() );
+	mRadii.append( 0.0f );
+	mDirty.append( true );
+	mVersions.append( 0 );
+	mParentVersions.append( 0 );
+	mAllValid = false;
+	return handle;
+}
+
+
+void TransformHierarchy::erase( int handle )
+{
+	int slot = mSlots.at(handle);
+	// the slot stays valid until the next sort() so children can still read it
+	mObjects[slot] = NULL;
+	++mFreeSlots;
+	mOrderDirty = true;
+}
+
+
+void TransformHierarchy::setParent( int handle, int parentHandle )
+{
+	int slot = mSlots.at(handle);
+	int parent = parentHandle >= 0 ? mSlots.at(parentHandle) : -1;
+	if( mParents.at(slot) == parent )
+		return;
+	mParents[slot] = parent;
+	mDirty[slot] = true;
+	mAllValid = false;
+	if( parent > slot )
+		mOrderDirty = true;
+}
+
+
+void TransformHierarchy::validate( int slot )
+{
+	int parent = mParents.at(slot);
+	if( parent >= 0 )
+	{
+		validate( parent );
+		if( mParentVersions.at(slot) != mVersions.at(parent) )
+			mDirty[slot] = true;
+	}
+	if( mDirty.at(slot) )
+		recalculate( slot );
+}
+
+
+void TransformHierarchy::propagate()
+{
+	if( mOrderDirty )
+		sort();
+
+	// parents are stored in front of their children - one pass is enough
+	for( int slot = 0; slot < mObjects.size(); ++slot )
+	{
+		int parent = mParents.at(slot);
+		if( mDirty.at(slot) || ( parent >= 0 && mParentVersions.at(slot) != mVersions.at(parent) ) )
+			recalculate( slot );
+	}
+	mAllValid = true;
+}
+
+
+void TransformHierarchy::sort()
+{
+	int count = mObjects.size();
+
+	// build child lists, objects whose parent got erased become roots
+	QVector<int> firstChild( count, -1 );
+	QVector<int> lastChild( count, -1 );
+	QVector<int> nextSibling( count, -1 );
+	QVector<int> order;
+	order.reserve( count - mFreeSlots );
+	for( int slot = 0; slot < count; ++slot )
+	{
+		if( !mObjects.at(slot) )
+		{
+			mFreeHandles.append( mHandles.at(slot) );
+			mSlots[mHandles.at(slot)] = -1;
+			continue;
+		}
+		int parent = mParents.at(slot);
+		if( parent >= 0 && !mObjects.at(parent) )
+		{
+			mParents[slot] = parent = -1;
+			mDirty[slot] = true;
+		}
+		if( parent < 0 )
+		{
+			order.append( slot );
+		} else {
+			if( lastChild.at(parent) < 0 )
+				firstChild[parent] = slot;
+			else
+				nextSibling[lastChild.at(parent)] = slot;
+			lastChild[parent] = slot;
+		}
+	}
+
+	// breadth first traversal yields depth order
+	for( int i = 0; i < order.size(); ++i )
+	{
+		for( int child = firstChild.at(order.at(i)); child >= 0; child = nextSibling.at(child) )
+			order.append( child );
+	}
+
+	QVector<int> newSlots( count, -1 );
+	for( int i = 0; i < order.size(); ++i )
+		newSlots[order.at(i)] = i;
+
+	QVector<AObject*> objects( order.size() );
+	QVector<int> handles( order.size() );
+	QVector<int> parents( order.size() );
+	QVector<QVector3D> positions( order.size() );
+	QVector<QQuaternion> rotations( order.size() );
+	QVector<QMatrix4x4> worldMatrices( order.size() );
+	QVector<float> radii( order.size() );
+	QVector<bool> dirty( order.size() );
+	QVector<unsigned int> versions( order.size() );
+	QVector<unsigned int> parentVersions( order.size() );
+	for( int i = 0; i < order.size(); ++i )
+	{
+		int old = order.at(i);
+		objects[i] = mObjects.at(old);
+		handles[i] = mHandles.at(old);
+		parents[i] = mParents.at(old) >= 0 ? newSlots.at(mParents.at(old)) : -1;
+		positions[i] = mPositions.at(old);
+		rotations[i] = mRotations.at(old);
+		worldMatrices[i] = mWorldMatrices.at(old);
+		radii[i] = mRadii.at(old);
+		dirty[i] = mDirty.at(old);
+		versions[i] = mVersions.at(old);
+		parentVersions[i] = mParentVersions.at(old);
+		mSlots[handles.at(i)] = i;
+	}
+
+	mObjects = objects;
+	mHandles = handles;
+	mParents = parents;
+	mPositions = positions;
+	mRotations = rotations;
+	mWorldMatrices = worldMatrices;
+	mRadii = radii;
+	mDirty = dirty;
+	mVersions = versions;
+	mParentVersions = parentVersions;
+
+	mFreeSlots = 0;
+	mOrderDirty = false;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_TRANSFORMHIERARCHY_INCLUDED
+#define SCENE_TRANSFORMHIERARCHY_INCLUDED
+
+
+#include <QVector>
+#include <QVector3D>
+#include <QQuaternion>
+#include <QMatrix4x4>
+
+
+class AObject;
+
+
+/// Flat storage for the transformations of all objects in a scene
+/**
+ * Local positions, rotations, world matrices, bounding sphere radii and dirty flags
+ * of every AObject are kept in contiguous arrays instead of being scattered across the objects.\n
+ * The arrays are ordered by depth, so every parent is stored in front of its children and
+ * propagate() can update all world matrices in a single linear pass.\n
+ * Objects refer to their transformation using a handle which stays valid while the arrays are reordered.\n
+ * References returned by the accessors point directly into the arrays and are only valid until
+ * the next call to insert(), erase(), propagate() or any other call which may reorder them - copy the values
+ * if they need to be kept around.
+ * - Dirty propagation is incremental:
+ *   - Changing a local position or rotation only flags the node itself.
+ *   - Each node remembers the version of its parent's world matrix it was calculated from,
+ *     so children are only recalculated if an ancestor actually changed.
+ * - Concurrent updates - see setConcurrent():
+ *   - Workers may only modify and query the transformations of the objects they update themselves,
+ *     which only touches the dirty flags and matrices of those objects' slots.
+ *   - Of every other object workers may only read the matrices already propagated before the jobs started.
+ *   - insert(), erase(), setParent() and propagate() are only called from the main thread.
+ */
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+	~TransformHierarchy();
+
+	/// Registers an object and returns the handle to its transformation
+	int insert( AObject * object );
+	/// Unregisters the transformation identified by the given handle
+	void erase( int handle );
+
+	/// Sets the parent transformation - -1 for none
+	void setParent( int handle, int parentHandle );
+
+	/// The local position
+	const QVector3D & position( int handle ) const { return mPositions.at(mSlots.at(handle)); }
+	/// Sets the local position
+	void setPosition( int handle, const QVector3D & position ) { int s = mSlots.at(handle); mPositions[s] = position; mDirty[s] = true; if( !mConcurrent ) mAllValid = false; }
+	/// The local rotation
+	const QQuaternion & rotation( int handle ) const { return mRotations.at(mSlots.at(handle)); }
+	/// Sets the local rotation
+	void setRotation( int handle, const QQuaternion & rotation ) { int s = mSlots.at(handle); mRotations[s] = rotation; mDirty[s] = true; if( !mConcurrent ) mAllValid = false; }
+	/// The bounding sphere radius
+	const float & radius( int handle ) const { return mRadii.at(mSlots.at(handle)); }
+	/// Sets the bounding sphere radius
+	void setRadius( int handle, const float & radius ) { mRadii[mSlots.at(handle)] = radius; }
+
+	/// Returns the transformation matrix to world space - recalculated on demand
+	const QMatrix4x4 & worldMatrix( int handle ) { int s = mSlots.at(handle); if( mConcurrent || !mAllValid ) validate( s ); return mWorldMatrices.at(s); }
+
+	/// Recalculates all outdated world matrices in depth order
+	void propagate();
+
+	/// Marks the objects as being updated concurrently - called from the main thread around the update jobs
+	/**
+	 * While set, changes only flag their own slots and world matrices are validated slot by slot,
+	 * so no state shared by all objects is written by the workers.
+	 */
+	void setConcurrent( bool enable ) { mConcurrent = enable; mAllValid = false; }
+
+	/// Number of registered transformations
+	int size() const { return mObjects.size() - mFreeSlots; }
+
+private:
+	/// Slot index for each handle
+	QVector<int> mSlots;
+	/// Unused handles
+	QVector<int> mFreeHandles;
+
+	// Arrays indexed by slot - sorted by depth:
+	QVector<AObject*> mObjects;
+	QVector<int> mHandles;
+	QVector<int> mParents;
+	QVector<QVector3D> mPositions;
+	QVector<QQuaternion> mRotations;
+	QVector<QMatrix4x4> mWorldMatrices;
+	QVector<float> mRadii;
+	QVector<bool> mDirty;
+	/// Incremented every time the world matrix is recalculated
+	QVector<unsigned int> mVersions;
+	/// Version of the parent's world matrix the world matrix was calculated from
+	QVector<unsigned int> mParentVersions;
+
+	/// Number of erased slots not yet compacted
+	int mFreeSlots;
+	/// Set if a parent might be stored behind one of its children
+	bool mOrderDirty;
+	/// Set by propagate() while no transformation changed - world matrices can be returned without validation
+	bool mAllValid;
+	/// Set while objects are updated concurrently - mAllValid is left alone then
+	bool mConcurrent;
+
+	/// Recalculates a single world matrix from its parent's and its local transformation
+	void recalculate( int slot )
+	{
+		int parent = mParents.at(slot);
+		QMatrix4x4 & m = mWorldMatrices[slot];
+		if( parent >= 0 )
+		{
+			m = mWorldMatrices.at(parent);
+			mParentVersions[slot] = mVersions.at(parent);
+		} else {
+			m.setToIdentity();
+		}
+		m.translate( mPositions.at(slot) );
+		m.rotate( mRotations.at(slot) );
+		mDirty[slot] = false;
+		++mVersions[slot];
+	}
+	/// Recalculates a single world matrix and its ancestors if necessary
+	void validate( int slot );
+	/// Restores depth order and compacts erased slots
+	void sort();
+};
+
+
+#endif
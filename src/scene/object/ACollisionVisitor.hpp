@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_OBJECT_ACOLLISIONVISITOR_INCLUDED
+#define SCENE_OBJECT_ACOLLISIONVISITOR_INCLUDED
+
+
+class AObject;
+
+
+/// Abstract receiver for the results of a collision query
+/**
+ * Passed to AObject::visitSphereCollisions() instead of returning a container,
+ * so a query does not need to allocate memory.
+ */
+class ACollisionVisitor
+{
+public:
+	virtual ~ACollisionVisitor() {}
+	/// Called for every collision with the given object
+	virtual void visit( const AObject * object ) = 0;
+};
+
+
+/// Collision visitor storing up to N colliding objects in place
+/**
+ * Further collisions are only counted.
+ */
+template< int N >
+class CollisionList : public ACollisionVisitor
+{
+public:
+	CollisionList() : mCount( 0 ) {}
+
+	virtual void visit( const AObject * object )
+	{
+		if( mCount < N )
+			mObjects[mCount] = object;
+		++mCount;
+	}
+
+	/// Number of collisions - may exceed capacity()
+	int count() const { return mCount; }
+	/// Number of stored objects
+	int size() const { return mCount < N ? mCount : N; }
+	/// Returns true if no collision occurred
+	bool isEmpty() const { return mCount == 0; }
+	/// Returns the i'th stored object
+	const AObject * at( int i ) const { return mObjects[i]; }
+	/// Maximum number of stored objects
+	static int capacity() { return N; }
+
+	/// Forgets all collisions
+	void clear() { mCount = 0; }
+
+private:
+	const AObject * mObjects[N];
+	int mCount;
+};
+
+
+#endif
@@ -25,79 +25,137 @@
 
 #include <scene/object/Eye.hpp>
 #include <scene/Scene.hpp>
+#include <scene/SpatialIndex.hpp>
 #include <GLWidget.hpp>
+#include <utility/JobSystem.hpp>
+#include <utility/CommandBuffer.hpp>
 
 #include <float.h>
 
 
+/// Collects collisions in a vector
+class CollisionVector : public ACollisionVisitor
+{
+public:
+	CollisionVector( QVector<const AObject*> & collisions ) : mCollisions( collisions ) {}
+	virtual void visit( const AObject * object ) { mCollisions.append( object ); }
+private:
+	QVector<const AObject*> & mCollisions;
+};
+
+
+/// Updates a single object as part of a concurrent batch
+class UpdateJob : public JobSystem::AJob
+{
+public:
+	UpdateJob() : object( NULL ), delta( 0.0 ) {}
+	UpdateJob( AObject * object, const double & delta ) : object( object ), delta( delta ) {}
+	virtual void run() { object->update( delta ); }
+	AObject * object;
+	double delta;
+};
+
+
 AObject::AObject( Scene * scene, float boundingSphereRadius ) :
 	mScene( scene ),
 	mParent(),
-	mPosition( 0, 0, 0 ),
-	mRotation(),
-	mBoundingSphereRadius( boundingSphereRadius ),
+	mTransforms( scene->transforms() ),
+	mTransform( mTransforms->insert( this ) ),
 	mSubNodes(),
-	mModelMatrix(),
-	mModelMatrixNeedsUpdate( true )
+	mConcurrentUpdate( false ),
+	mRenderPasses( RenderPass::ALL ),
+	mSpatialIndex( NULL )
 {
+	setBoundingSphere( boundingSphereRadius );
 }
 
 
 AObject::AObject( const AObject & other ) :
 	mScene( other.mScene ),
 	mParent( other.mParent ),
-	mPosition( other.mPosition ),
-	mRotation( other.mRotation ),
-	mBoundingSphereRadius( other.mBoundingSphereRadius ),
+	mTransforms( other.mTransforms ),
+	mTransform( mTransforms->insert( this ) ),
 	mSubNodes( other.mSubNodes ),
-	mModelMatrix( other.mModelMatrix ),
-	mModelMatrixNeedsUpdate( other.mModelMatrixNeedsUpdate )
+	mConcurrentUpdate( other.mConcurrentUpdate ),
+	mRenderPasses( other.mRenderPasses ),
+	mSpatialIndex( NULL )
 {
+	setPosition( other.position() );
+	setRotation( other.rotation() );
+	setBoundingSphere( other.boundingSphereRadius() );
+	mTransforms->setParent( mTransform, mParent ? mParent->mTransform : -1 );
 }
 
 
 AObject::~AObject()
 {
+	QLinkedList< QSharedPointer<AObject> >::iterator i;
+	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
+	{
+		if( (*i)->parent() == this )
+			(*i)->setParent( 0 );
+	}
 	mSubNodes.clear();
+	delete mSpatialIndex;
+	mTransforms->erase( mTransform );
 }
 
 
 AObject & AObject::operator=( const AObject & other )
 {
-	mModelMatrix = other.mModelMatrix;
 	mScene = other.mScene;
-	mParent = other.mParent;
-	mPosition = other.mPosition;
-	mRotation = other.mRotation;
-	mBoundingSphereRadius = other.mBoundingSphereRadius;
+	setParent( other.mParent );
+	setPosition( other.position() );
+	setRotation( other.rotation() );
+	setBoundingSphere( other.boundingSphereRadius() );
 	mSubNodes = other.mSubNodes;
-	mModelMatrixNeedsUpdate = other.mModelMatrixNeedsUpdate;
+	mConcurrentUpdate = other.mConcurrentUpdate;
+	mRenderPasses = other.mRenderPasses;
 	return *this;
 }
 
 
-void AObject::syncMatrix() const
+void AObject::setParent( AObject * parent )
 {
-	if( mParent )
-	{
-		mModelMatrix = mParent->modelMatrix();
-	} else {
-		mModelMatrix.setToIdentity();
-	}
-	mModelMatrix.translate( position() );
-	mModelMatrix.rotate( rotation() );
+	mParent = parent;
+	mTransforms->setParent( mTransform, mParent ? mParent->mTransform : -1 );
 }
 
 
 void AObject::update( const double & delta )
 {
-	syncMatrix();
 	updateSelf( delta );
-	QLinkedList< QSharedPointer<AObject> >::iterator i;
-	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
+	CommandBuffer * commands = mScene->commands();
+	QLinkedList< QSharedPointer<AObject> >::iterator i = mSubNodes.begin();
+	while( i != mSubNodes.end() )
 	{
-		(*i)->update( delta );
+		if( !(*i)->concurrentUpdate() || commands->recording() )
+		{
+			(*i)->update( delta );
+			++i;
+			continue;
+		}
+
+		// collect consecutive siblings which may be updated concurrently
+		QVector<UpdateJob> jobs;
+		for( ; i != mSubNodes.end() && (*i)->concurrentUpdate(); ++i )
+			jobs.append( UpdateJob( (*i).data(), delta ) );
+		QVector<JobSystem::AJob*> jobPointers( jobs.size() );
+		for( int j = 0; j < jobs.size(); ++j )
+			jobPointers[j] = &jobs[j];
+
+		// lazy matrix updates must not touch shared transformations while running concurrently -
+		// the workers start from propagated matrices and only validate the slots of their own objects
+		mTransforms->propagate();
+		mTransforms->setConcurrent( true );
+		commands->setRecording( true );
+		mScene->jobs()->run( jobPointers );
+		commands->setRecording( false );
+		mTransforms->setConcurrent( false );
+		commands->execute();
 	}
+	if( mSpatialIndex )
+		mSpatialIndex->refresh();
 	updateSelfPost( delta );
 }
 
@@ -114,8 +172,22 @@ void AObject::update2( const double & delta )
 }
 
 
+bool AObject::isSubNodeVisible( const AObject & subNode ) const
+{
+	if( subNode.boundingSphereRadius() <= FLT_EPSILON )	// zero radius -> no culling
+		return true;
+	if( !mFrustumTest.isSphereInFrustum( subNode.position(), subNode.boundingSphereRadius() ) )
+		return false;
+	// offscreen passes clip at the water surface - objects on the other side don't have to be drawn at all
+	return !mScene->eye()->isSphereClipped( subNode.worldPosition(), subNode.boundingSphereRadius() );
+}
+
+
 void AObject::draw()
 {
+	if( !isDrawnIn( RenderPass::current() ) )
+		return;
+
 	mModelViewMatrix = scene()->eye()->viewMatrix() * modelMatrix();
 	if( mSubNodes.size() )
 		mFrustumTest.sync( mScene->eye()->projectionMatrix(), mModelViewMatrix );
@@ -126,15 +198,8 @@ void AObject::draw()
 	QLinkedList< QSharedPointer<AObject> >::iterator i;
 	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
 	{
-		if( (*i)->boundingSphereRadius() > FLT_EPSILON )	// nonzero radius -> do frustum culling
-		{
-			if( mFrustumTest.isSphereInFrustum( (*i)->position(), (*i)->boundingSphereRadius() ) )
-			{
-				(*i)->draw();
-			}
-		} else {	// zero radius -> no frustum culling
+		if( isSubNodeVisible( **i ) )
 			(*i)->draw();
-		}
 	}
 
 	glLoadMatrix( mModelViewMatrix );
@@ -147,21 +212,17 @@ void AObject::draw()
 
 void AObject::draw2()
 {
+	if( !isDrawnIn( RenderPass::current() ) )
+		return;
+
 	glLoadMatrix( mModelViewMatrix );
 	draw2Self();
 
 	QLinkedList< QSharedPointer<AObject> >::iterator i;
 	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
 	{
-		if( (*i)->boundingSphereRadius() > FLT_EPSILON )	// nonzero radius -> do frustum culling
-		{
-			if( mFrustumTest.isSphereInFrustum( (*i)->position(), (*i)->boundingSphereRadius() ) )
-			{
-				(*i)->draw2();
-			}
-		} else {	// zero radius -> no frustum culling
+		if( isSubNodeVisible( **i ) )
 			(*i)->draw2();
-		}
 	}
 
 	glLoadMatrix( mModelViewMatrix );
@@ -169,12 +230,28 @@ void AObject::draw2()
 }
 
 
+void AObject::syncModelView()
+{
+	mModelViewMatrix = scene()->eye()->viewMatrix() * modelMatrix();
+	if( mSubNodes.size() )
+		mFrustumTest.sync( mScene->eye()->projectionMatrix(), mModelViewMatrix );
+
+	QLinkedList< QSharedPointer<AObject> >::iterator i;
+	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
+	{
+		(*i)->syncModelView();
+	}
+}
+
+
 void AObject::add( QSharedPointer<AObject> other )
 {
 	if( other->parent() )
 		other->parent()->remove( other );
 	mSubNodes.append( other );
 	other->setParent( this );
+	if( mSpatialIndex )
+		mSpatialIndex->insert( other.data() );
 }
 
 
@@ -182,12 +259,24 @@ void AObject::remove( QSharedPointer<AObject> other )
 {
 	other->setParent( 0 );
 	mSubNodes.removeOne( other );
+	if( mSpatialIndex )
+		mSpatialIndex->erase( other.data() );
+}
+
+
+void AObject::enableSpatialIndex( float cellSize )
+{
+	delete mSpatialIndex;
+	mSpatialIndex = new SpatialIndex( cellSize );
+	QLinkedList< QSharedPointer<AObject> >::iterator i;
+	for( i = mSubNodes.begin(); i != mSubNodes.end(); ++i )
+		mSpatialIndex->insert( (*i).data() );
 }
 
 
 void AObject::drawBoundingShpere()
 {
-	if( mBoundingSphereRadius <= FLT_EPSILON )
+	if( boundingSphereRadius() <= FLT_EPSILON )
 		return;
 	GLUquadric * q = gluNewQuadric();
 	glPushAttrib( GL_POLYGON_BIT | GL_LIGHTING_BIT | GL_ENABLE_BIT );
@@ -195,7 +284,7 @@ void AObject::drawBoundingShpere()
 	glDisable( GL_LIGHTING );
 	glColor3f( 1, 1, 1 );
 	glDisable( GL_CULL_FACE );
-	gluSphere( q, mBoundingSphereRadius, 16, 16 );
+	gluSphere( q, boundingSphereRadius(), 16, 16 );
 	glEnable( GL_CULL_FACE );
 	glPopAttrib();
 	gluDeleteQuadric( q );
@@ -205,6 +294,9 @@ void AObject::drawBoundingShpere()
 const AObject * AObject::intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
 	float & length, QVector3D * normal ) const
 {
+	if( mSpatialIndex )
+		return mSpatialIndex->intersectLine( exclude, origin, direction, length, normal );
+
 	const AObject * nearestTarget = NULL;
 	QLinkedList< QSharedPointer<AObject> >::const_iterator i;
 	for( i = mSubNodes.constBegin(); i != mSubNodes.constEnd(); ++i )
@@ -220,17 +312,59 @@ const AObject * AObject::intersectLine( const AObject * exclude, const QVector3D
 }
 
 
+void AObject::intersectLines( const AObject * exclude, Ray * rays, int count ) const
+{
+	if( mSpatialIndex )
+	{
+		mSpatialIndex->intersectLines( exclude, rays, count );
+		return;
+	}
+
+	QLinkedList< QSharedPointer<AObject> >::const_iterator i;
+	for( i = mSubNodes.constBegin(); i != mSubNodes.constEnd(); ++i )
+	{
+		if( (*i).data() != exclude )
+			(*i)->intersectLines( exclude, rays, count );
+	}
+}
+
+
+void AObject::intersectLinesSeparately( const AObject * exclude, Ray * rays, int count ) const
+{
+	for( int i = 0; i < count; ++i )
+	{
+		const AObject * target = intersectLine( exclude, rays[i].origin, rays[i].direction, rays[i].length, &rays[i].normal );
+		if( target )
+			rays[i].target = target;
+	}
+}
+
+
 QVector<const AObject*> AObject::collideSphere( const AObject * exclude, const float & radius,
 	QVector3D & center, QVector3D * normal ) const
 {
 	QVector<const AObject*> collisions;
+	CollisionVector visitor( collisions );
+	visitSphereCollisions( exclude, radius, center, normal, visitor );
+	return collisions;
+}
+
+
+void AObject::visitSphereCollisions( const AObject * exclude, const float & radius,
+	QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
+{
+	if( mSpatialIndex )
+	{
+		mSpatialIndex->visitSphereCollisions( exclude, radius, center, normal, visitor );
+		return;
+	}
+
 	QLinkedList< QSharedPointer<AObject> >::const_iterator i;
 	for( i = mSubNodes.constBegin(); i != mSubNodes.constEnd(); ++i )
 	{
 		if( (*i).data() != exclude )
-			collisions << ((*i)->collideSphere( exclude, radius, center, normal ));
+			(*i)->visitSphereCollisions( exclude, radius, center, normal, visitor );
 	}
-	return collisions;
 }
 
 
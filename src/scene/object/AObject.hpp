@@ -33,10 +33,16 @@
 #include <QLinkedList>
 #include <QSharedPointer>
 
+#include "ACollisionVisitor.hpp"
+
+#include <scene/TransformHierarchy.hpp>
+#include <scene/RenderPass.hpp>
 #include <utility/FrustumTest.hpp>
+#include <utility/Ray.hpp>
 
 
 class Scene;
+class SpatialIndex;
 
 
 /// Abstract object in a scene
@@ -61,8 +67,8 @@ class Scene;
  *     10. draw2Self()
  *     11. (draw subnodes - second pass)
  *     12. draw2SelfPost()
- * Each object tracks its own model transformation matrix and synchronizes it with
- * it's parent object on each update( const double & delta ) call.\n
+ * The transformation of each object is stored in the scene's TransformHierarchy.
+ * The model matrix is recalculated on demand and only if the object or one of its parents moved.\n
  * Changes in position/orientation are only allowed in an update pass.
  */
 class AObject
@@ -78,11 +84,15 @@ public:
 	AObject & operator=( const AObject & other );
 
 	/// Transform a vector from local object space to world space
-	const QVector4D toWorld( const QVector4D & v ) const { validateMatrix(); return mModelMatrix * v; }
+	const QVector4D toWorld( const QVector4D & v ) const { return modelMatrix() * v; }
 	/// Transform a point vectorfrom local object space to world space
-	const QVector3D pointToWorld( const QVector3D & v ) const { validateMatrix(); return (mModelMatrix * QVector4D(v,1)).toVector3D(); }
+	const QVector3D pointToWorld( const QVector3D & v ) const { return (modelMatrix() * QVector4D(v,1)).toVector3D(); }
 	/// Transform a direction vector from local object space to world space
-	const QVector3D directionToWorld( const QVector3D & v ) const { validateMatrix(); return (mModelMatrix * QVector4D(v,0)).toVector3D(); }
+	const QVector3D directionToWorld( const QVector3D & v ) const { return (modelMatrix() * QVector4D(v,0)).toVector3D(); }
+	/// Transform a point vector from world space to local object space - transformations are rigid, so distances are kept
+	const QVector3D pointToLocal( const QVector3D & v ) const { return directionToLocal( v - worldPosition() ); }
+	/// Transform a direction vector from world space to local object space (multiplies with the transposed rotation)
+	const QVector3D directionToLocal( const QVector3D & v ) const { return (QVector4D(v,0) * modelMatrix()).toVector3D(); }
 
 	/// Returns the transformation matrix to eye space - only valid while drawing
 	const QMatrix4x4 & modelViewMatrix() const { return mModelViewMatrix; }
@@ -96,46 +106,50 @@ public:
 	const QVector3D eyeDirection() const { return mModelViewMatrix.row(2).toVector3D(); }
 
 	/// Returns the transformation matrix to world space
-	const QMatrix4x4 & modelMatrix() const { validateMatrix(); return mModelMatrix; }
+	/**
+	 * The transformations live in the scene's TransformHierarchy whose arrays get reallocated
+	 * whenever objects are added or reordered, so this returns a copy instead of a reference.
+	 */
+	const QMatrix4x4 modelMatrix() const { return mTransforms->worldMatrix( mTransform ); }
 	/// The object's position in world space
-	const QVector3D worldPosition() const { validateMatrix(); return mModelMatrix.column(3).toVector3D(); }
+	const QVector3D worldPosition() const { return modelMatrix().column(3).toVector3D(); }
 	/// Returns the vector in world space pointing along the positive local X axis
-	const QVector3D worldLeft() const { validateMatrix(); return mModelMatrix.column(0).toVector3D(); }
+	const QVector3D worldLeft() const { return modelMatrix().column(0).toVector3D(); }
 	/// Returns the vector in world space pointing along the positive local Y axis
-	const QVector3D worldUp() const { validateMatrix(); return mModelMatrix.column(1).toVector3D(); }
+	const QVector3D worldUp() const { return modelMatrix().column(1).toVector3D(); }
 	/// Returns the vector in world space pointing along the positive local Z axis
-	const QVector3D worldDirection() const { validateMatrix(); return mModelMatrix.column(2).toVector3D(); }
+	const QVector3D worldDirection() const { return modelMatrix().column(2).toVector3D(); }
 
 	/// Returns the vector pointing along the positive local X axis
-	const QVector3D left() const { return mRotation.rotatedVector(QVector3D(1,0,0)); }
+	const QVector3D left() const { return rotation().rotatedVector(QVector3D(1,0,0)); }
 	/// Returns the vector pointing along the positive local Y axis
-	const QVector3D up() const { return mRotation.rotatedVector(QVector3D(0,1,0)); }
+	const QVector3D up() const { return rotation().rotatedVector(QVector3D(0,1,0)); }
 	/// Returns the vector pointing along the positive local Z axis
-	const QVector3D direction() const { return mRotation.rotatedVector(QVector3D(0,0,1)); }
+	const QVector3D direction() const { return rotation().rotatedVector(QVector3D(0,0,1)); }
 
 	/// Adds a vector to the local position
-	void move( const QVector3D & distance ) { mPosition += distance; mModelMatrixNeedsUpdate = true; }
+	void move( const QVector3D & distance ) { setPosition( position() + distance ); }
 	/// Adds a scalar to the local position on the X axis
-	void moveX( const qreal & x ) { mPosition.setX(mPosition.x()+x); mModelMatrixNeedsUpdate = true; }
+	void moveX( const qreal & x ) { QVector3D p = position(); p.setX(p.x()+x); setPosition( p ); }
 	/// Adds a scalar to the local position on the Y axis
-	void moveY( const qreal & y ) { mPosition.setY(mPosition.y()+y); mModelMatrixNeedsUpdate = true; }
+	void moveY( const qreal & y ) { QVector3D p = position(); p.setY(p.y()+y); setPosition( p ); }
 	/// Adds a scalar to the local position on the Z axis
-	void moveZ( const qreal & z ) { mPosition.setZ(mPosition.z()+z); mModelMatrixNeedsUpdate = true; }
+	void moveZ( const qreal & z ) { QVector3D p = position(); p.setZ(p.z()+z); setPosition( p ); }
 	/// Sets the local position
-	void setPosition( const QVector3D & position ) { mPosition = position; mModelMatrixNeedsUpdate = true; }
+	void setPosition( const QVector3D & position ) { mTransforms->setPosition( mTransform, position ); }
 	/// Sets the local position on the X axis
-	void setPositionX( const qreal & x ) { mPosition.setX(x); mModelMatrixNeedsUpdate = true; }
+	void setPositionX( const qreal & x ) { QVector3D p = position(); p.setX(x); setPosition( p ); }
 	/// Sets the local position on the Y axis
-	void setPositionY( const qreal & y ) { mPosition.setY(y); mModelMatrixNeedsUpdate = true; }
+	void setPositionY( const qreal & y ) { QVector3D p = position(); p.setY(y); setPosition( p ); }
 	/// Sets the local position on the Z axis
-	void setPositionZ( const qreal & z ) { mPosition.setZ(z); mModelMatrixNeedsUpdate = true; }
+	void setPositionZ( const qreal & z ) { QVector3D p = position(); p.setZ(z); setPosition( p ); }
 	/// Sets the local rotation
-	void setRotation( const QQuaternion & rotation ) { mRotation = rotation; mModelMatrixNeedsUpdate = true; }
+	void setRotation( const QQuaternion & rotation ) { mTransforms->setRotation( mTransform, rotation ); }
 
 	/// The object's local position
-	const QVector3D & position() const { return mPosition; }
+	const QVector3D position() const { return mTransforms->position( mTransform ); }
 	/// The object's local rotation
-	const QQuaternion & rotation() const { return mRotation; }
+	const QQuaternion rotation() const { return mTransforms->rotation( mTransform ); }
 
 	/// Add a child to this object
 	void add( QSharedPointer<AObject> other );
@@ -148,8 +162,28 @@ public:
 	/// Returns all child objects
 	QLinkedList< QSharedPointer<AObject> > & subNodes() { return mSubNodes; }
 
+	/// Allows updating this object concurrently to its siblings
+	/**
+	 * Consecutive siblings with this flag set are updated in parallel using the scene's JobSystem.
+	 * Their update passes may only modify their own state and have to defer any other modification
+	 * to the scene's CommandBuffer while it is recording.
+	 */
+	void setConcurrentUpdate( bool enable ) { mConcurrentUpdate = enable; }
+	/// Returns true if this object may be updated concurrently to its siblings
+	bool concurrentUpdate() const { return mConcurrentUpdate; }
+
+	/// Selects the passes this object and all of it's sub-objects are drawn in
+	/**
+	 * @param passes Combination of RenderPass::Mask bits - all passes by default.
+	 */
+	void setRenderPasses( int passes ) { mRenderPasses = passes; }
+	/// Returns the RenderPass::Mask bits of the passes this object is drawn in
+	int renderPasses() const { return mRenderPasses; }
+	/// Returns true if this object is drawn in the given pass
+	bool isDrawnIn( const RenderPass::Type & pass ) const { return mRenderPasses & (1 << pass); }
+
 	/// Returns the bounding sphere
-	const float & boundingSphereRadius() const { return mBoundingSphereRadius; }
+	float boundingSphereRadius() const { return mTransforms->radius( mTransform ); }
 
 	/// Recursively intersect a line with an object and the object's objects
 	/**
@@ -163,18 +197,46 @@ public:
 	virtual const AObject * intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
 		float & length, QVector3D * normal = NULL ) const;
 
+	/// Recursively intersect multiple lines with an object and the object's objects
+	/**
+	 * Candidate objects are only looked up once for the whole batch.
+	 * Objects with own geometry should override this method - intersectLinesSeparately() provides a fallback.
+	 * @param exclude Exclude this object and all subordinates - NULL to disable exclusion.
+	 * @param rays Each ray's length, normal and target are updated on intersection.
+	 * @param count Number of rays.
+	 */
+	virtual void intersectLines( const AObject * exclude, Ray * rays, int count ) const;
+
 	/// Recursively collision-test a sphere with an object and the object's objects
 	/**
+	 * Convenience wrapper collecting the results of visitSphereCollisions() in a newly allocated vector.
+	 * Not virtual - objects implement their collisions by overriding visitSphereCollisions().
 	 * @param exclude Exclude this object and all subordinates - NULL to disable exclusion.
 	 * @param radius The radius of the sphere.
 	 * @param center The center of the sphere - if an intersection occurs, this will be set to a nonintersecting position.
 	 * @param normal Optionally return surface normal.
 	 */
-	virtual QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius,
+	QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius,
 		QVector3D & center, QVector3D * normal = NULL ) const;
 
+	/// Recursively collision-test a sphere with an object and the object's objects without allocating memory
+	/**
+	 * Objects implementing collisions override this method and call the base implementation
+	 * to visit their subordinated objects.
+	 * @param exclude Exclude this object and all subordinates - NULL to disable exclusion.
+	 * @param radius The radius of the sphere.
+	 * @param center The center of the sphere - if an intersection occurs, this will be set to a nonintersecting position.
+	 * @param normal Optionally return surface normal.
+	 * @param visitor Receives every colliding object.
+	 */
+	virtual void visitSphereCollisions( const AObject * exclude, const float & radius,
+		QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const;
+
 	/// Updates this object and all of it's sub-objects
-	void update( const double & delta );
+	/**
+	 * May be overridden to hold back updates - the delta of skipped ticks has to be passed on later then.
+	 */
+	virtual void update( const double & delta );
 	/// Abstract method for updating this object
 	virtual void updateSelf( const double & delta ) {}
 	/// Executed after all sub-objects are updated
@@ -201,36 +263,42 @@ public:
 	/// Executed after all sub-objects are drawn (second pass)
 	virtual void draw2SelfPost() {}
 
+	/// Recalculates the eye space matrices and frustum tests of this object and all of it's sub-objects
+	/**
+	 * Offscreen passes started while drawing (e.g. water reflections) leave them behind for their own eye.
+	 */
+	void syncModelView();
+
 	/// Causes all objects to draw the bounding sphere
 	static void setGlobalDebugBoundingSpheres( bool enable ) { sDebugBoundingSpheres = enable; }
 
 protected:
 	/// Set bounding sphere radius for frustum culling
-	void setBoundingSphere( const float & radius ) { mBoundingSphereRadius = radius; }
+	void setBoundingSphere( const float & radius ) { mTransforms->setRadius( mTransform, radius ); }
+	/// Keeps the subordinated objects in a SpatialIndex so intersectLine() and visitSphereCollisions() only visit nearby objects
+	void enableSpatialIndex( float cellSize );
 	/// Draws the bounding sphere as wireframe (for debugging)
 	void drawBoundingShpere();
+	/// Adapter intersecting each ray using intersectLine()
+	void intersectLinesSeparately( const AObject * exclude, Ray * rays, int count ) const;
 
 private:
 	static bool sDebugBoundingSpheres;
 	Scene * mScene;
 	AObject * mParent;
-	QVector3D mPosition;
-	QQuaternion mRotation;
-	float mBoundingSphereRadius;
+	/// The scene's transformation storage
+	TransformHierarchy * mTransforms;
+	/// Handle to this object's transformation
+	int mTransform;
 	QLinkedList< QSharedPointer<AObject> > mSubNodes;
+	bool mConcurrentUpdate;
+	int mRenderPasses;
+	SpatialIndex * mSpatialIndex;
 	FrustumTest mFrustumTest;
 	QMatrix4x4 mModelViewMatrix;
 
-	/// Precalculated model matrix
-	mutable QMatrix4x4 mModelMatrix;
-	/// Set to true if this object's position/orientation changed
-	mutable bool mModelMatrixNeedsUpdate;
-	/// Synchronizes matrix to current position and rotation
-	void syncMatrix() const;
-	/// Synchronizes matrix to current position and rotation if necessary
-	void validateMatrix() const { if( mModelMatrixNeedsUpdate ) { syncMatrix(); mModelMatrixNeedsUpdate = false; } }
-
-	void setParent( AObject * parent ) { mParent = parent; }
+	void setParent( AObject * parent );
+	bool isSubNodeVisible( const AObject & subNode ) const;
 };
 
 
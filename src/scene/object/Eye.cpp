@@ -160,6 +160,20 @@ void Eye::disableClippingPlanes()
 }
 
 
+bool Eye::isSphereClipped( const QVector3D & center, float radius ) const
+{
+	QMap<int,QVector4D>::const_iterator i = mClippingPlanes.constBegin();
+	while( i != mClippingPlanes.constEnd() )
+	{
+		const QVector4D & plane = i.value();
+		if( QVector3D::dotProduct( plane.toVector3D(), center ) + plane.w() < -radius * plane.toVector3D().length() )
+			return true;
+		++i;
+	}
+	return false;
+}
+
+
 void Eye::attach( QWeakPointer< AObject > object )
 {
 	mAttached = object;
@@ -85,6 +85,8 @@ public:
 	void enableClippingPlanes();
 	/// Disables all defined clipping planes.
 	void disableClippingPlanes();
+	/// Returns true if a sphere in world space lies completely behind one of the clipping planes.
+	bool isSphereClipped( const QVector3D & center, float radius ) const;
 
 	/// Sets the position
 	void setPosition( const QVector3D & position ) { mPosition = position; }
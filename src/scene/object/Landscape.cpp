@@ -36,22 +36,69 @@
 #include <geometry/Terrain.hpp>
 
 #include <resource/Material.hpp>
+#include <resource/TerrainMaterial.hpp>
 #include <resource/Shader.hpp>
+#include <utility/CommandBuffer.hpp>
 
 #include <QString>
 #include <QSettings>
 #include <QGLShaderProgram>
+#include <QtAlgorithms>
+
+#include <math.h>
+#include <float.h>
 
 
 int Landscape::Blob::sQuality = 0;
 
 
+/// Deferred call to Landscape::deform
+class LandscapeDeformCommand : public CommandBuffer::ACommand
+{
+public:
+	LandscapeDeformCommand( Landscape * landscape, const QVector3D & center, float radius, float depth ) :
+		mLandscape( landscape ), mCenter( center ), mRadius( radius ), mDepth( depth ) {}
+	virtual void execute() { mLandscape->deform( mCenter, mRadius, mDepth ); }
+private:
+	Landscape * mLandscape;
+	QVector3D mCenter;
+	float mRadius;
+	float mDepth;
+};
+
+
+/// A blob as described in landscape.ini
+struct BlobSettings
+{
+	QRect rect;
+	QString material;
+	QVector2D materialScale;
+	int priority;
+	QString maskPath;
+};
+
+
+static bool higherPriority( const BlobSettings & a, const BlobSettings & b )
+{
+	return a.priority > b.priority;
+}
+
+
 Landscape::Landscape( World * world, QString name ) :
 	AWorldObject( world )
 {
 	mName = name;
 	mDrawingReflection = false;
 	mDrawingRefraction = false;
+	mWaterFrame = 0;
+	mEyeAboveWater = true;
+	mWaterOccluded = false;
+	mWaterQueried = false;
+	mReflectionOutdated = true;
+	mRefractionOutdated = true;
+
+	// vegetation groups and power ups are static - a coarse grid is sufficient
+	enableSpatialIndex( 128.0f );
 
 	QSettings s( "./data/landscape/"+name+"/landscape.ini", QSettings::IniFormat );
 
@@ -73,14 +120,19 @@ Landscape::Landscape( World * world, QString name ) :
 			s.value( "materialScaleT", 1.0f ).toFloat()
 		);
 		int smoothingPasses = s.value( "smoothingPasses", 1 ).toInt();
+		mTerrainPixelError = s.value( "pixelError", 4.0f ).toFloat();
+		int tileRadius = s.value( "tileRadius", 0 ).toInt();
 	s.endGroup();
-	mTerrain = new Terrain( "./data/landscape/"+name+'/'+heightMapPath, mTerrainSize, mTerrainOffset, smoothingPasses );
-	mTerrainFilter = new Filter( this, QSize( 3, 3 ) );
+	mTerrain = new Terrain( "./data/landscape/"+name+'/'+heightMapPath, mTerrainSize, mTerrainOffset, smoothingPasses, scene()->jobs(), tileRadius );
 	mTerrainMaterial = new Material( scene()->glWidget(), terrainMaterial );
 
 	s.beginGroup( "Water" );
 		mWaterHeight = s.value( "height", 0.0f ).toFloat();
 		mWaterClippingPlaneOffset = s.value( "clippingPlaneOffset", 0.01f ).toFloat();
+		int waterResolution = s.value( "resolution", 512 ).toInt();
+		mWaterMinimumResolution = qMin( s.value( "minimumResolution", 128 ).toInt(), waterResolution );
+		mWaterUpdateInterval = qMax( s.value( "updateInterval", 2 ).toInt(), 1 );
+		mWaterStaggerUpdates = s.value( "staggerUpdates", true ).toBool();
 	s.endGroup();
 	mWaterShader = new Shader( scene()->glWidget(), "water" );
 	QImage waterImage( "./data/landscape/"+name+'/'+"water.png" );
@@ -89,27 +141,58 @@ Landscape::Landscape( World * world, QString name ) :
 		qFatal( "\"%s\" not found!", qPrintable("./data/landscape/"+name+'/'+"water.png") );
 	}
 	mWaterMap = scene()->glWidget()->bindTexture( waterImage );
-	mReflectionRenderer = new TextureRenderer( scene()->glWidget(), QSize(512,512), true );
-	mRefractionRenderer = new TextureRenderer( scene()->glWidget(), QSize(512,512), true );
+	mReflectionRenderer = new TextureRenderer( scene()->glWidget(), QSize(waterResolution,waterResolution), true );
+	mRefractionRenderer = new TextureRenderer( scene()->glWidget(), QSize(waterResolution,waterResolution), true );
+	mReflectionViewport = mReflectionRenderer->size();
+	mRefractionViewport = mRefractionRenderer->size();
+	glGenQueries( 1, &mWaterQuery );
 
+	QList<BlobSettings> blobs;
 	int blobNum = s.beginReadArray( "Blob" );
 		for( int i=0; i<blobNum; i++ )
 		{
 			s.setArrayIndex( i );
-			Blob * b = new Blob( this,
-				s.value("rect").toRect(),
-				s.value("material").toString(),
-				QVector2D(
-					s.value( "materialScaleS", 1.0f ).toFloat(),
-					s.value( "materialScaleT", 1.0f ).toFloat()
-				),
-				s.value("priority").toInt(),
-				"./data/landscape/"+name+'/'+s.value("maskPath").toString()
+			BlobSettings b;
+			b.rect = s.value("rect").toRect();
+			b.material = s.value("material").toString();
+			b.materialScale = QVector2D(
+				s.value( "materialScaleS", 1.0f ).toFloat(),
+				s.value( "materialScaleT", 1.0f ).toFloat()
 			);
-			mBlobs.append( b );
+			b.priority = s.value("priority").toInt();
+			b.maskPath = "./data/landscape/"+name+'/'+s.value("maskPath").toString();
+			blobs.append( b );
 		}
 	s.endArray();
 
+	// blobs are drawn by descending priority - lower quality settings skip the last ones
+	qStableSort( blobs.begin(), blobs.end(), higherPriority );
+	mTerrainLayers = new TerrainMaterial( scene()->glWidget(), terrainMaterial, QVector2D( mTerrainMaterialScale.x(), -mTerrainMaterialScale.y() ), mTerrain->mapSize() );
+	for( int i = 0; i < blobs.size(); ++i )
+	{
+		const BlobSettings & b = blobs[i];
+		// successive blobs sharing material and priority only add their mask to the same layer
+		const bool sameLayer = i > 0 && mBlobs.isEmpty() && mTerrainLayers->layers() > 1 &&
+			blobs[i-1].material == b.material && blobs[i-1].materialScale == b.materialScale && blobs[i-1].priority == b.priority;
+		if( mBlobs.isEmpty() && ( sameLayer || mTerrainLayers->canAddLayer() ) )
+		{
+			QImage mask( b.maskPath );
+			if( mask.isNull() )
+			{
+				qFatal( "BlobMap from file \"%s\" could not be loaded!", b.maskPath.toLocal8Bit().constData() );
+			}
+			if( !sameLayer )
+			{
+				mTerrainLayers->addLayer( b.material, QVector2D( b.materialScale.x(), -b.materialScale.y() ) );
+				mTerrainLayerPriorities.append( b.priority );
+			}
+			mTerrainLayers->addMask( mask, b.rect );
+		} else {
+			// out of texture units - keep the order by drawing all following blobs in passes of their own
+			mBlobs.append( new Blob( this, b.rect, b.material, b.materialScale, b.priority, b.maskPath ) );
+		}
+	}
+
 	int vegeNum = s.beginReadArray( "Vegetation" );
 		for( int i=0; i<vegeNum; i++ )
 		{
@@ -120,7 +203,8 @@ Landscape::Landscape( World * world, QString name ) :
 			{
 				f = QSharedPointer<AObject>( new Forest( this,
 					s.value("model").toString(), s.value("position").toPoint(),
-					s.value("radius").toInt(), s.value("number").toInt(), s.value("priority").toInt() ) );
+					s.value("radius").toInt(), s.value("number").toInt(), s.value("priority").toInt(),
+					s.value("impostorDistance", 150.0f).toFloat(), s.value("impostorFade", 30.0f).toFloat() ) );
 			}
 			else if( type == "grass" )
 			{
@@ -165,17 +249,30 @@ Landscape::~Landscape()
 		delete mBlobs[i];
 	}
 	delete mTerrain;
-	delete mTerrainFilter;
 	delete mTerrainMaterial;
+	delete mTerrainLayers;
 	delete mReflectionRenderer;
 	delete mRefractionRenderer;
 	delete mWaterShader;
+	glDeleteQueries( 1, &mWaterQuery );
 }
 
 
 void Landscape::updateSelf( const double & delta )
 {
-	mTerrainFilter->update();
+}
+
+
+void Landscape::deform( const QVector3D & center, float radius, float depth )
+{
+	if( mTerrain->isPaged() )
+		return;
+	if( scene()->commands()->recording() )
+	{
+		scene()->commands()->push( new LandscapeDeformCommand( this, center, radius, depth ) );
+		return;
+	}
+	mTerrain->applyBrush( center, radius, depth, Terrain::BRUSH_SPHERE );
 }
 
 
@@ -186,7 +283,15 @@ void Landscape::drawSelf()
 
 void Landscape::drawSelfPost()
 {
-	mTerrainFilter->draw();
+	// mirrored passes reuse the detail levels of the main view
+	if( !mDrawingReflection && !mDrawingRefraction )
+		updateTerrainLevelOfDetail();
+
+	// every pass has its own frustum - the visible chunks are reused by the blobs and splatters drawn afterwards
+	FrustumTest frustumTest;
+	frustumTest.sync();
+	mTerrain->cull( frustumTest );
+	drawPatch( QRectF( mTerrainOffset.x(), mTerrainOffset.z(), mTerrainSize.x(), mTerrainSize.z() ) );
 
 	mTerrainMaterial->bind();
 	drawInfinitePlane( mTerrainOffset.y() );
@@ -194,6 +299,23 @@ void Landscape::drawSelfPost()
 }
 
 
+void Landscape::updateTerrainLevelOfDetail()
+{
+	if( mTerrainPixelError <= 0.0f )
+	{
+		// always draw at full resolution - paged terrains still have to follow the eye
+		if( mTerrain->isPaged() )
+			mTerrain->updateLevelOfDetail( scene()->eye()->position(), FLT_MAX );
+		return;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv( GL_VIEWPORT, viewport );
+	float errorScale = (float)viewport[3] / ( 2.0f * tanf( scene()->eye()->fov() * (float)M_PI / 360.0f ) * mTerrainPixelError );
+	mTerrain->updateLevelOfDetail( scene()->eye()->position(), errorScale );
+}
+
+
 void Landscape::drawInfinitePlane( const float & height )
 {
 	QVector2D groundPlaneFrom
@@ -223,10 +345,121 @@ void Landscape::drawInfinitePlane( const float & height )
 }
 
 
-void Landscape::renderReflection()
+float Landscape::waterCoverage( const QMatrix4x4 & modelViewProjection )
+{
+	// the water plane as drawn by drawInfinitePlane() in clip space
+	const QVector3D & eye = scene()->eye()->position();
+	const float & farPlane = scene()->eye()->farPlane();
+	QVector<QVector4D> polygon;
+	polygon.append( modelViewProjection * QVector4D( eye.x()-farPlane, mWaterHeight, eye.z()+farPlane, 1.0f ) );
+	polygon.append( modelViewProjection * QVector4D( eye.x()+farPlane, mWaterHeight, eye.z()+farPlane, 1.0f ) );
+	polygon.append( modelViewProjection * QVector4D( eye.x()+farPlane, mWaterHeight, eye.z()-farPlane, 1.0f ) );
+	polygon.append( modelViewProjection * QVector4D( eye.x()-farPlane, mWaterHeight, eye.z()-farPlane, 1.0f ) );
+
+	// clip it against the frustum planes: -w <= x,y,z <= w
+	static const QVector4D clipPlanes[6] =
+	{
+		QVector4D( 1, 0, 0, 1 ), QVector4D(-1, 0, 0, 1 ),
+		QVector4D( 0, 1, 0, 1 ), QVector4D( 0,-1, 0, 1 ),
+		QVector4D( 0, 0, 1, 1 ), QVector4D( 0, 0,-1, 1 )
+	};
+	for( int p = 0; p < 6; p++ )
+	{
+		QVector<QVector4D> clipped;
+		for( int i = 0; i < polygon.size(); i++ )
+		{
+			const QVector4D & a = polygon[i];
+			const QVector4D & b = polygon[(i+1)%polygon.size()];
+			float distanceA = QVector4D::dotProduct( clipPlanes[p], a );
+			float distanceB = QVector4D::dotProduct( clipPlanes[p], b );
+			if( distanceA >= 0.0f )
+				clipped.append( a );
+			if( (distanceA >= 0.0f) != (distanceB >= 0.0f) )
+				clipped.append( a + (b-a) * (distanceA/(distanceA-distanceB)) );
+		}
+		polygon = clipped;
+		if( polygon.size() < 3 )
+			return 0.0f;
+	}
+
+	// area in normalized device coordinates - the whole screen is 2x2
+	float area = 0.0f;
+	for( int i = 0; i < polygon.size(); i++ )
+	{
+		const QVector4D & a = polygon[i];
+		const QVector4D & b = polygon[(i+1)%polygon.size()];
+		area += (a.x()/a.w()) * (b.y()/b.w()) - (b.x()/b.w()) * (a.y()/a.w());
+	}
+	return qMin( fabsf( area ) * 0.5f / 4.0f, 1.0f );
+}
+
+
+QSize Landscape::waterViewport( const float & coverage ) const
+{
+	// small puddles at the border of the screen don't need sharp reflections
+	const int maximum = mReflectionRenderer->size().width();
+	int resolution = (int)ceilf( maximum * sqrtf( coverage ) / 32.0f ) * 32;	// steps of 32 pixels keep the viewport from changing every frame
+	resolution = qBound( mWaterMinimumResolution, resolution, maximum );
+	return QSize( resolution, resolution );
+}
+
+
+void Landscape::updateWaterMaps( const QMatrix4x4 & modelViewProjection, const float & coverage )
+{
+	mWaterFrame++;
+
+	if( mWaterOccluded )
+	{
+		// render both maps as soon as the water shows up again
+		mReflectionOutdated = true;
+		mRefractionOutdated = true;
+		return;
+	}
+
+	// reflection and refraction are clipped at the other side of the surface when the eye dives through it
+	const bool eyeAboveWater = scene()->eye()->position().y() > mWaterHeight;
+	if( eyeAboveWater != mEyeAboveWater )
+	{
+		mEyeAboveWater = eyeAboveWater;
+		mReflectionOutdated = true;
+		mRefractionOutdated = true;
+	}
+
+	const int phase = mWaterFrame % mWaterUpdateInterval;
+	const bool updateReflection = mReflectionOutdated || phase == 0;
+	const bool updateRefraction = mRefractionOutdated || phase == ( mWaterStaggerUpdates ? mWaterUpdateInterval/2 : 0 );
+	if( !updateReflection && !updateRefraction )
+		return;
+
+	const QSize viewport = waterViewport( coverage );
+	MaterialQuality::Type defaultQuality = MaterialQuality::maximum();
+	MaterialQuality::setMaximum( MaterialQuality::LOW );
+	if( updateReflection )
+	{
+		renderReflection( viewport );
+		mReflectionMatrix = modelViewProjection;
+		mReflectionViewport = viewport;
+		mReflectionOutdated = false;
+	}
+	if( updateRefraction )
+	{
+		renderRefraction( viewport );
+		mRefractionMatrix = modelViewProjection;
+		mRefractionViewport = viewport;
+		mRefractionOutdated = false;
+	}
+	MaterialQuality::setMaximum( defaultQuality );
+
+	// the passes leave the scene graph behind for their own eye
+	scene()->root()->syncModelView();
+}
+
+
+void Landscape::renderReflection( const QSize & viewport )
 {
 	mDrawingReflection = true;
-	mReflectionRenderer->bind();
+	RenderPass::setCurrent( RenderPass::REFLECTION );
+	mReflectionRenderer->bind( viewport );
 	glClear( GL_DEPTH_BUFFER_BIT );
 	glMatrixMode( GL_PROJECTION );	glPushMatrix();	glLoadIdentity();
 	glMatrixMode( GL_MODELVIEW );	glPushMatrix();	glLoadIdentity();
@@ -260,14 +493,16 @@ void Landscape::renderReflection()
 	glMatrixMode( GL_PROJECTION ); glPopMatrix();
 	glMatrixMode( GL_MODELVIEW ); glPopMatrix();
 	mReflectionRenderer->release();
+	RenderPass::setCurrent( RenderPass::MAIN );
 	mDrawingReflection = false;
 }
 
 
-void Landscape::renderRefraction()
+void Landscape::renderRefraction( const QSize & viewport )
 {
 	mDrawingRefraction = true;
-	mRefractionRenderer->bind();
+	RenderPass::setCurrent( RenderPass::REFRACTION );
+	mRefractionRenderer->bind( viewport );
 	glClear( GL_DEPTH_BUFFER_BIT );
 	glMatrixMode( GL_PROJECTION );	glPushMatrix();	glLoadIdentity();
 	glMatrixMode( GL_MODELVIEW );	glPushMatrix();	glLoadIdentity();
@@ -285,6 +520,7 @@ void Landscape::renderRefraction()
 	glMatrixMode( GL_PROJECTION );	glPopMatrix();
 	glMatrixMode( GL_MODELVIEW );	glPopMatrix();
 	mRefractionRenderer->release();
+	RenderPass::setCurrent( RenderPass::MAIN );
 	mDrawingRefraction = false;
 }
 
@@ -294,12 +530,34 @@ void Landscape::draw2SelfPost()
 	if( mDrawingReflection || mDrawingRefraction )
 		return;
 
-	MaterialQuality::Type defaultQuality = MaterialQuality::maximum();
-	MaterialQuality::setMaximum( MaterialQuality::LOW );
-	renderReflection();
-	renderRefraction();
-	MaterialQuality::setMaximum( defaultQuality );
+	// the samples of the water surface drawn in an earlier frame tell whether it is hidden behind the terrain -
+	// waiting for the result would stall the pipeline, so the last state is kept until it is available
+	if( mWaterQueried )
+	{
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv( mWaterQuery, GL_QUERY_RESULT_AVAILABLE, &available );
+		if( available )
+		{
+			GLuint sampleCount = 0;
+			glGetQueryObjectuiv( mWaterQuery, GL_QUERY_RESULT, &sampleCount );
+			mWaterOccluded = sampleCount == 0;
+			mWaterQueried = false;
+		}
+	}
 
+	// the offscreen passes are only affordable for water that can be seen
+	const QMatrix4x4 modelViewProjection = scene()->eye()->projectionMatrix() * modelViewMatrix();
+	const float coverage = waterCoverage( modelViewProjection );
+	if( coverage <= 0.0f )
+	{
+		mWaterOccluded = false;
+		mReflectionOutdated = true;
+		mRefractionOutdated = true;
+		return;
+	}
+	updateWaterMaps( modelViewProjection, coverage );
+
+	const QSizeF mapSize = mReflectionRenderer->size();
 	glDisable( GL_CULL_FACE );
 	mWaterShader->bind();
 
@@ -308,10 +566,27 @@ void Landscape::draw2SelfPost()
 	mWaterShader->program()->setUniformValue( "refractionMap", 1 );
 	mWaterShader->program()->setUniformValue( "waterMap", 2 );
 	mWaterShader->program()->setUniformValue( "time", world()->sky()->timeOfDay() );
+	// in between two updates the maps are reprojected with the view they were rendered from
+	mWaterShader->program()->setUniformValue( "reflectionMatrix", mReflectionMatrix );
+	mWaterShader->program()->setUniformValue( "refractionMatrix", mRefractionMatrix );
+	mWaterShader->program()->setUniformValue( "reflectionScale",
+		QVector2D( mReflectionViewport.width() / mapSize.width(), mReflectionViewport.height() / mapSize.height() ) );
+	mWaterShader->program()->setUniformValue( "refractionScale",
+		QVector2D( mRefractionViewport.width() / mapSize.width(), mRefractionViewport.height() / mapSize.height() ) );
+	mWaterShader->program()->setUniformValue( "mapTexel", QVector2D( 1.0f / mapSize.width(), 1.0f / mapSize.height() ) );
 	glActiveTexture( GL_TEXTURE2 );	glBindTexture( GL_TEXTURE_2D, mWaterMap );
 	glActiveTexture( GL_TEXTURE1 );	glBindTexture( GL_TEXTURE_2D, mRefractionRenderer->texID() );
 	glActiveTexture( GL_TEXTURE0 );	glBindTexture( GL_TEXTURE_2D, mReflectionRenderer->texID() );
-	drawInfinitePlane( mWaterHeight );
+	// a new query is only issued once the result of the pending one was read
+	if( mWaterQueried )
+	{
+		drawInfinitePlane( mWaterHeight );
+	} else {
+		glBeginQuery( GL_SAMPLES_PASSED, mWaterQuery );
+		drawInfinitePlane( mWaterHeight );
+		glEndQuery( GL_SAMPLES_PASSED );
+		mWaterQueried = true;
+	}
 	mWaterShader->release();
 	glActiveTexture( GL_TEXTURE2 );	glBindTexture( GL_TEXTURE_2D, 0 );
 	glActiveTexture( GL_TEXTURE1 );	glBindTexture( GL_TEXTURE_2D, 0 );
@@ -322,15 +597,15 @@ void Landscape::draw2SelfPost()
 
 void Landscape::drawPatch( const QRectF & rect )
 {
-	mTerrainMaterial->bind();
-	glMatrixMode( GL_TEXTURE );	glActiveTexture( GL_TEXTURE0 );	glPushMatrix();
-		glScalef( mTerrainMaterialScale.x(), -mTerrainMaterialScale.y(), 1.0f );
-		glMatrixMode( GL_MODELVIEW );
-		mTerrain->drawPatch( rect );
-	glMatrixMode( GL_TEXTURE );	glPopMatrix();
-	glMatrixMode( GL_MODELVIEW );
-	mTerrainMaterial->release();
-
+	int layers = 1;
+	while( layers <= mTerrainLayerPriorities.size() && mTerrainLayerPriorities[layers-1] >= 99-Blob::quality() )
+		++layers;
+	mTerrainLayers->bind( layers );
+	mTerrain->drawPatch( rect );
+	mTerrainLayers->release();
+
+	if( mBlobs.isEmpty() )
+		return;
 	glDepthMask( GL_FALSE );
 	glEnable( GL_BLEND );
 	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
@@ -352,9 +627,16 @@ const AObject * Landscape::intersectLine( const AObject * exclude, const QVector
 }
 
 
-QVector<const AObject*> Landscape::collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal ) const
+void Landscape::intersectLines( const AObject * exclude, Ray * rays, int count ) const
 {
-	QVector<const AObject*> collides = AObject::collideSphere( exclude, radius, center, normal );
+	AObject::intersectLines( exclude, rays, count );
+	mTerrain->intersectLines( rays, count, this );
+}
+
+
+void Landscape::visitSphereCollisions( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
+{
+	AObject::visitSphereCollisions( exclude, radius, center, normal, visitor );
 
 	float landscapeHeight;
 	if( mTerrain->getHeight( center, landscapeHeight ) )
@@ -362,7 +644,7 @@ QVector<const AObject*> Landscape::collideSphere( const AObject * exclude, const
 		float depth = landscapeHeight + radius - center.y();
 		if( depth > 0.0f )
 		{
-			collides.append( this );
+			visitor.visit( this );
 			center += QVector3D( 0, depth, 0 );
 			if( normal )
 				*normal += mTerrain->getNormal( center );
@@ -373,13 +655,12 @@ QVector<const AObject*> Landscape::collideSphere( const AObject * exclude, const
 		float depth = mTerrainOffset.y() + radius - center.y();
 		if( depth > 0.0f )
 		{
-			collides.append( this );
+			visitor.visit( this );
 			center += QVector3D( 0, depth, 0 );
 			if( normal )
 				*normal += QVector3D( 0, 1, 0 );
 		}
 	}
-	return collides;
 }
 
 
@@ -421,6 +702,8 @@ void Landscape::Blob::drawPatchMap( const QRect & visible )
 		QRect rectToDraw = mRect.intersected( visible );
 		if( rectToDraw.width() <= 1 || rectToDraw.height() <= 1 )
 			return;	// nothing to draw
+		if( !mLandscape->terrain()->isVisibleMap( rectToDraw ) )
+			return;
 
 		mMaterial->bind();
 		glMatrixMode( GL_TEXTURE );
@@ -442,118 +725,3 @@ void Landscape::Blob::drawPatchMap( const QRect & visible )
 		mMaterial->release();
 	}
 }
-
-
-
-
-////////////////////////////////////////////////////////////////
-// Filter
-
-
-Landscape::Filter::Patch::Patch( QVector3D position, QVector3D size ) :
-	mPosition(position),
-	mSize(size)
-{
-	mCenter = mPosition + mSize/2.0;
-	mBoundingSphereRadius = size.length()/2.0f;
-}
-
-
-Landscape::Filter::Filter( Landscape * landscape, QSize filterSize ) :
-	mLandscape( landscape ),
-	mFilterSize( filterSize )
-{
-	mPatches.resize( filterSize.width() * filterSize.height() );
-}
-
-
-Landscape::Filter::~Filter()
-{
-}
-
-
-void Landscape::Filter::update()
-{
-	/* example for filterSize 3x3
-	 *
-	 * .---------size.x()---------.
-	 *                   .-stepX--.
-	 * |--------|--------|--------|-    -
-	 * |        |        |        | |    |
-	 * |        |        |        |stepZ |
-	 * |        |        |        | |    |
-	 * |--------|--------|--------|-     |
-	 * |        |        |        |      |
-	 * |        |  Eye   |        |     size.z()
-	 * |        |        |        |      |
-	 * |--------|--------|--------|      |
-	 * |        |        |        |      |
-	 * |        |        |        |      |
-	 * |        |        |        |      |
-	 * |--------|--------|--------|     -
-	 * ^             '--farPlane--'
-	 * from
-	 */
-	//TODO: maybe do these calculations in map coordinates ...
-	float farPlane = mLandscape->scene()->eye()->farPlane();
-	QVector3D from = QVector3D( -farPlane, mLandscape->terrain()->offset().y(), -farPlane );
-	QVector3D size = QVector3D( 2.0f*farPlane, mLandscape->terrain()->size().y(), 2.0f*farPlane );
-	float stepX =  size.x()/(float)mFilterSize.width();
-	float stepZ =  size.z()/(float)mFilterSize.height();
-	QVector3D patchSize = QVector3D( stepX, mLandscape->terrain()->size().y(), stepZ );
-	for( int z=0; z<mFilterSize.height(); ++z )
-	{
-		for( int x=0; x<mFilterSize.width(); ++x )
-		{
-			QVector3D pos = from + QVector3D( (float)x*stepX, 0.0f, (float)z*stepZ );
-			mPatches[z*mFilterSize.width()+x] = Patch( pos, patchSize );
-		}
-	}
-}
-
-
-void Landscape::Filter::draw()
-{
-	FrustumTest frustumTest;
-	frustumTest.sync();
-	for( int z=0; z<mFilterSize.height(); ++z )
-	{
-		QRectF mergedRect;	// we will merge patches along the x axis as this is optimal for the terrain mesh VBO
-		for( int x=0; x<mFilterSize.width(); ++x )
-		{
-			Patch & patch = mPatches[z*mFilterSize.width()+x];
-			QVector3D eyePosition = QVector3D( mLandscape->scene()->eye()->position().x(), 0.0f, mLandscape->scene()->eye()->position().z() );
-			QVector3D spherePosition = eyePosition + patch.center();
-			/*
-			GLUquadric * q = gluNewQuadric();
-			glPushAttrib( GL_POLYGON_BIT | GL_LIGHTING_BIT | GL_ENABLE_BIT );
-			glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
-			glDisable( GL_LIGHTING );
-			glColor3f( 1, 1, 1 );
-			glPushMatrix();
-			glTranslate( spherePosition );
-			glDisable( GL_CULL_FACE );
-			gluSphere( q, patch.boundingSphereRadius(), 32, 32 );
-			glEnable( GL_CULL_FACE );
-			glPopMatrix();
-			glPopAttrib();
-			gluDeleteQuadric( q );
-			*/
-			if( frustumTest.isSphereInFrustum( spherePosition, patch.boundingSphereRadius() ) )
-			{
-				mergedRect = mergedRect.united(
-					QRectF(
-						eyePosition.x() + patch.position().x(),
-						eyePosition.z() + patch.position().z(),
-						patch.size().x(),
-						patch.size().z()
-					)
-				);
-			}
-		}
-		if( !mergedRect.isNull() )
-		{
-			mLandscape->drawPatch( mergedRect );
-		}
-	}
-}
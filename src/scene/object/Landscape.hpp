@@ -31,6 +31,7 @@
 #include <QRect>
 #include <QSizeF>
 #include <QVector2D>
+#include <QMatrix4x4>
 #include <QDebug>
 
 
@@ -38,6 +39,7 @@ class GLWidget;
 class Shader;
 class TextureRenderer;
 class Material;
+class TerrainMaterial;
 
 
 /// A Landscape consisting of terrain and water
@@ -57,12 +59,19 @@ public:
 
 	virtual const AObject * intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
 		float & length, QVector3D * normal = NULL ) const;
+	virtual void intersectLines( const AObject * exclude, Ray * rays, int count ) const;
 
-	virtual QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius,
-		QVector3D & center, QVector3D * normal = NULL ) const;
+	virtual void visitSphereCollisions( const AObject * exclude, const float & radius,
+		QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const;
 
 	void drawPatch( const QRectF & rect );
 
+	/// Leaves a crater in the terrain - see Terrain::applyBrush()
+	/**
+	 * Deferred to the scene's CommandBuffer while it is recording. Paged terrains are left as they are.
+	 */
+	void deform( const QVector3D & center, float radius, float depth );
+
 	QSharedPointer<AObject> getFlowers(){ return mFlower; }
 
 	Terrain * terrain() { return mTerrain; }
@@ -72,6 +81,11 @@ public:
 	const bool & drawingRefraction() const { return mDrawingRefraction; }
 
 	/// Draws a part of the Terrain using another Material.
+	/**
+	 * Blobs are blended into the terrain's TerrainMaterial as long as it has room for another layer,
+	 * only the remaining ones are drawn in passes of their own.\n
+	 * The quality selects the blobs to draw by their priority - the terrain material compiles a shader for each number of layers.
+	 */
 	class Blob
 	{
 		GLWidget * mGLWidget;
@@ -96,46 +110,22 @@ public:
 	};
 
 private:
-	/// Splits the Terrain into a grid of patches and applies frustum culling.
-	class Filter
-	{
-	public:
-		Filter( Landscape * landscape, QSize filterSize );
-		~Filter();
-		void update();
-		void draw();
-	private:
-		class Patch
-		{
-		public:
-			Patch() : mPosition(), mSize(), mCenter(), mBoundingSphereRadius(0.0f) {};
-			Patch( QVector3D position, QVector3D size );
-			const QVector3D & position() { return mPosition; }
-			const QVector3D & size() { return mSize; }
-			const QVector3D & center() { return mCenter; }
-			const float & boundingSphereRadius() { return mBoundingSphereRadius; }
-		private:
-			QVector3D mPosition;
-			QVector3D mSize;
-			QVector3D mCenter;
-			float mBoundingSphereRadius;
-		};
-		Landscape * mLandscape;
-		QSize mFilterSize;
-		QVector<Patch> mPatches;
-	};
-
 	QString mName;
 	QVector<Blob*> mBlobs;
 	QVector< QSharedPointer<AObject> > mVegetation;
 	QSharedPointer<AObject> mFlower;
 	QVector< QSharedPointer<AObject> > mPowerUps;
 	Terrain * mTerrain;
-	Filter * mTerrainFilter;
 	Material * mTerrainMaterial;
+	/// The terrain material and the blobs blended into it
+	TerrainMaterial * mTerrainLayers;
+	/// Priority of each layer of mTerrainLayers above the base layer - in descending order
+	QVector<int> mTerrainLayerPriorities;
 	QVector3D mTerrainSize;
 	QVector3D mTerrainOffset;
 	QVector2D mTerrainMaterialScale;
+	/// Accepted screen space error of the terrain's level of detail in pixels - 0 disables it
+	float mTerrainPixelError;
 	float mWaterHeight;
 	Shader * mWaterShader;
 	TextureRenderer * mReflectionRenderer;
@@ -144,10 +134,34 @@ private:
 	bool mDrawingReflection;
 	bool mDrawingRefraction;
 	GLuint mWaterMap;
-
+	/// Frames between two updates of the reflection - and of the refraction
+	int mWaterUpdateInterval;
+	/// Updates the reflection and the refraction in different frames
+	bool mWaterStaggerUpdates;
+	/// Smallest viewport the reflection and refraction are rendered with
+	int mWaterMinimumResolution;
+	int mWaterFrame;
+	bool mEyeAboveWater;
+	/// No sample of the water surface passed the depth test in the last frame queried
+	bool mWaterOccluded;
+	/// An occlusion query of the water surface is pending
+	bool mWaterQueried;
+	GLuint mWaterQuery;
+	/// Projection and model view matrix of the main view when the reflection was rendered
+	QMatrix4x4 mReflectionMatrix;
+	QMatrix4x4 mRefractionMatrix;
+	QSize mReflectionViewport;
+	QSize mRefractionViewport;
+	bool mReflectionOutdated;
+	bool mRefractionOutdated;
+
+	void updateTerrainLevelOfDetail();
 	void drawInfinitePlane( const float & height );
-	void renderReflection();
-	void renderRefraction();
+	float waterCoverage( const QMatrix4x4 & modelViewProjection );
+	QSize waterViewport( const float & coverage ) const;
+	void updateWaterMaps( const QMatrix4x4 & modelViewProjection, const float & coverage );
+	void renderReflection( const QSize & viewport );
+	void renderRefraction( const QSize & viewport );
 };
 
 
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Perception.hpp"
+#include "AObject.hpp"
+
+#include <geometry/Terrain.hpp>
+
+#include <math.h>
+#include <float.h>
+
+
+/// Cosine of the half angle of the view cone - the creatures used to compare twice the angle in degrees with 100
+static const float sViewConeCosine = cosf( 50.0f * M_PI / 180.0f );
+
+
+Perception::Percept::Percept() :
+	playerDistance( FLT_MAX ),
+	playerInView( false ),
+	torchCarried( false ),
+	torchDistance( FLT_MAX ),
+	torchInView( false ),
+	flowerFound( false ),
+	flowerDistance( FLT_MAX ),
+	flower()
+{
+}
+
+
+Perception::Perception( float cellSize ) :
+	mCellSize( qMax( cellSize, 1.0f ) ),
+	mColumns( 0 ),
+	mRows( 0 ),
+	mMinimumX( 0.0f ),
+	mMinimumZ( 0.0f ),
+	mOccluder( NULL )
+{
+}
+
+
+Perception::~Perception()
+{
+}
+
+
+void Perception::setFlowers( const QVector<QVector3D> & flowers )
+{
+	mCellStart.clear();
+	mFlowerX.clear();
+	mFlowerY.clear();
+	mFlowerZ.clear();
+	mColumns = mRows = 0;
+	if( flowers.isEmpty() )
+		return;
+
+	float maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	mMinimumX = mMinimumZ = FLT_MAX;
+	foreach( const QVector3D & flower, flowers )
+	{
+		mMinimumX = qMin( mMinimumX, (float)flower.x() );
+		mMinimumZ = qMin( mMinimumZ, (float)flower.z() );
+		maxX = qMax( maxX, (float)flower.x() );
+		maxZ = qMax( maxZ, (float)flower.z() );
+	}
+	mColumns = (int)( ( maxX - mMinimumX ) / mCellSize ) + 1;
+	mRows = (int)( ( maxZ - mMinimumZ ) / mCellSize ) + 1;
+
+	// sort the flowers by cell
+	QVector<int> cells( flowers.size() );
+	mCellStart.fill( 0, mColumns * mRows + 1 );
+	for( int i = 0; i < flowers.size(); i++ )
+	{
+		const int x = qMin( (int)( ( flowers[i].x() - mMinimumX ) / mCellSize ), mColumns-1 );
+		const int z = qMin( (int)( ( flowers[i].z() - mMinimumZ ) / mCellSize ), mRows-1 );
+		cells[i] = z * mColumns + x;
+		mCellStart[cells[i]+1]++;
+	}
+	for( int c = 0; c < mColumns * mRows; c++ )
+		mCellStart[c+1] += mCellStart[c];
+
+	mFlowerX.resize( flowers.size() );
+	mFlowerY.resize( flowers.size() );
+	mFlowerZ.resize( flowers.size() );
+	QVector<int> next = mCellStart;
+	for( int i = 0; i < flowers.size(); i++ )
+	{
+		const int j = next[cells[i]]++;
+		mFlowerX[j] = flowers[i].x();
+		mFlowerY[j] = flowers[i].y();
+		mFlowerZ[j] = flowers[i].z();
+	}
+}
+
+
+bool Perception::nearestFlower( const QVector3D & position, float range, QVector3D & flower ) const
+{
+	if( mFlowerX.isEmpty() || range <= 0.0f )
+		return false;
+
+	const int centerX = (int)floorf( ( position.x() - mMinimumX ) / mCellSize );
+	const int centerZ = (int)floorf( ( position.z() - mMinimumZ ) / mCellSize );
+	const int rings = (int)ceilf( range / mCellSize );
+	float nearestSquared = range * range;
+	int nearest = -1;
+
+	// visit the cells in rings around the position's cell until no nearer flower can follow
+	for( int ring = 0; ring <= rings; ring++ )
+	{
+		// every point of a cell in this ring is at least ring-1 cells away from the position
+		const float ringDistance = ( ring - 1 ) * mCellSize;
+		if( ring > 1 && ringDistance * ringDistance >= nearestSquared )
+			break;
+
+		for( int z = qMax( centerZ - ring, 0 ); z <= qMin( centerZ + ring, mRows-1 ); z++ )
+		{
+			// rows between the first and the last one only touch the ring at both ends
+			const bool edge = z == centerZ - ring || z == centerZ + ring;
+			const int step = edge ? 1 : 2 * ring;
+			for( int x = centerX - ring; x <= centerX + ring; x += step )
+			{
+				if( x < 0 || x >= mColumns )
+					continue;
+				const int end = mCellStart[z*mColumns+x+1];
+				for( int i = mCellStart[z*mColumns+x]; i < end; i++ )
+				{
+					const float dx = mFlowerX[i] - position.x();
+					const float dy = mFlowerY[i] - position.y();
+					const float dz = mFlowerZ[i] - position.z();
+					const float distanceSquared = dx*dx + dy*dy + dz*dz;
+					if( distanceSquared < nearestSquared )
+					{
+						nearestSquared = distanceSquared;
+						nearest = i;
+					}
+				}
+			}
+		}
+	}
+
+	if( nearest < 0 )
+		return false;
+	flower = QVector3D( mFlowerX[nearest], mFlowerY[nearest], mFlowerZ[nearest] );
+	return true;
+}
+
+
+void Perception::addObserver( const AObject * observer, float flowerRange )
+{
+	if( mObserverIndices.contains( observer ) )
+	{
+		mFlowerRanges[mObserverIndices.value( observer )] = flowerRange;
+		return;
+	}
+	mObserverIndices.insert( observer, mObservers.size() );
+	mObservers.append( observer );
+	mFlowerRanges.append( flowerRange );
+	mAwake.append( true );
+	mPercepts.append( Percept() );
+}
+
+
+void Perception::removeObserver( const AObject * observer )
+{
+	QHash<const AObject*,int>::iterator found = mObserverIndices.find( observer );
+	if( found == mObserverIndices.end() )
+		return;
+
+	// move the last observer into the gap
+	const int index = found.value();
+	const int last = mObservers.size() - 1;
+	mObserverIndices.erase( found );
+	if( index != last )
+	{
+		mObservers[index] = mObservers[last];
+		mFlowerRanges[index] = mFlowerRanges[last];
+		mAwake[index] = mAwake[last];
+		mPercepts[index] = mPercepts[last];
+		mObserverIndices[mObservers[index]] = index;
+	}
+	mObservers.resize( last );
+	mFlowerRanges.resize( last );
+	mAwake.resize( last );
+	mPercepts.resize( last );
+}
+
+
+void Perception::setObserverAwake( const AObject * observer, bool awake )
+{
+	QHash<const AObject*,int>::const_iterator found = mObserverIndices.constFind( observer );
+	if( found != mObserverIndices.constEnd() )
+		mAwake[found.value()] = awake;
+}
+
+
+const Perception::Percept & Perception::percept( const AObject * observer ) const
+{
+	static const Percept nothing;
+	QHash<const AObject*,int>::const_iterator found = mObserverIndices.constFind( observer );
+	if( found == mObserverIndices.constEnd() )
+		return nothing;
+	return mPercepts[found.value()];
+}
+
+
+void Perception::update( const QVector3D & player, const QVector3D * torch )
+{
+	int sightLines = 0;
+	if( mOccluder && mSightLines.size() < mObservers.size() * 2 )
+	{
+		mSightLines.resize( mObservers.size() * 2 );
+		mSightResults.resize( mObservers.size() * 2 );
+		mSightDistances.resize( mObservers.size() * 2 );
+	}
+
+	for( int i = 0; i < mObservers.size(); i++ )
+	{
+		if( !mAwake[i] )
+			continue;
+
+		const QVector3D position = mObservers[i]->worldPosition();
+		const QVector3D direction = mObservers[i]->worldDirection();
+		Percept & percept = mPercepts[i];
+
+		const QVector3D toPlayer = player - position;
+		percept.playerDistance = toPlayer.length();
+		percept.playerInView = isInView( direction, toPlayer, percept.playerDistance );
+		if( mOccluder && percept.playerInView )
+		{
+			mSightLines[sightLines] = Ray( position, toPlayer / percept.playerDistance, percept.playerDistance );
+			mSightDistances[sightLines] = percept.playerDistance;
+			mSightResults[sightLines++] = &percept.playerInView;
+		}
+
+		percept.torchCarried = torch != NULL;
+		if( torch )
+		{
+			const QVector3D toTorch = *torch - position;
+			percept.torchDistance = toTorch.length();
+			percept.torchInView = isInView( direction, toTorch, percept.torchDistance );
+			if( mOccluder && percept.torchInView )
+			{
+				mSightLines[sightLines] = Ray( position, toTorch / percept.torchDistance, percept.torchDistance );
+				mSightDistances[sightLines] = percept.torchDistance;
+				mSightResults[sightLines++] = &percept.torchInView;
+			}
+		} else {
+			percept.torchDistance = FLT_MAX;
+			percept.torchInView = false;
+		}
+
+		percept.flowerFound = nearestFlower( position, mFlowerRanges[i], percept.flower );
+		percept.flowerDistance = percept.flowerFound ? ( percept.flower - position ).length() : FLT_MAX;
+	}
+
+	// a line of sight which hits the terrain before it reaches its target is blocked
+	if( sightLines )
+	{
+		mOccluder->intersectLines( mSightLines.data(), sightLines, NULL );
+		for( int i = 0; i < sightLines; i++ )
+		{
+			if( mSightLines[i].length < mSightDistances[i] )
+				*mSightResults[i] = false;
+		}
+	}
+}
+
+
+bool Perception::isInView( const QVector3D & direction, const QVector3D & toTarget, float distance )
+{
+	// cos(angle) > cos(half angle) without dividing by the distance
+	return distance > FLT_EPSILON && QVector3D::dotProduct( direction, toTarget ) > sViewConeCosine * distance;
+}
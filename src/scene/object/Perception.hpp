@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_OBJECT_PERCEPTION_INCLUDED
+#define SCENE_OBJECT_PERCEPTION_INCLUDED
+
+
+#include <utility/Ray.hpp>
+
+#include <QVector>
+#include <QVector3D>
+#include <QHash>
+
+
+class AObject;
+class Terrain;
+
+
+/// Spatial queries shared by the senses of all creatures
+/**
+ * Static points of interest like flowers are sorted into a uniform grid on the XZ plane once,
+ * so finding the nearest one only visits the cells around the query position.\n
+ * The creatures register as observers. update() is called once per tick before they are updated
+ * and answers the questions of all observers in one go - the creatures only read their Percept.\n
+ * Whether a target is in view is decided by comparing the dot product of the observer's direction and the
+ * direction to the target with the cosine of the view cone's half angle, so no acos() is needed.\n
+ * If an occluder is set, the lines of sight of all targets within a view cone are then traced
+ * through the terrain in a single batch - targets behind hills are not in view.
+ */
+class Perception
+{
+public:
+	/// What an observer perceived during the last update()
+	class Percept
+	{
+	public:
+		Percept();
+
+		float playerDistance;
+		bool playerInView;
+		/// The torch can only be seen while the player carries it
+		bool torchCarried;
+		float torchDistance;
+		bool torchInView;
+		/// False if there is no flower within the observer's flower range
+		bool flowerFound;
+		float flowerDistance;
+		QVector3D flower;
+	};
+
+	/// Creates a service without any points of interest or observers
+	explicit Perception( float cellSize );
+	~Perception();
+
+	/// Sorts the flowers into the grid - replaces all previous flowers
+	void setFlowers( const QVector<QVector3D> & flowers );
+	bool hasFlowers() const { return !mFlowerX.isEmpty(); }
+	/// Sets the terrain hiding targets from the observers - NULL to disable line of sight tests
+	void setOccluder( const Terrain * terrain ) { mOccluder = terrain; }
+
+	/// Finds the nearest flower within range of the position
+	/**
+	 * @return False if there is no flower within range - the flower is left unchanged then.
+	 */
+	bool nearestFlower( const QVector3D & position, float range, QVector3D & flower ) const;
+
+	/// Adds an observer whose percept is updated by every update()
+	/**
+	 * @param flowerRange The nearest flower is only searched within this distance - 0 for none at all.
+	 */
+	void addObserver( const AObject * observer, float flowerRange );
+	void removeObserver( const AObject * observer );
+	/// Selects whether update() refreshes the observer's percept - sleeping observers keep their old percept
+	void setObserverAwake( const AObject * observer, bool awake );
+	/// Returns the observer's percept of the last update() - an empty percept for unknown observers
+	const Percept & percept( const AObject * observer ) const;
+
+	/// Updates the percepts of all observers which are awake
+	/**
+	 * @param torch Position of the torch or NULL if the player does not carry it.
+	 */
+	void update( const QVector3D & player, const QVector3D * torch );
+
+	/// Returns true if the target lies within the view cone around the observer's direction
+	static bool isInView( const QVector3D & direction, const QVector3D & toTarget, float distance );
+
+private:
+	float mCellSize;
+	int mColumns;
+	int mRows;
+	float mMinimumX;
+	float mMinimumZ;
+	/// Index of the first flower of each cell - followed by the number of flowers
+	QVector<int> mCellStart;
+	QVector<float> mFlowerX;
+	QVector<float> mFlowerY;
+	QVector<float> mFlowerZ;
+
+	const Terrain * mOccluder;
+	/// Lines of sight traced by the last update() - only grows
+	QVector<Ray> mSightLines;
+	/// Distance to the target of each line of sight
+	QVector<float> mSightDistances;
+	/// Percept entry each line of sight decides
+	QVector<bool*> mSightResults;
+
+	QVector<const AObject*> mObservers;
+	QVector<float> mFlowerRanges;
+	QVector<bool> mAwake;
+	QVector<Percept> mPercepts;
+	QHash<const AObject*,int> mObserverIndices;
+};
+
+
+#endif
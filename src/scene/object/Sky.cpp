@@ -25,6 +25,7 @@
 #include "World.hpp"
 
 #include <utility/Interpolation.hpp>
+#include <utility/DrawStatistics.hpp>
 #include <resource/Shader.hpp>
 #include <resource/Material.hpp>
 #include <scene/object/Eye.hpp>
@@ -94,6 +95,7 @@ void Sky::drawCube( bool texCoords )
 	}
 
 	glDrawElements( GL_QUADS, sizeof(sCubeIndices)/sizeof(GLushort), GL_UNSIGNED_SHORT, 0 );
+	DrawStatistics::countDrawCall( sizeof(sCubeIndices)/sizeof(GLushort)/2 );
 
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	glDisableClientState( GL_VERTEX_ARRAY );
@@ -117,6 +119,7 @@ void Sky::drawQuad( bool texCoords )
 	}
 
 	glDrawElements( GL_QUADS, 4, GL_UNSIGNED_SHORT, 0 );
+	DrawStatistics::countDrawCall( 2 );
 
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	glDisableClientState( GL_VERTEX_ARRAY );
@@ -535,6 +538,7 @@ void Sky::drawCloudPlane()
 				mCloudPlaneRes*slice			// index to start
 			) ) )
 		);
+		DrawStatistics::countDrawCall( mCloudPlaneRes*2-2 );
 	}
 	glDisableClientState( GL_INDEX_ARRAY );
 	VertexP3fT2f::glDisableClientState();
@@ -85,15 +85,15 @@ void Teapot::drawSelf()
 }
 
 
-QVector<const AObject*> Teapot::collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal ) const
+void Teapot::visitSphereCollisions( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
 {
-	QVector<const AObject*> collides = AObject::collideSphere( exclude, radius, center, normal );
+	AObject::visitSphereCollisions( exclude, radius, center, normal, visitor );
 	float depth;
 	QVector3D tmpNormal(0,1,0);
 	/*
 	if( Sphere::intersectSphere( position(), boundingSphereRadius(), center, radius, &tmpNormal, &depth ) )
 	{
-		collides.append( this );
+		visitor.visit( this );
 		center += tmpNormal * depth;
 		if( normal )
 			*normal = tmpNormal;
@@ -101,11 +101,9 @@ QVector<const AObject*> Teapot::collideSphere( const AObject * exclude, const fl
 	*/
 	if( Capsule::intersectSphere( position(), position()+QVector3D(0,2,0), boundingSphereRadius()/2.0f, center, radius, &tmpNormal, &depth ) )
 	{
-		collides.append( this );
+		visitor.visit( this );
 		center += tmpNormal * depth;
 		if( normal )
 			*normal = tmpNormal;
 	}
-
-	return collides;
 }
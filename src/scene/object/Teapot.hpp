@@ -45,7 +45,7 @@ public:
 	virtual void updateSelf( const double & delta );
 	virtual void drawSelf();
 
-	virtual QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal = NULL ) const;
+	virtual void visitSphereCollisions( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const;
 
 private:
 	Material * mMaterial;
@@ -28,6 +28,7 @@
 #include <scene/Scene.hpp>
 #include <resource/Material.hpp>
 #include <resource/StaticModel.hpp>
+#include <utility/DrawStatistics.hpp>
 
 
 const GLfloat Torch::sQuadVertices[] =
@@ -157,8 +158,10 @@ void Torch::draw2Self()
 	glScale( mFlareSize );
 	glRotate( mFlareRotation, QVector3D(0,0,1) );
 	glDrawArrays( GL_QUADS, 0, 4 );
+	DrawStatistics::countDrawCall( 2 );
 	glRotate( -mFlareRotation*2.7f, QVector3D(0,0,1) );
 	glDrawArrays( GL_QUADS, 0, 4 );
+	DrawStatistics::countDrawCall( 2 );
 	Bilboard::end();
 
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
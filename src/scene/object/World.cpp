@@ -26,16 +26,30 @@
 #include <scene/object/Eye.hpp>
 #include <scene/Scene.hpp>
 #include <utility/RandomNumber.hpp>
+#include <utility/CommandBuffer.hpp>
 #include <geometry/ParticleSystem.hpp>
 #include <effect/SplatterSystem.hpp>
 #include "Landscape.hpp"
 #include "Teapot.hpp"
 #include "Sky.hpp"
+#include "Torch.hpp"
+#include "environment/Flower.hpp"
 
 #include <QPainter>
 #include <QSettings>
 
 
+/// Deferred call to World::addRandomEnemy
+class AddRandomEnemyCommand : public CommandBuffer::ACommand
+{
+public:
+	AddRandomEnemyCommand( World * world ) : mWorld( world ) {}
+	virtual void execute() { mWorld->addRandomEnemy(); }
+private:
+	World * mWorld;
+};
+
+
 SplatterQuality::Type SplatterQuality::sMaximum = SplatterQuality::HIGH;
 
 SplatterQuality::Type SplatterQuality::fromString( const QString & name )
@@ -74,8 +88,13 @@ World::World( Scene * scene, QString name ) :
 	s.beginGroup( "World" );
 		QString skyName = s.value( "skyName", "earth" ).toString();
 		QString landscapeName = s.value( "landscapeName", "earth" ).toString();
+		float spatialIndexCellSize = s.value( "spatialIndexCellSize", 64.0f ).toFloat();
+		float perceptionCellSize = s.value( "perceptionCellSize", 32.0f ).toFloat();
+		float creatureUpdateBudget = s.value( "creatureUpdateBudget", 2.0f ).toFloat();
 	s.endGroup();
 
+	enableSpatialIndex( spatialIndexCellSize );
+
 	mLevel = 1;
 	mLevelTime = 0.0f;
 	mLevelDuration = 20.0f;
@@ -88,6 +107,13 @@ World::World( Scene * scene, QString name ) :
 	mLandscape = QSharedPointer<Landscape>( new Landscape( this, landscapeName ) );
 	add( mLandscape );
 
+	mPerception = new Perception( perceptionCellSize );
+	mPerception->setOccluder( mLandscape->terrain() );
+	Flower * flowers = dynamic_cast<Flower*>( mLandscape->getFlowers().data() );
+	if( flowers )
+		mPerception->setFlowers( flowers->getInstances() );
+	mScheduler = new CreatureScheduler( mPerception, creatureUpdateBudget );
+
 	mSky = QSharedPointer<Sky>( new Sky( this, skyName ) );
 	add( mSky );
 
@@ -113,6 +139,7 @@ World::World( Scene * scene, QString name ) :
 		"Splatter",
 		"splatter"
 	);
+	mSplatterSystem->setCommandBuffer( scene->commands() );
 	mSplatterInteractor = new SplatterInteractor( *this );
 	mSplatterSystem->particleSystem()->setInteractionCallback( mSplatterInteractor );
 }
@@ -124,6 +151,8 @@ World::~World()
 	scene()->removeKeyListener( this );
 	delete mSplatterSystem;
 	delete mSplatterInteractor;
+	delete mScheduler;
+	delete mPerception;
 }
 
 
@@ -201,6 +230,15 @@ void World::updateSelf( const double & delta )
 	else
 		mSplatterSystem->setSplatBelow( false );
 	mSplatterSystem->update( delta );
+
+	mScheduler->schedule( mPlayer->worldPosition(), scene()->eye()->projectionMatrix(), scene()->eye()->viewMatrix() );
+
+	// the creatures read their percepts while they are updated after this
+	QVector3D torchPosition;
+	const bool torchCarried = mPlayer->getTorch()->parent() != NULL;
+	if( torchCarried )
+		torchPosition = mPlayer->getTorch()->worldPosition();
+	mPerception->update( mPlayer->worldPosition(), torchCarried ? &torchPosition : NULL );
 }
 
 
@@ -228,18 +266,44 @@ void World::drawSelf()
 
 void World::drawSelfPost()
 {
-	mSplatterSystem->draw( modelViewMatrix() );
+	// decals and blood particles are lost in the low resolution water maps
+	if( RenderPass::current() == RenderPass::MAIN )
+		mSplatterSystem->draw( modelViewMatrix() );
 }
 
 
 void World::SplatterInteractor::particleInteraction( const double & delta, ParticleSystem::Particle & particle )
+{
+	interact( delta, particle, mWorld.landscape()->terrain()->getHeight( particle.position() ) );
+}
+
+
+void World::SplatterInteractor::particleInteractions( const double & delta, ParticleSystem::Particle ** particles, int count )
+{
+	// sample the ground below all particles at once
+	mParticleX.resize( count );
+	mParticleZ.resize( count );
+	mGroundHeights.resize( count );
+	for( int i = 0; i < count; ++i )
+	{
+		mParticleX[i] = particles[i]->position().x();
+		mParticleZ[i] = particles[i]->position().z();
+	}
+	mWorld.landscape()->terrain()->getHeights( mParticleX.constData(), mParticleZ.constData(), mGroundHeights.data(), count );
+
+	for( int i = 0; i < count; ++i )
+		interact( delta, *particles[i], mGroundHeights[i] );
+}
+
+
+void World::SplatterInteractor::interact( const double & delta, ParticleSystem::Particle & particle, float groundHeight )
 {
 	bool belowWater = false;
 	bool belowGround = false;
 
 	if( particle.position().y() - mWorld.landscape()->waterHeight() < -mWorld.splatterSystem()->particleSystem()->size()/2.0f )
 		belowWater = true;
-	if( mWorld.landscape()->terrain()->getHeightAboveGround( particle.position() ) < -mWorld.splatterSystem()->particleSystem()->size()/2.0f )
+	if( particle.position().y() - groundHeight < -mWorld.splatterSystem()->particleSystem()->size()/2.0f )
 		belowGround = true;
 
 	if( belowWater )
@@ -268,11 +332,19 @@ void World::respawnEnemies()
 
 void World::addRandomEnemy()
 {
+	if( scene()->commands()->recording() )
+	{
+		scene()->commands()->push( new AddRandomEnemyCommand( this ) );
+		return;
+	}
+
 	QSharedPointer<ACreature> newEnemy;
+	float flowerRange = 0.0f;
 	switch( qrand()%2 )
 	{
 		case 0:
 			newEnemy = QSharedPointer<ACreature>(new Splatterling( this, 0.25*(mLevel*0.25) ));
+			flowerRange = Splatterling::DetectionDistanceOfFlower;
 			break;
         case 1:
             newEnemy = QSharedPointer<ACreature>(new Splatterbug(this, 0.5f*(mLevel*5.0f)));
@@ -280,6 +352,8 @@ void World::addRandomEnemy()
 	}
 	if( newEnemy.isNull() )
 		return;
+	mPerception->addObserver( newEnemy.data(), flowerRange );
+	mScheduler->add( newEnemy.data() );
 	mEnemies.append( newEnemy );
 	add( newEnemy );
 }
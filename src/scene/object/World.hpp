@@ -30,6 +30,8 @@
 #include <geometry/ParticleSystem.hpp>
 
 #include "AObject.hpp"
+#include "Perception.hpp"
+#include "creature/CreatureScheduler.hpp"
 #include "creature/Player.hpp"
 #include "creature/Dummy.hpp"
 #include "creature/Splatterling.hpp"
@@ -100,6 +102,10 @@ public:
 	QSharedPointer<Sky> sky() { return mSky; }
 
 	QSharedPointer<Player> player() { return mPlayer; }
+	/// What the creatures perceive - updated once per tick before they are updated
+	const Perception * perception() const { return mPerception; }
+	/// Decides which enemies are updated in a tick
+	const CreatureScheduler * scheduler() const { return mScheduler; }
 	QSharedPointer<Teapot> teapot() { return mTeapot; }
 
 	void addRandomEnemy();
@@ -112,8 +118,13 @@ private:
         SplatterInteractor( World & world ) : mWorld(world) {}
 		virtual ~SplatterInteractor() {}
 		virtual void particleInteraction( const double & delta, ParticleSystem::Particle & particle );
+		virtual void particleInteractions( const double & delta, ParticleSystem::Particle ** particles, int count );
 	private:
 		World & mWorld;
+		QVector<float> mParticleX;
+		QVector<float> mParticleZ;
+		QVector<float> mGroundHeights;
+		void interact( const double & delta, ParticleSystem::Particle & particle, float groundHeight );
 	};
 	void respawnEnemies();
 
@@ -130,6 +141,8 @@ private:
 	QVector3D mTarget;
 	QVector3D mTargetNormal;
 	SplatterSystem * mSplatterSystem;
+	Perception * mPerception;
+	CreatureScheduler * mScheduler;
 	QList< ALightSource * > mLightSources;
 	float mLevelTime;
 	float mLevelDuration;
@@ -23,11 +23,16 @@
 
 #include "ACreature.hpp"
 
+#include <QElapsedTimer>
+
 
 ACreature::ACreature( World * world ) :
 	AWorldObject( world ),
 	mState( ACreature::SPAWNING ),
-	mLife( 0 )
+	mLife( 0 ),
+	mAwake( true ),
+	mPendingDelta( 0.0 ),
+	mUpdateCost( 0.0f )
 {
 }
 
@@ -35,3 +40,18 @@ ACreature::ACreature( World * world ) :
 ACreature::~ACreature()
 {
 }
+
+
+void ACreature::update( const double & delta )
+{
+	mPendingDelta += delta;
+	if( !mAwake )
+		return;
+
+	const double elapsed = mPendingDelta;
+	mPendingDelta = 0.0;
+	QElapsedTimer timer;
+	timer.start();
+	AWorldObject::update( elapsed );
+	mUpdateCost = timer.nsecsElapsed() / 1000000.0f;
+}
@@ -58,11 +58,29 @@ public:
 	void setState( const State & state ) { mState = state; }
 	void setLife( const int & life ) { mLife = life; }
 
+	/// Updates this creature only while it is awake
+	/**
+	 * The delta of ticks slept through is accumulated and passed on with the next update,
+	 * so the creature moves as far as it would have moved in all skipped ticks.
+	 */
+	virtual void update( const double & delta );
+
+	/// Selects whether the next update() is executed - creatures are awake unless a scheduler says otherwise
+	void setAwake( bool awake ) { mAwake = awake; }
+	bool awake() const { return mAwake; }
+	/// Time in seconds which passed since the last executed update
+	const double & pendingDelta() const { return mPendingDelta; }
+	/// Milliseconds the last executed update took - including all sub-objects
+	const float & updateCost() const { return mUpdateCost; }
+
 protected:
 
 private:
 	State mState;
 	int mLife;
+	bool mAwake;
+	double mPendingDelta;
+	float mUpdateCost;
 };
 
 
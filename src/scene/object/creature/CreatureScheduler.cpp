@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CreatureScheduler.hpp"
+#include "ACreature.hpp"
+#include "../Perception.hpp"
+
+#include <algorithm>
+
+
+/// No creature sleeps longer than this many seconds - even if the budget is exceeded
+static const double MaximumSleep = 0.5;
+/// Weight of the newest measurements in the average cost of an update
+static const float CostSmoothing = 0.05f;
+
+
+/// Orders indices of creatures by the time passed since their last update - longest first
+class CreatureScheduler::LongestPending
+{
+public:
+	LongestPending( const QVector<ACreature*> & creatures ) : mCreatures( creatures ) {}
+	bool operator()( int a, int b ) const
+		{ return mCreatures[a]->pendingDelta() > mCreatures[b]->pendingDelta(); }
+private:
+	const QVector<ACreature*> & mCreatures;
+};
+
+
+CreatureScheduler::CreatureScheduler( Perception * perception, float budget ) :
+	mPerception( perception ),
+	mBudget( budget ),
+	mAverageCost( 0.0f )
+{
+}
+
+
+CreatureScheduler::~CreatureScheduler()
+{
+}
+
+
+void CreatureScheduler::add( ACreature * creature )
+{
+	if( mCreatures.contains( creature ) )
+		return;
+	mCreatures.append( creature );
+	// random phase - zero is left for creatures updated in the last tick
+	mTicks.append( 1 + qrand() % MaximumInterval );
+}
+
+
+void CreatureScheduler::schedule( const QVector3D & player, const QMatrix4x4 & projection, const QMatrix4x4 & view )
+{
+	mView.sync( projection, view );
+
+	// learn the cost from the living creatures updated in the last tick
+	for( int i = 0; i < mCreatures.size(); i++ )
+	{
+		if( mTicks[i] == 0 && mCreatures[i]->state() == ACreature::ALIVE )
+			mAverageCost += CostSmoothing * ( mCreatures[i]->updateCost() - mAverageCost );
+	}
+
+	float budget = mBudget;
+	mDue.clear();
+	for( int i = 0; i < mCreatures.size(); i++ )
+	{
+		const ACreature * creature = mCreatures[i];
+		mTicks[i]++;
+
+		bool awake = false;
+		if( creature->state() != ACreature::ALIVE )
+		{
+			// spawning and dying is cheap and has to happen in time
+			awake = true;
+		}
+		else
+		{
+			const int ticks = interval( creature, player );
+			if( ticks <= 1 || creature->pendingDelta() >= MaximumSleep )
+			{
+				awake = true;
+				if( ticks > 1 )
+					budget -= mAverageCost;
+			}
+			else if( mTicks[i] >= ticks )
+			{
+				mDue.append( i );
+			}
+		}
+		setAwake( i, awake );
+	}
+
+	// spend the rest of the budget on the due creatures which waited longest
+	std::sort( mDue.begin(), mDue.end(), LongestPending( mCreatures ) );
+	for( int i = 0; i < mDue.size() && budget >= mAverageCost; i++ )
+	{
+		setAwake( mDue[i], true );
+		budget -= mAverageCost;
+	}
+}
+
+
+int CreatureScheduler::interval( const ACreature * creature, const QVector3D & player ) const
+{
+	const QVector3D position = creature->worldPosition();
+	const float distance = ( position - player ).length();
+	if( distance <= NearDistance )
+		return 1;
+
+	int ticks = 2 + (int)( ( distance - NearDistance ) / IntervalDistance );
+	if( !mView.isSphereInFrustum( position, creature->boundingSphereRadius() ) )
+		ticks *= 2;
+	return qMin( ticks, (int)MaximumInterval );
+}
+
+
+void CreatureScheduler::setAwake( int index, bool awake )
+{
+	if( awake )
+		mTicks[index] = 0;
+	mCreatures[index]->setAwake( awake );
+	if( mPerception )
+		mPerception->setObserverAwake( mCreatures[index], awake );
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_OBJECT_CREATURE_CREATURESCHEDULER_INCLUDED
+#define SCENE_OBJECT_CREATURE_CREATURESCHEDULER_INCLUDED
+
+
+#include <utility/FrustumTest.hpp>
+
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix4x4>
+
+class ACreature;
+class Perception;
+
+
+/// Decides which creatures are updated in a tick
+/**
+ * Creatures near the player are updated every tick. Beyond that the number of ticks between two updates
+ * grows with the distance to the player and doubles for creatures outside the view frustum.
+ * Every creature starts with a random phase, so creatures at the same distance don't all wake up in the same tick.\n
+ * The far creatures which are due share a budget of CPU time per tick. It is converted into a number of updates
+ * using the average cost of an update measured by the creatures themselves. Creatures which waited longest are
+ * woken first, the others stay due for the next tick - but no creature sleeps longer than MaximumSleep seconds.\n
+ * Sleeping creatures are also skipped by the Perception, so their decisions and senses are spread over several ticks.
+ */
+class CreatureScheduler
+{
+public:
+	/// Creatures closer to the player are updated every tick
+	static const int NearDistance = 64;
+	/// Distance after which the interval between updates grows by one tick
+	static const int IntervalDistance = 48;
+	/// Upper limit of ticks between two updates
+	static const int MaximumInterval = 8;
+
+	/**
+	 * @param perception Observers in here are put to sleep together with their creatures - may be NULL.
+	 * @param budget Milliseconds of CPU time per tick for updating far creatures - summed over all threads.
+	 */
+	CreatureScheduler( Perception * perception, float budget );
+	~CreatureScheduler();
+
+	/// Adds a creature which is scheduled from now on
+	/**
+	 * Creatures stay registered as long as the scheduler exists - the World owns both and respawns dead creatures
+	 * instead of destroying them, so the scheduler has to be destroyed before any of it's creatures.
+	 */
+	void add( ACreature * creature );
+
+	/// Wakes or puts to sleep all creatures for the coming update
+	/**
+	 * Has to be called once per tick before the creatures and the perception are updated.
+	 * @param projection,view The eye's matrices used for deciding which creatures are visible.
+	 */
+	void schedule( const QVector3D & player, const QMatrix4x4 & projection, const QMatrix4x4 & view );
+
+	/// Measured milliseconds of CPU time one creature update takes on average
+	const float & averageCost() const { return mAverageCost; }
+
+private:
+	class LongestPending;
+	int interval( const ACreature * creature, const QVector3D & player ) const;
+	void setAwake( int index, bool awake );
+
+	Perception * mPerception;
+	float mBudget;
+	float mAverageCost;
+	FrustumTest mView;
+
+	QVector<ACreature*> mCreatures;
+	/// Ticks since the last update of each creature
+	QVector<int> mTicks;
+	/// Far creatures which are due in the current tick
+	QVector<int> mDue;
+};
+
+
+#endif
@@ -25,6 +25,7 @@
 
 #include <scene/Scene.hpp>
 #include <effect/SplatterSystem.hpp>
+#include <utility/CommandBuffer.hpp>
 #include "../World.hpp"
 #include "../Landscape.hpp"
 #include "../weapon/Knife.hpp"
@@ -36,6 +37,43 @@
 #include <float.h>
 
 
+/// Deferred call to Player::receiveDamage
+class PlayerDamageCommand : public CommandBuffer::ACommand
+{
+public:
+	PlayerDamageCommand( Player * player, int damage, const QVector3D * position, const QVector3D * direction ) :
+		mPlayer( player ), mDamage( damage ),
+		mHasPosition( position != NULL ), mHasDirection( direction != NULL )
+	{
+		if( position )
+			mPosition = *position;
+		if( direction )
+			mDirection = *direction;
+	}
+	virtual void execute()
+		{ mPlayer->receiveDamage( mDamage, mHasPosition ? &mPosition : NULL, mHasDirection ? &mDirection : NULL ); }
+private:
+	Player * mPlayer;
+	int mDamage;
+	bool mHasPosition;
+	bool mHasDirection;
+	QVector3D mPosition;
+	QVector3D mDirection;
+};
+
+
+/// Deferred call to Player::receivePoints
+class PlayerPointsCommand : public CommandBuffer::ACommand
+{
+public:
+	PlayerPointsCommand( Player * player, int points ) : mPlayer( player ), mPoints( points ) {}
+	virtual void execute() { mPlayer->receivePoints( mPoints ); }
+private:
+	Player * mPlayer;
+	int mPoints;
+};
+
+
 Player::Player( World * world ) :
 	ACreature( world )
 {
@@ -335,6 +373,12 @@ void Player::draw2Self()
 
 void Player::receiveDamage( int damage, const QVector3D * position, const QVector3D * direction )
 {
+	if( scene()->commands()->recording() )
+	{
+		scene()->commands()->push( new PlayerDamageCommand( this, damage, position, direction ) );
+		return;
+	}
+
 	if( !mGodMode )
 	{
 		if( mArmor >= damage )
@@ -361,6 +405,12 @@ void Player::receiveDamage( int damage, const QVector3D * position, const QVecto
 
 void Player::receivePoints( int points )
 {
+	if( scene()->commands()->recording() )
+	{
+		scene()->commands()->push( new PlayerPointsCommand( this, points ) );
+		return;
+	}
+
 	float time = mKillTimer;
 	float mult = 1;
 	if( time < 1.0f )
@@ -562,7 +612,9 @@ void Player::updatePosition( const double & delta )
 	}
 
 	QVector3D newPosition = position();
-	mOnGround = !( world()->collideSphere( this, mHeightAboveGround, newPosition, &mGroundNormal ) ).isEmpty();
+	CollisionList<1> collisions;
+	world()->visitSphereCollisions( this, mHeightAboveGround, newPosition, &mGroundNormal, collisions );
+	mOnGround = !collisions.isEmpty();
 	if( mOnGround )
 	{
 		mGroundNormal.normalize();
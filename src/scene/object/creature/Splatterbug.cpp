@@ -24,6 +24,8 @@
 
 Splatterbug::Splatterbug( World * world, float damage ) : ACreature( world )
 {
+    setConcurrentUpdate( true );
+
     mModel = new StaticModel( scene()->glWidget(), "Splatterbug");
     mMaterial = new Material( scene()->glWidget(), "Splatterbug_Splatterbug" );
     mBugSound = new AudioSample("bug_walk2");
@@ -192,13 +194,10 @@ void Splatterbug::setRandomDestination()
 }
 
 bool Splatterbug::isPlayerDetected(float & distToPlayer ){
-    QVector3D vectPlayerSplatter = world()->player()->worldPosition() - worldPosition();
-    distToPlayer = ( vectPlayerSplatter ).length();
-    vectPlayerSplatter = vectPlayerSplatter.normalized();
-
-    double anglePlayerInSight = acos( QVector3D::dotProduct( vectPlayerSplatter, worldDirection() ) ) * 360 / M_PI;
+    const Perception::Percept & percept = world()->perception()->percept( this );
+    distToPlayer = percept.playerDistance;
 
-    if( anglePlayerInSight < 100 && anglePlayerInSight > -100 && distToPlayer < 2.0f * mActDetectionDistance )
+    if( percept.playerInView && distToPlayer < 2.0f * mActDetectionDistance )
     {
         return true;
     }
@@ -212,20 +211,16 @@ bool Splatterbug::isPlayerDetected(float & distToPlayer ){
     }
 }
 bool Splatterbug::isTorchDetected( float & distToTorch ){
-    if(mNightActive){
-        if(world()->player()->getTorch()->parent() != NULL){
-            QVector3D vectTorchSplatter = world()->player()->getTorch().data()->worldPosition() - worldPosition();
-            distToTorch = ( vectTorchSplatter ).length();
-            vectTorchSplatter = vectTorchSplatter.normalized();
-            double angleTorchInSight = acos( QVector3D::dotProduct( vectTorchSplatter, worldDirection() ) ) * 360 / M_PI;
-            if( angleTorchInSight < 100 && angleTorchInSight > -100 && distToTorch < 2.0f * Splatterling::DetectionDistanceOfTorch )
-            {
-                return true;
-            }
-            else if( distToTorch < Splatterling::DetectionDistanceOfTorch )
-            {
-                return true;
-            }
+    const Perception::Percept & percept = world()->perception()->percept( this );
+    if( mNightActive && percept.torchCarried ){
+        distToTorch = percept.torchDistance;
+        if( percept.torchInView && distToTorch < 2.0f * Splatterling::DetectionDistanceOfTorch )
+        {
+            return true;
+        }
+        else if( distToTorch < Splatterling::DetectionDistanceOfTorch )
+        {
+            return true;
         }
     }
     distToTorch = 10000.0;
@@ -311,8 +306,9 @@ void Splatterbug::updateSelf( const double & delta )
 
 
                     QVector3D newPos = position() + direction()*delta * 12.0;
-                    if(world()->landscape()->terrain()->getHeight(newPos)+2.0 > worldPosition().y()){
-                        newPos.setY(world()->landscape()->terrain()->getHeight(newPos)+2.0);
+                    const float groundHeight = world()->landscape()->terrain()->getHeight( newPos ) + 2.0f;
+                    if( groundHeight > worldPosition().y() ){
+                        newPos.setY( groundHeight );
                     }
                     setPosition( newPos );
                 }else{
@@ -70,6 +70,8 @@ public:
 	virtual void drawSelf();
 	virtual const AObject * intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
 		float & length, QVector3D * normal = NULL ) const;
+	virtual void intersectLines( const AObject * exclude, Ray * rays, int count ) const
+		{ intersectLinesSeparately( exclude, rays, count ); }
 
     virtual void receiveDamage( int damage, const QVector3D * position = NULL, const QVector3D * direction = NULL );
 protected:
@@ -30,7 +30,8 @@
 #include <utility/Intersection.hpp>
 #include <utility/Quaternion.hpp>
 #include <utility/Sphere.hpp>
-#include <scene/object/environment/Flower.hpp>
+#include <utility/RayPacket.hpp>
+#include <utility/DrawStatistics.hpp>
 #include <scene/object/AObject.hpp>
 
 #include <math.h>
@@ -404,6 +405,8 @@ static void initTexCoordArray()
 
 Splatterling::Splatterling( World * world , float SplatterlingSizeFactor ) : ACreature( world )
 {
+	setConcurrentUpdate( true );
+
 	mQuadric = gluNewQuadric();
 	gluQuadricTexture( mQuadric, GL_TRUE );
 
@@ -456,6 +459,7 @@ Splatterling::Splatterling( World * world , float SplatterlingSizeFactor ) : ACr
 	{
 		PositionData[i] = GlobalPositionData[i] * this->mSplatterlingSizeFactor;
 	}
+	updateHitBoxes();
 
 	mCoolDown = 0.0f;
 	recalculationOfRotationAngle = true;
@@ -479,20 +483,9 @@ Splatterling::Splatterling( World * world , float SplatterlingSizeFactor ) : ACr
 	this->mFlowerDetected = false;
 	this->mFlowerIsInteresting = true;
 
-	AObject* landFlower = world->landscape()->getFlowers().data();
-	Flower * flowers = dynamic_cast<Flower*>(landFlower);
-	if( flowers )
-	{
-		if( flowers->getInstances().size() > 0 )
-			mFlowersAvailable = true;
-		else
-			mFlowersAvailable = false;
-	}else{
-		mFlowersAvailable = false;
-	}
+	mFlowersAvailable = world->perception()->hasFlowers();
 
 	this->mFlowerFlyTimer = Splatterling::MaxFlyAroundFlowerTimer;
-	updateNearestFlowerPosition();
 }
 
 
@@ -580,6 +573,7 @@ void Splatterling::updateSelf( const double & delta )
 			{
 				PositionData[i] = GlobalPositionData[i] * this->mSplatterlingSizeFactor;
 			}
+			updateWingHitBoxes();
 			break;
 		}
 		case ALIVE:
@@ -643,8 +637,9 @@ void Splatterling::updateSelf( const double & delta )
 					setRotation( QQuaternion::slerp( rotation(), targetRotation, 5 * delta ) );
 
 					QVector3D newPos = position() + direction()*delta * 12.0;
-					if(world()->landscape()->terrain()->getHeight(newPos)+2.0 > worldPosition().y()){
-						newPos.setY(world()->landscape()->terrain()->getHeight(newPos)+2.0);
+					const float groundHeight = world()->landscape()->terrain()->getHeight( newPos ) + 2.0f;
+					if( groundHeight > worldPosition().y() ){
+						newPos.setY( groundHeight );
 					}
 
 					setPosition( newPos );
@@ -662,8 +657,9 @@ void Splatterling::updateSelf( const double & delta )
 					setRotation( QQuaternion::slerp( rotation(), targetRotation, 5 * delta ) );
 
 					QVector3D newPos = position() + direction()*delta * 12.0;
-					if(world()->landscape()->terrain()->getHeight(newPos)+2.0 > worldPosition().y()){
-						newPos.setY(world()->landscape()->terrain()->getHeight(newPos)+2.0);
+					const float groundHeight = world()->landscape()->terrain()->getHeight( newPos ) + 2.0f;
+					if( groundHeight > worldPosition().y() ){
+						newPos.setY( groundHeight );
 					}
 
 					setPosition( newPos );
@@ -687,8 +683,9 @@ void Splatterling::updateSelf( const double & delta )
 					setRotation( QQuaternion::slerp( rotation(), targetRotation, 5 * delta ) );
 
 					QVector3D newPos = position() + direction()*delta * 12.0;
-					if(world()->landscape()->terrain()->getHeight(newPos)+2.0 > worldPosition().y()){
-						newPos.setY(world()->landscape()->terrain()->getHeight(newPos)+2.0);
+					const float groundHeight = world()->landscape()->terrain()->getHeight( newPos ) + 2.0f;
+					if( groundHeight > worldPosition().y() ){
+						newPos.setY( groundHeight );
 					}
 
 					setPosition( newPos );
@@ -834,10 +831,14 @@ void Splatterling::drawSelf()
 		//body
 		glDrawArrays( GL_TRIANGLE_FAN, 6, 10 );
 		glDrawArrays( GL_TRIANGLE_STRIP, 16, 18 );
+		DrawStatistics::countDrawCall( 10-2 );
+		DrawStatistics::countDrawCall( 18-2 );
 
 		//head
 		glDrawArrays( GL_TRIANGLE_FAN, Splatterling::BodyVertexCount, 10 );
 		glDrawArrays( GL_TRIANGLE_STRIP, Splatterling::BodyVertexCount + 10, 18 );
+		DrawStatistics::countDrawCall( 10-2 );
+		DrawStatistics::countDrawCall( 18-2 );
 //		glDrawArrays( GL_TRIANGLE_STRIP, 6 + Splatterling::HeadVertexCount-4, 4 );
 	}
 
@@ -847,11 +848,13 @@ void Splatterling::drawSelf()
 	if( !mWingLeftDisintegrated )
 	{
 		glDrawArrays( GL_TRIANGLES, Splatterling::BodyVertexCount + Splatterling::HeadVertexCount, 3 );
+		DrawStatistics::countDrawCall( 1 );
 	}
 
 	if( !mWingRightDisintegrated )
 	{
 		glDrawArrays( GL_TRIANGLES, Splatterling::BodyVertexCount + Splatterling::HeadVertexCount + 3, 3 );
+		DrawStatistics::countDrawCall( 1 );
 	}
 
 //	glDisableClientState( GL_COLOR_ARRAY );
@@ -869,34 +872,64 @@ const AObject * Splatterling::intersectLine( const AObject * exclude, const QVec
 
 	if( Sphere::intersectCulledRay( worldPosition(), boundingSphereRadius(), origin, direction, &rayLength ) )
 	{
-		if( rayLength < length )
-		{
-			rayLength = length;
+		if( rayLength < length && intersectBodyParts( origin, direction, length, normal ) )
+			nearestTarget = this;
+	}
 
-			bool hit = false;
+	return nearestTarget;
+}
 
-			hit |= intersectHead( origin, direction, rayLength );
-			hit |= intersectBody( origin, direction, rayLength );
-			hit |= intersectRightWing( origin, direction, rayLength );
-			hit |= intersectLeftWing( origin, direction, rayLength );
 
-			if( hit )
-			{
-				if( rayLength < length )
-				{
-					// intersection closer than previous intersections?
-					length = rayLength;
+void Splatterling::intersectLines( const AObject * exclude, Ray * rays, int count ) const
+{
+	AObject::intersectLines( exclude, rays, count );
 
-					if( normal )	// interested in normal?
-						*normal = origin - worldPosition();
+	const QVector3D center = worldPosition();
+	const float radius = boundingSphereRadius();
+	RayPacket packet;
+	for( int first = 0; first < count; first += RayPacket::size )
+	{
+		const int packetSize = qMin( (int)RayPacket::size, count-first );
+		packet.clear();
+		for( int i = 0; i < packetSize; ++i )
+			packet.set( i, rays[first+i].origin, rays[first+i].direction, rays[first+i].length );
 
-					nearestTarget = this;
-				}
-			}
+		const int candidates = packet.intersectSphere( center, radius );
+		for( int i = 0; i < packetSize; ++i )
+		{
+			if( !( candidates & (1<<i) ) )
+				continue;
+			Ray & ray = rays[first+i];
+			if( intersectBodyParts( ray.origin, ray.direction, ray.length, &ray.normal ) )
+				ray.target = this;
 		}
 	}
+}
 
-	return nearestTarget;
+
+bool Splatterling::intersectBodyParts( const QVector3D & origin, const QVector3D & direction, float & length, QVector3D * normal ) const
+{
+	float rayLength = length;
+
+	// transformations are rigid, so distances along the local ray equal world distances
+	QVector3D localOrigin = pointToLocal( origin );
+	QVector3D localDirection = directionToLocal( direction );
+
+	bool hit = false;
+
+	hit |= intersectHead( localOrigin, localDirection, rayLength );
+	hit |= intersectBody( localOrigin, localDirection, rayLength );
+	hit |= intersectRightWing( localOrigin, localDirection, rayLength );
+	hit |= intersectLeftWing( localOrigin, localDirection, rayLength );
+
+	if( !hit || rayLength >= length )
+		return false;
+
+	// intersection closer than previous intersections
+	length = rayLength;
+	if( normal )	// interested in normal?
+		*normal = origin - worldPosition();
+	return true;
 }
 
 
@@ -904,9 +937,9 @@ bool Splatterling::intersectBody( const QVector3D & origin, const QVector3D & di
 {
 	float rayLength;
 
-	if( !mHeadDisintegrated )
+	if( !mHeadDisintegrated && mHitBoxes[TARGET_BODY].intersectCulledRay( origin, direction, &rayLength ) && rayLength < intersectionDistance )
 	{
-		if( Intersection::intersectTriangleFan( PositionData, 6, 15, modelMatrix(), origin, direction, &rayLength ) )
+		if( Intersection::intersectTriangleFan( PositionData, 6, 15, origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -915,7 +948,7 @@ bool Splatterling::intersectBody( const QVector3D & origin, const QVector3D & di
 			}
 		}
 
-		if( Intersection::intersectTriangleStrip( PositionData, 16, BodyVertexCount - 1, modelMatrix(), origin, direction, &rayLength ) )
+		if( Intersection::intersectTriangleStrip( PositionData, 16, BodyVertexCount - 1, origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -935,15 +968,15 @@ bool Splatterling::intersectLeftWing( const QVector3D & origin, const QVector3D
 	float rayLength;
 	bool hit = false;
 
-	if( !mWingLeftDisintegrated )
+	if( !mWingLeftDisintegrated && mHitBoxes[TARGET_WING_LEFT].intersectCulledRay( origin, direction, &rayLength ) && rayLength < intersectionDistance )
 	{
 		//LeftWing
 		for( int i = 0; i < 3; i++ )
 		{
 			v[i] = QVector3D( PositionData[( BodyVertexCount + HeadVertexCount + i ) * 3], PositionData[( BodyVertexCount + HeadVertexCount + i ) * 3 + 1], PositionData[( BodyVertexCount + HeadVertexCount + i ) * 3 + 2] );
 		}
-		if( Triangle::intersectCulledRay( this->pointToWorld(v[0]), this->pointToWorld(v[1]), this->pointToWorld(v[2]), origin, direction, &rayLength ) ||
-			Triangle::intersectCulledRay( this->pointToWorld(v[0]), this->pointToWorld(v[2]), this->pointToWorld(v[1]), origin, direction, &rayLength ) )
+		if( Triangle::intersectCulledRay( v[0], v[1], v[2], origin, direction, &rayLength ) ||
+			Triangle::intersectCulledRay( v[0], v[2], v[1], origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -963,15 +996,15 @@ bool Splatterling::intersectRightWing( const QVector3D & origin, const QVector3D
 	float rayLength;
 	bool hit = false;
 
-	if( !mWingRightDisintegrated )
+	if( !mWingRightDisintegrated && mHitBoxes[TARGET_WING_RIGHT].intersectCulledRay( origin, direction, &rayLength ) && rayLength < intersectionDistance )
 	{
 		//rightWing
 		for( int i = 0; i < 3; i++ )
 		{
 			v[i] = QVector3D( PositionData[( BodyVertexCount + HeadVertexCount + 3 + i ) * 3], PositionData[( BodyVertexCount + HeadVertexCount + 3 + i ) * 3 + 1], PositionData[( BodyVertexCount + HeadVertexCount + 3 + i ) * 3 + 2] );
 		}
-		if( Triangle::intersectCulledRay( this->pointToWorld(v[0]), this->pointToWorld(v[1]), this->pointToWorld(v[2]), origin, direction, &rayLength ) ||
-			Triangle::intersectCulledRay( this->pointToWorld(v[0]), this->pointToWorld(v[2]), this->pointToWorld(v[1]), origin, direction, &rayLength ) )
+		if( Triangle::intersectCulledRay( v[0], v[1], v[2], origin, direction, &rayLength ) ||
+			Triangle::intersectCulledRay( v[0], v[2], v[1], origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -990,10 +1023,10 @@ bool Splatterling::intersectHead( const QVector3D & origin, const QVector3D & di
 	float rayLength;
 	bool hit = false;
 
-	if( !mHeadDisintegrated )
+	if( !mHeadDisintegrated && mHitBoxes[TARGET_HEAD].intersectCulledRay( origin, direction, &rayLength ) && rayLength < intersectionDistance )
 	{
 		//inner
-		if( Intersection::intersectTriangleFan( PositionData, BodyVertexCount, BodyVertexCount + 9, modelMatrix(), origin, direction, &rayLength ) )
+		if( Intersection::intersectTriangleFan( PositionData, BodyVertexCount, BodyVertexCount + 9, origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -1003,7 +1036,7 @@ bool Splatterling::intersectHead( const QVector3D & origin, const QVector3D & di
 		}
 
 		//Outter
-		if( Intersection::intersectTriangleStrip( PositionData, BodyVertexCount + 10, BodyVertexCount + HeadVertexCount - 5, modelMatrix(), origin, direction, &rayLength ) )
+		if( Intersection::intersectTriangleStrip( PositionData, BodyVertexCount + 10, BodyVertexCount + HeadVertexCount - 5, origin, direction, &rayLength ) )
 		{
 			if( rayLength < intersectionDistance )
 			{
@@ -1022,18 +1055,19 @@ void Splatterling::receiveDamage( int damage, const QVector3D * position, const
 	float rayLength = FLT_MAX;
 	int targetBodyPart = TARGET_BODY;
 
-	QVector3D mTrailStart = ( *position - (*direction) * 0.01f );
+	QVector3D mTrailStart = pointToLocal( *position - (*direction) * 0.01f );
+	QVector3D localDirection = directionToLocal( *direction );
 
-	if( intersectBody( mTrailStart, *direction, rayLength ) )
+	if( intersectBody( mTrailStart, localDirection, rayLength ) )
 		targetBodyPart = TARGET_BODY;
 
-	if( intersectRightWing( mTrailStart, *direction, rayLength ) )
+	if( intersectRightWing( mTrailStart, localDirection, rayLength ) )
 		targetBodyPart = TARGET_WING_RIGHT;
 
-	if( intersectLeftWing( mTrailStart, *direction, rayLength ) )
+	if( intersectLeftWing( mTrailStart, localDirection, rayLength ) )
 		targetBodyPart = TARGET_WING_LEFT;
 
-	if( intersectHead( mTrailStart, *direction, rayLength ) )
+	if( intersectHead( mTrailStart, localDirection, rayLength ) )
 		targetBodyPart = TARGET_HEAD;
 
 	damage *= damageMultiplicationFactor[targetBodyPart];
@@ -1089,6 +1123,35 @@ void Splatterling::receiveDamage( int damage, const QVector3D * position, const
 }
 
 
+void Splatterling::updateHitBoxes()
+{
+	mHitBoxes[TARGET_BODY].clear();
+	for( int i = 6; i < BodyVertexCount; i++ )
+		mHitBoxes[TARGET_BODY].extend( QVector3D( PositionData[i*3], PositionData[i*3+1], PositionData[i*3+2] ) );
+
+	mHitBoxes[TARGET_HEAD].clear();
+	for( int i = BodyVertexCount; i <= BodyVertexCount + HeadVertexCount - 5; i++ )
+		mHitBoxes[TARGET_HEAD].extend( QVector3D( PositionData[i*3], PositionData[i*3+1], PositionData[i*3+2] ) );
+
+	updateWingHitBoxes();
+}
+
+
+void Splatterling::updateWingHitBoxes()
+{
+	const int leftWing = BodyVertexCount + HeadVertexCount;
+	const int rightWing = leftWing + 3;
+
+	mHitBoxes[TARGET_WING_LEFT].clear();
+	mHitBoxes[TARGET_WING_RIGHT].clear();
+	for( int i = 0; i < 3; i++ )
+	{
+		mHitBoxes[TARGET_WING_LEFT].extend( QVector3D( PositionData[(leftWing+i)*3], PositionData[(leftWing+i)*3+1], PositionData[(leftWing+i)*3+2] ) );
+		mHitBoxes[TARGET_WING_RIGHT].extend( QVector3D( PositionData[(rightWing+i)*3], PositionData[(rightWing+i)*3+1], PositionData[(rightWing+i)*3+2] ) );
+	}
+}
+
+
 void Splatterling::recalculateWingPosition( const double & delta )
 {
 	if( wingUpMovement )
@@ -1109,6 +1172,8 @@ void Splatterling::recalculateWingPosition( const double & delta )
 			wingUpMovement = true;
 		}
 	}
+
+	updateWingHitBoxes();
 }
 
 void Splatterling::doWingUpMove( const double & delta )
@@ -1133,50 +1198,39 @@ void Splatterling::doWingDownMove( const double & delta )
 
 bool Splatterling::moveWingsToGround( const double & delta )
 {
-	QVector3D WingPos(PositionData[Splatterling::WingOneYPos-1], PositionData[Splatterling::WingOneYPos], PositionData[Splatterling::WingOneYPos+1]);
-	WingPos = pointToWorld(WingPos);
-	float height = world()->landscape()->terrain()->getHeight(WingPos);
-	PositionData[Splatterling::WingOneYPos] -= (WingPos.y()-height)-0.01f;
-
-	WingPos = QVector3D(PositionData[Splatterling::WingOneYPos+2], PositionData[Splatterling::WingOneYPos+3], PositionData[Splatterling::WingOneYPos+4]);
-	WingPos = pointToWorld(WingPos);
-	height = world()->landscape()->terrain()->getHeight(WingPos);
-	PositionData[Splatterling::WingOneYPos + 3] -= (WingPos.y()-height)-0.01f;
-
-
-	WingPos = QVector3D(PositionData[Splatterling::WingTwoYPos-1], PositionData[Splatterling::WingTwoYPos], PositionData[Splatterling::WingTwoYPos+1]);
-	WingPos = pointToWorld(WingPos);
-	height = world()->landscape()->terrain()->getHeight(WingPos);
-	PositionData[Splatterling::WingTwoYPos] -= (WingPos.y()-height)-0.01f;
-
-	WingPos = QVector3D(PositionData[Splatterling::WingTwoYPos+2], PositionData[Splatterling::WingTwoYPos+3], PositionData[Splatterling::WingTwoYPos+4]);
-	WingPos = pointToWorld(WingPos);
-	height = world()->landscape()->terrain()->getHeight(WingPos);
-	PositionData[Splatterling::WingTwoYPos + 3] -= (WingPos.y()-height)-0.01f;
+	// the tips of both wings - sampled at once
+	const int tips[4] = { Splatterling::WingOneYPos, Splatterling::WingOneYPos+3, Splatterling::WingTwoYPos, Splatterling::WingTwoYPos+3 };
+	QVector3D wingPositions[4];
+	float x[4], z[4], heights[4];
+	for( int i = 0; i < 4; ++i )
+	{
+		wingPositions[i] = pointToWorld( QVector3D( PositionData[tips[i]-1], PositionData[tips[i]], PositionData[tips[i]+1] ) );
+		x[i] = wingPositions[i].x();
+		z[i] = wingPositions[i].z();
+	}
+	world()->landscape()->terrain()->getHeights( x, z, heights, 4 );
+	for( int i = 0; i < 4; ++i )
+		PositionData[tips[i]] -= (wingPositions[i].y()-heights[i])-0.01f;
 
+	updateWingHitBoxes();
 	return true;
 }
 
 void Splatterling::isTorchDetected( float & distToTorch )
 {
-	if(mNightActive){
-		if(world()->player()->getTorch()->parent() != NULL){
-
-			QVector3D vectTorchSplatter = world()->player()->getTorch().data()->worldPosition() - worldPosition();
-			distToTorch = ( vectTorchSplatter ).length();
-			vectTorchSplatter = vectTorchSplatter.normalized();
-			double angleTorchInSight = acos( QVector3D::dotProduct( vectTorchSplatter, worldDirection() ) ) * 360 / M_PI;
-
-			if( angleTorchInSight < 100 && angleTorchInSight > -100 && distToTorch < 2.0f * Splatterling::DetectionDistanceOfTorch )
-			{
-				mTorchDetected = true;
-				return;
-			}
-			else if( distToTorch < Splatterling::DetectionDistanceOfTorch )
-			{
-				mTorchDetected = true;
-				return;
-			}
+	const Perception::Percept & percept = world()->perception()->percept( this );
+	if( mNightActive && percept.torchCarried )
+	{
+		distToTorch = percept.torchDistance;
+		if( percept.torchInView && distToTorch < 2.0f * Splatterling::DetectionDistanceOfTorch )
+		{
+			mTorchDetected = true;
+			return;
+		}
+		else if( distToTorch < Splatterling::DetectionDistanceOfTorch )
+		{
+			mTorchDetected = true;
+			return;
 		}
 	}
 
@@ -1186,13 +1240,10 @@ void Splatterling::isTorchDetected( float & distToTorch )
 
 void Splatterling::isPlayerDetected(float & distToPlayer )
 {
-	QVector3D vectPlayerSplatter = world()->player()->worldPosition() - worldPosition();
-	distToPlayer = ( vectPlayerSplatter ).length();
-	vectPlayerSplatter = vectPlayerSplatter.normalized();
-
-	double anglePlayerInSight = acos( QVector3D::dotProduct( vectPlayerSplatter, worldDirection() ) ) * 360 / M_PI;
+	const Perception::Percept & percept = world()->perception()->percept( this );
+	distToPlayer = percept.playerDistance;
 
-	if( anglePlayerInSight < 100 && anglePlayerInSight > -100 && distToPlayer < 2.0f * mActDetectionDistance )
+	if( percept.playerInView && distToPlayer < 2.0f * mActDetectionDistance )
 	{
 		playerDetected = true;
 	}
@@ -1222,12 +1273,12 @@ void Splatterling::isFlowerDetected( float & distToFlower, const double & delta)
 		}
 	}else
 	{
-		updateNearestFlowerPosition();
-		QVector3D vectFlowerSplatter = mDetectedFlowerPosition - worldPosition();
-		distToFlower = ( vectFlowerSplatter ).length();
-
-		if( distToFlower < Splatterling::DetectionDistanceOfFlower )
+		// the perception only searches flowers within the detection distance
+		const Perception::Percept & percept = world()->perception()->percept( this );
+		distToFlower = percept.flowerDistance;
+		if( percept.flowerFound )
 		{
+			mDetectedFlowerPosition = percept.flower;
 			mFlowerDetected = true;
 		}
 		else
@@ -1237,26 +1288,6 @@ void Splatterling::isFlowerDetected( float & distToFlower, const double & delta)
 	}
 }
 
-void Splatterling::updateNearestFlowerPosition()
-{
-	if( mFlowersAvailable )
-	{
-		AObject* landFlower = world()->landscape()->getFlowers().data();
-		Flower * flowers = dynamic_cast<Flower*>(landFlower);
-		float shortestDist = world()->landscape()->terrain()->mapSize().width();
-
-		for (int i = 0; i < flowers->getInstances().size(); ++i)
-		{
-			float tmpDistToFlower =  (flowers->getInstances().at(i)-worldPosition()).length();
-			if( tmpDistToFlower < shortestDist)
-			{
-				shortestDist = tmpDistToFlower;
-				mDetectedFlowerPosition = flowers->getInstances().at(i);
-			}
-		}
-	}
-}
-
 void Splatterling::flyAroundTarget( QVector3D & mTarget, bool & recalculationOfRotationAngle, const double & delta, const float & dist )
 {
 	if( recalculationOfRotationAngle )
@@ -1297,9 +1328,10 @@ void Splatterling::flyAroundTarget( QVector3D & mTarget, bool & recalculationOfR
 	setRotation( QQuaternion::slerp( rotation(), targetRotation, 5 * delta ) );
 
 	QVector3D newPos = position() + direction()*delta * 8.0;
-	if(world()->landscape()->terrain()->getHeight(newPos)+2.0 > worldPosition().y())
+	const float groundHeight = world()->landscape()->terrain()->getHeight( newPos ) + 2.0f;
+	if( groundHeight > worldPosition().y() )
 	{
-		newPos.setY(world()->landscape()->terrain()->getHeight(newPos)+2.0);
+		newPos.setY( groundHeight );
 	}
 	setPosition( newPos );
 }
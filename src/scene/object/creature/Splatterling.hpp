@@ -27,6 +27,7 @@
 
 #include "ACreature.hpp"
 #include "resource/AudioSample.hpp"
+#include <utility/Box.hpp>
 
 
 struct GLUquadric;
@@ -97,10 +98,13 @@ public:
 
 	virtual const AObject * intersectLine( const AObject * exclude, const QVector3D & origin, const QVector3D & direction,
 		float & length, QVector3D * normal = NULL ) const;
+	/// Tests the rays against the bounding sphere four at a time - only rays passing it are tested against the body parts
+	virtual void intersectLines( const AObject * exclude, Ray * rays, int count ) const;
 
 	virtual void receiveDamage( int damage, const QVector3D * position = NULL, const QVector3D * direction = NULL );
 	virtual void recalculateWingPosition( const double & delta );
 
+	/// Part intersection tests - the ray has to be given in local object space
 	virtual bool intersectBody(const QVector3D & origin, const QVector3D & direction, float & intersectionDistance) const;
 	virtual bool intersectRightWing(const QVector3D & origin, const QVector3D & direction, float & intersectionDistance) const;
 	virtual bool intersectLeftWing(const QVector3D & origin, const QVector3D & direction, float & intersectionDistance) const;
@@ -117,7 +121,12 @@ private:
 	void isTorchDetected( float & distToTorch );
 	void isPlayerDetected( float & distToPlayer );
 	void isFlowerDetected( float & distToFlower, const double & delta );
-	void updateNearestFlowerPosition();
+	/// Recalculates the local bounding boxes of all body parts
+	void updateHitBoxes();
+	/// Recalculates the local bounding boxes of the wings after they moved
+	void updateWingHitBoxes();
+	/// Intersects a ray passing the bounding sphere with the body parts - length and normal are updated on intersection
+	bool intersectBodyParts( const QVector3D & origin, const QVector3D & direction, float & length, QVector3D * normal ) const;
 	void flyAroundTarget( QVector3D & mTarget, bool & recalculationOfRotationAngle, const double & delta, const float & dist );
 	GLUquadric * mQuadric;
 	Material * mMaterial;
@@ -126,6 +135,8 @@ private:
 	float mHeightAboveGround;
 	GLuint vboId;
 	GLfloat PositionData[PositionSize/sizeof( GLfloat )];
+	/// Local bounding boxes of the body parts, indexed by TARGET_BODY ... TARGET_WING_LEFT
+	Box mHitBoxes[4];
 	QVector3D destinationPoint;
 	bool wingUpMovement;
 	bool playerDetected;
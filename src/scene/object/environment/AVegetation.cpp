@@ -22,13 +22,73 @@
  */
 
 #include "AVegetation.hpp"
+#include "../Eye.hpp"
+
+#include <resource/StaticModel.hpp>
+#include <resource/Impostor.hpp>
+#include <scene/Scene.hpp>
 
 #include <QSettings>
 
+#include <float.h>
+
 int AVegetation::sQuality = 0;
 
 AVegetation::AVegetation( World * world, int priority , float boundingSphereRadius) :
 	AWorldObject( world, boundingSphereRadius ),
-	mPriority( priority )
+	mCulledCutOff( -1.0f ),
+	mPriority( priority ),
+	mDrawDistance( FLT_MAX ),
+	mFullDensity( 1.0f ),
+	mImpostorDistance( FLT_MAX ),
+	mImpostorFade( 0.0f )
+{
+}
+
+
+void AVegetation::drawInstances( StaticModel * model, const QVector<QMatrix4x4> & instances )
 {
+	// the instances may be placed after the constructor of the group
+	if( mVisibleInstances.size() != instances.size() )
+	{
+		mVisibleInstances.build( instances, model->boundingSphereRadius(), mFullDensity );
+		mCulledCutOff = -1.0f;
+	}
+
+	// the fog hides everything beyond the far plane, lower qualities pull the cut-off closer
+	float cutOff = qMin( mDrawDistance, scene()->eye()->farPlane() * 1.1f );
+	cutOff *= 0.25f + 0.75f * sQuality / 99.0f;
+	// within the fade band the impostors are drawn over the models
+	const float impostorStart = mImpostorDistance < FLT_MAX ? mImpostorDistance - mImpostorFade : FLT_MAX;
+
+	// the refraction pass looks through the main pass's eye - only the mirrored reflection needs instances of it's own
+	const QMatrix4x4 viewProjection = scene()->eye()->projectionMatrix() * scene()->eye()->viewMatrix();
+	if( cutOff != mCulledCutOff || viewProjection != mCulledViewProjection )
+	{
+		// the instances are placed in world space
+		FrustumTest frustumTest;
+		frustumTest.sync( scene()->eye()->projectionMatrix(), scene()->eye()->viewMatrix() );
+		mVisibleInstances.cull( frustumTest, scene()->eye()->position(), cutOff, impostorStart, mImpostorDistance );
+
+		if( StaticModel::instancingSupported() )
+		{
+			if( !mVisibleInstances.visible().isEmpty() )
+				StaticModel::uploadInstances( mInstanceBuffer, mVisibleInstances.visible(), QGLBuffer::StreamDraw );
+			if( !mVisibleInstances.impostors().isEmpty() )
+				StaticModel::uploadInstances( mImpostorBuffer, mVisibleInstances.impostors(), QGLBuffer::StreamDraw );
+		}
+		mCulledViewProjection = viewProjection;
+		mCulledCutOff = cutOff;
+	}
+
+	if( !mVisibleInstances.visible().isEmpty() )
+	{
+		model->draw( scene()->eye()->viewMatrix(), mVisibleInstances.visible(), mInstanceBuffer );
+	}
+
+	if( !mVisibleInstances.impostors().isEmpty() )
+	{
+		model->impostor()->draw( scene()->eye()->viewMatrix(), scene()->eye()->position(), mVisibleInstances.impostors(),
+			mImpostorBuffer, impostorStart, mImpostorDistance );
+	}
 }
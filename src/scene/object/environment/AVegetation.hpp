@@ -25,13 +25,36 @@
 #define AVEGETATION_HPP
 
 #include "../AWorldObject.hpp"
+#include "VegetationInstances.hpp"
+
+#include <QGLBuffer>
+
+class StaticModel;
 
 class AVegetation : public AWorldObject
 {
 	static int sQuality;
 
+	VegetationInstances mVisibleInstances;
+	QGLBuffer mInstanceBuffer;
+	QGLBuffer mImpostorBuffer;
+	/// Eye and cut-off the instances were last culled and uploaded for - passes sharing them draw the buffers again
+	QMatrix4x4 mCulledViewProjection;
+	float mCulledCutOff;
+
 protected:
 	int mPriority;
+	/// Distance to the eye instances are drawn up to at the highest quality
+	float mDrawDistance;
+	/// Fraction of the draw distance all instances are drawn up to - their density falls off linearly beyond
+	float mFullDensity;
+	/// Distance to the eye instances are drawn as impostors beyond - FLT_MAX draws models only
+	float mImpostorDistance;
+	/// Width of the band before the impostor distance the impostors fade in over the models
+	float mImpostorFade;
+
+	/// Draws the instances within the frustum and the draw distance
+	void drawInstances( StaticModel * model, const QVector<QMatrix4x4> & instances );
 
 public:
 	AVegetation( World * world, int priority, float boundingSphereRadius=0.0f );
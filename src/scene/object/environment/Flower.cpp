@@ -28,8 +28,6 @@
 #include <scene/object/Landscape.hpp>
 #include <resource/StaticModel.hpp>
 #include <utility/RandomNumber.hpp>
-#include <utility/Capsule.hpp>
-#include <utility/Sphere.hpp>
 
 
 Flower::Flower( Landscape * landscape, const QString & filename, const QPoint & mapPosition, int mapRadius, int number, int priority ) :
@@ -42,6 +40,11 @@ Flower::Flower( Landscape * landscape, const QString & filename, const QPoint &
 	mModel = new StaticModel( world()->scene()->glWidget(), filename );
 	setPosition( QVector3D( position.x(), 0, position.y() ) );
 	setBoundingSphere( qMax( radi.width(),radi.height() ) );
+	// small plants thin out in the distance
+	mDrawDistance = 200.0f;
+	mFullDensity = 0.5f;
+	// too small to be noticed in the distorted reflection
+	setRenderPasses( RenderPass::MAIN_BIT | RenderPass::REFRACTION_BIT );
 
 	for( int i=0; i<number; i++ )
 	{
@@ -56,9 +59,11 @@ Flower::Flower( Landscape * landscape, const QString & filename, const QPoint &
 			if( tries > 1000 )
 			{
 				qWarning() << QObject::tr("Giving up placing trees - no suitable position found");
-				return;
+				break;
 			}
 		} while( treePos.y() < mLandscape->waterHeight() );
+		if( tries > 1000 )
+			break;
 
 		QMatrix4x4 pos;
 		pos.translate( treePos );
@@ -87,32 +92,6 @@ void Flower::updateSelf( const double & delta )
 void Flower::drawSelf()
 {
 	if( mPriority >= 99-quality() )
-		mModel->draw( scene()->eye()->viewMatrix(), mInstances );
+		drawInstances( mModel, mInstances );
 }
 
-
-QVector<const AObject*> Flower::collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal )
-{
-	QVector<const AObject*> collides = AObject::collideSphere( exclude, radius, center, normal );
-	float depth;
-	QVector3D tmpNormal;
-
-	if( !Sphere::intersectSphere( position(), boundingSphereRadius(), center, radius, &tmpNormal, &depth ) )
-		return collides;	// return if we aren't even near the forest
-
-	for( QVector<QMatrix4x4>::iterator i = mInstances.begin(); i != mInstances.end(); ++i )
-	{
-		float treeScale = (*i).column(0).length();
-		QVector3D treeBottom = (*i).column(3).toVector3D() + (*i).mapVector( QVector3D(0,-10,0) );
-		QVector3D treeTop = (*i).column(3).toVector3D() + (*i).mapVector( QVector3D(0,60,0) );
-		if( Capsule::intersectSphere( treeBottom, treeTop, treeScale, center, radius/3, &tmpNormal, &depth ) )
-		{
-			collides.append( this );
-			center += tmpNormal * depth;
-			if( normal )
-				*normal += tmpNormal;
-		}
-	}
-
-	return collides;
-}
@@ -35,6 +35,10 @@
 class Landscape;
 class StaticModel;
 
+/// A patch of flowers scattered around a position on the terrain
+/**
+ * Flowers are too small to block anyone - unlike Forest they have no colliders.
+ */
 class Flower : public AVegetation
 {
 public:
@@ -45,8 +49,6 @@ public:
 	virtual void drawSelf();
 	QVector<QVector3D> getInstances(){ return mPositions; }
 
-	virtual QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal );
-
 private:
 	Landscape * mLandscape;
 	QVector<QMatrix4x4> mInstances;
@@ -28,11 +28,11 @@
 #include <scene/object/Landscape.hpp>
 #include <resource/StaticModel.hpp>
 #include <utility/RandomNumber.hpp>
-#include <utility/Capsule.hpp>
 #include <utility/Sphere.hpp>
 
 
-Forest::Forest( Landscape * landscape, const QString & filename, const QPoint & mapPosition, int mapRadius, int number, int priority ) :
+Forest::Forest( Landscape * landscape, const QString & filename, const QPoint & mapPosition, int mapRadius, int number, int priority,
+	float impostorDistance, float impostorFade ) :
 	AVegetation( landscape->world(), priority ),
 	mLandscape( landscape )
 {
@@ -40,6 +40,12 @@ Forest::Forest( Landscape * landscape, const QString & filename, const QPoint &
 	QSizeF radi = mLandscape->terrain()->fromMap( QSize( mapRadius, mapRadius ) );
 
 	mModel = new StaticModel( world()->scene()->glWidget(), filename );
+	if( impostorDistance > 0.0f )
+	{
+		mImpostorDistance = impostorDistance;
+		mImpostorFade = qBound( 0.0f, impostorFade, impostorDistance );
+		mModel->impostor();	// rendering the atlas takes a while - better now than in the middle of the game
+	}
 	setPosition( QVector3D( position.x(), 0, position.y() ) );
 	setBoundingSphere( qMax( radi.width(),radi.height() ) );
 
@@ -56,9 +62,11 @@ Forest::Forest( Landscape * landscape, const QString & filename, const QPoint &
 			if( tries > 1000 )
 			{
 				qWarning() << QObject::tr("Giving up placing trees - no suitable position found");
-				return;
+				break;
 			}
 		} while( treePos.y() < mLandscape->waterHeight() );
+		if( tries > 1000 )
+			break;
 
 		QMatrix4x4 pos;
 		pos.translate( treePos );
@@ -69,6 +77,9 @@ Forest::Forest( Landscape * landscape, const QString & filename, const QPoint &
 
 		mInstances.append( pos );
 	}
+
+	// the trunk
+	mColliders.build( mInstances, QVector3D( 0, -10, 0 ), QVector3D( 0, 60, 0 ), 1.0f );
 }
 
 
@@ -86,32 +97,22 @@ void Forest::updateSelf( const double & delta )
 void Forest::drawSelf()
 {
 	if( mPriority >= 99-quality() )
-		mModel->draw( scene()->eye()->viewMatrix(), mInstances );
+		drawInstances( mModel, mInstances );
 }
 
 
-QVector<const AObject*> Forest::collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal ) const
+void Forest::visitSphereCollisions( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const
 {
-	QVector<const AObject*> collides = AObject::collideSphere( exclude, radius, center, normal );
+	AObject::visitSphereCollisions( exclude, radius, center, normal, visitor );
 	float depth;
 	QVector3D tmpNormal;
 
 	if( !Sphere::intersectSphere( position(), boundingSphereRadius(), center, radius, &tmpNormal, &depth ) )
-		return collides;	// return if we aren't even near the forest
+		return;	// return if we aren't even near the forest
 
-	for( QVector<QMatrix4x4>::const_iterator i = mInstances.constBegin(); i != mInstances.constEnd(); ++i )
+	int hits = mColliders.pushSphere( radius/3, center, normal );
+	for( int i = 0; i < hits; i++ )
 	{
-		float treeScale = (*i).column(0).length();
-		QVector3D treeBottom = (*i).column(3).toVector3D() + (*i).mapVector( QVector3D(0,-10,0) );
-		QVector3D treeTop = (*i).column(3).toVector3D() + (*i).mapVector( QVector3D(0,60,0) );
-		if( Capsule::intersectSphere( treeBottom, treeTop, treeScale, center, radius/3, &tmpNormal, &depth ) )
-		{
-			collides.append( this );
-			center += tmpNormal * depth;
-			if( normal )
-				*normal += tmpNormal;
-		}
+		visitor.visit( this );
 	}
-
-	return collides;
 }
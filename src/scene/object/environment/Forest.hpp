@@ -25,6 +25,7 @@
 #define SCENE_OBJECT_ENVIRONMENT_FOREST_INCLUDED
 
 #include "AVegetation.hpp"
+#include "VegetationColliders.hpp"
 #include "../../Scene.hpp"
 
 #include <QPointF>
@@ -38,17 +39,23 @@ class StaticModel;
 class Forest : public AVegetation
 {
 public:
-	Forest( Landscape * landscape, const QString & filename, const QPoint & mapPosition, int mapRadius, int number, int priority );
+	/**
+	 * @param impostorDistance Distance to the eye the trees are drawn as impostors beyond - 0 draws models only.
+	 * @param impostorFade Width of the band before the impostor distance the impostors fade in over.
+	 */
+	Forest( Landscape * landscape, const QString & filename, const QPoint & mapPosition, int mapRadius, int number, int priority,
+		float impostorDistance = 0.0f, float impostorFade = 0.0f );
 	virtual ~Forest();
 
 	virtual void updateSelf( const double & delta );
 	virtual void drawSelf();
 
-	virtual QVector<const AObject*> collideSphere( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal ) const;
+	virtual void visitSphereCollisions( const AObject * exclude, const float & radius, QVector3D & center, QVector3D * normal, ACollisionVisitor & visitor ) const;
 
 private:
 	Landscape * mLandscape;
 	QVector<QMatrix4x4> mInstances;
+	VegetationColliders mColliders;
 	StaticModel * mModel;
 };
 
@@ -40,6 +40,11 @@ Grass::Grass( Landscape * landscape, const QString & filename, const QPoint & ma
 	mModel = new StaticModel( world()->scene()->glWidget(), filename );
 	setPosition( QVector3D( position.x(), 0, position.y() ) );
 	setBoundingSphere( qMax( radi.width(),radi.height() ) );
+	// small plants thin out in the distance
+	mDrawDistance = 150.0f;
+	mFullDensity = 0.5f;
+	// too small to be noticed in the distorted reflection
+	setRenderPasses( RenderPass::MAIN_BIT | RenderPass::REFRACTION_BIT );
 
 	for( int i=0; i<number; i++ )
 	{
@@ -81,5 +86,5 @@ void Grass::updateSelf( const double & delta )
 void Grass::drawSelf()
 {
 	if( mPriority >= 99-quality() )
-		mModel->draw( scene()->eye()->viewMatrix(), mInstances );
+		drawInstances( mModel, mInstances );
 }
@@ -45,6 +45,7 @@ PowerUp::PowerUp( Landscape * landscape, QString type, const QPoint & mapPositio
 	mRandom(false)
 {
 	setBoundingSphere( 1.0f );
+	setRenderPasses( RenderPass::MAIN_BIT | RenderPass::REFRACTION_BIT );
 
 	if( type == "health" )
 	{
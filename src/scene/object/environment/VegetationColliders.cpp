@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VegetationColliders.hpp"
+
+#include <math.h>
+#include <float.h>
+
+
+const int VegetationColliders::MaxGridSize;
+const float VegetationColliders::MinimumCellSize = 1.0f;
+
+
+/// The cell containing a position along one axis of the grid
+/**
+ * Clamped before converting to an integer, so positions far outside the grid can't overflow.
+ */
+static int cellIndex( float position, float cellSize, int cells )
+{
+	return (int)qBound( 0.0f, floorf( position / cellSize ), (float)( cells-1 ) );
+}
+
+
+VegetationColliders::VegetationColliders() :
+	mColumns( 0 ),
+	mRows( 0 ),
+	mMinimumX( 0.0f ),
+	mMinimumZ( 0.0f ),
+	mCellWidth( 1.0f ),
+	mCellDepth( 1.0f ),
+	mReach( 0.0f )
+{
+}
+
+
+void VegetationColliders::build( const QVector<QMatrix4x4> & instances, const QVector3D & bottom, const QVector3D & top, float radius )
+{
+	mCellStart.clear();
+	mBottomX.clear();
+	mBottomY.clear();
+	mBottomZ.clear();
+	mAxisX.clear();
+	mAxisY.clear();
+	mAxisZ.clear();
+	mInverseAxisLengthSquared.clear();
+	mRadius.clear();
+	mColumns = mRows = 0;
+	mReach = 0.0f;
+	if( instances.isEmpty() )
+		return;
+
+	// transform the capsules once and find the extent of their bottoms on the ground
+	QVector<QVector3D> bottoms( instances.size() );
+	QVector<QVector3D> axes( instances.size() );
+	QVector<float> radi( instances.size() );
+	float maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	mMinimumX = mMinimumZ = FLT_MAX;
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		bottoms[i] = instances[i].map( bottom );
+		axes[i] = instances[i].map( top ) - bottoms[i];
+		radi[i] = radius * instances[i].column(0).toVector3D().length();
+		mMinimumX = qMin( mMinimumX, (float)bottoms[i].x() );
+		mMinimumZ = qMin( mMinimumZ, (float)bottoms[i].z() );
+		maxX = qMax( maxX, (float)bottoms[i].x() );
+		maxZ = qMax( maxZ, (float)bottoms[i].z() );
+		mReach = qMax( mReach, sqrtf( axes[i].x()*axes[i].x() + axes[i].z()*axes[i].z() ) + radi[i] );
+	}
+
+	// the denser the group, the finer the grid
+	const int gridSize = qBound( 1, (int)sqrtf( (float)instances.size() / CapsulesPerCell ), MaxGridSize );
+	mColumns = mRows = gridSize;
+	// a single instance or a row of instances has no extent along an axis
+	mCellWidth = qMax( ( maxX - mMinimumX ) / mColumns, MinimumCellSize );
+	mCellDepth = qMax( ( maxZ - mMinimumZ ) / mRows, MinimumCellSize );
+
+	// sort the capsules by cell
+	QVector<int> cells( instances.size() );
+	mCellStart.fill( 0, mColumns * mRows + 1 );
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		const int x = cellIndex( bottoms[i].x() - mMinimumX, mCellWidth, mColumns );
+		const int z = cellIndex( bottoms[i].z() - mMinimumZ, mCellDepth, mRows );
+		cells[i] = z * mColumns + x;
+		mCellStart[cells[i]+1]++;
+	}
+	for( int c = 0; c < mColumns * mRows; c++ )
+		mCellStart[c+1] += mCellStart[c];
+
+	mBottomX.resize( instances.size() );
+	mBottomY.resize( instances.size() );
+	mBottomZ.resize( instances.size() );
+	mAxisX.resize( instances.size() );
+	mAxisY.resize( instances.size() );
+	mAxisZ.resize( instances.size() );
+	mInverseAxisLengthSquared.resize( instances.size() );
+	mRadius.resize( instances.size() );
+	QVector<int> next = mCellStart;
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		const int j = next[cells[i]]++;
+		mBottomX[j] = bottoms[i].x();
+		mBottomY[j] = bottoms[i].y();
+		mBottomZ[j] = bottoms[i].z();
+		mAxisX[j] = axes[i].x();
+		mAxisY[j] = axes[i].y();
+		mAxisZ[j] = axes[i].z();
+		mInverseAxisLengthSquared[j] = 1.0f / qMax( (float)axes[i].lengthSquared(), FLT_EPSILON );
+		mRadius[j] = radi[i];
+	}
+}
+
+
+int VegetationColliders::pushSphere( float radius, QVector3D & center, QVector3D * normal ) const
+{
+	if( mCellStart.isEmpty() )
+		return 0;
+
+	// cells of capsules the sphere may reach
+	const float reach = radius + mReach;
+	const float gridX = center.x() - mMinimumX;
+	const float gridZ = center.z() - mMinimumZ;
+	if( gridX + reach < 0.0f || gridZ + reach < 0.0f || gridX - reach > mColumns * mCellWidth || gridZ - reach > mRows * mCellDepth )
+		return 0;
+	const int firstX = cellIndex( gridX - reach, mCellWidth, mColumns );
+	const int lastX = cellIndex( gridX + reach, mCellWidth, mColumns );
+	const int firstZ = cellIndex( gridZ - reach, mCellDepth, mRows );
+	const int lastZ = cellIndex( gridZ + reach, mCellDepth, mRows );
+
+	int hits = 0;
+	for( int z = firstZ; z <= lastZ; z++ )
+	{
+		// the cells of a row are stored one after another
+		const int end = mCellStart[z*mColumns+lastX+1];
+		for( int i = mCellStart[z*mColumns+firstX]; i < end; i++ )
+		{
+			// closest point on the capsule's axis - see Capsule::intersectSphere()
+			const float toCenterX = center.x() - mBottomX[i];
+			const float toCenterY = center.y() - mBottomY[i];
+			const float toCenterZ = center.z() - mBottomZ[i];
+			const float t = qBound( 0.0f,
+				( toCenterX*mAxisX[i] + toCenterY*mAxisY[i] + toCenterZ*mAxisZ[i] ) * mInverseAxisLengthSquared[i], 1.0f );
+			const float dx = toCenterX - mAxisX[i] * t;
+			const float dy = toCenterY - mAxisY[i] * t;
+			const float dz = toCenterZ - mAxisZ[i] * t;
+			const float distanceSquared = dx*dx + dy*dy + dz*dz;
+			const float radi = radius + mRadius[i];
+			if( distanceSquared >= radi * radi )
+				continue;
+
+			const float distance = sqrtf( distanceSquared );
+			QVector3D push;
+			if( distance > FLT_EPSILON )
+				push = QVector3D( dx, dy, dz ) / distance;
+			center += push * ( radi - distance );
+			if( normal )
+				*normal += push;
+			hits++;
+		}
+	}
+	return hits;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_OBJECT_ENVIRONMENT_VEGETATIONCOLLIDERS_INCLUDED
+#define SCENE_OBJECT_ENVIRONMENT_VEGETATIONCOLLIDERS_INCLUDED
+
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix4x4>
+
+
+/// The capsules of a vegetation group sorted into a 2D grid for colliding spheres with them
+/**
+ * The capsules are transformed once when the group is built and stored one array per component.
+ * A sphere is only tested against the capsules of the cells it may reach,
+ * so the cost of a test depends on the density around the sphere instead of the size of the group.
+ */
+class VegetationColliders
+{
+public:
+	VegetationColliders();
+
+	/// Places a capsule for each instance
+	/**
+	 * @param instances Model matrices of the instances in world space.
+	 * @param bottom End of the capsule in model space.
+	 * @param top Other end of the capsule in model space.
+	 * @param radius Radius of the capsule in model space - scaled like the instance.
+	 */
+	void build( const QVector<QMatrix4x4> & instances, const QVector3D & bottom, const QVector3D & top, float radius );
+
+	/// Pushes the sphere out of every capsule it intersects
+	/**
+	 * @param normal The normals of all intersected capsules are added to it.
+	 * @return Number of capsules the sphere intersected.
+	 */
+	int pushSphere( float radius, QVector3D & center, QVector3D * normal ) const;
+
+	/// Number of capsules
+	int size() const { return mRadius.size(); }
+
+private:
+	/// Average number of capsules per cell
+	static const int CapsulesPerCell = 4;
+	/// Upper limit of cells along each axis
+	static const int MaxGridSize = 64;
+	/// Lower limit of a cell's width and depth in world units
+	static const float MinimumCellSize;
+
+	int mColumns;
+	int mRows;
+	float mMinimumX;
+	float mMinimumZ;
+	float mCellWidth;
+	float mCellDepth;
+	/// Largest horizontal distance of any point of a capsule to it's bottom
+	float mReach;
+	/// Index of the first capsule of each cell - followed by the number of capsules
+	QVector<int> mCellStart;
+
+	QVector<float> mBottomX;
+	QVector<float> mBottomY;
+	QVector<float> mBottomZ;
+	/// Bottom to top
+	QVector<float> mAxisX;
+	QVector<float> mAxisY;
+	QVector<float> mAxisZ;
+	QVector<float> mInverseAxisLengthSquared;
+	QVector<float> mRadius;
+};
+
+
+#endif
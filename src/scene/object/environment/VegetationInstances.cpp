@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VegetationInstances.hpp"
+
+#include <utility/RandomNumber.hpp>
+
+#include <float.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+VegetationInstances::VegetationInstances()
+{
+}
+
+
+void VegetationInstances::build( const QVector<QMatrix4x4> & instances, float modelRadius, float fullDensity )
+{
+	mCells.clear();
+	mInstances.clear();
+	mX.clear();
+	mY.clear();
+	mZ.clear();
+	mRadius.clear();
+	mLodDistanceSquared.clear();
+	mVisible.clear();
+	mImpostors.clear();
+	if( instances.isEmpty() )
+		return;
+
+	// extent of the group on the ground
+	float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		const QVector4D position = instances[i].column(3);
+		minX = qMin( minX, (float)position.x() );
+		maxX = qMax( maxX, (float)position.x() );
+		minZ = qMin( minZ, (float)position.z() );
+		maxZ = qMax( maxZ, (float)position.z() );
+	}
+	const float cellWidth = qMax( ( maxX - minX ) / GridSize, FLT_EPSILON );
+	const float cellDepth = qMax( ( maxZ - minZ ) / GridSize, FLT_EPSILON );
+
+	QVector< QVector<int> > cellInstances( GridSize * GridSize );
+	for( int i = 0; i < instances.size(); i++ )
+	{
+		const QVector4D position = instances[i].column(3);
+		int x = qBound( 0, (int)( ( position.x() - minX ) / cellWidth ), GridSize-1 );
+		int z = qBound( 0, (int)( ( position.z() - minZ ) / cellDepth ), GridSize-1 );
+		cellInstances[z*GridSize+x].append( i );
+	}
+
+	mX.fill( 0.0f, instances.size() );
+	mY.fill( 0.0f, instances.size() );
+	mZ.fill( 0.0f, instances.size() );
+	mRadius.fill( 0.0f, instances.size() );
+	mLodDistanceSquared.fill( 0.0f, instances.size() );
+	mInstances.reserve( instances.size() );
+	for( int c = 0; c < cellInstances.size(); c++ )
+	{
+		if( cellInstances[c].isEmpty() )
+			continue;
+
+		Cell cell;
+		cell.first = mInstances.size();
+		cell.count = cellInstances[c].size();
+		cell.minimum = QVector3D( FLT_MAX, FLT_MAX, FLT_MAX );
+		cell.maximum = QVector3D( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+		for( int j = 0; j < cellInstances[c].size(); j++ )
+		{
+			const QMatrix4x4 & instance = instances[cellInstances[c][j]];
+			const QVector3D position = instance.column(3).toVector3D();
+			const float radius = modelRadius * instance.column(0).toVector3D().length();
+			const int i = mInstances.size();
+			mInstances.append( instance );
+			mX[i] = position.x();
+			mY[i] = position.y();
+			mZ[i] = position.z();
+			mRadius[i] = radius;
+			// a random share of the instances disappears at each distance beyond the full density
+			const float lodDistance = fullDensity + ( 1.0f - fullDensity ) * RandomNumber::minMax( 0.0f, 1.0f );
+			mLodDistanceSquared[i] = lodDistance * lodDistance;
+
+			cell.minimum.setX( qMin( (float)cell.minimum.x(), (float)position.x() - radius ) );
+			cell.minimum.setY( qMin( (float)cell.minimum.y(), (float)position.y() - radius ) );
+			cell.minimum.setZ( qMin( (float)cell.minimum.z(), (float)position.z() - radius ) );
+			cell.maximum.setX( qMax( (float)cell.maximum.x(), (float)position.x() + radius ) );
+			cell.maximum.setY( qMax( (float)cell.maximum.y(), (float)position.y() + radius ) );
+			cell.maximum.setZ( qMax( (float)cell.maximum.z(), (float)position.z() + radius ) );
+		}
+		mCells.append( cell );
+	}
+
+	// keeps the lists from being reallocated while they are refilled every pass
+	mVisible.reserve( mInstances.size() );
+	mImpostors.reserve( mInstances.size() );
+}
+
+
+void VegetationInstances::cull( const FrustumTest & frustum, const QVector3D & eye, float cutOff, float impostorStart, float impostorEnd )
+{
+	mVisible.resize( 0 );
+	mImpostors.resize( 0 );
+	for( int c = 0; c < mCells.size(); c++ )
+	{
+		const Cell & cell = mCells[c];
+
+		// distance to the nearest point of the cell
+		QVector3D nearest(
+			qBound( (float)cell.minimum.x(), (float)eye.x(), (float)cell.maximum.x() ),
+			qBound( (float)cell.minimum.y(), (float)eye.y(), (float)cell.maximum.y() ),
+			qBound( (float)cell.minimum.z(), (float)eye.z(), (float)cell.maximum.z() )
+		);
+		if( ( nearest - eye ).lengthSquared() > cutOff * cutOff )
+			continue;
+
+		unsigned int planes = FrustumTest::AllPlanes;
+		if( frustum.testBox( cell.minimum, cell.maximum, planes ) == FrustumTest::OUTSIDE )
+			continue;
+		cullCell( cell, frustum, planes, eye, cutOff, impostorStart, impostorEnd );
+	}
+}
+
+
+void VegetationInstances::cullCell( const Cell & cell, const FrustumTest & frustum, unsigned int planes, const QVector3D & eye, float cutOff,
+	float impostorStart, float impostorEnd )
+{
+	// only the planes the cell intersects can reject any of it's instances
+	QVector4D testPlanes[6];
+	int planeCount = 0;
+	for( int p = 0; p < 6; p++ )
+	{
+		if( planes & (1<<p) )
+			testPlanes[planeCount++] = frustum.plane( p );
+	}
+
+	const float cutOffSquared = cutOff * cutOff;
+	// FLT_MAX squared turns into infinity - no instance is farther
+	const float impostorStartSquared = impostorStart * impostorStart;
+	const float impostorEndSquared = impostorEnd * impostorEnd;
+	const float eyeX = eye.x(), eyeY = eye.y(), eyeZ = eye.z();
+	const int end = cell.first + cell.count;
+	int i = cell.first;
+#ifdef __SSE2__
+	const __m128 ex = _mm_set1_ps( eyeX );
+	const __m128 ey = _mm_set1_ps( eyeY );
+	const __m128 ez = _mm_set1_ps( eyeZ );
+	const __m128 cutOff2 = _mm_set1_ps( cutOffSquared );
+	const __m128 impostorStart2 = _mm_set1_ps( impostorStartSquared );
+	const __m128 impostorEnd2 = _mm_set1_ps( impostorEndSquared );
+	for( ; i + 4 <= end; i += 4 )
+	{
+		const __m128 x = _mm_loadu_ps( mX.constData()+i );
+		const __m128 y = _mm_loadu_ps( mY.constData()+i );
+		const __m128 z = _mm_loadu_ps( mZ.constData()+i );
+		const __m128 negRadius = _mm_sub_ps( _mm_setzero_ps(), _mm_loadu_ps( mRadius.constData()+i ) );
+
+		const __m128 dx = _mm_sub_ps( x, ex );
+		const __m128 dy = _mm_sub_ps( y, ey );
+		const __m128 dz = _mm_sub_ps( z, ez );
+		const __m128 distance2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) );
+		__m128 visible = _mm_cmplt_ps( distance2, _mm_mul_ps( cutOff2, _mm_loadu_ps( mLodDistanceSquared.constData()+i ) ) );
+
+		for( int p = 0; p < planeCount; p++ )
+		{
+			const __m128 distance = _mm_add_ps(
+				_mm_add_ps( _mm_mul_ps( _mm_set1_ps( testPlanes[p].x() ), x ), _mm_mul_ps( _mm_set1_ps( testPlanes[p].y() ), y ) ),
+				_mm_add_ps( _mm_mul_ps( _mm_set1_ps( testPlanes[p].z() ), z ), _mm_set1_ps( testPlanes[p].w() ) ) );
+			visible = _mm_and_ps( visible, _mm_cmpgt_ps( distance, negRadius ) );
+		}
+
+		const int mask = _mm_movemask_ps( visible );
+		if( !mask )
+			continue;
+		const int modelMask = mask & _mm_movemask_ps( _mm_cmplt_ps( distance2, impostorEnd2 ) );
+		const int impostorMask = mask & _mm_movemask_ps( _mm_cmpge_ps( distance2, impostorStart2 ) );
+		for( int k = 0; k < 4; k++ )
+		{
+			if( modelMask & (1<<k) )
+				mVisible.append( mInstances[i+k] );
+			if( impostorMask & (1<<k) )
+				mImpostors.append( mInstances[i+k] );
+		}
+	}
+#endif
+	for( ; i < end; i++ )
+	{
+		const float dx = mX[i] - eyeX, dy = mY[i] - eyeY, dz = mZ[i] - eyeZ;
+		const float distanceSquared = dx*dx + dy*dy + dz*dz;
+		if( distanceSquared >= cutOffSquared * mLodDistanceSquared[i] )
+			continue;
+
+		bool inside = true;
+		for( int p = 0; p < planeCount && inside; p++ )
+			inside = testPlanes[p].x() * mX[i] + testPlanes[p].y() * mY[i] + testPlanes[p].z() * mZ[i] + testPlanes[p].w() > -mRadius[i];
+		if( !inside )
+			continue;
+		if( distanceSquared < impostorEndSquared )
+			mVisible.append( mInstances[i] );
+		if( distanceSquared >= impostorStartSquared )
+			mImpostors.append( mInstances[i] );
+	}
+}
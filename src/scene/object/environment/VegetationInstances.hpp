@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENE_OBJECT_ENVIRONMENT_VEGETATIONINSTANCES_INCLUDED
+#define SCENE_OBJECT_ENVIRONMENT_VEGETATIONINSTANCES_INCLUDED
+
+#include <utility/FrustumTest.hpp>
+
+#include <QVector>
+#include <QVector3D>
+#include <QMatrix4x4>
+
+#include <float.h>
+
+
+/// The instances of a vegetation group sorted into a coarse grid for culling them one by one
+/**
+ * The grid divides the group's extent in the X/Z plane into GridSize x GridSize cells,
+ * each cell's bounds span the heights of the instances within it.\n
+ * Cells completely outside the frustum or beyond the cut-off distance are skipped,
+ * the instances of the remaining cells are tested against the planes the cell intersects.\n
+ * The instances are drawn with full density up to a fraction of the cut-off distance,
+ * beyond their density falls off linearly until none is left at the cut-off distance.\n
+ * Instances within a band of distances can be drawn as impostors as well as models,
+ * those beyond the band as impostors only.
+ */
+class VegetationInstances
+{
+public:
+	VegetationInstances();
+
+	/// Sorts the instances into the grid
+	/**
+	 * @param instances Model matrices of the instances in world space.
+	 * @param modelRadius Radius of the unscaled model's bounding sphere around it's origin.
+	 * @param fullDensity Fraction of the cut-off distance all instances are drawn up to.
+	 */
+	void build( const QVector<QMatrix4x4> & instances, float modelRadius, float fullDensity );
+
+	/// Collects the instances within the frustum and the cut-off distance to the eye in visible() and impostors()
+	/**
+	 * @param impostorStart Distance to the eye instances start being collected in impostors().
+	 * @param impostorEnd Distance to the eye instances stop being collected in visible().
+	 */
+	void cull( const FrustumTest & frustum, const QVector3D & eye, float cutOff,
+		float impostorStart = FLT_MAX, float impostorEnd = FLT_MAX );
+
+	/// Number of instances sorted into the grid
+	int size() const { return mInstances.size(); }
+	/// The instances found by the last cull() closer than the impostor band's end
+	const QVector<QMatrix4x4> & visible() const { return mVisible; }
+	/// The instances found by the last cull() farther than the impostor band's start
+	const QVector<QMatrix4x4> & impostors() const { return mImpostors; }
+
+private:
+	/// Cells along the X and Z axis of the group - the grid is not divided vertically
+	static const int GridSize = 4;
+
+	struct Cell
+	{
+		int first;
+		int count;
+		QVector3D minimum;
+		QVector3D maximum;
+	};
+
+	QVector<Cell> mCells;
+	/// Model matrices sorted by cell
+	QVector<QMatrix4x4> mInstances;
+	/// Bounding spheres of the instances - one array per component, so four of them are tested at once
+	QVector<float> mX;
+	QVector<float> mY;
+	QVector<float> mZ;
+	QVector<float> mRadius;
+	/// Squared fraction of the cut-off distance each instance is drawn up to
+	QVector<float> mLodDistanceSquared;
+	QVector<QMatrix4x4> mVisible;
+	QVector<QMatrix4x4> mImpostors;
+
+	void cullCell( const Cell & cell, const FrustumTest & frustum, unsigned int planes, const QVector3D & eye, float cutOff,
+		float impostorStart, float impostorEnd );
+};
+
+
+#endif
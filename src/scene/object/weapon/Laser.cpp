@@ -24,6 +24,7 @@
 #include "Laser.hpp"
 
 #include "../World.hpp"
+#include "../Landscape.hpp"
 
 
 #include <scene/object/Eye.hpp>
@@ -49,6 +50,8 @@ Laser::Laser( World * world ) :
 	mRange = 250.0f;
 	mTrailRadius = 0.04f;
 	mDamage = 50.0f;
+	mCraterRadius = 1.5f;
+	mCraterDepth = 0.4f;
 
 	mMaterial = new Material( scene()->glWidget(), "KirksEntry" );
 
@@ -128,6 +131,8 @@ void Laser::updateSelf( const double & delta )
 
 				if( target )
 					mImpactParticles->emitSpherical( mTrailEnd, 64, 5.0, 10.0, QVector3D(0,10,0) );
+				if( target == world()->landscape().data() )
+					world()->landscape()->deform( mTrailEnd, mCraterRadius, mCraterDepth );
 				ACreature * victim = dynamic_cast<ACreature*>(target);
 				if( victim )
 					victim->receiveDamage( mDamage, &mTrailEnd, &mTrailDirection );
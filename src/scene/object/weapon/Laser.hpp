@@ -65,6 +65,8 @@ private:
 	float mTrailAlpha;
 	float mTrailVisibilityDuration;
 	float mDamage;
+	float mCraterRadius;	///< Radius of the crater left in the terrain on impact
+	float mCraterDepth;
 	const QVector3D * mTarget;
 	QVector3D mTrailStart;
 	QVector3D mTrailDirection;
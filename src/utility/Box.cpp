@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Box.hpp"
+
+#include <math.h>
+#include <float.h>
+
+
+void Box::extend( const QVector3D & point )
+{
+	if( mEmpty )
+	{
+		mMinimum = point;
+		mMaximum = point;
+		mEmpty = false;
+		return;
+	}
+
+	mMinimum.setX( qMin( mMinimum.x(), point.x() ) );
+	mMinimum.setY( qMin( mMinimum.y(), point.y() ) );
+	mMinimum.setZ( qMin( mMinimum.z(), point.z() ) );
+	mMaximum.setX( qMax( mMaximum.x(), point.x() ) );
+	mMaximum.setY( qMax( mMaximum.y(), point.y() ) );
+	mMaximum.setZ( qMax( mMaximum.z(), point.z() ) );
+}
+
+
+// slab test - the ray is clipped against the three pairs of parallel planes
+
+bool Box::intersectCulledRay( const QVector3D & boxMinimum, const QVector3D & boxMaximum,
+	const QVector3D & rayOrigin, const QVector3D & rayDirection,
+	float * intersectionDistance )
+{
+	const float origin[3] = { rayOrigin.x(), rayOrigin.y(), rayOrigin.z() };
+	const float direction[3] = { rayDirection.x(), rayDirection.y(), rayDirection.z() };
+	const float minimum[3] = { boxMinimum.x(), boxMinimum.y(), boxMinimum.z() };
+	const float maximum[3] = { boxMaximum.x(), boxMaximum.y(), boxMaximum.z() };
+
+	float tEnter = 0.0f;
+	float tExit = FLT_MAX;
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		if( fabsf( direction[axis] ) < FLT_EPSILON )
+		{
+			// parallel to the slab - the origin has to be inside
+			if( origin[axis] < minimum[axis] || origin[axis] > maximum[axis] )
+				return false;
+			continue;
+		}
+
+		float t0 = ( minimum[axis] - origin[axis] ) / direction[axis];
+		float t1 = ( maximum[axis] - origin[axis] ) / direction[axis];
+		if( t0 > t1 )
+		{
+			float temp = t0;
+			t0 = t1;
+			t1 = temp;
+		}
+		if( t0 > tEnter )
+			tEnter = t0;
+		if( t1 < tExit )
+			tExit = t1;
+		if( tEnter > tExit )
+			return false;
+	}
+
+	if( intersectionDistance )
+		*intersectionDistance = tEnter;
+
+	return true;
+}
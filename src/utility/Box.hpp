@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_BOX_INCLUDED
+#define UTILITY_BOX_INCLUDED
+
+
+#include <QVector3D>
+
+
+/// Axis aligned box
+class Box
+{
+public:
+	/// Creates an empty box - the first extend() call sets both corners
+	Box() : mMinimum(), mMaximum(), mEmpty(true) {}
+	Box( const QVector3D & minimum, const QVector3D & maximum ) : mMinimum(minimum), mMaximum(maximum), mEmpty(false) {}
+	const QVector3D & minimum() const { return mMinimum; }
+	const QVector3D & maximum() const { return mMaximum; }
+	bool isEmpty() const { return mEmpty; }
+
+	/// Empties the box
+	void clear() { mEmpty = true; }
+	/// Grows the box to contain a point
+	void extend( const QVector3D & point );
+
+	/// Box/Ray intersection test - only intersections along the positive direction vector are tested
+	bool intersectCulledRay( const QVector3D & origin, const QVector3D & direction, float * intersectionDistance ) const
+		{ return !mEmpty && intersectCulledRay( mMinimum, mMaximum, origin, direction, intersectionDistance ); }
+
+	/// Box/Ray intersection test - only intersections along the positive direction vector are tested
+	/**
+	 * If the origin is inside the box, the intersection distance is 0.
+	 */
+	static bool intersectCulledRay( const QVector3D & boxMinimum, const QVector3D & boxMaximum,
+		const QVector3D & rayOrigin, const QVector3D & rayDirection,
+		float * intersectionDistance );
+
+private:
+	QVector3D mMinimum;
+	QVector3D mMaximum;
+	bool mEmpty;
+};
+
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CommandBuffer.hpp"
+
+#include <QMutexLocker>
+
+
+CommandBuffer::CommandBuffer() :
+	mRecording( false )
+{
+}
+
+
+CommandBuffer::~CommandBuffer()
+{
+	for( int i = 0; i < mCommands.size(); ++i )
+		delete mCommands[i];
+}
+
+
+void CommandBuffer::push( ACommand * command )
+{
+	QMutexLocker lock( &mMutex );
+	mCommands.append( command );
+}
+
+
+void CommandBuffer::execute()
+{
+	QVector<ACommand*> commands;
+	mMutex.lock();
+	commands = mCommands;
+	mCommands.clear();
+	mMutex.unlock();
+
+	for( int i = 0; i < commands.size(); ++i )
+	{
+		commands[i]->execute();
+		delete commands[i];
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_COMMANDBUFFER_INCLUDED
+#define UTILITY_COMMANDBUFFER_INCLUDED
+
+#include <QVector>
+#include <QMutex>
+
+
+/// Collects deferred modifications of shared state
+/**
+ * While recording, code running concurrently must not modify state shared with other objects.
+ * Such modifications are wrapped in a command and pushed to this buffer instead.
+ * The commands are executed in order of arrival at the next synchronization point.
+ */
+class CommandBuffer
+{
+public:
+	/// Abstract command
+	class ACommand
+	{
+	public:
+		virtual ~ACommand() {}
+		/// Applies the deferred modification - always called from the owning thread
+		virtual void execute() = 0;
+	};
+
+	CommandBuffer();
+	~CommandBuffer();
+
+	/// Returns true if modifications of shared state have to be deferred
+	bool recording() const { return mRecording; }
+	/// Starts or stops deferring
+	void setRecording( bool enable ) { mRecording = enable; }
+
+	/// Queues a command and takes ownership - thread safe
+	void push( ACommand * command );
+	/// Executes and deletes all queued commands
+	void execute();
+
+private:
+	QMutex mMutex;
+	QVector<ACommand*> mCommands;
+	bool mRecording;
+};
+
+
+#endif
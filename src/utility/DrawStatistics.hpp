@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_DRAWSTATISTICS_INCLUDED
+#define UTILITY_DRAWSTATISTICS_INCLUDED
+
+#include <scene/RenderPass.hpp>
+
+
+/// Counts draw calls and triangles per frame for the debug overlay
+/**
+ * Vertex array draws (glDrawArrays, glDrawElements, glMultiDrawElements) count themselves,
+ * immediate mode and GLU debug geometry is not counted.\n
+ * Draw calls are counted separately for each RenderPass.
+ */
+class DrawStatistics
+{
+public:
+	/// Counts a single draw call submitting the given number of triangles
+	static void countDrawCall( int triangles = 0 ) { ++sDrawCalls[RenderPass::current()]; sTriangles += triangles; }
+	/// Keeps the counts of the finished frame and restarts counting
+	static void finishFrame();
+
+	/// Draw calls of the last finished frame
+	static int drawCalls();
+	/// Draw calls of a single pass of the last finished frame
+	static int drawCalls( const RenderPass::Type & pass ) { return sLastDrawCalls[pass]; }
+	/// Triangles of the last finished frame
+	static int triangles() { return sLastTriangles; }
+
+	/// Enables showing the statistics in the debug overlay
+	static void setVisible( bool visible ) { sVisible = visible; }
+	static bool visible() { return sVisible; }
+
+private:
+	static int sDrawCalls[RenderPass::num];
+	static int sTriangles;
+	static int sLastDrawCalls[RenderPass::num];
+	static int sLastTriangles;
+	static bool sVisible;
+};
+
+
+#endif
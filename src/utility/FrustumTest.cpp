@@ -98,3 +98,30 @@ bool FrustumTest::isSphereInFrustum( QVector3D center, float radius ) const
 		return false;
 	return true;
 }
+
+
+FrustumTest::Intersection FrustumTest::testBox( const QVector3D & minimum, const QVector3D & maximum, unsigned int & planes ) const
+{
+	for( int p = 0; p < 6; p++ )
+	{
+		if( !( planes & ( 1u << p ) ) )
+			continue;
+		const QVector4D & plane = mFrustum[p];
+		// corners farthest inside and outside along the plane's normal
+		const QVector3D inner(
+			plane.x() >= 0.0f ? maximum.x() : minimum.x(),
+			plane.y() >= 0.0f ? maximum.y() : minimum.y(),
+			plane.z() >= 0.0f ? maximum.z() : minimum.z()
+		);
+		const QVector3D outer(
+			plane.x() >= 0.0f ? minimum.x() : maximum.x(),
+			plane.y() >= 0.0f ? minimum.y() : maximum.y(),
+			plane.z() >= 0.0f ? minimum.z() : maximum.z()
+		);
+		if( plane.x() * inner.x() + plane.y() * inner.y() + plane.z() * inner.z() + plane.w() <= 0 )
+			return OUTSIDE;
+		if( plane.x() * outer.x() + plane.y() * outer.y() + plane.z() * outer.z() + plane.w() > 0 )
+			planes &= ~( 1u << p );
+	}
+	return planes ? INTERSECTING : INSIDE;
+}
@@ -46,6 +46,27 @@ public:
 	/// Visibility test on viewing frustum.
 	bool isSphereInFrustum( QVector3D center, float radius ) const;
 
+	/// Result of a box test
+	enum Intersection
+	{
+		OUTSIDE,
+		INTERSECTING,
+		INSIDE
+	};
+
+	/// Bit mask selecting all six planes of the frustum
+	static const unsigned int AllPlanes = 0x3f;
+
+	/// Visibility test of an axis aligned box on viewing frustum.
+	/**
+	 * @param planes Bit n selects plane n for testing. The bits of planes the box lies completely inside of are cleared,
+	 *  so boxes contained in this box only need to be tested against the remaining planes.
+	 */
+	Intersection testBox( const QVector3D & minimum, const QVector3D & maximum, unsigned int & planes ) const;
+
+	/// Returns plane n of the frustum - points inside have a positive distance to all planes
+	const QVector4D & plane( int n ) const { return mFrustum[n]; }
+
 private:
 	QVector4D mFrustum[6];
 };
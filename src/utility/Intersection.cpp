@@ -26,7 +26,7 @@
 
 
 bool Intersection::intersectTriangleFan(const GLfloat PositionData[], const int firstVertexPos, const int lastVertexPos,
-	const QMatrix4x4 & modelMatrix, const QVector3D & origin, const QVector3D & direction, float * intersectionDistance )
+	const QVector3D & origin, const QVector3D & direction, float * intersectionDistance )
 {
 	QVector3D v[3];
 	v[0] = QVector3D(PositionData[firstVertexPos*3], PositionData[firstVertexPos*3+1], PositionData[firstVertexPos*3+2]);
@@ -41,8 +41,8 @@ bool Intersection::intersectTriangleFan(const GLfloat PositionData[], const int
 
 		v[2] = QVector3D(PositionData[i*3], PositionData[i*3+1], PositionData[i*3+2]);
 
-		if( Triangle::intersectRay(modelMatrix.map(v[0]), modelMatrix.map(v[1]), modelMatrix.map(v[2]), origin, direction, intersectionDistance) ||
-			Triangle::intersectRay(modelMatrix.map(v[0]), modelMatrix.map(v[2]), modelMatrix.map(v[1]), origin, direction, intersectionDistance) )
+		if( Triangle::intersectRay(v[0], v[1], v[2], origin, direction, intersectionDistance) ||
+			Triangle::intersectRay(v[0], v[2], v[1], origin, direction, intersectionDistance) )
 		{
 			return true;
 		}
@@ -53,7 +53,7 @@ bool Intersection::intersectTriangleFan(const GLfloat PositionData[], const int
 
 
 bool Intersection::intersectTriangleStrip(const GLfloat PositionData[], const int firstVertexPos, const int lastVertexPos,
-	const QMatrix4x4 & modelMatrix, const QVector3D & origin, const QVector3D & direction, float * intersectionDistance )
+	const QVector3D & origin, const QVector3D & direction, float * intersectionDistance )
 {
 	QVector3D v[3];
 	v[0] = QVector3D(PositionData[firstVertexPos*3], PositionData[firstVertexPos*3+1], PositionData[firstVertexPos*3+2]);
@@ -68,8 +68,8 @@ bool Intersection::intersectTriangleStrip(const GLfloat PositionData[], const in
 
 		v[2] = QVector3D(PositionData[i*3], PositionData[i*3+1], PositionData[i*3+2]);
 
-		if( Triangle::intersectCulledRay(modelMatrix.map(v[0]), modelMatrix.map(v[1]), modelMatrix.map(v[2]), origin, direction, intersectionDistance) ||
-			Triangle::intersectCulledRay(modelMatrix.map(v[1]), modelMatrix.map(v[0]), modelMatrix.map(v[2]), origin, direction, intersectionDistance) )
+		if( Triangle::intersectCulledRay(v[0], v[1], v[2], origin, direction, intersectionDistance) ||
+			Triangle::intersectCulledRay(v[1], v[0], v[2], origin, direction, intersectionDistance) )
 		{
 			return true;
 		}
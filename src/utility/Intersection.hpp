@@ -24,18 +24,17 @@
 #ifndef UTILITY_INTERSECTION_INCLUDED
 #define UTILITY_INTERSECTION_INCLUDED
 
-#include <QVector4D>
 #include <QVector3D>
-#include <QMatrix4x4>
 #include <GLWidget.hpp>
 
 
+/// Ray tests against vertex arrays - the ray has to be given in the same space as the vertices
 namespace Intersection
 {
 	bool intersectTriangleFan(const GLfloat PositionData[], const int firstVertexPos, const int lastVertexPos,
-		const QMatrix4x4 & modelMatrix,const QVector3D & origin, const QVector3D & direction, float * intersectionDistance=NULL );
+		const QVector3D & origin, const QVector3D & direction, float * intersectionDistance=NULL );
 	bool intersectTriangleStrip(const GLfloat PositionData[], const int firstVertexPos, const int lastVertexPos,
-		const QMatrix4x4 & modelMatrix,const QVector3D & origin, const QVector3D & direction, float * intersectionDistance=NULL );
+		const QVector3D & origin, const QVector3D & direction, float * intersectionDistance=NULL );
 }
 
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JobSystem.hpp"
+
+#include <QMutexLocker>
+#include <QDateTime>
+
+
+JobSystem::JobSystem( int numWorkers ) :
+	mPending( 0 ),
+	mGeneration( 0 ),
+	mQuit( false )
+{
+	if( numWorkers < 0 )
+		numWorkers = qMax( QThread::idealThreadCount() - 1, 0 );
+
+	// queue 0 belongs to the thread calling run()
+	for( int i = 0; i <= numWorkers; ++i )
+		mQueues.append( new Queue );
+
+	for( int i = 1; i <= numWorkers; ++i )
+	{
+		Worker * worker = new Worker( this, i );
+		mWorkers.append( worker );
+		worker->start();
+	}
+}
+
+
+JobSystem::~JobSystem()
+{
+	mSleepMutex.lock();
+	mQuit = true;
+	mWorkAvailable.wakeAll();
+	mSleepMutex.unlock();
+
+	for( int i = 0; i < mWorkers.size(); ++i )
+	{
+		mWorkers[i]->wait();
+		delete mWorkers[i];
+	}
+	for( int i = 0; i < mQueues.size(); ++i )
+		delete mQueues[i];
+}
+
+
+void JobSystem::run( const QVector<AJob*> & jobs )
+{
+	if( jobs.isEmpty() )
+		return;
+
+	if( mWorkers.isEmpty() || jobs.size() == 1 )
+	{
+		for( int i = 0; i < jobs.size(); ++i )
+			jobs[i]->run();
+		return;
+	}
+
+	mPending.fetchAndAddOrdered( jobs.size() );
+	for( int i = 0; i < jobs.size(); ++i )
+	{
+		Queue * queue = mQueues[i % mQueues.size()];
+		QMutexLocker lock( &queue->mutex );
+		queue->jobs.append( jobs[i] );
+	}
+
+	mSleepMutex.lock();
+	++mGeneration;
+	mWorkAvailable.wakeAll();
+	mSleepMutex.unlock();
+
+	while( true )
+	{
+		AJob * job = take( 0 );
+		if( job )
+		{
+			job->run();
+			finish();
+			continue;
+		}
+		QMutexLocker lock( &mSleepMutex );
+		if( mPending.fetchAndAddOrdered( 0 ) == 0 )
+			break;
+		mWorkDone.wait( &mSleepMutex );
+	}
+}
+
+
+JobSystem::AJob * JobSystem::take( int index )
+{
+	{
+		Queue * own = mQueues[index];
+		QMutexLocker lock( &own->mutex );
+		if( !own->jobs.isEmpty() )
+			return own->jobs.takeLast();
+	}
+	for( int i = 1; i < mQueues.size(); ++i )
+	{
+		Queue * victim = mQueues[(index+i) % mQueues.size()];
+		QMutexLocker lock( &victim->mutex );
+		if( !victim->jobs.isEmpty() )
+			return victim->jobs.takeFirst();
+	}
+	return NULL;
+}
+
+
+void JobSystem::finish()
+{
+	if( !mPending.deref() )
+	{
+		QMutexLocker lock( &mSleepMutex );
+		mWorkDone.wakeAll();
+	}
+}
+
+
+void JobSystem::Worker::run()
+{
+	// qrand() keeps its state per thread - jobs using RandomNumber would otherwise all see the same sequence
+	qsrand( uint( QDateTime::currentMSecsSinceEpoch() ) ^ ( uint( mIndex ) * 2654435761u ) );
+
+	while( true )
+	{
+		mSystem->mSleepMutex.lock();
+		if( mSystem->mQuit )
+		{
+			mSystem->mSleepMutex.unlock();
+			return;
+		}
+		int generation = mSystem->mGeneration;
+		mSystem->mSleepMutex.unlock();
+
+		AJob * job = mSystem->take( mIndex );
+		if( job )
+		{
+			job->run();
+			mSystem->finish();
+			continue;
+		}
+
+		// nothing left - sleep unless a new batch arrived in the meantime
+		mSystem->mSleepMutex.lock();
+		if( !mSystem->mQuit && mSystem->mGeneration == generation )
+			mSystem->mWorkAvailable.wait( &mSystem->mSleepMutex );
+		mSystem->mSleepMutex.unlock();
+	}
+}
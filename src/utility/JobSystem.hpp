@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_JOBSYSTEM_INCLUDED
+#define UTILITY_JOBSYSTEM_INCLUDED
+
+#include <QList>
+#include <QVector>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+
+/// Runs batches of independent jobs on all cores
+/**
+ * Each worker thread owns a queue of jobs.
+ * A worker takes jobs from the back of its own queue and
+ * steals from the front of the other queues when its own queue runs dry.\n
+ * The thread calling run() takes part in the work and returns once the whole batch is done.
+ */
+class JobSystem
+{
+public:
+	/// Abstract job
+	class AJob
+	{
+	public:
+		virtual ~AJob() {}
+		/// Executes the job - may be called from any thread
+		virtual void run() = 0;
+	};
+
+	/// Starts the given number of worker threads - negative to use one per additional core
+	explicit JobSystem( int numWorkers = -1 );
+	~JobSystem();
+
+	/// Executes all jobs and waits for them to finish
+	void run( const QVector<AJob*> & jobs );
+
+	/// Number of threads working on a batch including the calling thread
+	int numThreads() const { return mQueues.size(); }
+
+private:
+	class Worker : public QThread
+	{
+	public:
+		Worker( JobSystem * system, int index ) : mSystem( system ), mIndex( index ) {}
+	protected:
+		virtual void run();
+	private:
+		JobSystem * mSystem;
+		int mIndex;
+	};
+
+	class Queue
+	{
+	public:
+		QMutex mutex;
+		QList<AJob*> jobs;
+	};
+
+	QVector<Queue*> mQueues;
+	QVector<Worker*> mWorkers;
+
+	QAtomicInt mPending;
+	QMutex mSleepMutex;
+	QWaitCondition mWorkAvailable;
+	QWaitCondition mWorkDone;
+	int mGeneration;
+	bool mQuit;
+
+	/// Takes a job from the given queue or steals one from another queue
+	AJob * take( int index );
+	/// Marks one job as done
+	void finish();
+};
+
+
+#endif
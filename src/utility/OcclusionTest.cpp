@@ -23,6 +23,7 @@
 
 #include "OcclusionTest.hpp"
 #include "RandomNumber.hpp"
+#include "DrawStatistics.hpp"
 #include <geometry/Vertex.hpp>
 
 
@@ -117,6 +118,7 @@ unsigned char OcclusionTest::randomPointsInUnitSphereVisible( const unsigned cha
 	VertexP3f::glEnableClientState();
 	VertexP3f::glPointerVBO();
 	glDrawArrays( GL_POINTS, 0, numPoints );
+	DrawStatistics::countDrawCall();
 	VertexP3f::glDisableClientState();
 	sRandomVertexInSphereBuffer.release();
 	glEndQuery( GL_SAMPLES_PASSED );
@@ -149,6 +151,7 @@ unsigned char OcclusionTest::randomPointsOnUnitSphereVisible( const unsigned cha
 	VertexP3f::glEnableClientState();
 	VertexP3f::glPointerVBO();
 	glDrawArrays( GL_POINTS, 0, numPoints );
+	DrawStatistics::countDrawCall();
 	VertexP3f::glDisableClientState();
 	sRandomVertexOnSphereBuffer.release();
 	glEndQuery( GL_SAMPLES_PASSED );
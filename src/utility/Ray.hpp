@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_RAY_INCLUDED
+#define UTILITY_RAY_INCLUDED
+
+#include <QVector3D>
+
+
+class AObject;
+
+
+/// A line used for batched intersection tests
+/**
+ * The line starts at origin and extends length units along direction.
+ * Batched intersection tests shorten length to the nearest intersection
+ * and store the surface normal and the object that was hit.
+ */
+class Ray
+{
+public:
+	Ray() : length( 0.0f ), target( NULL ) {}
+	Ray( const QVector3D & origin, const QVector3D & direction, float length ) :
+		origin( origin ), direction( direction ), length( length ), target( NULL ) {}
+
+	QVector3D origin;
+	QVector3D direction;
+	float length;
+	/// Surface normal at the nearest intersection
+	QVector3D normal;
+	/// Object hit by this ray - NULL if no intersection occurred
+	const AObject * target;
+};
+
+
+#endif
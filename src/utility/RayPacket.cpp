@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RayPacket.hpp"
+
+#include <float.h>
+#include <math.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+static inline float reciprocal( float d )
+{
+	if( fabsf( d ) > FLT_EPSILON )
+		return 1.0f / d;
+	return d < 0.0f ? -FLT_MAX : FLT_MAX;
+}
+
+
+void RayPacket::clear()
+{
+	for( int i = 0; i < size; ++i )
+		unset( i );
+}
+
+
+void RayPacket::set( int i, const QVector3D & origin, const QVector3D & direction, float length )
+{
+	mOX[i] = origin.x(); mOY[i] = origin.y(); mOZ[i] = origin.z();
+	mDX[i] = direction.x(); mDY[i] = direction.y(); mDZ[i] = direction.z();
+	mInvDX[i] = reciprocal( mDX[i] ); mInvDY[i] = reciprocal( mDY[i] ); mInvDZ[i] = reciprocal( mDZ[i] );
+	mLength[i] = length;
+}
+
+
+void RayPacket::unset( int i )
+{
+	// a negative length never passes the distance tests
+	mOX[i] = mOY[i] = mOZ[i] = 0.0f;
+	mDX[i] = mDY[i] = mDZ[i] = 0.0f;
+	mInvDX[i] = mInvDY[i] = mInvDZ[i] = FLT_MAX;
+	mLength[i] = -1.0f;
+}
+
+
+#ifdef __SSE__
+
+int RayPacket::clipBox( const QVector3D & minimum, const QVector3D & maximum, float * enter ) const
+{
+	__m128 tEnter = _mm_setzero_ps();
+	__m128 tExit = _mm_loadu_ps( mLength );
+
+	const float * origins[3] = { mOX, mOY, mOZ };
+	const float * inverse[3] = { mInvDX, mInvDY, mInvDZ };
+	const float lower[3] = { (float)minimum.x(), (float)minimum.y(), (float)minimum.z() };
+	const float upper[3] = { (float)maximum.x(), (float)maximum.y(), (float)maximum.z() };
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		const __m128 o = _mm_loadu_ps( origins[axis] );
+		const __m128 inv = _mm_loadu_ps( inverse[axis] );
+		const __m128 t0 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( lower[axis] ), o ), inv );
+		const __m128 t1 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( upper[axis] ), o ), inv );
+		tEnter = _mm_max_ps( tEnter, _mm_min_ps( t0, t1 ) );
+		tExit = _mm_min_ps( tExit, _mm_max_ps( t0, t1 ) );
+	}
+
+	_mm_storeu_ps( enter, tEnter );
+	return _mm_movemask_ps( _mm_cmple_ps( tEnter, tExit ) );
+}
+
+
+int RayPacket::intersectSphere( const QVector3D & center, float radius ) const
+{
+	// nearest point of each line segment to the center
+	const __m128 cx = _mm_sub_ps( _mm_set1_ps( center.x() ), _mm_loadu_ps( mOX ) );
+	const __m128 cy = _mm_sub_ps( _mm_set1_ps( center.y() ), _mm_loadu_ps( mOY ) );
+	const __m128 cz = _mm_sub_ps( _mm_set1_ps( center.z() ), _mm_loadu_ps( mOZ ) );
+	const __m128 dx = _mm_loadu_ps( mDX );
+	const __m128 dy = _mm_loadu_ps( mDY );
+	const __m128 dz = _mm_loadu_ps( mDZ );
+	const __m128 length = _mm_loadu_ps( mLength );
+
+	const __m128 along = _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, dx ), _mm_mul_ps( cy, dy ) ), _mm_mul_ps( cz, dz ) );
+	const __m128 dd = _mm_max_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ), _mm_set1_ps( FLT_EPSILON ) );
+	const __m128 t = _mm_min_ps( _mm_max_ps( _mm_div_ps( along, dd ), _mm_setzero_ps() ), length );
+
+	const __m128 px = _mm_sub_ps( cx, _mm_mul_ps( dx, t ) );
+	const __m128 py = _mm_sub_ps( cy, _mm_mul_ps( dy, t ) );
+	const __m128 pz = _mm_sub_ps( cz, _mm_mul_ps( dz, t ) );
+	const __m128 distanceSquared = _mm_add_ps( _mm_add_ps( _mm_mul_ps( px, px ), _mm_mul_ps( py, py ) ), _mm_mul_ps( pz, pz ) );
+
+	const __m128 mask = _mm_and_ps(
+		_mm_cmple_ps( distanceSquared, _mm_set1_ps( radius * radius ) ),
+		_mm_cmpge_ps( length, _mm_setzero_ps() ) );
+	return _mm_movemask_ps( mask );
+}
+
+
+int RayPacket::intersectTriangle( const QVector3D & p, const QVector3D & q, const QVector3D & r )
+{
+	const __m128 e1x = _mm_set1_ps( q.x()-p.x() );
+	const __m128 e1y = _mm_set1_ps( q.y()-p.y() );
+	const __m128 e1z = _mm_set1_ps( q.z()-p.z() );
+	const __m128 e2x = _mm_set1_ps( r.x()-p.x() );
+	const __m128 e2y = _mm_set1_ps( r.y()-p.y() );
+	const __m128 e2z = _mm_set1_ps( r.z()-p.z() );
+	const __m128 dx = _mm_loadu_ps( mDX );
+	const __m128 dy = _mm_loadu_ps( mDY );
+	const __m128 dz = _mm_loadu_ps( mDZ );
+	const __m128 zero = _mm_setzero_ps();
+
+	// pVec = direction x edge2
+	const __m128 px = _mm_sub_ps( _mm_mul_ps( dy, e2z ), _mm_mul_ps( dz, e2y ) );
+	const __m128 py = _mm_sub_ps( _mm_mul_ps( dz, e2x ), _mm_mul_ps( dx, e2z ) );
+	const __m128 pz = _mm_sub_ps( _mm_mul_ps( dx, e2y ), _mm_mul_ps( dy, e2x ) );
+
+	const __m128 det = _mm_add_ps( _mm_add_ps( _mm_mul_ps( e1x, px ), _mm_mul_ps( e1y, py ) ), _mm_mul_ps( e1z, pz ) );
+	__m128 mask = _mm_cmpgt_ps( det, _mm_set1_ps( FLT_EPSILON ) );
+	if( !_mm_movemask_ps( mask ) )
+		return 0;
+
+	// tVec = origin - p
+	const __m128 tx = _mm_sub_ps( _mm_loadu_ps( mOX ), _mm_set1_ps( p.x() ) );
+	const __m128 ty = _mm_sub_ps( _mm_loadu_ps( mOY ), _mm_set1_ps( p.y() ) );
+	const __m128 tz = _mm_sub_ps( _mm_loadu_ps( mOZ ), _mm_set1_ps( p.z() ) );
+
+	const __m128 u = _mm_add_ps( _mm_add_ps( _mm_mul_ps( tx, px ), _mm_mul_ps( ty, py ) ), _mm_mul_ps( tz, pz ) );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpge_ps( u, zero ), _mm_cmple_ps( u, det ) ) );
+	if( !_mm_movemask_ps( mask ) )
+		return 0;
+
+	// qVec = tVec x edge1
+	const __m128 qx = _mm_sub_ps( _mm_mul_ps( ty, e1z ), _mm_mul_ps( tz, e1y ) );
+	const __m128 qy = _mm_sub_ps( _mm_mul_ps( tz, e1x ), _mm_mul_ps( tx, e1z ) );
+	const __m128 qz = _mm_sub_ps( _mm_mul_ps( tx, e1y ), _mm_mul_ps( ty, e1x ) );
+
+	const __m128 v = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, qx ), _mm_mul_ps( dy, qy ) ), _mm_mul_ps( dz, qz ) );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpge_ps( v, zero ), _mm_cmple_ps( _mm_add_ps( u, v ), det ) ) );
+	if( !_mm_movemask_ps( mask ) )
+		return 0;
+
+	const __m128 length = _mm_loadu_ps( mLength );
+	const __m128 t = _mm_div_ps(
+		_mm_add_ps( _mm_add_ps( _mm_mul_ps( e2x, qx ), _mm_mul_ps( e2y, qy ) ), _mm_mul_ps( e2z, qz ) ), det );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpgt_ps( t, zero ), _mm_cmplt_ps( t, length ) ) );
+	_mm_storeu_ps( mLength, _mm_or_ps( _mm_and_ps( mask, t ), _mm_andnot_ps( mask, length ) ) );
+	return _mm_movemask_ps( mask );
+}
+
+#else
+
+int RayPacket::clipBox( const QVector3D & minimum, const QVector3D & maximum, float * enter ) const
+{
+	const float * origins[3] = { mOX, mOY, mOZ };
+	const float * inverse[3] = { mInvDX, mInvDY, mInvDZ };
+	const float lower[3] = { (float)minimum.x(), (float)minimum.y(), (float)minimum.z() };
+	const float upper[3] = { (float)maximum.x(), (float)maximum.y(), (float)maximum.z() };
+	int mask = 0;
+	for( int i = 0; i < size; ++i )
+	{
+		float tEnter = 0.0f;
+		float tExit = mLength[i];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			float t0 = ( lower[axis] - origins[axis][i] ) * inverse[axis][i];
+			float t1 = ( upper[axis] - origins[axis][i] ) * inverse[axis][i];
+			tEnter = qMax( tEnter, qMin( t0, t1 ) );
+			tExit = qMin( tExit, qMax( t0, t1 ) );
+		}
+		enter[i] = tEnter;
+		if( tEnter <= tExit )
+			mask |= 1 << i;
+	}
+	return mask;
+}
+
+
+int RayPacket::intersectSphere( const QVector3D & center, float radius ) const
+{
+	int mask = 0;
+	for( int i = 0; i < size; ++i )
+	{
+		if( mLength[i] < 0.0f )
+			continue;
+		// nearest point of the line segment to the center
+		const QVector3D toCenter = center - origin( i );
+		const QVector3D d = direction( i );
+		const float t = qBound( 0.0f, QVector3D::dotProduct( toCenter, d ) / qMax( d.lengthSquared(), FLT_EPSILON ), mLength[i] );
+		if( ( toCenter - d*t ).lengthSquared() <= radius*radius )
+			mask |= 1 << i;
+	}
+	return mask;
+}
+
+
+int RayPacket::intersectTriangle( const QVector3D & p, const QVector3D & q, const QVector3D & r )
+{
+	const QVector3D edge1 = q - p;
+	const QVector3D edge2 = r - p;
+	int mask = 0;
+	for( int i = 0; i < size; ++i )
+	{
+		const QVector3D d = direction( i );
+		QVector3D pVec = QVector3D::crossProduct( d, edge2 );
+		float det = QVector3D::dotProduct( edge1, pVec );
+		if( det <= FLT_EPSILON )
+			continue;
+		QVector3D tVec = origin( i ) - p;
+		float u = QVector3D::dotProduct( tVec, pVec );
+		if( u < 0.0f || u > det )
+			continue;
+		QVector3D qVec = QVector3D::crossProduct( tVec, edge1 );
+		float v = QVector3D::dotProduct( d, qVec );
+		if( v < 0.0f || u+v > det )
+			continue;
+		float t = QVector3D::dotProduct( edge2, qVec ) / det;
+		if( t > 0.0f && t < mLength[i] )
+		{
+			mLength[i] = t;
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+}
+
+#endif
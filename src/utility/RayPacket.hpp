@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_RAYPACKET_INCLUDED
+#define UTILITY_RAYPACKET_INCLUDED
+
+#include <QVector3D>
+
+
+/// Four rays tested against a primitive at once
+/**
+ * The counterpart of TrianglePacket - the rays are stored as a structure of arrays,
+ * so boxes, spheres and triangles are tested against all four of them in parallel using SSE where available.\n
+ * Every test returns a bit mask with one bit per slot.
+ * Empty slots never hit anything.
+ */
+class RayPacket
+{
+public:
+	static const int size = 4;
+
+	/// Creates a packet without any rays
+	RayPacket() { clear(); }
+
+	/// Removes all rays
+	void clear();
+	/// Sets the ray in the given slot
+	void set( int i, const QVector3D & origin, const QVector3D & direction, float length );
+	/// Removes the ray in the given slot
+	void unset( int i );
+
+	QVector3D origin( int i ) const { return QVector3D( mOX[i], mOY[i], mOZ[i] ); }
+	QVector3D direction( int i ) const { return QVector3D( mDX[i], mDY[i], mDZ[i] ); }
+	float length( int i ) const { return mLength[i]; }
+	/// Shortens the ray in the given slot - e.g. after it was intersected separately
+	void setLength( int i, float length ) { mLength[i] = length; }
+
+	/// Clips the rays to an axis aligned box
+	/**
+	 * @param minimum The corner of the box with the smallest coordinates.
+	 * @param maximum The corner of the box with the largest coordinates.
+	 * @param enter Receives the distance at which each ray enters the box - 0 if it starts inside.
+	 * @return The rays passing the box in front of their origin and closer than their length.
+	 */
+	int clipBox( const QVector3D & minimum, const QVector3D & maximum, float * enter ) const;
+	/// Tests the rays against a sphere
+	/**
+	 * @return The rays passing the sphere closer than their length or starting inside of it.
+	 */
+	int intersectSphere( const QVector3D & center, float radius ) const;
+	/// Intersects the rays with a triangle
+	/**
+	 * Like Triangle::intersectRay() only front faces are hit.
+	 * @return The rays hitting the triangle - their length is set to the distance to the intersection.
+	 */
+	int intersectTriangle( const QVector3D & p, const QVector3D & q, const QVector3D & r );
+
+private:
+	float mOX[size], mOY[size], mOZ[size];
+	float mDX[size], mDY[size], mDZ[size];
+	/// Reciprocal direction for the slab test - very large instead of infinite for axis parallel rays
+	float mInvDX[size], mInvDY[size], mInvDZ[size];
+	/// Negative for empty slots
+	float mLength[size];
+};
+
+
+#endif
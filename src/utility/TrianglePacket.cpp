@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrianglePacket.hpp"
+
+#include <float.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+void TrianglePacket::clear()
+{
+	for( int i = 0; i < size; ++i )
+		unset( i );
+}
+
+
+void TrianglePacket::set( int i, const QVector3D & p, const QVector3D & q, const QVector3D & r )
+{
+	mPX[i] = p.x(); mPY[i] = p.y(); mPZ[i] = p.z();
+	mE1X[i] = q.x()-p.x(); mE1Y[i] = q.y()-p.y(); mE1Z[i] = q.z()-p.z();
+	mE2X[i] = r.x()-p.x(); mE2Y[i] = r.y()-p.y(); mE2Z[i] = r.z()-p.z();
+}
+
+
+void TrianglePacket::unset( int i )
+{
+	// degenerated edges never pass the determinant test
+	mPX[i] = mPY[i] = mPZ[i] = 0.0f;
+	mE1X[i] = mE1Y[i] = mE1Z[i] = 0.0f;
+	mE2X[i] = mE2Y[i] = mE2Z[i] = 0.0f;
+}
+
+
+#ifdef __SSE__
+
+int TrianglePacket::intersectRay( const QVector3D & origin, const QVector3D & direction, float & length ) const
+{
+	const __m128 dx = _mm_set1_ps( direction.x() );
+	const __m128 dy = _mm_set1_ps( direction.y() );
+	const __m128 dz = _mm_set1_ps( direction.z() );
+	const __m128 e1x = _mm_loadu_ps( mE1X );
+	const __m128 e1y = _mm_loadu_ps( mE1Y );
+	const __m128 e1z = _mm_loadu_ps( mE1Z );
+	const __m128 e2x = _mm_loadu_ps( mE2X );
+	const __m128 e2y = _mm_loadu_ps( mE2Y );
+	const __m128 e2z = _mm_loadu_ps( mE2Z );
+	const __m128 zero = _mm_setzero_ps();
+
+	// pVec = direction x edge2
+	const __m128 px = _mm_sub_ps( _mm_mul_ps( dy, e2z ), _mm_mul_ps( dz, e2y ) );
+	const __m128 py = _mm_sub_ps( _mm_mul_ps( dz, e2x ), _mm_mul_ps( dx, e2z ) );
+	const __m128 pz = _mm_sub_ps( _mm_mul_ps( dx, e2y ), _mm_mul_ps( dy, e2x ) );
+
+	const __m128 det = _mm_add_ps( _mm_add_ps( _mm_mul_ps( e1x, px ), _mm_mul_ps( e1y, py ) ), _mm_mul_ps( e1z, pz ) );
+	__m128 mask = _mm_cmpgt_ps( det, _mm_set1_ps( FLT_EPSILON ) );
+	if( !_mm_movemask_ps( mask ) )
+		return -1;
+
+	// tVec = origin - p
+	const __m128 tx = _mm_sub_ps( _mm_set1_ps( origin.x() ), _mm_loadu_ps( mPX ) );
+	const __m128 ty = _mm_sub_ps( _mm_set1_ps( origin.y() ), _mm_loadu_ps( mPY ) );
+	const __m128 tz = _mm_sub_ps( _mm_set1_ps( origin.z() ), _mm_loadu_ps( mPZ ) );
+
+	const __m128 u = _mm_add_ps( _mm_add_ps( _mm_mul_ps( tx, px ), _mm_mul_ps( ty, py ) ), _mm_mul_ps( tz, pz ) );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpge_ps( u, zero ), _mm_cmple_ps( u, det ) ) );
+	if( !_mm_movemask_ps( mask ) )
+		return -1;
+
+	// qVec = tVec x edge1
+	const __m128 qx = _mm_sub_ps( _mm_mul_ps( ty, e1z ), _mm_mul_ps( tz, e1y ) );
+	const __m128 qy = _mm_sub_ps( _mm_mul_ps( tz, e1x ), _mm_mul_ps( tx, e1z ) );
+	const __m128 qz = _mm_sub_ps( _mm_mul_ps( tx, e1y ), _mm_mul_ps( ty, e1x ) );
+
+	const __m128 v = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, qx ), _mm_mul_ps( dy, qy ) ), _mm_mul_ps( dz, qz ) );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpge_ps( v, zero ), _mm_cmple_ps( _mm_add_ps( u, v ), det ) ) );
+	if( !_mm_movemask_ps( mask ) )
+		return -1;
+
+	const __m128 t = _mm_div_ps(
+		_mm_add_ps( _mm_add_ps( _mm_mul_ps( e2x, qx ), _mm_mul_ps( e2y, qy ) ), _mm_mul_ps( e2z, qz ) ), det );
+	mask = _mm_and_ps( mask, _mm_and_ps( _mm_cmpgt_ps( t, zero ), _mm_cmplt_ps( t, _mm_set1_ps( length ) ) ) );
+	int hits = _mm_movemask_ps( mask );
+	if( !hits )
+		return -1;
+
+	float distances[size];
+	_mm_storeu_ps( distances, t );
+	int nearest = -1;
+	for( int i = 0; i < size; ++i )
+	{
+		if( ( hits & (1<<i) ) && distances[i] < length )
+		{
+			length = distances[i];
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+#else
+
+int TrianglePacket::intersectRay( const QVector3D & origin, const QVector3D & direction, float & length ) const
+{
+	int nearest = -1;
+	for( int i = 0; i < size; ++i )
+	{
+		QVector3D edge1( mE1X[i], mE1Y[i], mE1Z[i] );
+		QVector3D edge2( mE2X[i], mE2Y[i], mE2Z[i] );
+		QVector3D pVec = QVector3D::crossProduct( direction, edge2 );
+		float det = QVector3D::dotProduct( edge1, pVec );
+		if( det <= FLT_EPSILON )
+			continue;
+		QVector3D tVec = origin - QVector3D( mPX[i], mPY[i], mPZ[i] );
+		float u = QVector3D::dotProduct( tVec, pVec );
+		if( u < 0.0f || u > det )
+			continue;
+		QVector3D qVec = QVector3D::crossProduct( tVec, edge1 );
+		float v = QVector3D::dotProduct( direction, qVec );
+		if( v < 0.0f || u+v > det )
+			continue;
+		float t = QVector3D::dotProduct( edge2, qVec ) / det;
+		if( t > 0.0f && t < length )
+		{
+			length = t;
+			nearest = i;
+		}
+	}
+	return nearest;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2013
+ * Branimir Djordjevic <branimir.djordjevic@gmail.com>
+ * Tobias Himmer <provisorisch@online.de>
+ * Michael Wydler <michael.wydler@gmail.com>
+ * Karl-Heinz Zimmermann <karlzimmermann3787@gmail.com>
+ *
+ * This file is part of Splatterlinge.
+ *
+ * Splatterlinge is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * Splatterlinge is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splatterlinge. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UTILITY_TRIANGLEPACKET_INCLUDED
+#define UTILITY_TRIANGLEPACKET_INCLUDED
+
+#include <QVector3D>
+
+
+/// Four triangles tested against a ray at once
+/**
+ * The triangles are stored as a structure of arrays so the Möller–Trumbore test
+ * runs on all four of them in parallel using SSE where available.\n
+ * Like Triangle::intersectRay() only front faces are hit.
+ */
+class TrianglePacket
+{
+public:
+	static const int size = 4;
+
+	/// Creates a packet without any triangles
+	TrianglePacket() { clear(); }
+
+	/// Removes all triangles
+	void clear();
+	/// Sets the triangle in the given slot
+	void set( int i, const QVector3D & p, const QVector3D & q, const QVector3D & r );
+	/// Removes the triangle in the given slot
+	void unset( int i );
+
+	/// Intersects a ray with all triangles
+	/**
+	 * @param origin The origin of the ray.
+	 * @param direction The direction of the ray.
+	 * @param length Only intersections in front of the origin and closer than length are reported -
+	 *  set to the distance to the nearest intersection.
+	 * @return The slot of the nearest intersected triangle or -1.
+	 */
+	int intersectRay( const QVector3D & origin, const QVector3D & direction, float & length ) const;
+
+private:
+	float mPX[size], mPY[size], mPZ[size];
+	float mE1X[size], mE1Y[size], mE1Z[size];
+	float mE2X[size], mE2Y[size], mE2Z[size];
+};
+
+
+#endif